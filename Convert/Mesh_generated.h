@@ -10,6 +10,12 @@ namespace Mesh {
 
 struct Vec3;
 
+struct Box;
+
+struct Meshlet;
+
+struct SubMesh;
+
 struct Mesh;
 
 struct Meshes;
@@ -30,15 +36,73 @@ MANUALLY_ALIGNED_STRUCT(4) Vec3 FLATBUFFERS_FINAL_CLASS {
 };
 STRUCT_END(Vec3, 12);
 
+MANUALLY_ALIGNED_STRUCT(4) Box FLATBUFFERS_FINAL_CLASS {
+ private:
+  Vec3 Min_;
+  Vec3 Max_;
+
+ public:
+  Box(const Vec3 &_Min, const Vec3 &_Max)
+    : Min_(_Min), Max_(_Max) { }
+
+  const Vec3 &Min() const { return Min_; }
+  const Vec3 &Max() const { return Max_; }
+};
+STRUCT_END(Box, 24);
+
+MANUALLY_ALIGNED_STRUCT(4) Meshlet FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t FirstTriangle_;
+  uint32_t NumTriangles_;
+  Box Bounds_;
+
+ public:
+  Meshlet(uint32_t _FirstTriangle, uint32_t _NumTriangles, const Box &_Bounds)
+    : FirstTriangle_(flatbuffers::EndianScalar(_FirstTriangle)), NumTriangles_(flatbuffers::EndianScalar(_NumTriangles)), Bounds_(_Bounds) { }
+
+  uint32_t FirstTriangle() const { return flatbuffers::EndianScalar(FirstTriangle_); }
+  uint32_t NumTriangles() const { return flatbuffers::EndianScalar(NumTriangles_); }
+  const Box &Bounds() const { return Bounds_; }
+};
+STRUCT_END(Meshlet, 32);
+
+MANUALLY_ALIGNED_STRUCT(4) SubMesh FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t FirstVertex_;
+  uint32_t NumVertices_;
+  Box Bounds_;
+
+ public:
+  SubMesh(uint32_t _FirstVertex, uint32_t _NumVertices, const Box &_Bounds)
+    : FirstVertex_(flatbuffers::EndianScalar(_FirstVertex)), NumVertices_(flatbuffers::EndianScalar(_NumVertices)), Bounds_(_Bounds) { }
+
+  uint32_t FirstVertex() const { return flatbuffers::EndianScalar(FirstVertex_); }
+  uint32_t NumVertices() const { return flatbuffers::EndianScalar(NumVertices_); }
+  const Box &Bounds() const { return Bounds_; }
+};
+STRUCT_END(SubMesh, 32);
+
 struct Mesh FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   enum {
     VT_POSITIONS = 4,
     VT_NORMALS = 6,
-    VT_INDICES = 8
+    VT_INDICES = 8,
+    VT_BOUNDS = 10,
+    VT_QUANTIZEDPOSITIONS = 12,
+    VT_OCTAHEDRALNORMALS = 14,
+    VT_SHORTINDICES = 16,
+    VT_MESHLETS = 18,
+    VT_SUBMESHES = 20
   };
   const flatbuffers::Vector<const Vec3 *> *Positions() const { return GetPointer<const flatbuffers::Vector<const Vec3 *> *>(VT_POSITIONS); }
   const flatbuffers::Vector<const Vec3 *> *Normals() const { return GetPointer<const flatbuffers::Vector<const Vec3 *> *>(VT_NORMALS); }
   const flatbuffers::Vector<uint32_t> *Indices() const { return GetPointer<const flatbuffers::Vector<uint32_t> *>(VT_INDICES); }
+  const Box *Bounds() const { return GetStruct<const Box *>(VT_BOUNDS); }
+  const flatbuffers::Vector<uint16_t> *QuantizedPositions() const { return GetPointer<const flatbuffers::Vector<uint16_t> *>(VT_QUANTIZEDPOSITIONS); }
+  const flatbuffers::Vector<int16_t> *OctahedralNormals() const { return GetPointer<const flatbuffers::Vector<int16_t> *>(VT_OCTAHEDRALNORMALS); }
+  const flatbuffers::Vector<uint16_t> *ShortIndices() const { return GetPointer<const flatbuffers::Vector<uint16_t> *>(VT_SHORTINDICES); }
+  const flatbuffers::Vector<const Meshlet *> *Meshlets() const { return GetPointer<const flatbuffers::Vector<const Meshlet *> *>(VT_MESHLETS); }
+  const flatbuffers::Vector<const SubMesh *> *SubMeshes() const { return GetPointer<const flatbuffers::Vector<const SubMesh *> *>(VT_SUBMESHES); }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, VT_POSITIONS) &&
@@ -47,6 +111,17 @@ struct Mesh FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.Verify(Normals()) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, VT_INDICES) &&
            verifier.Verify(Indices()) &&
+           VerifyField<Box>(verifier, VT_BOUNDS) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_QUANTIZEDPOSITIONS) &&
+           verifier.Verify(QuantizedPositions()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_OCTAHEDRALNORMALS) &&
+           verifier.Verify(OctahedralNormals()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_SHORTINDICES) &&
+           verifier.Verify(ShortIndices()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_MESHLETS) &&
+           verifier.Verify(Meshlets()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_SUBMESHES) &&
+           verifier.Verify(SubMeshes()) &&
            verifier.EndTable();
   }
 };
@@ -57,10 +132,16 @@ struct MeshBuilder {
   void add_Positions(flatbuffers::Offset<flatbuffers::Vector<const Vec3 *>> Positions) { fbb_.AddOffset(Mesh::VT_POSITIONS, Positions); }
   void add_Normals(flatbuffers::Offset<flatbuffers::Vector<const Vec3 *>> Normals) { fbb_.AddOffset(Mesh::VT_NORMALS, Normals); }
   void add_Indices(flatbuffers::Offset<flatbuffers::Vector<uint32_t>> Indices) { fbb_.AddOffset(Mesh::VT_INDICES, Indices); }
+  void add_Bounds(const Box *Bounds) { fbb_.AddStruct(Mesh::VT_BOUNDS, Bounds); }
+  void add_QuantizedPositions(flatbuffers::Offset<flatbuffers::Vector<uint16_t>> QuantizedPositions) { fbb_.AddOffset(Mesh::VT_QUANTIZEDPOSITIONS, QuantizedPositions); }
+  void add_OctahedralNormals(flatbuffers::Offset<flatbuffers::Vector<int16_t>> OctahedralNormals) { fbb_.AddOffset(Mesh::VT_OCTAHEDRALNORMALS, OctahedralNormals); }
+  void add_ShortIndices(flatbuffers::Offset<flatbuffers::Vector<uint16_t>> ShortIndices) { fbb_.AddOffset(Mesh::VT_SHORTINDICES, ShortIndices); }
+  void add_Meshlets(flatbuffers::Offset<flatbuffers::Vector<const Meshlet *>> Meshlets) { fbb_.AddOffset(Mesh::VT_MESHLETS, Meshlets); }
+  void add_SubMeshes(flatbuffers::Offset<flatbuffers::Vector<const SubMesh *>> SubMeshes) { fbb_.AddOffset(Mesh::VT_SUBMESHES, SubMeshes); }
   MeshBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
   MeshBuilder &operator=(const MeshBuilder &);
   flatbuffers::Offset<Mesh> Finish() {
-    auto o = flatbuffers::Offset<Mesh>(fbb_.EndTable(start_, 3));
+    auto o = flatbuffers::Offset<Mesh>(fbb_.EndTable(start_, 9));
     return o;
   }
 };
@@ -68,8 +149,20 @@ struct MeshBuilder {
 inline flatbuffers::Offset<Mesh> CreateMesh(flatbuffers::FlatBufferBuilder &_fbb,
    flatbuffers::Offset<flatbuffers::Vector<const Vec3 *>> Positions = 0,
    flatbuffers::Offset<flatbuffers::Vector<const Vec3 *>> Normals = 0,
-   flatbuffers::Offset<flatbuffers::Vector<uint32_t>> Indices = 0) {
+   flatbuffers::Offset<flatbuffers::Vector<uint32_t>> Indices = 0,
+   const Box *Bounds = 0,
+   flatbuffers::Offset<flatbuffers::Vector<uint16_t>> QuantizedPositions = 0,
+   flatbuffers::Offset<flatbuffers::Vector<int16_t>> OctahedralNormals = 0,
+   flatbuffers::Offset<flatbuffers::Vector<uint16_t>> ShortIndices = 0,
+   flatbuffers::Offset<flatbuffers::Vector<const Meshlet *>> Meshlets = 0,
+   flatbuffers::Offset<flatbuffers::Vector<const SubMesh *>> SubMeshes = 0) {
   MeshBuilder builder_(_fbb);
+  builder_.add_SubMeshes(SubMeshes);
+  builder_.add_Meshlets(Meshlets);
+  builder_.add_ShortIndices(ShortIndices);
+  builder_.add_OctahedralNormals(OctahedralNormals);
+  builder_.add_QuantizedPositions(QuantizedPositions);
+  builder_.add_Bounds(Bounds);
   builder_.add_Indices(Indices);
   builder_.add_Normals(Normals);
   builder_.add_Positions(Positions);
@@ -78,14 +171,17 @@ inline flatbuffers::Offset<Mesh> CreateMesh(flatbuffers::FlatBufferBuilder &_fbb
 
 struct Meshes FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   enum {
-    VT_OBJECTS = 4
+    VT_OBJECTS = 4,
+    VT_VERSION = 6
   };
   const flatbuffers::Vector<flatbuffers::Offset<Mesh>> *Objects() const { return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<Mesh>> *>(VT_OBJECTS); }
+  uint32_t Version() const { return GetField<uint32_t>(VT_VERSION, 1); }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, VT_OBJECTS) &&
            verifier.Verify(Objects()) &&
            verifier.VerifyVectorOfTables(Objects()) &&
+           VerifyField<uint32_t>(verifier, VT_VERSION) &&
            verifier.EndTable();
   }
 };
@@ -94,17 +190,20 @@ struct MeshesBuilder {
   flatbuffers::FlatBufferBuilder &fbb_;
   flatbuffers::uoffset_t start_;
   void add_Objects(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mesh>>> Objects) { fbb_.AddOffset(Meshes::VT_OBJECTS, Objects); }
+  void add_Version(uint32_t Version) { fbb_.AddElement<uint32_t>(Meshes::VT_VERSION, Version, 1); }
   MeshesBuilder(flatbuffers::FlatBufferBuilder &_fbb) : fbb_(_fbb) { start_ = fbb_.StartTable(); }
   MeshesBuilder &operator=(const MeshesBuilder &);
   flatbuffers::Offset<Meshes> Finish() {
-    auto o = flatbuffers::Offset<Meshes>(fbb_.EndTable(start_, 1));
+    auto o = flatbuffers::Offset<Meshes>(fbb_.EndTable(start_, 2));
     return o;
   }
 };
 
 inline flatbuffers::Offset<Meshes> CreateMeshes(flatbuffers::FlatBufferBuilder &_fbb,
-   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mesh>>> Objects = 0) {
+   flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Mesh>>> Objects = 0,
+   uint32_t Version = 1) {
   MeshesBuilder builder_(_fbb);
+  builder_.add_Version(Version);
   builder_.add_Objects(Objects);
   return builder_.Finish();
 }
@@ -0,0 +1,161 @@
+#include "Approximation.h"
+
+#include "Makros.h"
+#include "Morton.h"
+#include "Platform.h"
+#include "TreeNode.h"
+
+float3 UintToFloat3( uint32_t val ) {
+	float3 out;
+	out.x = ( val & 1023 ) / 1023.f;
+	out.y = ( ( val >> 10 ) & 1023 ) / 1023.f;
+	out.z = ( ( val >> 20 ) & 1023 ) / 1023.f;
+	return out;
+}
+
+uint32_t Float3ToUint( float3 val ) {
+	uint32_t x = static_cast<uint32_t>( Min( val.x, 1.f ) * 1023.f );
+	uint32_t y = static_cast<uint32_t>( Min( val.y, 1.f ) * 1023.f );
+	uint32_t z = static_cast<uint32_t>( Min( val.z, 1.f ) * 1023.f );
+
+	return ( z << 20 ) + ( y << 10 ) + x;
+}
+
+uint32_t GetAnisotropicValue( uint2 uiBrick ) {
+	float3 value = float3( 0.f, 0.f, 0.f );
+	// X-Face
+	for( uint32_t i : { 0, 2, 4, 6, 16, 20, 18, 22 } ) {
+		if( uiBrick.x & ( 0x303 << i ) )
+			value.x += 1.f / 16.f;
+		if( uiBrick.y & ( 0x303 << i ) )
+			value.x += 1.f / 16.f;
+	}
+	//Y-Face
+	for( uint32_t j : { 0, 1, 4, 5, 8, 9, 12, 13 } ) {
+		if( uiBrick.x & ( 0x50005 << j ) )
+			value.y += 1.f / 16.f;
+		if( uiBrick.y & ( 0x50005 << j ) )
+			value.y += 1.f / 16.f;
+	}
+	// Z-Face
+	for( uint32_t k : { 0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27 } ) {
+		if( uiBrick.x & ( 0x11 << k ) || uiBrick.y & ( 0x11 << k ) )
+			value.z += 1.f / 16.f;
+	}
+
+	return Float3ToUint( value );
+}
+
+uint32_t GetInnerApproxVal( const Node& node, const uint32_t* approx, const uint32_t* pointer ) {
+	float3 approxVal = { 0.f, 0.f, 0.f };
+	for( uint32_t z = 0; z < 4; z++ ) {
+		for( uint32_t y = 0; y < 4; y++ ) {
+			float sum = 0.f;
+			for( uint32_t x = 0; x < 4; x++ ) {
+				uint32_t mortonPos = MortonEncode( { x,y,z } );
+
+				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
+				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
+				if( data & ( 1 << dataPos ) ) {
+					// offset determined via counting of previous set bits
+					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
+					uint32_t offset = __popcnt( data & compVal );
+					if( mortonPos > 31 )
+						offset += __popcnt( node.Data.x );
+
+					uint32_t ptr = pointer[node.Pointer + offset];
+					if( ptr == -1 )
+						sum = 1.f;
+					else
+						sum = Max( UintToFloat3( approx[ptr] ).x, sum );
+				}
+			}
+			approxVal.x += 1.f / 16.f * Min( sum, 1.f );
+		}
+	}
+
+	for( uint32_t z = 0; z < 4; z++ ) {
+		for( uint32_t x = 0; x < 4; x++ ) {
+			float sum = 0.f;
+			for( uint32_t y = 0; y < 4; y++ ) {
+				uint32_t mortonPos = MortonEncode( { x,y,z } );
+
+				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
+				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
+				if( data & ( 1 << dataPos ) ) {
+					// offset determined via counting of previous set bits
+					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
+					uint32_t offset = __popcnt( data & compVal );
+					if( mortonPos > 31 )
+						offset += __popcnt( node.Data.x );
+
+					uint32_t ptr = pointer[node.Pointer + offset];
+					if( ptr == -1 )
+						sum = 1.f;
+					else
+						sum = Max( UintToFloat3( approx[ptr] ).y, sum );
+				}
+			}
+			approxVal.y += 1.f / 16.f * Min( sum, 1.f );
+		}
+	}
+
+	for( uint32_t y = 0; y < 4; y++ ) {
+		for( uint32_t x = 0; x < 4; x++ ) {
+			float sum = 0.f;
+			for( uint32_t z = 0; z < 4; z++ ) {
+				uint32_t mortonPos = MortonEncode( { x,y,z } );
+
+				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
+				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
+				if( data & ( 1 << dataPos ) ) {
+					// offset determined via counting of previous set bits
+					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
+					uint32_t offset = __popcnt( data & compVal );
+					if( mortonPos > 31 )
+						offset += __popcnt( node.Data.x );
+
+					uint32_t ptr = pointer[node.Pointer + offset];
+					if( ptr == -1 )
+						sum = 1.f;
+					else
+						sum = Max( UintToFloat3( approx[ptr] ).z, sum );
+				}
+			}
+			approxVal.z += 1.f / 16.f * Min( sum, 1.f );
+		}
+	}
+	return Float3ToUint( approxVal );
+}
+
+void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t* approx ) {
+
+	for( uint32_t i = numNodes - 1; i != -1; i-- ) {
+		if( nodes[i].Pointer == 0 ) {
+			approx[i] = GetAnisotropicValue( nodes[i].Data );
+		}
+		else {
+			approx[i] = GetInnerApproxVal( nodes[i], approx, pointers );
+		}
+	}
+}
+
+void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, float* approx ) {
+	for( uint32_t i = numNodes - 1; i != -1; i-- ) {
+		if( nodes[i].Pointer == 0 ) {
+			approx[i] = Min( __popcnt( nodes[i].Data.x ) + __popcnt( nodes[i].Data.y ), 64u ) / 64.f;
+		}
+		else {
+			uint32_t numChildren = __popcnt( nodes[i].Data.x ) + __popcnt( nodes[i].Data.y );
+			float val = 0.f;
+			uint32_t ptr = nodes[i].Pointer;
+			for( uint32_t j = 0; j < numChildren; j++ ) {
+				if( pointers[ptr + j] == -1 )
+					val += 1.f;
+				else
+					val += approx[pointers[ptr + j]];
+			}
+			approx[i] = val / 64.f;
+		}
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "Types.h"
+
+struct Node;
+
+// values of the Approx buffer of TreeTraverse.hlsli, one per node. the float version is the filled part of the node,
+// the uint version the covered part of its projection along x, y and z packed like R10G10B10A2_Unorm for ANISOTROPIC.
+// children have higher indices than their parents, so the nodes are computed from the back
+void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, float* approx );
+void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t* approx );
+
+float3 UintToFloat3( uint32_t val );
+uint32_t Float3ToUint( float3 val );
+// anisotropic value of a brick and of an inner node from the values of its children
+uint32_t GetAnisotropicValue( uint2 uiBrick );
+uint32_t GetInnerApproxVal( const Node& node, const uint32_t* approx, const uint32_t* pointer );
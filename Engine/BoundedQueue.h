@@ -0,0 +1,54 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// blocking queue with a fixed capacity to connect two pipeline stages, the producer waits while it is full
+template<typename T>
+class BoundedQueue {
+public:
+	BoundedQueue( size_t capacity )
+		: m_Capacity( capacity ) {
+	}
+
+	void Push( T value ) {
+		std::unique_lock<std::mutex> lock( m_Mutex );
+		m_NotFull.wait( lock, [&]() {
+			return m_Queue.size() < m_Capacity || m_Closed;
+		} );
+		if( m_Closed )
+			return;
+		m_Queue.push_back( std::move( value ) );
+		m_NotEmpty.notify_one();
+	}
+
+	// returns false when the queue is closed and empty
+	bool Pop( T& value ) {
+		std::unique_lock<std::mutex> lock( m_Mutex );
+		m_NotEmpty.wait( lock, [&]() {
+			return !m_Queue.empty() || m_Closed;
+		} );
+		if( m_Queue.empty() )
+			return false;
+		value = std::move( m_Queue.front() );
+		m_Queue.pop_front();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	// no more elements get pushed, waiting consumers and producers return
+	void Close() {
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		m_Closed = true;
+		m_NotEmpty.notify_all();
+		m_NotFull.notify_all();
+	}
+private:
+	std::deque<T> m_Queue;
+	size_t m_Capacity;
+	bool m_Closed = false;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NotFull;
+	std::condition_variable m_NotEmpty;
+};
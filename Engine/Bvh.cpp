@@ -0,0 +1,271 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Makros.h"
+#include "Math.h"
+
+namespace {
+const uint32_t NumBins = 16;
+const uint32_t MaxLeafSize = 4;
+// sah costs of a node visit and a triangle test
+const float TraversalCost = 1.f;
+const float IntersectionCost = 1.f;
+// below this depth nodes are split in the middle, so the traversal stack is enough for every tree
+const uint32_t MaxSahDepth = 64;
+const uint32_t StackSize = 128;
+
+struct Bounds {
+	float3 Min = float3( FLT_MAX, FLT_MAX, FLT_MAX );
+	float3 Max = float3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+	void Grow( const float3& p ) {
+		Min = float3( ::Min( Min.x, p.x ), ::Min( Min.y, p.y ), ::Min( Min.z, p.z ) );
+		Max = float3( ::Max( Max.x, p.x ), ::Max( Max.y, p.y ), ::Max( Max.z, p.z ) );
+	}
+	void Grow( const Bounds& b ) {
+		Grow( b.Min );
+		Grow( b.Max );
+	}
+	// half the surface area
+	float Area() const {
+		if( Min.x > Max.x )
+			return 0.f;
+		float3 d = Max - Min;
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+};
+
+float GetAxis( const float3& v, uint32_t axis ) {
+	return axis == 0 ? v.x : ( axis == 1 ? v.y : v.z );
+}
+
+uint32_t GetBin( float centroid, float minCentroid, float scale ) {
+	return Min( static_cast<uint32_t>( ( centroid - minCentroid ) * scale ), NumBins - 1 );
+}
+
+// entry distance of the ray into the box, false if it misses it in [tNear, tFar]
+bool IntersectBox( const float3& boxMin, const float3& boxMax, const float3& origin, const float3& invDir, float tNear, float tFar, float& tEntry ) {
+	float3 t0 = ( boxMin - origin ) * invDir;
+	float3 t1 = ( boxMax - origin ) * invDir;
+	tEntry = Max( tNear, Max( Min( t0.x, t1.x ), Max( Min( t0.y, t1.y ), Min( t0.z, t1.z ) ) ) );
+	float tExit = Min( tFar, Min( Max( t0.x, t1.x ), Min( Max( t0.y, t1.y ), Max( t0.z, t1.z ) ) ) );
+	return tEntry <= tExit;
+}
+}
+
+void Bvh::AddMesh( const std::vector<float4a>& positions, const std::vector<uint3>& indices ) {
+	m_Triangles.reserve( m_Triangles.size() + indices.size() );
+	for( const uint3& index : indices ) {
+		float3 v0 = float3( positions[index.x].x, positions[index.x].y, positions[index.x].z );
+		float3 v1 = float3( positions[index.y].x, positions[index.y].y, positions[index.y].z );
+		float3 v2 = float3( positions[index.z].x, positions[index.z].y, positions[index.z].z );
+		m_Triangles.push_back( { v0, v1 - v0, v2 - v0 } );
+	}
+}
+
+void Bvh::Build() {
+	m_Nodes.clear();
+	uint32_t numTriangles = static_cast<uint32_t>( m_Triangles.size() );
+	if( numTriangles == 0 )
+		return;
+
+	std::vector<Bounds> bounds( numTriangles );
+	std::vector<float3> centroids( numTriangles );
+	std::vector<uint32_t> order( numTriangles );
+	for( uint32_t i = 0; i < numTriangles; i++ ) {
+		const Triangle& triangle = m_Triangles[i];
+		bounds[i].Grow( triangle.V0 );
+		bounds[i].Grow( triangle.V0 + triangle.Edge1 );
+		bounds[i].Grow( triangle.V0 + triangle.Edge2 );
+		centroids[i] = ( bounds[i].Min + bounds[i].Max ) * 0.5f;
+		order[i] = i;
+	}
+
+	m_Nodes.reserve( 2 * numTriangles );
+	m_Nodes.push_back( { float3(), 0, float3(), numTriangles } );
+	// node and its depth
+	std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+	while( !stack.empty() ) {
+		uint32_t nodeIdx = stack.back().first;
+		uint32_t depth = stack.back().second;
+		stack.pop_back();
+
+		uint32_t first = m_Nodes[nodeIdx].First;
+		uint32_t count = m_Nodes[nodeIdx].Count;
+		Bounds box, centroidBox;
+		for( uint32_t i = first; i < first + count; i++ ) {
+			box.Grow( bounds[order[i]] );
+			centroidBox.Grow( centroids[order[i]] );
+		}
+		m_Nodes[nodeIdx].BoxMin = box.Min;
+		m_Nodes[nodeIdx].BoxMax = box.Max;
+		if( count == 1 )
+			continue;
+
+		// costs are scaled by the area of the node, so there is no division
+		float bestCost = FLT_MAX;
+		uint32_t bestAxis = 3, bestBin = 0;
+		for( uint32_t axis = 0; axis < 3 && depth < MaxSahDepth; axis++ ) {
+			float minCentroid = GetAxis( centroidBox.Min, axis );
+			float extent = GetAxis( centroidBox.Max, axis ) - minCentroid;
+			if( !( extent > 0.f ) )
+				continue;
+			float scale = NumBins / extent;
+
+			Bounds binBounds[NumBins];
+			uint32_t binCounts[NumBins] = {};
+			for( uint32_t i = first; i < first + count; i++ ) {
+				uint32_t bin = GetBin( GetAxis( centroids[order[i]], axis ), minCentroid, scale );
+				binCounts[bin]++;
+				binBounds[bin].Grow( bounds[order[i]] );
+			}
+
+			// split b puts the bins below b to the left
+			float leftCosts[NumBins];
+			uint32_t leftCounts[NumBins];
+			Bounds left;
+			uint32_t numLeft = 0;
+			for( uint32_t b = 1; b < NumBins; b++ ) {
+				left.Grow( binBounds[b - 1] );
+				numLeft += binCounts[b - 1];
+				leftCosts[b] = left.Area() * numLeft;
+				leftCounts[b] = numLeft;
+			}
+			Bounds right;
+			uint32_t numRight = 0;
+			for( uint32_t b = NumBins - 1; b > 0; b-- ) {
+				right.Grow( binBounds[b] );
+				numRight += binCounts[b];
+				if( leftCounts[b] == 0 || numRight == 0 )
+					continue;
+				float cost = TraversalCost * box.Area() + IntersectionCost * ( leftCosts[b] + right.Area() * numRight );
+				if( cost < bestCost ) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		uint32_t middle;
+		if( bestAxis < 3 ) {
+			if( count <= MaxLeafSize && bestCost >= IntersectionCost * box.Area() * count )
+				continue;
+			float minCentroid = GetAxis( centroidBox.Min, bestAxis );
+			float scale = NumBins / ( GetAxis( centroidBox.Max, bestAxis ) - minCentroid );
+			auto split = std::partition( order.begin() + first, order.begin() + first + count, [&]( uint32_t triangle ) {
+				return GetBin( GetAxis( centroids[triangle], bestAxis ), minCentroid, scale ) < bestBin;
+			} );
+			middle = static_cast<uint32_t>( split - order.begin() );
+		}
+		else {
+			// all centroids are equal or the tree is too deep
+			if( count <= MaxLeafSize )
+				continue;
+			middle = first + count / 2;
+		}
+
+		uint32_t firstChild = static_cast<uint32_t>( m_Nodes.size() );
+		m_Nodes.push_back( { float3(), first, float3(), middle - first } );
+		m_Nodes.push_back( { float3(), middle, float3(), first + count - middle } );
+		m_Nodes[nodeIdx].First = firstChild;
+		m_Nodes[nodeIdx].Count = 0;
+		stack.push_back( { firstChild, depth + 1 } );
+		stack.push_back( { firstChild + 1, depth + 1 } );
+	}
+
+	std::vector<Triangle> sorted( numTriangles );
+	for( uint32_t i = 0; i < numTriangles; i++ )
+		sorted[i] = m_Triangles[order[i]];
+	m_Triangles.swap( sorted );
+}
+
+void Bvh::Clear() {
+	m_Nodes.clear();
+	m_Triangles.clear();
+}
+
+float Bvh::IntersectTriangle( const Triangle & triangle, const float3 & origin, const float3 & dir ) const {
+	// moeller trumbore
+	float3 p = Cross( dir, triangle.Edge2 );
+	float det = Dot( triangle.Edge1, p );
+	if( det == 0.f )
+		return -1.f;
+	float invDet = 1.f / det;
+	float3 s = origin - triangle.V0;
+	float u = Dot( s, p ) * invDet;
+	if( u < 0.f || u > 1.f )
+		return -1.f;
+	float3 q = Cross( s, triangle.Edge1 );
+	float v = Dot( dir, q ) * invDet;
+	if( v < 0.f || u + v > 1.f )
+		return -1.f;
+	return Dot( triangle.Edge2, q ) * invDet;
+}
+
+bool Bvh::Traverse( const float3 & origin, const float3 & dir, float tNear, float & tFar, uint32_t & triangle, bool anyHit ) const {
+	float3 invDir = float3( 1.f / dir.x, 1.f / dir.y, 1.f / dir.z );
+	float tEntry;
+	if( m_Nodes.empty() || !IntersectBox( m_Nodes[0].BoxMin, m_Nodes[0].BoxMax, origin, invDir, tNear, tFar, tEntry ) )
+		return false;
+
+	// nodes with their entry distance, the ones behind the closest hit get skipped
+	std::pair<uint32_t, float> stack[StackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, tEntry };
+	bool hit = false;
+	while( stackSize > 0 ) {
+		--stackSize;
+		if( stack[stackSize].second > tFar )
+			continue;
+		const Node* node = &m_Nodes[stack[stackSize].first];
+
+		// down to a leaf along the closer children
+		while( node->Count == 0 ) {
+			float tLeft, tRight;
+			bool hitLeft = IntersectBox( m_Nodes[node->First].BoxMin, m_Nodes[node->First].BoxMax, origin, invDir, tNear, tFar, tLeft );
+			bool hitRight = IntersectBox( m_Nodes[node->First + 1].BoxMin, m_Nodes[node->First + 1].BoxMax, origin, invDir, tNear, tFar, tRight );
+			if( hitLeft && hitRight ) {
+				uint32_t closer = tLeft <= tRight ? node->First : node->First + 1;
+				stack[stackSize++] = { closer == node->First ? node->First + 1 : node->First, Max( tLeft, tRight ) };
+				node = &m_Nodes[closer];
+			}
+			else if( hitLeft )
+				node = &m_Nodes[node->First];
+			else if( hitRight )
+				node = &m_Nodes[node->First + 1];
+			else
+				break;
+		}
+		if( node->Count == 0 )
+			continue;
+
+		for( uint32_t i = node->First; i < node->First + node->Count; i++ ) {
+			float t = IntersectTriangle( m_Triangles[i], origin, dir );
+			if( t >= tNear && t < tFar ) {
+				tFar = t;
+				triangle = i;
+				hit = true;
+				if( anyHit )
+					return true;
+			}
+		}
+	}
+	return hit;
+}
+
+bool Bvh::Intersect( const float3 & origin, const float3 & dir, float tNear, float & tFar, float3 & normal ) const {
+	uint32_t triangle;
+	if( !Traverse( origin, dir, tNear, tFar, triangle, false ) )
+		return false;
+	normal = Cross( m_Triangles[triangle].Edge2, m_Triangles[triangle].Edge1 );
+	return true;
+}
+
+bool Bvh::Occluded( const float3 & origin, const float3 & dir, float tNear, float tFar ) const {
+	uint32_t triangle;
+	return Traverse( origin, dir, tNear, tFar, triangle, true );
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "Types.h"
+
+// binned sah bvh over the triangles of the scene, the backend of the reference renderer when embree isn't available.
+// it only needs the math types, so it can trace meshes without a device
+class Bvh {
+public:
+	// appends the triangles of a mesh, Build has to be called afterwards
+	void AddMesh( const std::vector<float4a>& positions, const std::vector<uint3>& indices );
+	void Build();
+	void Clear();
+
+	// closest hit in [tNear, tFar], tFar becomes its distance. the normal is cross( v0 - v1, v2 - v0 ) like Ng of embree
+	bool Intersect( const float3& origin, const float3& dir, float tNear, float& tFar, float3& normal ) const;
+	// any hit in [tNear, tFar]
+	bool Occluded( const float3& origin, const float3& dir, float tNear, float tFar ) const;
+
+	size_t GetNumNodes() const {
+		return m_Nodes.size();
+	}
+	size_t GetNumTriangles() const {
+		return m_Triangles.size();
+	}
+private:
+	struct Node {
+		float3 BoxMin;
+		// first triangle of a leaf, first child of an inner node, the second one follows it
+		uint32_t First;
+		float3 BoxMax;
+		// 0 for inner nodes
+		uint32_t Count;
+	};
+
+	struct Triangle {
+		float3 V0;
+		float3 Edge1;
+		float3 Edge2;
+	};
+
+	// distance of the hit or a negative value, the edges are v1 - v0 and v2 - v0
+	float IntersectTriangle( const Triangle& triangle, const float3& origin, const float3& dir ) const;
+	// closest hit if anyHit is false, otherwise the first one found
+	bool Traverse( const float3& origin, const float3& dir, float tNear, float& tFar, uint32_t& triangle, bool anyHit ) const;
+
+	std::vector<Node> m_Nodes;
+	std::vector<Triangle> m_Triangles;
+};
@@ -22,7 +22,7 @@ Camera::Camera( const CameraDesc & desc )
 	GetViewMat();
 	GetProjMat();
 
-	m_Transform.SetOnInvalidateFunction( [&]() {
+	m_Transform.AddOnInvalidateFunction( [&]() {
 		m_IsViewValid = false;
 		m_IsViewProjValid = false;
 		m_IsInvViewProjValid = false;
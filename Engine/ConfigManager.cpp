@@ -33,7 +33,11 @@ const std::wstring & ConfigManager::LookUpNameInMap( std::unordered_map<std::wst
 }
 
 void ConfigManager::ReloadConfig() {
-	std::wifstream file( m_File, std::ios::in );
+	// tools without a config file only use the values set from their arguments
+	if( m_File.empty() )
+		return;
+
+	std::wifstream file( FilePath( m_File ), std::ios::in );
 
 	if( !file.is_open() ) {
 		Game::GetLogger().Log( L"Config", L" Couldn't open config File \"" + m_File + L"\"." );
@@ -211,6 +215,22 @@ const std::wstring & ConfigManager::GetString( const std::wstring & name, const
 	return LookUpNameInMap( m_Strings, name, defaultVal );
 }
 
+void ConfigManager::SetBool( const std::wstring & name, bool value ) {
+	m_Bools[name] = value;
+}
+
+void ConfigManager::SetInt( const std::wstring & name, int value ) {
+	m_Ints[name] = value;
+}
+
+void ConfigManager::SetFloat( const std::wstring & name, float value ) {
+	m_Floats[name] = value;
+}
+
+void ConfigManager::SetString( const std::wstring & name, const std::wstring & value ) {
+	m_Strings[name] = value;
+}
+
 bool StringToInt( const std::wstring & input, int & out ) {
 	try {
 		out = std::stoi( input, nullptr, 0 );
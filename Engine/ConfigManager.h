@@ -3,6 +3,7 @@
 #include <unordered_map>
 
 #include "Types.h"
+#include "Game.h"
 #include "Logger.h"
 
 bool StringToInt( const std::wstring& input, int& out );
@@ -25,6 +26,12 @@ public:
 	float4 GetFloat4( const std::wstring& name, float4 defaultVal = { 0.f, 0.f, 0.f, 0.f } );
 
 	const std::wstring& GetString( const std::wstring& name, const std::wstring& defaultVal = L"" );
+
+	// overrides a value of the config file, used by the tools for their command line arguments
+	void SetBool( const std::wstring& name, bool value );
+	void SetInt( const std::wstring& name, int value );
+	void SetFloat( const std::wstring& name, float value );
+	void SetString( const std::wstring& name, const std::wstring& value );
 	
 
 private:
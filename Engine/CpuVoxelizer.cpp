@@ -0,0 +1,319 @@
+#include "CpuVoxelizer.h"
+
+#include <cfloat>
+#include <cmath>
+
+#include "Makros.h"
+#include "Math.h"
+#include "Platform.h"
+#include "TreeNode.h"
+#include "Shader/VoxelDefines.hlsli"
+
+namespace {
+const uint32_t NumBits = 4;
+
+struct GridConstants {
+	uint32_t GridSize;
+	uint32_t VoxelMode;
+	float3 DeltaGrid;
+	float3 InvDeltaGrid;
+	float3 MinBoxPos;
+	float3 BoxSize;
+};
+
+struct TriangleVals {
+	float3 n;
+	float d1;
+	float d2;
+	float d1T;
+	float d2T;
+	float2 n_xy[3];
+	float d_xy[3];
+	float d_xyT[3];
+	float2 n_xz[3];
+	float d_xz[3];
+	float d_xzT[3];
+	float2 n_yz[3];
+	float d_yz[3];
+	float d_yzT[3];
+};
+
+// half extent of the inner diamond of a voxel along the normal
+float DiamondExtent( const float3& n, const float3& delta ) {
+	return 0.5f * Max( fabsf( n.x ) * delta.x, Max( fabsf( n.y ) * delta.y, fabsf( n.z ) * delta.z ) );
+}
+
+float DiamondExtent( const float2& n, float deltaX, float deltaY ) {
+	return 0.5f * Max( fabsf( n.x ) * deltaX, fabsf( n.y ) * deltaY );
+}
+
+TriangleVals CalculateTriangleVals( const GridConstants& grid, const float3 tri[3] ) {
+	TriangleVals vals;
+	const float3& deltaGrid = grid.DeltaGrid;
+
+	// triangle edges
+	float3 e[3];
+	e[0] = tri[1] - tri[0];
+	e[1] = tri[2] - tri[1];
+	e[2] = tri[0] - tri[2];
+
+	// normal of the triangle
+	vals.n = Normalize( Cross( e[0], -e[2] ) );
+
+	// critical point
+	float3 c = float3( 0, 0, 0 );
+	if( vals.n.x > 0 )
+		c.x = deltaGrid.x;
+	if( vals.n.y > 0 )
+		c.y = deltaGrid.y;
+	if( vals.n.z > 0 )
+		c.z = deltaGrid.z;
+
+	// d for bit width
+	vals.d1 = Dot( vals.n, c - tri[0] );
+	vals.d2 = Dot( vals.n, ( deltaGrid - c ) - tri[0] );
+	// d for texel width
+	float3 deltaTex = deltaGrid * static_cast<float>( NumBits );
+	c *= static_cast<float>( NumBits );
+	vals.d1T = Dot( vals.n, c - tri[0] );
+	vals.d2T = Dot( vals.n, ( deltaTex - c ) - tri[0] );
+
+	// the thin mode only needs the plane to cross the diamond, tested from the voxel center
+	float3 halfDelta = 0.5f * deltaGrid;
+	if( grid.VoxelMode == VOXEL_MODE_6_SEPARATING ) {
+		float center = Dot( vals.n, halfDelta - tri[0] );
+		vals.d1 = center - DiamondExtent( vals.n, deltaGrid );
+		vals.d2 = center + DiamondExtent( vals.n, deltaGrid );
+	}
+
+	for( uint32_t i = 0; i < 3; ++i ) {
+		// ns and ds for bit width
+		vals.n_xy[i] = float2( -e[i].y, e[i].x );
+		if( vals.n.z < 0 )
+			vals.n_xy[i] *= -1;
+		vals.d_xy[i] = -Dot( vals.n_xy[i], float2( tri[i].x, tri[i].y ) ) + Max( 0.f, deltaGrid.x * vals.n_xy[i].x ) + Max( 0.f, deltaGrid.y * vals.n_xy[i].y );
+
+		vals.n_xz[i] = float2( e[i].z, -e[i].x );
+		if( vals.n.y < 0 )
+			vals.n_xz[i] *= -1;
+		vals.d_xz[i] = -Dot( vals.n_xz[i], float2( tri[i].x, tri[i].z ) ) + Max( 0.f, deltaGrid.x * vals.n_xz[i].x ) + Max( 0.f, deltaGrid.z * vals.n_xz[i].y );
+
+		vals.n_yz[i] = float2( -e[i].z, e[i].y );
+		if( vals.n.x < 0 )
+			vals.n_yz[i] *= -1;
+		vals.d_yz[i] = -Dot( vals.n_yz[i], float2( tri[i].y, tri[i].z ) ) + Max( 0.f, deltaGrid.y * vals.n_yz[i].x ) + Max( 0.f, deltaGrid.z * vals.n_yz[i].y );
+
+		// ds for texel width
+		vals.d_xyT[i] = -Dot( vals.n_xy[i], float2( tri[i].x, tri[i].y ) ) + Max( 0.f, deltaTex.x * vals.n_xy[i].x ) + Max( 0.f, deltaTex.y * vals.n_xy[i].y );
+		vals.d_xzT[i] = -Dot( vals.n_xz[i], float2( tri[i].x, tri[i].z ) ) + Max( 0.f, deltaTex.x * vals.n_xz[i].x ) + Max( 0.f, deltaTex.z * vals.n_xz[i].y );
+		vals.d_yzT[i] = -Dot( vals.n_yz[i], float2( tri[i].y, tri[i].z ) ) + Max( 0.f, deltaTex.y * vals.n_yz[i].x ) + Max( 0.f, deltaTex.z * vals.n_yz[i].y );
+
+		// the texel tests stay conservative, they only prefilter the voxel tests
+		if( grid.VoxelMode != VOXEL_MODE_CONSERVATIVE ) {
+			float3 center = tri[i] - halfDelta;
+			vals.d_xy[i] = -Dot( vals.n_xy[i], float2( center.x, center.y ) ) + DiamondExtent( vals.n_xy[i], deltaGrid.x, deltaGrid.y );
+			vals.d_xz[i] = -Dot( vals.n_xz[i], float2( center.x, center.z ) ) + DiamondExtent( vals.n_xz[i], deltaGrid.x, deltaGrid.z );
+			vals.d_yz[i] = -Dot( vals.n_yz[i], float2( center.y, center.z ) ) + DiamondExtent( vals.n_yz[i], deltaGrid.y, deltaGrid.z );
+		}
+	}
+
+	// for 6-separation only the projection along the dominant axis is tested
+	if( grid.VoxelMode == VOXEL_MODE_6_SEPARATING ) {
+		float3 absN = float3( fabsf( vals.n.x ), fabsf( vals.n.y ), fabsf( vals.n.z ) );
+		for( uint32_t j = 0; j < 3; ++j ) {
+			if( absN.z < absN.x || absN.z < absN.y )
+				vals.d_xy[j] = FLT_MAX;
+			if( absN.y < absN.x || absN.y <= absN.z )
+				vals.d_xz[j] = FLT_MAX;
+			if( absN.x <= absN.y || absN.x <= absN.z )
+				vals.d_yz[j] = FLT_MAX;
+		}
+	}
+
+	return vals;
+}
+
+bool HitElement( const float3& pos, const float3& n, float d1, float d2, const float2 n_xy[3], const float d_xy[3],
+				 const float2 n_xz[3], const float d_xz[3], const float2 n_yz[3], const float d_yz[3] ) {
+	float n_dot_p = Dot( n, pos );
+	if( ( n_dot_p + d1 ) * ( n_dot_p + d2 ) > 0 )
+		return false;
+
+	for( uint32_t i = 0; i < 3; ++i ) {
+		if( Dot( n_xy[i], float2( pos.x, pos.y ) ) + d_xy[i] < 0 )
+			return false;
+	}
+	for( uint32_t j = 0; j < 3; ++j ) {
+		if( Dot( n_xz[j], float2( pos.x, pos.z ) ) + d_xz[j] < 0 )
+			return false;
+	}
+	for( uint32_t k = 0; k < 3; ++k ) {
+		if( Dot( n_yz[k], float2( pos.y, pos.z ) ) + d_yz[k] < 0 )
+			return false;
+	}
+	return true;
+}
+
+// morton code of a 10 bit position, the same as Encode in csVoxel.hlsl
+uint32_t Encode( uint3 pos ) {
+	pos.x = pos.x & 0x3ff;
+	pos.x = ( pos.x | ( pos.x << 16 ) ) & 0x030000FF;
+	pos.x = ( pos.x | ( pos.x << 8 ) ) & 0x0300F00F;
+	pos.x = ( pos.x | ( pos.x << 4 ) ) & 0x030C30C3;
+	pos.x = ( pos.x | ( pos.x << 2 ) ) & 0x09249249;
+
+	pos.y = pos.y & 0x3ff;
+	pos.y = ( pos.y | ( pos.y << 16 ) ) & 0x030000FF;
+	pos.y = ( pos.y | ( pos.y << 8 ) ) & 0x0300F00F;
+	pos.y = ( pos.y | ( pos.y << 4 ) ) & 0x030C30C3;
+	pos.y = ( pos.y | ( pos.y << 2 ) ) & 0x09249249;
+
+	pos.z = pos.z & 0x3ff;
+	pos.z = ( pos.z | ( pos.z << 16 ) ) & 0x030000FF;
+	pos.z = ( pos.z | ( pos.z << 8 ) ) & 0x0300F00F;
+	pos.z = ( pos.z | ( pos.z << 4 ) ) & 0x030C30C3;
+	pos.z = ( pos.z | ( pos.z << 2 ) ) & 0x09249249;
+
+	return pos.x | ( pos.y << 1 ) | ( pos.z << 2 );
+}
+
+uint2 HitTexel( const GridConstants& grid, const float3& pos, const uint3& bitStart, const uint3& bitEnd, const TriangleVals& vals ) {
+	uint2 bits = { 0, 0 };
+	// test texel for hit, only if hit test the single voxel bits
+	if( HitElement( pos, vals.n, vals.d1T, vals.d2T, vals.n_xy, vals.d_xyT, vals.n_xz, vals.d_xzT, vals.n_yz, vals.d_yzT ) ) {
+		for( uint32_t z = bitStart.z; z <= bitEnd.z; ++z ) {
+			for( uint32_t y = bitStart.y; y <= bitEnd.y; ++y ) {
+				for( uint32_t x = bitStart.x; x <= bitEnd.x; ++x ) {
+					float3 bitPos = pos + float3( static_cast<float>( x ), static_cast<float>( y ), static_cast<float>( z ) ) * grid.DeltaGrid;
+					if( HitElement( bitPos, vals.n, vals.d1, vals.d2, vals.n_xy, vals.d_xy, vals.n_xz, vals.d_xz, vals.n_yz, vals.d_yz ) ) {
+						if( z < 2 )
+							bits.x |= 1 << Encode( uint3( x, y, z ) );
+						else
+							bits.y |= 1 << Encode( uint3( x, y, z - 2 ) );
+					}
+				}
+			}
+		}
+	}
+	return bits;
+}
+
+void VoxelizeTriangle( const GridConstants& grid, const float3 tri[3], std::vector<Node>& bricks ) {
+	float3 triBoxMin( Min( tri[0].x, Min( tri[1].x, tri[2].x ) ), Min( tri[0].y, Min( tri[1].y, tri[2].y ) ), Min( tri[0].z, Min( tri[1].z, tri[2].z ) ) );
+	float3 triBoxMax( Max( tri[0].x, Max( tri[1].x, tri[2].x ) ), Max( tri[0].y, Max( tri[1].y, tri[2].y ) ), Max( tri[0].z, Max( tri[1].z, tri[2].z ) ) );
+
+	float3 boxMax = grid.MinBoxPos + grid.BoxSize;
+	if( triBoxMin.x > boxMax.x || triBoxMin.y > boxMax.y || triBoxMin.z > boxMax.z
+		|| triBoxMax.x < grid.MinBoxPos.x || triBoxMax.y < grid.MinBoxPos.y || triBoxMax.z < grid.MinBoxPos.z )
+		return;
+
+	// calculate start and end voxel
+	float maxVoxel = static_cast<float>( grid.GridSize - 1 );
+	float3 start = ( triBoxMin - grid.MinBoxPos ) * grid.InvDeltaGrid;
+	float3 end = ( triBoxMax - grid.MinBoxPos ) * grid.InvDeltaGrid;
+	uint3 startVoxel( static_cast<uint32_t>( Max( start.x, 0.f ) ), static_cast<uint32_t>( Max( start.y, 0.f ) ), static_cast<uint32_t>( Max( start.z, 0.f ) ) );
+	uint3 endVoxel( static_cast<uint32_t>( Min( end.x, maxVoxel ) ), static_cast<uint32_t>( Min( end.y, maxVoxel ) ), static_cast<uint32_t>( Min( end.z, maxVoxel ) ) );
+	// start and end bit in the border texels
+	uint3 bitStart( startVoxel.x & ( NumBits - 1 ), startVoxel.y & ( NumBits - 1 ), startVoxel.z & ( NumBits - 1 ) );
+	uint3 bitEnd( endVoxel.x & ( NumBits - 1 ), endVoxel.y & ( NumBits - 1 ), endVoxel.z & ( NumBits - 1 ) );
+	startVoxel >>= 2;
+	endVoxel >>= 2;
+
+	TriangleVals vals = CalculateTriangleVals( grid, tri );
+
+	float3 deltaTex = grid.DeltaGrid * static_cast<float>( NumBits );
+	uint3 startBit = bitStart;
+	uint3 endBit( NumBits - 1, NumBits - 1, NumBits - 1 );
+	// iterate over all texels, that overlap the bb of the triangle
+	for( uint32_t z = startVoxel.z; z <= endVoxel.z; ++z ) {
+		if( z == endVoxel.z )
+			endBit.z = bitEnd.z;
+		for( uint32_t y = startVoxel.y; y <= endVoxel.y; ++y ) {
+			if( y == endVoxel.y )
+				endBit.y = bitEnd.y;
+			for( uint32_t x = startVoxel.x; x <= endVoxel.x; ++x ) {
+				if( x == endVoxel.x )
+					endBit.x = bitEnd.x;
+				float3 pos = grid.MinBoxPos + float3( static_cast<float>( x ), static_cast<float>( y ), static_cast<float>( z ) ) * deltaTex;
+				uint2 bits = HitTexel( grid, pos, startBit, endBit, vals );
+				if( bits.x != 0 || bits.y != 0 )
+					bricks.push_back( { bits, Encode( uint3( x, y, z ) ) } );
+				startBit.x = 0;
+			}
+			startBit.x = bitStart.x;
+			endBit.x = NumBits - 1;
+			startBit.y = 0;
+		}
+		startBit.y = bitStart.y;
+		endBit.y = NumBits - 1;
+		startBit.z = 0;
+	}
+}
+
+// sorts the bricks by position and merges the bits of bricks at the same position
+void CombineBricks( std::vector<Node>& bricks ) {
+	std::sort( bricks.begin(), bricks.end(), []( const Node& a, const Node& b ) {
+		return a.Pointer < b.Pointer;
+	} );
+	auto last = std::unique( bricks.begin(), bricks.end(), []( Node& a, Node& b ) {
+		if( a.Pointer == b.Pointer ) {
+			a.Data = a.Data | b.Data;
+			return true;
+		}
+		return false;
+	} );
+	bricks.erase( last, bricks.end() );
+}
+
+struct ThreadBricks {
+	std::vector<Node> Bricks;
+	size_t CombinedSize = 0;
+};
+
+// the positions are float3 in the mesh files and float4a in the transform cache
+template<typename Position>
+void VoxelizePositions( const CpuVoxelizeData & data, const Position * positions, const uint32_t * indices, uint32_t numTriangles, std::vector<Node>& bricks ) {
+	GridConstants grid;
+	grid.GridSize = data.GridSize;
+	grid.VoxelMode = data.VoxelMode;
+	grid.DeltaGrid = data.BoxSize / static_cast<float>( data.GridSize );
+	grid.InvDeltaGrid = float3( 1.f / grid.DeltaGrid.x, 1.f / grid.DeltaGrid.y, 1.f / grid.DeltaGrid.z );
+	grid.MinBoxPos = data.MinBoxPos;
+	grid.BoxSize = data.BoxSize;
+
+	// every thread collects its own bricks, neighbouring triangles hit the same texels
+	// so the bricks get combined whenever a thread doubled its combined size
+	const uint32_t blockSize = 4096;
+	uint32_t numBlocks = ( numTriangles + blockSize - 1 ) / blockSize;
+	concurrency::combinable<ThreadBricks> threadBricks;
+	concurrency::parallel_for( 0u, numBlocks, [&]( uint32_t block ) {
+		ThreadBricks& local = threadBricks.local();
+		uint32_t end = Min( ( block + 1 ) * blockSize, numTriangles );
+		for( uint32_t id = block * blockSize; id < end; id++ ) {
+			float3 tri[3];
+			for( uint32_t i = 0; i < 3; i++ ) {
+				const Position& pos = positions[indices[id * 3 + i]];
+				tri[i] = float3( pos.x, pos.y, pos.z );
+			}
+			VoxelizeTriangle( grid, tri, local.Bricks );
+		}
+		if( local.Bricks.size() > Max( local.CombinedSize * 2, size_t( 1 << 20 ) ) ) {
+			CombineBricks( local.Bricks );
+			local.CombinedSize = local.Bricks.size();
+		}
+	} );
+
+	threadBricks.combine_each( [&]( ThreadBricks& local ) {
+		bricks.insert( bricks.end(), local.Bricks.begin(), local.Bricks.end() );
+	} );
+	CombineBricks( bricks );
+}
+}
+
+void VoxelizeTriangles( const CpuVoxelizeData & data, const float3 * positions, const uint32_t * indices, uint32_t numTriangles, std::vector<Node>& bricks ) {
+	VoxelizePositions( data, positions, indices, numTriangles, bricks );
+}
+
+void VoxelizeTriangles( const CpuVoxelizeData & data, const float4a * positions, const uint32_t * indices, uint32_t numTriangles, std::vector<Node>& bricks ) {
+	VoxelizePositions( data, positions, indices, numTriangles, bricks );
+}
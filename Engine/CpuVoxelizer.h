@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+
+#include "Types.h"
+
+struct Node;
+
+// grid of one voxelization part, the same values csVoxel.hlsl gets from the voxelizer
+struct CpuVoxelizeData {
+	uint32_t GridSize;
+	uint32_t VoxelMode;
+	float3 MinBoxPos;
+	float3 BoxSize;
+};
+
+// voxelizes world space triangles into 4x4x4 bricks with the same tests as csVoxel.hlsl, so no device is needed.
+// the bricks are sorted by position and bricks with the same position are combined, also with the bricks already in the vector
+void VoxelizeTriangles( const CpuVoxelizeData& data, const float3* positions, const uint32_t* indices, uint32_t numTriangles, std::vector<Node>& bricks );
+// for the world space positions of the TransformCache
+void VoxelizeTriangles( const CpuVoxelizeData& data, const float4a* positions, const uint32_t* indices, uint32_t numTriangles, std::vector<Node>& bricks );
@@ -25,6 +25,7 @@
 #include "Profiler.h"
 #include "RenderPass.h"
 #include "Embree.h"
+#include "ImageDiff.h"
 
 #include "imgui.h"
 #include "ImGUI_Impl.h"
@@ -39,6 +40,7 @@ void D3DRenderBackend::AddToVoxelization( GameObject& gameObject ) {
 	m_VoxelElements.push_back( { &geometry, transform } );
 	m_EmbreeObjects.push_back( &gameObject );
 	m_Voxelizer->VoxelizeObject( gameObject );
+	m_Voxelizer->AddDynamicObject( gameObject );
 }
 
 void D3DRenderBackend::NotifyChangeInVisibility() {
@@ -61,6 +63,22 @@ void D3DRenderBackend::SaveTexture( TextureResource* res, const std::wstring & f
 		Game::GetLogger().Log( L"RenderBackend", L"Failed saving screenshot in " + fileName );
 }
 
+bool D3DRenderBackend::ReadTexture( TextureResource * res, std::vector<float>& out ) {
+	using namespace DirectX;
+	ScratchImage image;
+	if( FAILED( CaptureTexture( m_Device, m_Context, res, image ) ) )
+		return false;
+
+	const Image& texture = *image.GetImage( 0, 0, 0 );
+	if( texture.format != DXGI_FORMAT_R32_FLOAT )
+		return false;
+
+	out.resize( texture.width * texture.height );
+	for( size_t y = 0; y < texture.height; y++ )
+		memcpy( &out[y * texture.width], texture.pixels + y * texture.rowPitch, texture.width * sizeof( float ) );
+	return true;
+}
+
 void D3DRenderBackend::TakeScreenShot( const std::wstring & fileName ) {
 	m_ScreenShotName = fileName;
 	m_SaveScreenShot = true;
@@ -83,8 +101,20 @@ void D3DRenderBackend::SetGUIVisibility( bool visibility ) {
 }
 
 void D3DRenderBackend::TraceWithEmdree() {
-	if( m_Embree )
-		m_Embree->Render( m_DefaultRenderTarget, *Game::GetRenderer().GetActiveCamera(), m_Voxelizer->GetLightDir(), m_Voxelizer->GetLightAngleSize() );
+	if( !m_Embree )
+		return;
+	m_Embree->Render( m_DefaultRenderTarget, *Game::GetRenderer().GetActiveCamera(), m_Voxelizer->GetLightDir(), m_Voxelizer->GetLightAngleSize() );
+
+	// the reference against the last finished voxel shadows, the camera and light have to be the same in both
+	std::vector<float> shadow;
+	const std::vector<float>& reference = m_Embree->GetShadowValues();
+	if( !ReadTexture( m_Voxelizer->GetLastShadowTex()->GetTextureResource(), shadow ) || shadow.size() != reference.size() ) {
+		Game::GetLogger().Log( L"RenderBackend", L"Failed reading the shadow texture" );
+		return;
+	}
+	ImageDiff diff = CompareImages( reference.data(), shadow.data(), shadow.size() );
+	Game::GetLogger().Log( L"RenderBackend", L"Voxel shadows against the reference: rmse " + std::to_wstring( diff.Rmse ) + L", psnr " + std::to_wstring( diff.Psnr )
+		+ L" dB, max error " + std::to_wstring( diff.MaxError ) + L" over " + std::to_wstring( diff.NumPixels ) + L" pixels" );
 }
 
 void D3DRenderBackend::CopyRTV_DSV() {
@@ -210,20 +240,28 @@ void D3DRenderBackend::Initialize() {
 void D3DRenderBackend::Start() {
 
 	ConfigManager* config = &Game::GetConfig();
+	float startTime = Game::GetTime().GetRealTime();
 
 	float3 voxelPos = config->GetFloat3( L"VoxelPos", { 0.f,0.f,0.f } );
 	float3 voxelSize = config->GetFloat3( L"VoxelSize", { 3.f, 3.f, 3.f } );
 	int voxelRes = config->GetInt( L"VoxelRes", 256 );
 
 	m_Voxelizer = new Voxelizer( voxelPos, voxelSize, voxelRes );
+	// the stored tree gets loaded while the scene and embree are set up
+	if( config->GetBool( L"Voxelize", true ) && config->GetBool( L"LoadTree", false ) )
+		m_Voxelizer->PrefetchTree( config->GetString( L"TreeLoadPath", L"TestTree.vx" ) );
+
 	m_Embree = new Embree();
-	if( !m_Embree->Init() )
+	if( !m_Embree->Init( config->GetBool( L"UseBvhReference", false ) ) )
 		Game::GetLogger().FatalError( L"Failed creating embree" );
+	m_Embree->SetAdaptiveSampling( config->GetFloat( L"ReferenceConfidence", 0.f ), config->GetBool( L"CompareAdaptiveReference", false ) );
 
+	float sceneStart = Game::GetTime().GetRealTime();
 	m_MainScene = new Scene( *m_MainWindow );
 	m_MainScene->LoadScene();
 
-	m_Embree->SetGeometry( m_EmbreeObjects );
+	float embreeStart = Game::GetTime().GetRealTime();
+	m_Embree->SetGeometry( m_EmbreeObjects, m_TransformCache );
 
 	Game::GetRenderer().Start();
 
@@ -231,9 +269,17 @@ void D3DRenderBackend::Start() {
 		m_RenderVoxel = !m_RenderVoxel;
 	} );
 
+	float voxelStart = Game::GetTime().GetRealTime();
 	if( Game::GetConfig().GetBool( L"Voxelize", true ) )
-		m_Voxelizer->Voxelize( m_VoxelElements );
+		m_Voxelizer->Voxelize( m_VoxelElements, m_TransformCache );
 	m_VoxelElements.clear();
+	// embree and the tree have what they need, moved objects and rebuilds transform their elements again
+	m_TransformCache.Clear();
+
+	float endTime = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"RenderBackend", L"Startup of scene " + config->GetString( L"SceneName", L"Pillar" ) + L" took " + std::to_wstring( ( endTime - startTime ) * 1000.f ) + L" ms (scene "
+						   + std::to_wstring( ( embreeStart - sceneStart ) * 1000.f ) + L" ms, embree " + std::to_wstring( ( voxelStart - embreeStart ) * 1000.f ) + L" ms, voxelization "
+						   + std::to_wstring( ( endTime - voxelStart ) * 1000.f ) + L" ms)" );
 
 
 	RenderPassInit rInit;
@@ -242,6 +288,7 @@ void D3DRenderBackend::Start() {
 	rInit.PixelShader = Shader::Get( L"psShadow" );
 	rInit.PreFunction = [&]() {
 		SetRenderTarget( { nullptr }, nullptr );
+		m_Voxelizer->BuildBeams( m_TempDSV->GetSRV(), m_DeferredRTVs[1]->GetSRV() );
 		m_Voxelizer->BindSRVs();
 		SetSRVsPS( 0, { m_TempDSV->GetSRV(),  m_DeferredRTVs[1]->GetSRV() } );
 	};
@@ -272,6 +319,7 @@ void D3DRenderBackend::Render() {
 	ImGui::Text( "FPS: %f", Game::GetTime().GetFPS() );
 
 	Game::GetRenderer().Update();
+	m_Voxelizer->UpdateDynamicObjects( m_TransformCache );
 
 	Profiler::GlobalProfiler.StartProfile( L"Render Time", false );
 
@@ -312,6 +360,7 @@ void D3DRenderBackend::Render() {
 }
 
 void D3DRenderBackend::Exit() {
+	m_TransformCache.Clear();
 	delete m_MainScene;
 }
 
@@ -990,14 +1039,20 @@ Buffer* D3DRenderBackend::CreateBuffer( const void * data, const BufferDesc& des
 		return nullptr;
 	}
 
+	std::lock_guard<std::mutex> lock( m_BuffersMutex );
 	m_Buffers.push_back( buffer );
-	return m_Buffers.back();
+	return buffer;
 }
 
 void D3DRenderBackend::CopyResource( Resource * dst, Resource * src ) {
 	m_Context->CopyResource( dst, src );
 }
 
+void D3DRenderBackend::CopyBufferRegion( Buffer* dst, Buffer* src, UINT srcOffset, UINT size ) {
+	Box box = { srcOffset, 0, 0, srcOffset + size, 1, 1 };
+	m_Context->CopySubresourceRegion( dst, 0, 0, 0, 0, src, 0, &box );
+}
+
 void D3DRenderBackend::UpdateBuffer( Buffer* buffer, void * data, UINT bufferSize, UINT subresource, MapType mapType, bool doNotWait ) {
 	UINT mapflags = doNotWait ? D3D11_MAP_FLAG_DO_NOT_WAIT : 0;
 
@@ -6,8 +6,10 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <mutex>
 
 #include "D3DWrapper.h"
+#include "TransformCache.h"
 
 class Window;
 class Shader;
@@ -86,6 +88,7 @@ public:
 	Buffer* CreateBuffer( const void* data, const BufferDesc& desc ) override;
 
 	void CopyResource( Resource* dst, Resource* src ) override;
+	void CopyBufferRegion( Buffer* dst, Buffer* src, UINT srcOffset, UINT size ) override;
 	void UpdateBuffer( Buffer* buffer, void* data, UINT bufferSize, UINT subresource, MapType mapType, bool doNotWait = false ) override;
 	void ReadBuffer( Buffer * buffer, UINT bufferSize, void* out, UINT cpySize, UINT subresource ) override;
 	void MapBuffer( Buffer * buffer, void ** out, UINT subresource, MapType mapType ) override;
@@ -108,6 +111,7 @@ public:
 	void NotifyChangeInVisibility() override;
 
 	void SaveTexture( TextureResource* res, const std::wstring& fileName ) override;
+	bool ReadTexture( TextureResource* res, std::vector<float>& out ) override;
 	void TakeScreenShot( const std::wstring& fileName = L"ScreenShot" ) override;
 
 	void SetLightSizeAngle( float angle ) override;
@@ -150,6 +154,8 @@ private:
 	std::vector<BlendState*> m_BlendStates;
 	std::vector<SamplerState*> m_SamplerStates;
 	std::vector<Buffer*> m_Buffers;
+	// buffers are also created by the mesh loader thread
+	std::mutex m_BuffersMutex;
 
 	Window* m_MainWindow;
 	Scene* m_MainScene;
@@ -165,6 +171,8 @@ private:
 	Embree* m_Embree = nullptr;
 	std::vector<GameObject*> m_EmbreeObjects;
 
+	TransformCache m_TransformCache;
+
 	std::vector<std::pair<void*, std::function<void( uint2 )>>> m_ResizeCallbacks;
 };
 
@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "Makros.h"
 #include "Math.h"
 
 int3 Decode( uint32_t code ) {
@@ -68,10 +69,10 @@ float GetMinDistance( uint2 brick, uint32_t idx ) {
 
 	for( uint32_t i = 0; i < 32; i++ ) {
 		if( brick.x & 1 << i ) {
-			distance = min( distance, GetDistance( pos, Decode( i ) ) );
+			distance = Min( distance, GetDistance( pos, Decode( i ) ) );
 		}
 		if( brick.y & 1 << ( i - 32 ) )
-			distance = min( distance, GetDistance( pos, Decode( i + 32 ) ) );
+			distance = Min( distance, GetDistance( pos, Decode( i + 32 ) ) );
 	}
 
 	return distance;
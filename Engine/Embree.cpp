@@ -3,6 +3,9 @@
 #include <ppl.h>
 #include <random>
 
+#include "embree2\rtcore.h"
+#include "embree2\rtcore_ray.h"
+
 #include "Game.h"
 #include "Logger.h"
 #include "GameObject.h"
@@ -10,71 +13,171 @@
 #include "Camera.h"
 #include "Texture.h"
 #include "RenderBackend.h"
-#include "Logger.h"
 #include "Makros.h"
+#include "TransformCache.h"
+#include "Time.h"
+#include "ImageDiff.h"
+
+struct EmbreeScene {
+	RTCDevice Device = nullptr;
+	RTCScene Scene = nullptr;
+};
+
+namespace {
+// the rays are copied to embree in chunks of this size
+const size_t EmbreeRayChunk = 256;
+
+void ToRTCRay( const ReferenceRay& ray, RTCRay& rtcRay ) {
+	rtcRay.org[0] = ray.Origin.x; rtcRay.org[1] = ray.Origin.y; rtcRay.org[2] = ray.Origin.z;
+	rtcRay.dir[0] = ray.Direction.x; rtcRay.dir[1] = ray.Direction.y; rtcRay.dir[2] = ray.Direction.z;
+	rtcRay.tnear = ray.TNear;
+	rtcRay.tfar = ray.TFar;
+	rtcRay.geomID = RTC_INVALID_GEOMETRY_ID;
+	rtcRay.primID = RTC_INVALID_GEOMETRY_ID;
+	rtcRay.mask = -1;
+	rtcRay.time = 0;
+}
+}
 
-Embree::Embree() {
+Embree::Embree()
+	: m_NumEngines( 0 ), m_Engines( [this]() { return std::default_random_engine( m_NumEngines++ ); } ) {
 }
 
 
 Embree::~Embree() {
-	if( m_RTCDevice )
-		rtcDeleteDevice( m_RTCDevice );
+	if( m_EmbreeScene ) {
+		if( m_EmbreeScene->Scene )
+			rtcDeleteScene( m_EmbreeScene->Scene );
+		if( m_EmbreeScene->Device )
+			rtcDeleteDevice( m_EmbreeScene->Device );
+		delete m_EmbreeScene;
+	}
+}
+
+void Embree::SetAdaptiveSampling( float confidence, bool compareFixed ) {
+	m_Confidence = confidence;
+	m_CompareFixed = compareFixed;
 }
 
-bool Embree::Init() {
-	m_RTCDevice = rtcNewDevice();
-	if( !m_RTCDevice ) {
-		Game::GetLogger().FatalError( L"Embree initialization failed" );
-		return false;
+bool Embree::Init( bool useBvh ) {
+	m_UseBvh = useBvh;
+	if( m_UseBvh )
+		return true;
+	m_EmbreeScene = new EmbreeScene();
+	m_EmbreeScene->Device = rtcNewDevice();
+	if( !m_EmbreeScene->Device ) {
+		Game::GetLogger().Log( L"Embree", L"Embree initialization failed, using the bvh instead" );
+		m_UseBvh = true;
 	}
 	return true;
 }
 
-void Embree::SetGeometry( std::vector<GameObject*> objects ) {
-	if( m_RTCScene ) {
-		rtcDeleteScene( m_RTCScene );
-		m_RTCScene = nullptr;
+void Embree::SetGeometry( std::vector<GameObject*> objects, TransformCache& transformCache ) {
+	if( m_EmbreeScene && m_EmbreeScene->Scene ) {
+		rtcDeleteScene( m_EmbreeScene->Scene );
+		m_EmbreeScene->Scene = nullptr;
 	}
+	m_Bvh.Clear();
 
-	m_RTCScene = rtcDeviceNewScene( m_RTCDevice, RTC_SCENE_STATIC | RTC_SCENE_COHERENT, RTC_INTERSECT1 | RTC_INTERSECT_STREAM );
+	if( !m_UseBvh )
+		m_EmbreeScene->Scene = rtcDeviceNewScene( m_EmbreeScene->Device, RTC_SCENE_STATIC | RTC_SCENE_COHERENT, RTC_INTERSECT1 | RTC_INTERSECT_STREAM );
 
-	for( GameObject* object : objects ) {
-		const std::vector<float3a>& positions = object->GetRenderable()->GetGeometry()->GetAlignedPositions();
-		const std::vector<uint3>& indices = object->GetRenderable()->GetGeometry()->GetTriangleIndices();
-		Matrix transform = object->GetTransform().GetWorldTransMat();
+	std::vector<std::pair<const Geometry*, Matrix>> elements;
+	for( GameObject* object : objects )
+		elements.push_back( { object->GetRenderable()->GetGeometry(), object->GetTransform().GetWorldTransMat() } );
 
-		uint32_t id = rtcNewTriangleMesh( m_RTCScene, RTC_GEOMETRY_STATIC, indices.size(), positions.size() );
+	transformCache.Prepare( elements );
 
-		float4a* vertices = (float4a*)rtcMapBuffer( m_RTCScene, id, RTC_VERTEX_BUFFER );
+	for( const auto& element : elements ) {
+		const std::vector<float4a>& positions = transformCache.GetWorldPositions( *element.first, element.second );
+		const std::vector<uint3>& indices = element.first->GetTriangleIndices();
 
-		for( size_t i = 0; i < positions.size(); i++ ) {
-			float3a aPos = positions[i];
-			float4 pos = { aPos.x, aPos.y, aPos.z, 1 };
-			pos = Mult( transform, pos );
-			vertices[i] = make_float4a( pos );
+		if( m_UseBvh ) {
+			m_Bvh.AddMesh( positions, indices );
+			continue;
 		}
 
-		rtcUnmapBuffer( m_RTCScene, id, RTC_VERTEX_BUFFER );
+		uint32_t id = rtcNewTriangleMesh( m_EmbreeScene->Scene, RTC_GEOMETRY_STATIC, indices.size(), positions.size() );
+
+		float4a* vertices = (float4a*)rtcMapBuffer( m_EmbreeScene->Scene, id, RTC_VERTEX_BUFFER );
+
+		memcpy( vertices, positions.data(), positions.size() * sizeof( float4a ) );
 
-		uint3* newIndices = (uint3*)rtcMapBuffer( m_RTCScene, id, RTC_INDEX_BUFFER );
+		rtcUnmapBuffer( m_EmbreeScene->Scene, id, RTC_VERTEX_BUFFER );
+
+		uint3* newIndices = (uint3*)rtcMapBuffer( m_EmbreeScene->Scene, id, RTC_INDEX_BUFFER );
 
 		for( size_t i = 0; i < indices.size(); i++ ) {
 			newIndices[i] = indices[i];
 		}
 
-		rtcUnmapBuffer( m_RTCScene, id, RTC_INDEX_BUFFER );
+		rtcUnmapBuffer( m_EmbreeScene->Scene, id, RTC_INDEX_BUFFER );
+
+	}
+
+	if( m_UseBvh ) {
+		float start = Game::GetTime().GetRealTime();
+		m_Bvh.Build();
+		Game::GetLogger().Log( L"Embree", L"Bvh with " + std::to_wstring( m_Bvh.GetNumNodes() ) + L" nodes over " + std::to_wstring( m_Bvh.GetNumTriangles() )
+			+ L" triangles built in " + std::to_wstring( ( Game::GetTime().GetRealTime() - start ) * 1000.f ) + L" ms" );
+	}
+	else
+		rtcCommit( m_EmbreeScene->Scene );
+}
 
+void Embree::Intersect( ReferenceRay * rays, size_t numRays ) {
+	if( !m_UseBvh ) {
+		RTCIntersectContext context;
+		context.flags = RTC_INTERSECT_COHERENT;
+		RTCRay rtcRays[EmbreeRayChunk];
+		for( size_t first = 0; first < numRays; first += EmbreeRayChunk ) {
+			size_t count = Min( EmbreeRayChunk, numRays - first );
+			for( size_t i = 0; i < count; i++ )
+				ToRTCRay( rays[first + i], rtcRays[i] );
+			rtcIntersect1M( m_EmbreeScene->Scene, &context, rtcRays, count, sizeof( RTCRay ) );
+			for( size_t i = 0; i < count; i++ ) {
+				ReferenceRay& ray = rays[first + i];
+				ray.Hit = rtcRays[i].geomID != RTC_INVALID_GEOMETRY_ID;
+				if( ray.Hit ) {
+					ray.TFar = rtcRays[i].tfar;
+					ray.Normal = float3( rtcRays[i].Ng[0], rtcRays[i].Ng[1], rtcRays[i].Ng[2] );
+				}
+			}
+		}
+		return;
 	}
 
-	rtcCommit( m_RTCScene );
+	for( size_t i = 0; i < numRays; i++ ) {
+		ReferenceRay& ray = rays[i];
+		ray.Hit = m_Bvh.Intersect( ray.Origin, ray.Direction, ray.TNear, ray.TFar, ray.Normal );
+	}
 }
 
-float Embree::GetShadowVal( const float3& pos, const float3& dir, float jitterRad ) {
-	std::default_random_engine e;
-	std::uniform_real_distribution<float> distr( 0.f, 1.f );
-	e.seed( *reinterpret_cast<const uint32_t*>( &pos.x ) ^ *reinterpret_cast<const uint32_t*>( &pos.y ) ^ *reinterpret_cast<const uint32_t*>( &pos.z ) );
+void Embree::Occluded( ReferenceRay * rays, size_t numRays ) {
+	if( !m_UseBvh ) {
+		RTCIntersectContext context;
+		context.flags = RTC_INTERSECT_COHERENT;
+		RTCRay rtcRays[EmbreeRayChunk];
+		for( size_t first = 0; first < numRays; first += EmbreeRayChunk ) {
+			size_t count = Min( EmbreeRayChunk, numRays - first );
+			for( size_t i = 0; i < count; i++ )
+				ToRTCRay( rays[first + i], rtcRays[i] );
+			rtcOccluded1M( m_EmbreeScene->Scene, &context, rtcRays, count, sizeof( RTCRay ) );
+			// embree sets the geomID of occluded rays to 0
+			for( size_t i = 0; i < count; i++ )
+				rays[first + i].Hit = rtcRays[i].geomID == 0;
+		}
+		return;
+	}
 
+	for( size_t i = 0; i < numRays; i++ ) {
+		ReferenceRay& ray = rays[i];
+		ray.Hit = m_Bvh.Occluded( ray.Origin, ray.Direction, ray.TNear, ray.TFar );
+	}
+}
+
+float Embree::GetShadowVal( const float3& pos, const float3& dir, float jitterRad, float confidence, std::default_random_engine& e, uint32_t& numRays ) {
+	std::uniform_real_distribution<float> distr( 0.f, 1.f );
 	const int numSamples = 10;
 	float2 p[numSamples * numSamples];
 
@@ -115,51 +218,61 @@ float Embree::GetShadowVal( const float3& pos, const float3& dir, float jitterRa
 		}
 	}
 
-	float shadowVal = 0.f;
-
-	RTCRay rays[numSamples * numSamples];
-
-	for( int i = 0; i < iN; ++i ) {
-		for( int j = 0; j < iN; ++j ) {
-			float randX = ( ( ( p[iN * j + i].x ) * 2.f ) - 1.f ) * jitterRad;
-			float randY = ( ( ( p[iN * j + i].y ) * 2.f ) - 1.f ) * jitterRad;
-			float3 testDir = dir + vDir1 * randX + vDir2 * randY;
-			RTCRay ray;
-			ray.org[0] = pos.x; ray.org[1] = pos.y; ray.org[2] = pos.z;
-			ray.dir[0] = testDir.x; ray.dir[1] = testDir.y; ray.dir[2] = testDir.z;
-			ray.tnear = 0.001f;
-			ray.tfar = INFINITY;
-			ray.geomID = 1;
-			ray.primID = 0;
-			ray.mask = -1;
-			ray.time = 0;
-
-			rays[i + j * iN] = ray;
-		}
+	ReferenceRay rays[numSamples * numSamples];
+
+	// the cells are traced with a stride of 37, so the first rays are spread over the whole light
+	const int cellStride = 37;
+	for( int k = 0; k < iN * iN; ++k ) {
+		int cell = ( k * cellStride ) % ( iN * iN );
+		float randX = ( ( ( p[cell].x ) * 2.f ) - 1.f ) * jitterRad;
+		float randY = ( ( ( p[cell].y ) * 2.f ) - 1.f ) * jitterRad;
+		float3 testDir = dir + vDir1 * randX + vDir2 * randY;
+		ReferenceRay& ray = rays[k];
+		ray.Origin = pos;
+		ray.Direction = testDir;
+		ray.TNear = 0.001f;
+		ray.TFar = INFINITY;
+		ray.Hit = false;
 	}
 
-	RTCIntersectContext context;
-	context.flags = RTC_INTERSECT_COHERENT;
-
-	rtcOccluded1M( m_RTCScene, &context, rays, iN * iN, sizeof( RTCRay ) );
-
-	for( size_t i = 0; i < iN * iN; i++ ) {
-		if( rays[i].geomID )
-			shadowVal += 1.f;
+	// without a confidence all rays go in one batch
+	const int batchSize = confidence > 0.f ? 16 : iN * iN;
+	int numTraced = 0;
+	float shadowVal = 0.f;
+	while( numTraced < iN * iN ) {
+		int batch = Min( batchSize, iN * iN - numTraced );
+		Occluded( rays + numTraced, batch );
+		for( int i = numTraced; i < numTraced + batch; i++ ) {
+			if( !rays[i].Hit )
+				shadowVal += 1.f;
+		}
+		numTraced += batch;
+		if( numTraced == iN * iN )
+			break;
+
+		// wilson score interval of the hit ratio, unlike the normal approximation it doesn't collapse if all rays of the first batches agree
+		float n = static_cast<float>( numTraced );
+		float mean = shadowVal / n;
+		const float z = 1.96f;
+		float halfWidth = z / ( 1.f + z * z / n ) * sqrt( mean * ( 1.f - mean ) / n + z * z / ( 4.f * n * n ) );
+		if( halfWidth <= confidence )
+			break;
 	}
+	numRays += numTraced;
 
-	shadowVal /= fN * fN;
+	shadowVal /= numTraced;
 
 	return shadowVal;
 }
 
-void Embree::RenderTile( uint32_t idx, std::vector<uint32_t>& out, uint32_t width, uint32_t height, CamData & camData, const float3 & lightDir, float lightSize, uint2 numTiles ) {
+uint64_t Embree::RenderTile( uint32_t idx, std::vector<uint32_t>& out, std::vector<float>& shadowValues, uint32_t width, uint32_t height, CamData & camData, const float3 & lightDir, float lightSize, float confidence, uint2 numTiles ) {
 	uint32_t tileY = idx / numTiles.x;
 	uint32_t tileX = idx - tileY * numTiles.x;
 	uint32_t x0 = tileX * m_TileSize;
 	uint32_t x1 = Min( x0 + m_TileSize, width );
 	uint32_t y0 = tileY * m_TileSize;
 	uint32_t y1 = Min( y0 + m_TileSize, height );
+	uint32_t tileWidth = x1 - x0;
 
 	float3 pos = camData.Position;
 	float3 lookDir = camData.FwdDir;
@@ -173,47 +286,45 @@ void Embree::RenderTile( uint32_t idx, std::vector<uint32_t>& out, uint32_t widt
 
 	float jitterRad = tan( Deg2Rad( lightSize ) );
 
-	std::vector<RTCRay> rays;
-	rays.resize( width * height );
+	std::vector<ReferenceRay> rays;
+	rays.resize( tileWidth * ( y1 - y0 ) );
 
 	for( uint32_t y = y0; y < y1; y++ ) {
 		for( uint32_t x = x0; x < x1; x++ ) {
-			float3 dir = lookDir + screenDelta.x * ( x - hWidth ) * lookRight + screenDelta.y * ( hHeight - y ) * lookUp;
+			float3 dir = lookDir + screenDelta.x * ( static_cast<int>( x ) - hWidth ) * lookRight + screenDelta.y * ( hHeight - static_cast<int>( y ) ) * lookUp;
 
 			dir = Normalize( dir );
 
-			RTCRay& ray = rays[x + y*width];
-			ray.org[0] = pos.x; ray.org[1] = pos.y; ray.org[2] = pos.z;
-			ray.dir[0] = dir.x; ray.dir[1] = dir.y; ray.dir[2] = dir.z;
-			ray.tnear = 0.f;
-			ray.tfar = INFINITY;
-			ray.geomID = RTC_INVALID_GEOMETRY_ID;
-			ray.primID = RTC_INVALID_GEOMETRY_ID;
-			ray.mask = -1;
-			ray.time = 0;
+			ReferenceRay& ray = rays[( x - x0 ) + ( y - y0 ) * tileWidth];
+			ray.Origin = pos;
+			ray.Direction = dir;
+			ray.TNear = 0.f;
+			ray.TFar = INFINITY;
+			ray.Hit = false;
 		}
 	}
 
-	RTCIntersectContext context;
-	context.flags = RTC_INTERSECT_COHERENT;
-
-	rtcIntersect1M( m_RTCScene, &context, rays.data(), rays.size(), sizeof( RTCRay ) );
+	Intersect( rays.data(), rays.size() );
 
+	std::default_random_engine& engine = m_Engines.local();
+	uint32_t numRays = 0;
 	for( uint32_t y = y0; y < y1; y++ ) {
 		for( uint32_t x = x0; x < x1; x++ ) {
-			RTCRay& ray = rays[x + y*width];
-			if( ray.geomID != RTC_INVALID_GEOMETRY_ID ) {
+			ReferenceRay& ray = rays[( x - x0 ) + ( y - y0 ) * tileWidth];
+			if( ray.Hit ) {
 				float3 color = { .3f,.3f,.3f };
-				float3 diffuse = 1.f - color;
-				float3 normal = Normalize( { ray.Ng[0], ray.Ng[1], ray.Ng[2] } );
+				float3 diffuse = { 1.f, 1.f, 1.f };
+				float3 normal = Normalize( ray.Normal );
 
 				float3 hitPos = pos;
-				hitPos.x += ray.tfar * ray.dir[0];
-				hitPos.y += ray.tfar * ray.dir[1];
-				hitPos.z += ray.tfar * ray.dir[2];
+				hitPos.x += ray.TFar * ray.Direction.x;
+				hitPos.y += ray.TFar * ray.Direction.y;
+				hitPos.z += ray.TFar * ray.Direction.z;
 
-				float shadowVal = GetShadowVal( hitPos, lightDir, jitterRad );
+				// faces away from the light are 0 like in psShadow, they need no shadow rays
 				float lightVal = clamp( -Dot( lightDir, normal ), 0.0f, 1.0f );
+				float shadowVal = lightVal > 0.f ? GetShadowVal( hitPos, lightDir, jitterRad, confidence, engine, numRays ) : 0.f;
+				shadowValues[x + width*y] = shadowVal;
 
 				color = color + diffuse * lightVal * shadowVal;
 
@@ -227,106 +338,38 @@ void Embree::RenderTile( uint32_t idx, std::vector<uint32_t>& out, uint32_t widt
 		}
 	}
 
+	return numRays;
 }
 
-void Embree::Render( Texture * tex, Camera & camera, const float3& lightDir, float lightSize ) {
-	std::srand( static_cast<uint32_t>( time( 0 ) ) );
-	float3 pos = camera.GetTransform().GetWorldPosition();
-	float3 lookDir = camera.GetFwdVector();
-	float3 lookUp = camera.GetUpVector();
-	float3 lookRight = camera.GetRightVector();
-
-	int width = static_cast<int>( tex->GetTextureWidth() );
-	int height = static_cast<int>( tex->GetTextureHeight() );
-
-	float2 screenDelta;
-	screenDelta.y = 2.f * tan( camera.GetFoV() / 2.f );
-	screenDelta.x = screenDelta.y * camera.GetAspectRatio();
-
-	screenDelta.x /= width;
-	screenDelta.y /= height;
-
-	std::vector<uint32_t> out;
-	out.resize( width * height );
-
-	int hWidth = width / 2;
-	int hHeight = height / 2;
-
-	float jitterRad = tan( Deg2Rad( lightSize ) );
-
-	std::vector<RTCRay> rays;
-	rays.resize( width * height );
-
-	for( int y = 0; y < height; y++ ) {
-		for( int x = 0; x < width; x++ ) {
-			float3 dir = lookDir + screenDelta.x * ( x - hWidth ) * lookRight + screenDelta.y * ( hHeight - y ) * lookUp;
-
-			dir = Normalize( dir );
-
-			RTCRay ray;
-			ray.org[0] = pos.x; ray.org[1] = pos.y; ray.org[2] = pos.z;
-			ray.dir[0] = dir.x; ray.dir[1] = dir.y; ray.dir[2] = dir.z;
-			ray.tnear = 0.f;
-			ray.tfar = INFINITY;
-			ray.geomID = RTC_INVALID_GEOMETRY_ID;
-			ray.primID = RTC_INVALID_GEOMETRY_ID;
-			ray.mask = -1;
-			ray.time = 0;
-
-			rays[x + y*width] = ray;
-
-		}
-	}
-
-	RTCIntersectContext context;
-	context.flags = RTC_INTERSECT_COHERENT;
-
-	rtcIntersect1M( m_RTCScene, &context, rays.data(), rays.size(), sizeof( RTCRay ) );
-
-	for( int y = 0; y < height; y++ ) {
-		for( int x = 0; x < width; x++ ) {
-			RTCRay& ray = rays[x + y*width];
-			if( ray.geomID != RTC_INVALID_GEOMETRY_ID ) {
-				float3 color = { .3f,.3f,.3f };
-				float3 diffuse = { 1.f, 1.f, 1.f };
-				float3 normal = Normalize( { ray.Ng[0], ray.Ng[1], ray.Ng[2] } );
-
-				float3 hitPos = pos;
-				hitPos.x += ray.tfar * ray.dir[0];
-				hitPos.y += ray.tfar * ray.dir[1];
-				hitPos.z += ray.tfar * ray.dir[2];
-
-				float shadowVal = GetShadowVal( hitPos, lightDir, jitterRad );
-				float lightVal = clamp( -Dot( lightDir, normal ), 0.0f, 1.0f );
-				/*lightVal = shadowVal < lightVal ? shadowVal : lightVal;
-				if( lightVal < 0.3 )
-					lightVal = 0.3f;
-
-				color = diffuse * lightVal;*/
+void Embree::RenderTiles( std::vector<uint32_t>& out, std::vector<float>& shadowValues, uint32_t width, uint32_t height, CamData & camData, const float3 & lightDir, float lightSize, float confidence ) {
+	uint2 numTiles;
+	numTiles.x = ( width + m_TileSize - 1 ) / m_TileSize;
+	numTiles.y = ( height + m_TileSize - 1 ) / m_TileSize;
 
-				color = color + diffuse * lightVal * shadowVal;
+	shadowValues.assign( width * height, -1.f );
+	std::atomic<uint64_t> numRays( 0 );
+	float start = Game::GetTime().GetRealTime();
+	concurrency::parallel_for( size_t( 0 ), size_t( numTiles.x*numTiles.y ), [&]( size_t idx ) {
+		numRays += RenderTile( static_cast<uint32_t>( idx ), out, shadowValues, width, height, camData, lightDir, lightSize, confidence, numTiles );
+	} );
+	float time = Game::GetTime().GetRealTime() - start;
 
-				unsigned int r = (unsigned int)( 255.0f * clamp( color.x, 0.0f, 1.0f ) );
-				unsigned int g = (unsigned int)( 255.0f * clamp( color.y, 0.0f, 1.0f ) );
-				unsigned int b = (unsigned int)( 255.0f * clamp( color.z, 0.0f, 1.0f ) );
-				out[x + width*y] = 0xff000000 + ( b << 16 ) + ( g << 8 ) + r;
-			}
-			else
-				out[x + width*y] = 0xffff0000;
-		}
+	size_t numShaded = 0;
+	for( float value : shadowValues ) {
+		if( value >= 0.f )
+			numShaded++;
 	}
+	Game::GetLogger().Log( L"Embree", L"Reference rendered in " + std::to_wstring( time ) + L" s, " + std::to_wstring( numShaded ? static_cast<double>( numRays ) / numShaded : 0.0 )
+		+ L" shadow rays per pixel" + ( confidence > 0.f ? L" with a confidence of " + std::to_wstring( confidence ) : L"" ) );
+}
 
-	/*
-	int width = static_cast<int>( tex->GetTextureWidth() );
-	int height = static_cast<int>( tex->GetTextureHeight() );
+void Embree::Render( Texture * tex, Camera & camera, const float3& lightDir, float lightSize ) {
+	uint32_t width = tex->GetTextureWidth();
+	uint32_t height = tex->GetTextureHeight();
 
 	std::vector<uint32_t> out;
 	out.resize( width * height );
 
-	uint2 numTiles;
-	numTiles.x = ( width + m_TileSize - 1 ) / m_TileSize;
-	numTiles.y = ( height + m_TileSize - 1 ) / m_TileSize;
-
 	CamData camData;
 	camData.Position = camera.GetTransform().GetWorldPosition();
 	camData.FwdDir = camera.GetFwdVector();
@@ -338,12 +381,16 @@ void Embree::Render( Texture * tex, Camera & camera, const float3& lightDir, flo
 	camData.ScreenDelta.x /= width;
 	camData.ScreenDelta.y /= height;
 
-
-	concurrency::parallel_for( size_t( 0 ), size_t( numTiles.x*numTiles.y ), [&]( size_t idx ) {
-		//Game::GetLogger().PrintLine( std::to_wstring( idx ) );
-		RenderTile( idx, out, width, height, camData, lightDir, lightSize, numTiles );
-	} );
-	*/
+	// the fixed version goes first, so the image shows the adaptive one
+	std::vector<float> fixedValues;
+	if( m_Confidence > 0.f && m_CompareFixed )
+		RenderTiles( out, fixedValues, width, height, camData, lightDir, lightSize, 0.f );
+	RenderTiles( out, m_ShadowValues, width, height, camData, lightDir, lightSize, m_Confidence );
+	if( !fixedValues.empty() ) {
+		ImageDiff diff = CompareImages( fixedValues.data(), m_ShadowValues.data(), fixedValues.size() );
+		Game::GetLogger().Log( L"Embree", L"Adaptive against all rays: rmse " + std::to_wstring( diff.Rmse ) + L", psnr " + std::to_wstring( diff.Psnr )
+			+ L" dB, max error " + std::to_wstring( diff.MaxError ) );
+	}
 
 	tex->UpdateData( out.data(), width * sizeof( uint32_t ), 0 );
 
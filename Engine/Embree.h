@@ -1,27 +1,55 @@
 #pragma once
 
 #include <vector>
-
-#include "embree2\rtcore.h"
-#include "embree2\rtcore_ray.h"
+#include <random>
+#include <atomic>
+#include <ppl.h>
 
 #include "Types.h"
+#include "Bvh.h"
 
 class GameObject;
 class Texture;
 class Camera;
+class TransformCache;
+// device and scene of embree, only Embree.cpp includes the embree headers
+struct EmbreeScene;
+
+// ray of the reference renderer, the embree backend translates it to RTCRay
+struct ReferenceRay {
+	float3 Origin;
+	float3 Direction;
+	float TNear;
+	// distance of the closest hit after Intersect
+	float TFar;
+	// geometric normal of the hit, not normalized
+	float3 Normal;
+	bool Hit;
+};
 
 class Embree {
 public:
 	Embree();
 	~Embree();
 
-	bool Init();
-	void SetGeometry( std::vector<GameObject*> objects );
+	// useBvh traces with the own bvh instead of embree, it is also used if the embree device can't be created
+	bool Init( bool useBvh = false );
+	void SetGeometry( std::vector<GameObject*> objects, TransformCache& transformCache );
+
+	// a pixel stops shooting shadow rays once the 95% confidence interval of its value is within +-confidence, 0 always shoots all of them.
+	// compareFixed renders the shadows once more with all rays before and logs the error of the adaptive ones
+	void SetAdaptiveSampling( float confidence, bool compareFixed );
 
 	void Render( Texture* tex, Camera& camera, const float3& lightDir, float lightSize );
+	// shadow value of every pixel of the last render like the shadow textures of the voxelizer, -1 where the view ray missed
+	const std::vector<float>& GetShadowValues() const {
+		return m_ShadowValues;
+	}
 private:
-	float GetShadowVal( const float3& pos, const float3& dir, float jitterRad );
+	float GetShadowVal( const float3& pos, const float3& dir, float jitterRad, float confidence, std::default_random_engine& engine, uint32_t& numRays );
+	// closest hit and any hit with the backend in use
+	void Intersect( ReferenceRay* rays, size_t numRays );
+	void Occluded( ReferenceRay* rays, size_t numRays );
 
 	struct CamData {
 		float3 Position;
@@ -31,10 +59,21 @@ private:
 		float2 ScreenDelta;
 	};
 
-	void RenderTile( uint32_t idx, std::vector<uint32_t>& out, uint32_t width, uint32_t height, CamData& camData, const float3& lightDir, float lightSize, uint2 numTiles );
+	// returns the number of shadow rays
+	uint64_t RenderTile( uint32_t idx, std::vector<uint32_t>& out, std::vector<float>& shadowValues, uint32_t width, uint32_t height, CamData& camData, const float3& lightDir, float lightSize, float confidence, uint2 numTiles );
+	// shadow values of all pixels with the given confidence, logs the time and rays per pixel
+	void RenderTiles( std::vector<uint32_t>& out, std::vector<float>& shadowValues, uint32_t width, uint32_t height, CamData& camData, const float3& lightDir, float lightSize, float confidence );
+
+	EmbreeScene* m_EmbreeScene = nullptr;
+	bool m_UseBvh = false;
+	Bvh m_Bvh;
 
-	RTCDevice m_RTCDevice = nullptr;
-	RTCScene m_RTCScene = nullptr;
+	// every thread keeps its engine over all renders instead of seeding one per pixel
+	std::atomic<uint32_t> m_NumEngines;
+	concurrency::combinable<std::default_random_engine> m_Engines;
+	std::vector<float> m_ShadowValues;
+	float m_Confidence = 0.f;
+	bool m_CompareFixed = false;
 
 	uint32_t m_PictureID = 0;
 	const uint32_t m_TileSize = 100;
@@ -0,0 +1,65 @@
+#include "EmptyDistance.h"
+
+#include <ppl.h>
+
+#include "Makros.h"
+#include "Voxelizer.h"
+
+namespace {
+const uint32_t NodesPerTask = 4096;
+// in bit x + 4 * y + 16 * z of the linear mask
+const uint64_t FirstColumn = 0x1111111111111111ull;
+const uint64_t LastColumn = 0x8888888888888888ull;
+const uint64_t FirstRow = 0x000F000F000F000Full;
+const uint64_t LastRow = 0xF000F000F000F000ull;
+
+// position of child i of a node mask in a 4x4x4 grid, see GetNodePos
+uint32_t GetLinearPos( uint32_t child ) {
+	uint32_t x = ( child & 1 ) | ( ( child >> 2 ) & 2 );
+	uint32_t y = ( ( child >> 1 ) & 1 ) | ( ( child >> 3 ) & 2 );
+	uint32_t z = ( ( child >> 2 ) & 1 ) | ( ( child >> 4 ) & 2 );
+	return x + 4 * y + 16 * z;
+}
+
+// adds the 26 neighbours of every set cell, one chebyshev step
+uint64_t Dilate( uint64_t mask ) {
+	mask |= ( ( mask << 1 ) & ~FirstColumn ) | ( ( mask >> 1 ) & ~LastColumn );
+	mask |= ( ( mask << 4 ) & ~FirstRow ) | ( ( mask >> 4 ) & ~LastRow );
+	mask |= ( mask << 16 ) | ( mask >> 16 );
+	return mask;
+}
+}
+
+uint4 GetEmptyDistances( const uint2& mask ) {
+	uint64_t childMask = mask.x | ( static_cast<uint64_t>( mask.y ) << 32 );
+	uint64_t linear = 0;
+	for( uint32_t i = 0; i < 64; i++ ) {
+		if( ( childMask >> i ) & 1 )
+			linear |= 1ull << GetLinearPos( i );
+	}
+
+	// the distance of a cell is the number of dilations it isn't reached by, the 4x4x4 grid is covered after 3
+	uint64_t dilated[3];
+	dilated[0] = Dilate( linear );
+	dilated[1] = Dilate( dilated[0] );
+	dilated[2] = Dilate( dilated[1] );
+
+	uint32_t words[4] = { 0, 0, 0, 0 };
+	for( uint32_t i = 0; i < 64; i++ ) {
+		uint32_t pos = GetLinearPos( i );
+		uint32_t distance = 0;
+		for( uint64_t reached : dilated )
+			distance += ( ( reached >> pos ) & 1 ) ^ 1;
+		words[i / 16] |= distance << ( ( i % 16 ) * 2 );
+	}
+	return{ words[0], words[1], words[2], words[3] };
+}
+
+void ComputeEmptyDistances( const Node* nodes, uint32_t numNodes, uint4* distances ) {
+	uint32_t numTasks = ( numNodes + NodesPerTask - 1 ) / NodesPerTask;
+	concurrency::parallel_for( 0u, numTasks, [&]( uint32_t task ) {
+		uint32_t end = Min( ( task + 1 ) * NodesPerTask, numNodes );
+		for( uint32_t i = task * NodesPerTask; i < end; i++ )
+			distances[i] = GetEmptyDistances( nodes[i].Data );
+	} );
+}
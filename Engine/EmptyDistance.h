@@ -0,0 +1,17 @@
+#pragma once
+#include "Types.h"
+
+struct Node;
+
+// empty space distances of the children of a node, 2 bits per child in the order of the child mask (child i in word i / 16, bits ( i % 16 ) * 2).
+// the value of an empty child is its chebyshev distance to the nearest filled child of the same node minus 1, filled children have 0.
+// all cells of the node within that distance of the child are empty, so a traversal can leave this cube of cells in one step.
+// only the mask of the node is used, the value is valid for every instance of a shared node
+uint4 GetEmptyDistances( const uint2& mask );
+// one entry per node like ComputeApproximation, bricks get the distances of their voxels
+void ComputeEmptyDistances( const Node* nodes, uint32_t numNodes, uint4* distances );
+
+inline uint32_t GetEmptyDistance( const uint4& distances, uint32_t childPos ) {
+	uint32_t word = childPos < 32 ? ( childPos < 16 ? distances.x : distances.y ) : ( childPos < 48 ? distances.z : distances.w );
+	return ( word >> ( ( childPos & 0xf ) * 2 ) ) & 3;
+}
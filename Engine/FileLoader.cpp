@@ -2,6 +2,7 @@
 #include "FileLoader.h"
 
 #include <fstream>
+#include <ppl.h>
 
 #include "Makros.h"
 #include "Game.h"
@@ -11,9 +12,32 @@
 #include "DDSTextureLoader.h"
 #include "WICTextureLoader.h"
 #include "Mesh_generated.h"
-#include "Voxel_generated.h"
 #include "Voxelization_generated.h"
 #include "Voxelizer.h"
+#include "Time.h"
+#include "BoundedQueue.h"
+#include "ObjCache.h"
+#include "MeshFile.h"
+
+namespace {
+// reads one byte per page, so the pages of a mapping are loaded before they are needed
+void TouchPages( const uint8_t* data, size_t size ) {
+	volatile uint8_t sink = 0;
+	for( size_t offset = 0; offset < size; offset += 4096 )
+		sink += data[offset];
+}
+
+// files without an ending are dds files
+std::wstring GetTexLoadPath( const std::wstring& fileName, std::wstring& type ) {
+	size_t pos = fileName.rfind( '.' );
+	if( pos == std::wstring::npos ) {
+		type = L"dds";
+		return fileName + L".dds";
+	}
+	type = fileName.substr( pos + 1 );
+	return fileName;
+}
+}
 
 FileLoader & FileLoader::Init( ID3D11Device * device, ID3D11DeviceContext * context ) {
 	static FileLoader fileLoader( device, context );
@@ -21,13 +45,22 @@ FileLoader & FileLoader::Init( ID3D11Device * device, ID3D11DeviceContext * cont
 }
 
 ObjFileData FileLoader::GetObjFileData( const std::wstring & fileName, const std::wstring& path ) {
+	float start = Game::GetTime().GetRealTime();
+	std::wstring cacheName = path + fileName + L".cache";
+	bool useCache = Game::GetConfig().GetBool( L"CacheObjFiles", true );
+
+	ObjFileData data;
+	if( useCache && ReadObjCache( cacheName, path + fileName, path, data ) ) {
+		Game::GetLogger().Log( L"Loader", L"Loaded \"" + fileName + L"\" from cache in " + std::to_wstring( ( Game::GetTime().GetRealTime() - start ) * 1000.f ) + L" ms." );
+		return data;
+	}
+
 	std::string inputfile = ws2s( path + fileName );
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
 
 	std::string err;
 
-	ObjFileData data;
 	bool ret = tinyobj::LoadObj( shapes, materials, err, inputfile.c_str(), ws2s( path ).c_str() );
 
 	if( !err.empty() ) {
@@ -40,6 +73,10 @@ ObjFileData FileLoader::GetObjFileData( const std::wstring & fileName, const std
 
 	data.Shapes = shapes;
 	data.Materials = materials;
+	Game::GetLogger().Log( L"Loader", L"Parsed \"" + fileName + L"\" in " + std::to_wstring( ( Game::GetTime().GetRealTime() - start ) * 1000.f ) + L" ms." );
+
+	if( useCache )
+		WriteObjCache( cacheName, path + fileName, path, data );
 	return data;
 }
 
@@ -68,43 +105,18 @@ bool FileLoader::LoadObjFile( const std::wstring & fileName, const std::wstring&
 	}
 
 	// Create the textures
+	std::vector<std::wstring> texNames;
 	for( tinyobj::material_t& material : data.Materials ) {
-		if( !material.alpha_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.alpha_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.ambient_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.ambient_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.bump_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.bump_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.diffuse_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.diffuse_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.displacement_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.displacement_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.specular_highlight_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.specular_highlight_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
-		}
-		if( !material.specular_texname.empty() ) {
-			Texture* newTex( Texture::CreateFromFile( s2ws( material.specular_texname ) ) );
-			if( newTex )
-				loadedData.Textures.push_back( newTex );
+		for( const std::string* texName : { &material.alpha_texname, &material.ambient_texname, &material.bump_texname, &material.diffuse_texname,
+											&material.displacement_texname, &material.specular_highlight_texname, &material.specular_texname } ) {
+			if( !texName->empty() )
+				texNames.push_back( s2ws( *texName ) );
 		}
 	}
+	for( Texture* newTex : Texture::CreateFromFiles( texNames ) ) {
+		if( newTex )
+			loadedData.Textures.push_back( newTex );
+	}
 
 	if( geometries )
 		*geometries = loadedData.Geometries;
@@ -115,16 +127,10 @@ bool FileLoader::LoadObjFile( const std::wstring & fileName, const std::wstring&
 }
 
 bool FileLoader::LoadTexFile( const std::wstring & fileName, TextureResource*& texture, ShaderResourceView*& srv ) {
-	std::wstring loadPath = fileName;
-	size_t pos = loadPath.rfind( '.' );
 	std::wstring type;
-	if( pos == std::wstring::npos ) {
-		Game::GetLogger().Log( L"Texture", loadPath + L" has no file ending. DDS assumed." );
-		loadPath += L".dds";
-		type = L"dds";
-	}
-	else
-		type = loadPath.substr( pos + 1 );
+	std::wstring loadPath = GetTexLoadPath( fileName, type );
+	if( loadPath != fileName )
+		Game::GetLogger().Log( L"Texture", fileName + L" has no file ending. DDS assumed." );
 
 	HRESULT hr;
 	if( type == L"dds" ) {
@@ -141,120 +147,179 @@ bool FileLoader::LoadTexFile( const std::wstring & fileName, TextureResource*& t
 	return true;
 }
 
+bool FileLoader::ReadTexFile( const std::wstring & fileName, std::vector<uint8_t>& fileData ) {
+	std::wstring type;
+	MappedFile file;
+	if( !file.Open( GetTexLoadPath( fileName, type ) ) )
+		return false;
+	fileData.assign( file.GetData(), file.GetData() + file.GetSize() );
+	return true;
+}
+
+bool FileLoader::LoadTexFile( const std::wstring & fileName, const std::vector<uint8_t>& fileData, TextureResource*& texture, ShaderResourceView*& srv ) {
+	std::wstring type;
+	std::wstring loadPath = GetTexLoadPath( fileName, type );
+	if( loadPath != fileName )
+		Game::GetLogger().Log( L"Texture", fileName + L" has no file ending. DDS assumed." );
+
+	// an empty buffer from a failed read is rejected by the loaders
+	HRESULT hr;
+	if( type == L"dds" ) {
+		hr = DirectX::CreateDDSTextureFromMemory( m_Device, m_Context, fileData.data(), fileData.size(), &texture, &srv );
+	}
+	else {
+		hr = DirectX::CreateWICTextureFromMemory( m_Device, m_Context, fileData.data(), fileData.size(), &texture, &srv );
+	}
+
+	if( FAILED( hr ) ) {
+		Game::GetLogger().FatalError( L"Could not open file " + loadPath );
+		return false;
+	}
+	return true;
+}
+
 bool FileLoader::LoadMeshFile( const std::wstring & fileName, std::vector<Geometry*>* geometries ) {
 	Game::GetLogger().Log( L"Loader", L"Loading mesh " + fileName + L"." );
 	using namespace Loader::Mesh;
-	std::ifstream file( fileName, std::ios::in | std::ios::binary );
-	if( !file.is_open() ) {
+	MappedFile file;
+	if( !file.Open( fileName ) ) {
 		Game::GetLogger().Log( L"Loader", L"Loading failed. Couldn't open file \"" + fileName + L"\"." );
 		return false;
 	}
-	std::string data = std::string( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
 
-	flatbuffers::FlatBufferBuilder builder;
-	builder.PushFlatBuffer( reinterpret_cast<const uint8_t*>( data.c_str() ), data.size() );
+	flatbuffers::Verifier verifier( file.GetData(), file.GetSize() );
+	if( !VerifyMeshesBuffer( verifier ) || !GetMeshes( file.GetData() )->Objects() ) {
+		Game::GetLogger().Log( L"Loader", L"Loading failed. File \"" + fileName + L"\" is corrupted." );
+		return false;
+	}
 
-	auto meshes = GetMeshes( builder.GetBufferPointer() )->Objects();
-	for( uint32_t i = 0; i < static_cast<uint32_t>( meshes->size() ); i++ ) {
-		auto mesh = meshes->Get( i );
-		const float3* positions = reinterpret_cast<const float3*>( mesh->Positions()->Get( 0 ) );
-		const float3* normals = reinterpret_cast<const float3*>( mesh->Normals()->Get( 0 ) );
-		const uint32_t* indices = mesh->Indices()->data();
-		uint32_t numVertices = mesh->Positions()->size();
-		uint32_t numIndices = mesh->Indices()->size();
+	auto meshes = GetMeshes( file.GetData() )->Objects();
+	uint32_t numMeshes = static_cast<uint32_t>( meshes->size() );
+	uint32_t version = GetMeshes( file.GetData() )->Version();
+
+	// three stages connected by bounded queues: a worker reads and decodes the meshes, a second one copies them
+	// into the geometry and creates the device buffers and the main thread registers the finished geometries.
+	// the device is free threaded, only the geometry manager has to stay on the main thread
+	std::vector<DecodedMesh> decodedMeshes( version >= 2 ? numMeshes : 0 );
+	std::vector<uint8_t> decoded( numMeshes, false );
+	BoundedQueue<uint32_t> readMeshes( 4 );
+	BoundedQueue<Geometry*> builtMeshes( 4 );
+	concurrency::task_group loadTasks;
+	loadTasks.run( [&]() {
+		for( uint32_t i = 0; i < numMeshes; i++ ) {
+			auto mesh = meshes->Get( i );
+			if( version >= 2 ) {
+				decoded[i] = DecodeMesh( *mesh, decodedMeshes[i] );
+			}
+			else if( mesh->Positions() && mesh->Normals() && mesh->Indices() ) {
+				TouchPages( mesh->Positions()->Data(), mesh->Positions()->size() * sizeof( float3 ) );
+				TouchPages( mesh->Normals()->Data(), mesh->Normals()->size() * sizeof( float3 ) );
+				TouchPages( mesh->Indices()->Data(), mesh->Indices()->size() * sizeof( uint32_t ) );
+			}
+			readMeshes.Push( i );
+		}
+		readMeshes.Close();
+	} );
+	loadTasks.run( [&]() {
+		uint32_t i;
+		while( readMeshes.Pop( i ) ) {
+			auto mesh = meshes->Get( i );
+			const float3* positions;
+			const float3* normals;
+			const uint32_t* indices;
+			const std::pair<float3, float3>* bounds = nullptr;
+			uint32_t numVertices;
+			uint32_t numIndices;
+			if( version >= 2 ) {
+				if( !decoded[i] ) {
+					Game::GetLogger().Log( L"Loader", L"Skipping incomplete mesh " + std::to_wstring( i ) + L" in file \"" + fileName + L"\"." );
+					continue;
+				}
+				positions = decodedMeshes[i].Positions.data();
+				normals = decodedMeshes[i].Normals.data();
+				indices = decodedMeshes[i].Indices.data();
+				numVertices = static_cast<uint32_t>( decodedMeshes[i].Positions.size() );
+				numIndices = static_cast<uint32_t>( decodedMeshes[i].Indices.size() );
+				// empty meshes are stored with a box at the origin
+				if( numVertices > 0 )
+					bounds = &decodedMeshes[i].Bounds;
+			}
+			else {
+				if( !mesh->Positions() || !mesh->Normals() || !mesh->Indices() || mesh->Normals()->size() != mesh->Positions()->size() ) {
+					Game::GetLogger().Log( L"Loader", L"Skipping incomplete mesh " + std::to_wstring( i ) + L" in file \"" + fileName + L"\"." );
+					continue;
+				}
+				// the geometry copies the data into its own buffers, so it can be read straight from the mapping
+				positions = reinterpret_cast<const float3*>( mesh->Positions()->Data() );
+				normals = reinterpret_cast<const float3*>( mesh->Normals()->Data() );
+				indices = mesh->Indices()->data();
+				numVertices = mesh->Positions()->size();
+				numIndices = mesh->Indices()->size();
+			}
+
+			builtMeshes.Push( Geometry::CreateUnregistered( L"", positions, normals, nullptr, numVertices, indices, numIndices, PrimitiveTopology::Trianglelist, bounds ) );
+
+			if( version >= 2 )
+				decodedMeshes[i] = DecodedMesh();
+		}
+		builtMeshes.Close();
+	} );
 
+	Geometry* geometry;
+	while( builtMeshes.Pop( geometry ) ) {
+		geometry->Register();
 		if( geometries )
-			geometries->push_back( Geometry::Create( L"", positions, normals, nullptr, numVertices, indices, numIndices, PrimitiveTopology::Trianglelist ) );
-		Game::GetLogger().Log( L"Loader", L"Loaded mesh with " + std::to_wstring( numVertices ) + L" vertices and " + std::to_wstring( numIndices / 3 ) + L" triangles." );
+			geometries->push_back( geometry );
+		Game::GetLogger().Log( L"Loader", L"Loaded mesh with " + std::to_wstring( geometry->GetAlignedPositions().size() ) + L" vertices and " + std::to_wstring( geometry->GetTriangleCount() ) + L" triangles." );
 	}
+	loadTasks.wait();
 
 	return true;
 }
 
-bool FileLoader::StoreTreeData( uint32_t resolution, float3 position, float3 size, const Node * nodes, uint32_t numNodes, const uint32_t * pointers, uint32_t numPointers, const std::wstring & fileName ) {
-	using namespace Loader::Voxel;
-	flatbuffers::FlatBufferBuilder builder;
-
-	const Loader::Voxel::Node* voxNodes = reinterpret_cast<const Loader::Voxel::Node*>( nodes );
-
-	auto nodeVec = builder.CreateVectorOfStructs( voxNodes, numNodes );
-	auto ptrVec = builder.CreateVector( pointers, numPointers );
-
-	Loader::Voxel::float3* fbPos = reinterpret_cast<Loader::Voxel::float3*>( &position );
-	Loader::Voxel::float3* fbSize = reinterpret_cast<Loader::Voxel::float3*>( &size );
-	
-	auto obj = CreateVoxelObject( builder, resolution, fbPos, fbSize, nodeVec, ptrVec );
-
-	FinishVoxelObjectBuffer( builder, obj );
-
-	std::ofstream file( fileName, std::ios::out | std::ios::trunc | std::ios::binary );
-	if( !file.is_open() ) {
-		Game::GetLogger().Log( L"Loader", L"Creating file \"" + fileName + L"\" failed for storing voxel data." );
-		return false;
-	}
-
-	file.write( reinterpret_cast<char*>( builder.GetBufferPointer() ), builder.GetSize() );
-	file.close();
+bool FileLoader::StoreTreeData( uint32_t resolution, float3 position, float3 size, const Node * nodes, uint32_t numNodes, const uint32_t * pointers, uint32_t numPointers, const std::wstring & fileName, bool compress ) {
+	return StoreTreeFile( resolution, position, size, nodes, numNodes, pointers, numPointers, fileName, compress );
+}
 
-	if( file.bad() ) {
-		Game::GetLogger().Log( L"Loader", L"Storing voxel data into file \"" + fileName + L"\" failed." );
+bool FileLoader::MapTreeData( const std::wstring & fileName, MappedFile & file, TreeView & tree ) {
+	if( !MapTreeFile( fileName, file, tree ) ) {
+		Game::GetLogger().Log( L"Loader", L"Revoxalizing." );
 		return false;
 	}
 	return true;
 }
 
 bool FileLoader::LoadTreeData( const std::wstring & fileName, std::vector<Node>& nodes, std::vector<uint32_t>& pointer, uint32_t& resolution, float3& position, float3& size ) {
-	using namespace Loader::Voxel;
-	std::ifstream file( fileName, std::ios::in | std::ios::binary );
-	if( !file.is_open() ) {
-		Game::GetLogger().Log( L"Loader", L"Opening voxel file \"" + fileName + L"\" failed. Revoxalizing." );
+	MappedFile file;
+	TreeView tree;
+	if( !MapTreeData( fileName, file, tree ) )
 		return false;
-	}
-
-	std::string data = std::string( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
-
-	flatbuffers::FlatBufferBuilder builder;
-	builder.PushFlatBuffer( reinterpret_cast<const uint8_t*>( data.c_str() ), data.size() );
-
-	auto obj = GetVoxelObject( builder.GetBufferPointer() );
-	
-	const ::Node* nodePtr = reinterpret_cast<const ::Node*>( obj->Nodes()->Get( 0 ) );
-	uint32_t numNodes = obj->Nodes()->size();
 
-	nodes.assign( nodePtr, nodePtr + numNodes );
-	pointer.assign( obj->Pointers()->begin(), obj->Pointers()->end() );
+	nodes.assign( tree.Nodes.begin(), tree.Nodes.end() );
+	pointer.assign( tree.Pointers.begin(), tree.Pointers.end() );
 
-	resolution = obj->Resolution();
-	position = *reinterpret_cast<const ::float3*>( obj->Position() );
-	size = *reinterpret_cast<const ::float3*>( obj->Size() );
+	resolution = tree.Resolution;
+	position = tree.Position;
+	size = tree.Size;
 
 	return true;
 }
 
 bool FileLoader::LoadTreeData( const std::wstring & fileName, Node * nodes, uint32_t& numNodes, uint32_t * pointer, uint32_t& numPointers, uint32_t& resolution, float3& position, float3& size ) {
-	using namespace Loader::Voxel;
-	std::ifstream file( fileName, std::ios::in | std::ios::binary );
-	if( !file.is_open() ) {
-		Game::GetLogger().Log( L"Loader", L"Opening voxel file \"" + fileName + L"\" failed. Revoxalizing." );
+	MappedFile file;
+	TreeView tree;
+	if( !MapTreeData( fileName, file, tree ) )
 		return false;
-	}
-
-	std::string data = std::string( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
-
-	flatbuffers::FlatBufferBuilder builder;
-	builder.PushFlatBuffer( reinterpret_cast<const uint8_t*>( data.c_str() ), data.size() );
-
-	auto obj = GetVoxelObject( builder.GetBufferPointer() );
 
-	numNodes = obj->Nodes()->size();
-	memcpy( nodes, obj->Nodes()->Get( 0 ), numNodes * sizeof( ::Node ) );
+	numNodes = static_cast<uint32_t>( tree.Nodes.Size );
+	memcpy( nodes, tree.Nodes.Data, numNodes * sizeof( Node ) );
 
-	numPointers = obj->Pointers()->size();
-	memcpy( pointer, obj->Pointers()->data(), numPointers * sizeof( uint32_t ) );
+	numPointers = static_cast<uint32_t>( tree.Pointers.Size );
+	memcpy( pointer, tree.Pointers.Data, numPointers * sizeof( uint32_t ) );
 
-	resolution = obj->Resolution();
-	position = *reinterpret_cast<const ::float3*>( obj->Position() );
-	size = *reinterpret_cast<const ::float3*>( obj->Size() );
+	resolution = tree.Resolution;
+	position = tree.Position;
+	size = tree.Size;
 
 	return true;
 }
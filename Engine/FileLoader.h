@@ -3,6 +3,8 @@
 #include <d3d11.h>
 
 #include "Types.h"
+#include "MappedFile.h"
+#include "TreeFile.h"
 #include "tiny_obj_loader.h"
 
 class Geometry;
@@ -27,9 +29,14 @@ public:
 
 	bool LoadObjFile( const std::wstring& fileName, const std::wstring& path, std::vector<Geometry*>* geometries = nullptr, std::vector<Texture*>* textures = nullptr );
 	bool LoadTexFile( const std::wstring& fileName, TextureResource*& texture, ShaderResourceView*& srv );
+	// reading doesn't touch the device, so it can run on a loader thread
+	bool ReadTexFile( const std::wstring& fileName, std::vector<uint8_t>& fileData );
+	bool LoadTexFile( const std::wstring& fileName, const std::vector<uint8_t>& fileData, TextureResource*& texture, ShaderResourceView*& srv );
 	bool LoadMeshFile( const std::wstring& fileName, std::vector<Geometry*>* geometries );
 
-	bool StoreTreeData( uint32_t resolution, float3 position, float3 size, const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t numPointers, const std::wstring& fileName );
+	bool StoreTreeData( uint32_t resolution, float3 position, float3 size, const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t numPointers, const std::wstring& fileName, bool compress = false );
+	// maps and verifies the file, the view stays valid as long as file is open. compressed files are decoded into the view
+	bool MapTreeData( const std::wstring& fileName, MappedFile& file, TreeView& tree );
 	bool LoadTreeData( const std::wstring& fileName, std::vector<Node>& nodes, std::vector<uint32_t>& pointer, uint32_t& resolution, float3& position, float3& size );
 	bool LoadTreeData( const std::wstring& fileName, Node* nodes, uint32_t& numNodes, uint32_t* pointer, uint32_t& numPointers, uint32_t& resolution, float3& position, float3& size );
 	bool StoreVoxelData( uint32_t resolution, float3 position, float3 size, const std::vector<std::vector<Node>>& voxelParts, const std::wstring& fileName );
@@ -1,13 +1,5 @@
 #include "Game.h"
 
-#include "Application.h"
-#include "RenderBackend.h"
-#include "Window.h"
-#include "InputManager.h"
-#include "GameObjectManager.h"
-#include "Time.h"
-#include "Logger.h"
-
 void Game::SetApplication( Application & application ) {
 	Get().m_Application = &application;
 }
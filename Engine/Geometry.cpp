@@ -29,6 +29,16 @@ Geometry * Geometry::Create( const std::wstring & name, const float3 * positions
 	return new Geometry( name, positions, normals, texCoords, numVertices, indices, numIndices, topology );
 }
 
+Geometry * Geometry::CreateUnregistered( const std::wstring & name, const float3 * positions, const float3 * normals, const float2 * texCoords, uint32_t numVertices, const uint32_t * indices, uint32_t numIndices, PrimitiveTopology topology, const std::pair<float3, float3>* bounds ) {
+	return new Geometry( name, positions, normals, texCoords, numVertices, indices, numIndices, topology, false, bounds );
+}
+
+void Geometry::Register() {
+	if( !s_GeometryManager->RegisterGeometry( *this, m_ID ) )
+		if( m_Name.size() > 0 )
+			Game::GetLogger().Log( L"Geometry", L"Name \"" + m_Name + L"\" already taken. New Geometry not accessible through name" );
+}
+
 Geometry * Geometry::Get( const std::wstring & name ) {
 	return s_GeometryManager->GetGeometry( name );
 }
@@ -357,7 +367,7 @@ DynamicGeometry::DynamicGeometry( const std::wstring& name, Buffer* vertexBuffer
 
 
 Geometry::Geometry( const std::wstring& name, const float3* positions, const float3* normals, const float2* texCoords, uint32_t numVertices,
-					const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology )
+					const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology, bool registerGeometry, const std::pair<float3, float3>* bounds )
 	: m_Name( name )
 	, m_VertexCount( numVertices )
 	, m_IndexCount( numIndices )
@@ -365,9 +375,17 @@ Geometry::Geometry( const std::wstring& name, const float3* positions, const flo
 	, m_DrawIndexed( true )
 	, m_Topology( topology ) {
 
+	if( bounds ) {
+		m_BoxMin = bounds->first;
+		m_BoxMax = bounds->second;
+	}
 	m_AlignedPositions.reserve( m_VertexCount );
 	for( uint32_t i = 0; i < m_VertexCount; ++i ) {
 		m_AlignedPositions.push_back( make_float3a( positions[i] ) );
+		if( !bounds ) {
+			m_BoxMin = { Min( m_BoxMin.x, positions[i].x ), Min( m_BoxMin.y, positions[i].y ), Min( m_BoxMin.z, positions[i].z ) };
+			m_BoxMax = { Max( m_BoxMax.x, positions[i].x ), Max( m_BoxMax.y, positions[i].y ), Max( m_BoxMax.z, positions[i].z ) };
+		}
 	}
 	m_TriangleIndices.reserve( m_IndexCount / 3 );
 	for( uint32_t i = 0; i < m_IndexCount / 3; ++i ) {
@@ -415,8 +433,6 @@ Geometry::Geometry( const std::wstring& name, const float3* positions, const flo
 	srvDesc.Buffer.NumElements = numIndices;
 	m_IndexSRV = renderBackend->CreateSRV( m_IndexBuffer, &srvDesc );
 
-
-	if( !s_GeometryManager->RegisterGeometry( *this, m_ID ) )
-		if( name.size() > 0 )
-			Game::GetLogger().Log( L"Geometry", L"Name \"" + name + L"\" already taken. New Geometry not accessible through name" );
+	if( registerGeometry )
+		Register();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <cfloat>
 
 #include "D3DWrapper.h"
 #include "RenderBackend.h"
@@ -39,6 +40,11 @@ public:
 							 const std::vector<float2>& texCoords, const std::vector<uint32_t>& indices, PrimitiveTopology topology );
 	static Geometry* Create( const std::wstring& name, const float3* positions, const float3* normals, const float2* texCoords, uint32_t numVertices,
 							 const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology );
+	// only creates the buffers, so a loader thread can build it. Register has to be called on the main thread before it is used.
+	// bounds stored with the mesh are taken as they are instead of being computed from the positions
+	static Geometry* CreateUnregistered( const std::wstring& name, const float3* positions, const float3* normals, const float2* texCoords, uint32_t numVertices,
+										 const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology, const std::pair<float3, float3>* bounds = nullptr );
+	void Register();
 
 	static Geometry* Get( const std::wstring& name );
 	static Geometry* Get( uint32_t id );
@@ -60,12 +66,19 @@ public:
 	ShaderResourceView* GetIndexSRV() const {
 		return m_IndexSRV;
 	}
-	const std::vector<float3a>& GetAlignedPositions() {
+	const std::vector<float3a>& GetAlignedPositions() const {
 		return m_AlignedPositions;
 	}
-	const std::vector<uint3>& GetTriangleIndices(){
+	const std::vector<uint3>& GetTriangleIndices() const {
 		return m_TriangleIndices;
 	}
+	// object space bounds of the aligned positions, min is above max without them
+	const float3& GetBoxMin() const {
+		return m_BoxMin;
+	}
+	const float3& GetBoxMax() const {
+		return m_BoxMax;
+	}
 
 	static Geometry& GetTriangleGeometry();
 	static Geometry& GetPlaneGeometry();
@@ -79,7 +92,7 @@ protected:
 	template<typename T>
 	Geometry( const std::wstring& name, const std::vector<T>& vertices, const std::vector<uint32_t>& indices, PrimitiveTopology topology, bool isDynamic = false );
 	Geometry( const std::wstring& name, const float3* positions, const float3* normals, const float2* texCoords, uint32_t numVertices,
-			  const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology );
+			  const uint32_t* indices, uint32_t numIndices, PrimitiveTopology topology, bool registerGeometry = true, const std::pair<float3, float3>* bounds = nullptr );
 	virtual ~Geometry();
 
 	std::wstring m_Name;
@@ -97,6 +110,8 @@ protected:
 
 	std::vector<float3a> m_AlignedPositions;
 	std::vector<uint3> m_TriangleIndices;
+	float3 m_BoxMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float3 m_BoxMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
 
 	bool m_SeperateBuffers = false;
 
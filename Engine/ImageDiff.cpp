@@ -0,0 +1,26 @@
+#include "ImageDiff.h"
+
+#include <cmath>
+
+#include "Makros.h"
+
+ImageDiff CompareImages( const float * reference, const float * image, size_t numPixels ) {
+	ImageDiff diff;
+	double squaredError = 0.0;
+	for( size_t i = 0; i < numPixels; i++ ) {
+		if( reference[i] < 0.f )
+			continue;
+		float error = std::abs( image[i] - reference[i] );
+		squaredError += static_cast<double>( error ) * error;
+		diff.MaxError = Max( diff.MaxError, error );
+		diff.NumPixels++;
+	}
+	if( diff.NumPixels == 0 )
+		return diff;
+
+	double meanSquaredError = squaredError / diff.NumPixels;
+	diff.Rmse = static_cast<float>( sqrt( meanSquaredError ) );
+	// the peak value is 1
+	diff.Psnr = meanSquaredError > 0.0 ? static_cast<float>( -10.0 * log10( meanSquaredError ) ) : INFINITY;
+	return diff;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// error of an image against a reference, both with values in [0, 1] like the shadow textures
+struct ImageDiff {
+	float Rmse = 0.f;
+	// in dB, infinite for equal images
+	float Psnr = 0.f;
+	float MaxError = 0.f;
+	// pixels that got compared
+	size_t NumPixels = 0;
+};
+
+// pixels with a negative reference value are skipped, like the misses of Embree::GetShadowValues
+ImageDiff CompareImages( const float* reference, const float* image, size_t numPixels );
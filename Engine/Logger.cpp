@@ -4,9 +4,11 @@
 #include <sstream>
 #include <iomanip>
 #include <cassert>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 #include "Game.h"
-#include "Application.h"
 
 Logger & Logger::InitMainLogger() {
 	static Logger mainLogger;
@@ -23,22 +25,27 @@ Logger::~Logger() {
 }
 
 void Logger::Init() {
+#ifdef _WIN32
 	AllocConsole();
 	m_ConsoleHandle = GetStdHandle( STD_OUTPUT_HANDLE );
+#endif
 	CreateLogDirectory( m_LogDir );
 }
 
 void Logger::Log( const std::wstring & info ) {
+	std::lock_guard<std::recursive_mutex> lock( m_Mutex );
 	PrintToLogFile( info );
 	PrintLine( info );
 }
 
 void Logger::Log( const std::wstring & name, const std::wstring & info ) {
+	std::lock_guard<std::recursive_mutex> lock( m_Mutex );
 	PrintToSeperateFile( name, info );
 	PrintLine( name + L": " + info );
 }
 
 void Logger::PrintToLogFile( const std::wstring& info ) {
+	std::lock_guard<std::recursive_mutex> lock( m_Mutex );
 	if( !m_IsLogfileCreated )
 		if( !CreateStdLogFile() )
 			return;
@@ -47,6 +54,7 @@ void Logger::PrintToLogFile( const std::wstring& info ) {
 }
 
 void Logger::PrintToSeperateFile( const std::wstring& fileName, const std::wstring& info ) {
+	std::lock_guard<std::recursive_mutex> lock( m_Mutex );
 	auto it = m_OpenLogFiles.find( fileName );
 	if( it == m_OpenLogFiles.end() )
 		CreateLogFile( fileName );
@@ -56,13 +64,27 @@ void Logger::PrintToSeperateFile( const std::wstring& fileName, const std::wstri
 }
 
 void Logger::FatalError( const std::wstring& info ) {
-	MessageBox( NULL, info.c_str(), L"Fatal Error", MB_OK );
+#ifdef _WIN32
+	if( m_ShowMessageBox )
+		MessageBox( NULL, info.c_str(), L"Fatal Error", MB_OK );
+	else
+		PrintLine( L"Fatal Error: " + info );
+#else
+	PrintLine( L"Fatal Error: " + info );
+#endif
 	exit( -1 );
 }
 
 void Logger::Print( const std::wstring & info ) {
+	std::lock_guard<std::recursive_mutex> lock( m_Mutex );
 	std::wstring out = info;
-	WriteConsole( m_ConsoleHandle, out.c_str(), static_cast<DWORD>( out.size() ), nullptr, nullptr );
+#ifdef _WIN32
+	// fails if the output is redirected into a file or pipe
+	if( !WriteConsole( m_ConsoleHandle, out.c_str(), static_cast<DWORD>( out.size() ), nullptr, nullptr ) )
+		std::wcout << out << std::flush;
+#else
+	std::wcout << out << std::flush;
+#endif
 }
 
 void Logger::ResetCursor() {
@@ -76,25 +98,35 @@ void Logger::SetLogDir( const std::wstring & dir ) {
 
 void Logger::CreateLogDirectory( const std::wstring & dir ) {
 	// only creates directory if it doesn't already exist
+#ifdef _WIN32
 	if( GetFileAttributes( dir.c_str() ) == INVALID_FILE_ATTRIBUTES ) {
 		if( !CreateDirectory( dir.c_str(), NULL ) ) {
 			FatalError( L"Couldn't create Log directory" );
 			return;
 		}
 	}
+#else
+	struct stat info;
+	if( stat( FilePath( dir ).c_str(), &info ) != 0 ) {
+		if( mkdir( FilePath( dir ).c_str(), 0755 ) != 0 ) {
+			FatalError( L"Couldn't create Log directory" );
+			return;
+		}
+	}
+#endif
 }
 
 bool Logger::CreateStdLogFile() {
 	if( m_IsLogfileCreated )
 		return true;
-	std::wofstream file( m_StdLogFile, std::ios::out | std::ios::trunc );
+	std::wofstream file( FilePath( m_StdLogFile ), std::ios::out | std::ios::trunc );
 	if( !file.is_open() ) {
 		file.close();
 		FatalError( L"Failed creating standard log File" );
 		return false;
 	}
 	m_IsLogfileCreated = true;
-	m_StdFile.open( m_StdLogFile, std::ios::out | std::ios::trunc );
+	m_StdFile.open( FilePath( m_StdLogFile ), std::ios::out | std::ios::trunc );
 	return true;
 }
 
@@ -103,14 +135,14 @@ bool Logger::CreateLogFile( const std::wstring& fileName ) {
 		return true;
 
 	std::wstring path = m_LogDir + fileName + L".txt";
-	std::wofstream file( path, std::ios::out | std::ios::trunc );
+	std::wofstream file( FilePath( path ), std::ios::out | std::ios::trunc );
 	if( !file.is_open() ) {
 		file.close();
 		FatalError( L"Failed creating log File " + fileName );
 		return false;
 	}
 	file.close();
-	m_OpenLogFiles.emplace( fileName, std::wofstream( path, std::ios::out | std::ios::trunc ) );
+	m_OpenLogFiles.emplace( fileName, std::wofstream( FilePath( path ), std::ios::out | std::ios::trunc ) );
 
 	return true;
 }
@@ -1,10 +1,14 @@
 #pragma once
 #include <string>
 #include <unordered_map>
-#include <Windows.h>
 #include <fstream>
+#include <mutex>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
 
 #include "Types.h"
+#include "Platform.h"
 
 class Logger
 {
@@ -39,6 +43,10 @@ public:
 	void Print( const std::wstring& info );
 	void ResetCursor();
 	void SetLogDir( const std::wstring& dir );
+	// tools without a window print fatal errors instead of waiting on a message box
+	void SetShowMessageBox( bool show ) {
+		m_ShowMessageBox = show;
+	}
 private:
 	void CreateLogDirectory( const std::wstring& dir );
 
@@ -49,8 +57,14 @@ private:
 
 	bool m_IsLogfileCreated;
 
+#ifdef _WIN32
 	HANDLE m_ConsoleHandle;
+#endif
 	std::wstring m_LogDir = L"./Log/";
+	bool m_ShowMessageBox = true;
+
+	// logging is also done from worker threads
+	std::recursive_mutex m_Mutex;
 };
 
 namespace std {
@@ -78,7 +92,7 @@ std::wstring FloatToString( float val, int accuracy );
 
 template<typename T>
 inline bool Logger::SaveToFile( const std::wstring & fileName, const T& object ) {
-	std::ofstream file( fileName, std::ios::out | std::ios::trunc | std::ios::binary );
+	std::ofstream file( FilePath( fileName ), std::ios::out | std::ios::trunc | std::ios::binary );
 	if( !file.is_open() ) {
 		Log( L"Logger", L"Saving to file \"" + fileName + L"\" failed" );
 		return false;
@@ -91,7 +105,7 @@ inline bool Logger::SaveToFile( const std::wstring & fileName, const T& object )
 
 template<typename T>
 inline bool Logger::LoadFromFile( const std::wstring & fileName, T * object ) {
-	std::ifstream file( fileName, std::ios::in | std::ios::binary );
+	std::ifstream file( FilePath( fileName ), std::ios::in | std::ios::binary );
 	if( !file.is_open() ) {
 		Log( L"Logger", L"Loading file \"" + fileName + L"\" failed" );
 		return false;
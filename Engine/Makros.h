@@ -4,10 +4,12 @@
 #include <functional>
 #include <vector>
 #include <codecvt>
+#include <locale>
 #include <algorithm>
 #include <map>
 #include <unordered_map>
 #include <array>
+#include <cmath>
 
 #include "Types.h"
 
@@ -155,7 +157,7 @@ inline float Round( float val, float accuracy = 1.0f ) {
 
 template<typename T>
 inline bool CheckFlag( T a, T b ) {
-	typedef std::underlying_type<WriteEnable>::type enum_type;
+	typedef typename std::underlying_type<T>::type enum_type;
 	return ( static_cast<enum_type>( a ) & static_cast<enum_type>( b ) ) != 0;
 }
 
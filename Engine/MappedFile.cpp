@@ -0,0 +1,91 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Platform.h"
+#endif
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open( const std::wstring & fileName ) {
+	Close();
+
+#ifdef _WIN32
+	m_File = CreateFileW( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if( m_File == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	// empty files can't be mapped
+	if( !GetFileSizeEx( m_File, &fileSize ) || fileSize.QuadPart == 0 ) {
+		Close();
+		return false;
+	}
+
+	m_Mapping = CreateFileMappingW( m_File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( !m_Mapping ) {
+		Close();
+		return false;
+	}
+
+	m_Data = static_cast<const uint8_t*>( MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	if( !m_Data ) {
+		Close();
+		return false;
+	}
+	m_Size = static_cast<size_t>( fileSize.QuadPart );
+#else
+	m_File = open( FilePath( fileName ).c_str(), O_RDONLY );
+	if( m_File < 0 )
+		return false;
+
+	struct stat info;
+	// empty files can't be mapped
+	if( fstat( m_File, &info ) != 0 || info.st_size == 0 ) {
+		Close();
+		return false;
+	}
+
+	void* data = mmap( nullptr, static_cast<size_t>( info.st_size ), PROT_READ, MAP_PRIVATE, m_File, 0 );
+	if( data == MAP_FAILED ) {
+		Close();
+		return false;
+	}
+	m_Data = static_cast<const uint8_t*>( data );
+	m_Size = static_cast<size_t>( info.st_size );
+#endif
+
+	return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+	if( m_Data )
+		UnmapViewOfFile( m_Data );
+	if( m_Mapping )
+		CloseHandle( m_Mapping );
+	if( m_File != INVALID_HANDLE_VALUE )
+		CloseHandle( m_File );
+
+	m_Mapping = nullptr;
+	m_File = INVALID_HANDLE_VALUE;
+#else
+	if( m_Data )
+		munmap( const_cast<uint8_t*>( m_Data ), m_Size );
+	if( m_File >= 0 )
+		close( m_File );
+
+	m_File = -1;
+#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// read only memory mapping of a whole file, the data stays valid until the file is closed
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	bool Open( const std::wstring& fileName );
+	void Close();
+
+	bool IsOpen() const {
+		return m_Data != nullptr;
+	}
+	const uint8_t* GetData() const {
+		return m_Data;
+	}
+	size_t GetSize() const {
+		return m_Size;
+	}
+private:
+#ifdef _WIN32
+	HANDLE m_File = INVALID_HANDLE_VALUE;
+	HANDLE m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+};
+
+// non owning view on a contiguous range, e.g. inside a mapped file
+template<typename T>
+struct Span {
+	const T* Data = nullptr;
+	size_t Size = 0;
+
+	const T* begin() const {
+		return Data;
+	}
+	const T* end() const {
+		return Data + Size;
+	}
+	const T& operator[]( size_t idx ) const {
+		return Data[idx];
+	}
+};
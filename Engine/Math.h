@@ -1047,6 +1047,8 @@ inline constexpr float Rad2Deg( float angle ) {
 	return 180.0f / 3.14159265359f * angle;
 }
 
+// the vector and matrix functions below use DirectXMath, the CPU tools without it only get the component wise ones
+#ifdef _WIN32
 inline Quaternion QuaternionFromEuler( float3 angles ) {
 	using namespace DirectX;
 	Quaternion ret;
@@ -1138,6 +1140,7 @@ inline float4 Normalize( const float4& v ) {
 	XMStoreFloat4( &out, XMVector4Normalize( XMLoadFloat4( &v ) ) );
 	return out;
 }
+#endif
 
 inline float3 Cross( const float3& a, const float3& b ) {
 	float3 out;
@@ -1157,6 +1160,22 @@ inline float Dot( const float4& a, const float4& b ) {
 	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;	
 }
 
+#ifndef _WIN32
+inline float2 Normalize( const float2& v ) {
+	float length = sqrtf( Dot( v, v ) );
+	return length > 0.f ? v / length : float2( 0.f, 0.f );
+}
+inline float3 Normalize( const float3& v ) {
+	float length = sqrtf( Dot( v, v ) );
+	return length > 0.f ? v / length : float3( 0.f, 0.f, 0.f );
+}
+inline float4 Normalize( const float4& v ) {
+	float length = sqrtf( Dot( v, v ) );
+	return length > 0.f ? v / length : float4( 0.f, 0.f, 0.f, 0.f );
+}
+#endif
+
+#ifdef _WIN32
 inline Matrix InvertMatrix( const Matrix& matrix ) {
 	using namespace DirectX;
 
@@ -1172,3 +1191,4 @@ inline float4 Mult( const Matrix& matrix, const float4& vec ) {
 	XMStoreFloat4( &res, XMVector4Transform(  XMLoadFloat4( &vec ), XMLoadFloat4x4( &matrix ) ) );
 	return res;
 }
+#endif
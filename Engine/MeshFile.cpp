@@ -0,0 +1,122 @@
+#include "MeshFile.h"
+
+#include <cmath>
+#include <cfloat>
+
+#include "Makros.h"
+#include "Game.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "Mesh_generated.h"
+
+namespace {
+std::pair<float3, float3> ComputeBounds( const std::vector<float3>& positions ) {
+	std::pair<float3, float3> bounds( float3( FLT_MAX, FLT_MAX, FLT_MAX ), float3( -FLT_MAX, -FLT_MAX, -FLT_MAX ) );
+	for( const float3& pos : positions ) {
+		bounds.first = float3( Min( bounds.first.x, pos.x ), Min( bounds.first.y, pos.y ), Min( bounds.first.z, pos.z ) );
+		bounds.second = float3( Max( bounds.second.x, pos.x ), Max( bounds.second.y, pos.y ), Max( bounds.second.z, pos.z ) );
+	}
+	return bounds;
+}
+}
+
+bool DecodeMesh( const Loader::Mesh::Mesh& mesh, DecodedMesh& decoded ) {
+	auto positions = mesh.QuantizedPositions();
+	auto normals = mesh.OctahedralNormals();
+	if( !mesh.Bounds() || !positions || !normals || positions->size() % 3 != 0 || normals->size() != positions->size() / 3 * 2 )
+		return false;
+	if( !mesh.ShortIndices() && !mesh.Indices() )
+		return false;
+
+	uint32_t numVertices = positions->size() / 3;
+	const Loader::Mesh::Box& bounds = *mesh.Bounds();
+	decoded.Bounds = { float3( bounds.Min().x(), bounds.Min().y(), bounds.Min().z() ), float3( bounds.Max().x(), bounds.Max().y(), bounds.Max().z() ) };
+
+	// the shapes of a combined mesh are quantized relative to their own bounds
+	std::vector<Loader::Mesh::SubMesh> subMeshes;
+	if( mesh.SubMeshes() ) {
+		for( uint32_t i = 0; i < mesh.SubMeshes()->size(); i++ )
+			subMeshes.push_back( *mesh.SubMeshes()->Get( i ) );
+	}
+	else
+		subMeshes.push_back( Loader::Mesh::SubMesh( 0, numVertices, bounds ) );
+
+	decoded.Positions.resize( numVertices );
+	for( const Loader::Mesh::SubMesh& subMesh : subMeshes ) {
+		if( subMesh.FirstVertex() > numVertices || subMesh.NumVertices() > numVertices - subMesh.FirstVertex() )
+			return false;
+		const Loader::Mesh::Vec3& boxMin = subMesh.Bounds().Min();
+		const Loader::Mesh::Vec3& boxMax = subMesh.Bounds().Max();
+		float3 scale( ( boxMax.x() - boxMin.x() ) / 65535.f, ( boxMax.y() - boxMin.y() ) / 65535.f, ( boxMax.z() - boxMin.z() ) / 65535.f );
+		for( uint32_t i = subMesh.FirstVertex(); i < subMesh.FirstVertex() + subMesh.NumVertices(); i++ ) {
+			decoded.Positions[i] = float3( boxMin.x() + positions->Get( i * 3 ) * scale.x,
+										   boxMin.y() + positions->Get( i * 3 + 1 ) * scale.y,
+										   boxMin.z() + positions->Get( i * 3 + 2 ) * scale.z );
+		}
+	}
+
+	decoded.Normals.resize( numVertices );
+	for( uint32_t i = 0; i < numVertices; i++ ) {
+		// unfold the lower half of the octahedron
+		float x = Max( normals->Get( i * 2 ) / 32767.f, -1.f );
+		float y = Max( normals->Get( i * 2 + 1 ) / 32767.f, -1.f );
+		float z = 1.f - fabsf( x ) - fabsf( y );
+		if( z < 0.f ) {
+			float unfoldedX = ( 1.f - fabsf( y ) ) * ( x < 0.f ? -1.f : 1.f );
+			y = ( 1.f - fabsf( x ) ) * ( y < 0.f ? -1.f : 1.f );
+			x = unfoldedX;
+		}
+		float length = sqrtf( x * x + y * y + z * z );
+		decoded.Normals[i] = float3( x / length, y / length, z / length );
+	}
+
+	if( mesh.ShortIndices() )
+		decoded.Indices.assign( mesh.ShortIndices()->begin(), mesh.ShortIndices()->end() );
+	else
+		decoded.Indices.assign( mesh.Indices()->begin(), mesh.Indices()->end() );
+	return true;
+}
+
+bool ReadMeshFile( const std::wstring & fileName, std::vector<DecodedMesh>& meshes ) {
+	using namespace Loader::Mesh;
+	MappedFile file;
+	if( !file.Open( fileName ) ) {
+		Game::GetLogger().Log( L"Loader", L"Loading failed. Couldn't open file \"" + fileName + L"\"." );
+		return false;
+	}
+
+	flatbuffers::Verifier verifier( file.GetData(), file.GetSize() );
+	if( !VerifyMeshesBuffer( verifier ) || !GetMeshes( file.GetData() )->Objects() ) {
+		Game::GetLogger().Log( L"Loader", L"Loading failed. File \"" + fileName + L"\" is corrupted." );
+		return false;
+	}
+
+	auto objects = GetMeshes( file.GetData() )->Objects();
+	uint32_t version = GetMeshes( file.GetData() )->Version();
+	for( uint32_t i = 0; i < objects->size(); i++ ) {
+		auto mesh = objects->Get( i );
+		DecodedMesh decoded;
+		bool complete;
+		if( version >= 2 ) {
+			complete = DecodeMesh( *mesh, decoded );
+		}
+		else {
+			complete = mesh->Positions() && mesh->Normals() && mesh->Indices() && mesh->Normals()->size() == mesh->Positions()->size();
+			if( complete ) {
+				const float3* positions = reinterpret_cast<const float3*>( mesh->Positions()->Data() );
+				const float3* normals = reinterpret_cast<const float3*>( mesh->Normals()->Data() );
+				decoded.Positions.assign( positions, positions + mesh->Positions()->size() );
+				decoded.Normals.assign( normals, normals + mesh->Normals()->size() );
+				decoded.Indices.assign( mesh->Indices()->begin(), mesh->Indices()->end() );
+				decoded.Bounds = ComputeBounds( decoded.Positions );
+			}
+		}
+
+		if( !complete ) {
+			Game::GetLogger().Log( L"Loader", L"Skipping incomplete mesh " + std::to_wstring( i ) + L" in file \"" + fileName + L"\"." );
+			continue;
+		}
+		meshes.push_back( std::move( decoded ) );
+	}
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+namespace Loader {
+namespace Mesh {
+struct Mesh;
+}
+}
+
+// a mesh of a .mesh file expanded to the full precision layout of the geometries
+struct DecodedMesh {
+	std::vector<float3> Positions;
+	std::vector<float3> Normals;
+	std::vector<uint32_t> Indices;
+	// stored bounds of version 2 meshes, computed for version 1
+	std::pair<float3, float3> Bounds;
+};
+
+// expands the quantized attributes of a version 2 mesh
+bool DecodeMesh( const Loader::Mesh::Mesh& mesh, DecodedMesh& decoded );
+// reads all meshes of a .mesh file of any version without a device, incomplete meshes are skipped
+bool ReadMeshFile( const std::wstring& fileName, std::vector<DecodedMesh>& meshes );
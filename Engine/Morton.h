@@ -2,7 +2,7 @@
 
 #include "Math.h"
 
-uint32_t MortonEncode( uint3 pos ) {
+inline uint32_t MortonEncode( uint3 pos ) {
 	// Generate Morten Code
 	pos.x = ( pos.x | ( pos.x << 16 ) ) & 0x030000FF;
 	pos.x = ( pos.x | ( pos.x << 8 ) ) & 0x0300F00F;
@@ -22,7 +22,7 @@ uint32_t MortonEncode( uint3 pos ) {
 	return pos.x | ( pos.y << 1 ) | ( pos.z << 2 );
 }
 
-uint3 MortonDecode( uint32_t code ) {
+inline uint3 MortonDecode( uint32_t code ) {
 	uint3 pos;
 	pos.x = code;
 	pos.y = code >> 1;
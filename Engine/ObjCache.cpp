@@ -0,0 +1,312 @@
+#include "ObjCache.h"
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include "Makros.h"
+#include "Game.h"
+#include "Logger.h"
+#include "MappedFile.h"
+
+namespace {
+const uint32_t ObjCacheMagic = 'O' | ( 'B' << 8 ) | ( 'J' << 16 ) | ( 'C' << 24 );
+const uint32_t ObjCacheVersion = 2;
+
+bool GetSourceInfo( const std::wstring& sourceName, uint64_t& size, uint64_t& writeTime ) {
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if( !GetFileAttributesExW( sourceName.c_str(), GetFileExInfoStandard, &attributes ) )
+		return false;
+	size = ( static_cast<uint64_t>( attributes.nFileSizeHigh ) << 32 ) | attributes.nFileSizeLow;
+	writeTime = ( static_cast<uint64_t>( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+// 64 bit fnv-1a over words instead of bytes, it only has to detect changes of the source
+uint64_t HashData( const uint8_t* data, size_t size ) {
+	uint64_t hash = 14695981039346656037ull;
+	size_t numWords = size / sizeof( uint64_t );
+	for( size_t i = 0; i < numWords; i++ ) {
+		uint64_t word;
+		memcpy( &word, data + i * sizeof( uint64_t ), sizeof( uint64_t ) );
+		hash = ( hash ^ word ) * 1099511628211ull;
+	}
+	for( size_t i = numWords * sizeof( uint64_t ); i < size; i++ )
+		hash = ( hash ^ data[i] ) * 1099511628211ull;
+	return hash;
+}
+
+bool HashFile( const std::wstring& fileName, uint64_t& hash ) {
+	MappedFile file;
+	if( !file.Open( fileName ) )
+		return false;
+	hash = HashData( file.GetData(), file.GetSize() );
+	return true;
+}
+
+// a missing file is stored with the size -1, so the cache stays valid as long as it is missing
+const uint64_t MissingFileSize = ~0ull;
+
+bool GetFileStamp( const std::wstring& fileName, uint64_t& size, uint64_t& writeTime, uint64_t& hash ) {
+	if( !GetSourceInfo( fileName, size, writeTime ) ) {
+		size = MissingFileSize;
+		writeTime = 0;
+		hash = 0;
+		return true;
+	}
+	return HashFile( fileName, hash );
+}
+
+bool IsFileUnchanged( const std::wstring& fileName, uint64_t size, uint64_t writeTime, uint64_t hash ) {
+	uint64_t fileSize, fileWriteTime;
+	if( !GetSourceInfo( fileName, fileSize, fileWriteTime ) )
+		return size == MissingFileSize;
+	if( fileSize != size )
+		return false;
+	// a copied or touched file gets a new write time, only its content decides then
+	uint64_t fileHash;
+	return fileWriteTime == writeTime || ( HashFile( fileName, fileHash ) && fileHash == hash );
+}
+
+// names of the material libraries referenced by the .obj file, only the first name of a mtllib line is loaded by tinyobj
+std::vector<std::string> FindMaterialLibs( const uint8_t* data, size_t size ) {
+	std::vector<std::string> libs;
+	const char* text = reinterpret_cast<const char*>( data );
+	const char* end = text + size;
+	auto isSpace = []( char c ) {
+		return c == ' ' || c == '\t';
+	};
+	for( const char* line = text; line < end; ) {
+		const char* lineEnd = static_cast<const char*>( memchr( line, '\n', end - line ) );
+		if( !lineEnd )
+			lineEnd = end;
+
+		const char* ptr = line;
+		while( ptr < lineEnd && isSpace( *ptr ) )
+			++ptr;
+		if( lineEnd - ptr > 6 && strncmp( ptr, "mtllib", 6 ) == 0 && isSpace( ptr[6] ) ) {
+			ptr += 7;
+			while( ptr < lineEnd && isSpace( *ptr ) )
+				++ptr;
+			const char* nameEnd = ptr;
+			while( nameEnd < lineEnd && !isSpace( *nameEnd ) && *nameEnd != '\r' )
+				++nameEnd;
+			std::string name( ptr, nameEnd );
+			if( !name.empty() && std::find( libs.begin(), libs.end(), name ) == libs.end() )
+				libs.push_back( name );
+		}
+		line = lineEnd + 1;
+	}
+	return libs;
+}
+
+class CacheWriter {
+public:
+	template<typename T>
+	void Write( const T& value ) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>( &value );
+		m_Data.insert( m_Data.end(), bytes, bytes + sizeof( T ) );
+	}
+	template<typename T>
+	void Write( const std::vector<T>& values ) {
+		Write( static_cast<uint64_t>( values.size() ) );
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>( values.data() );
+		m_Data.insert( m_Data.end(), bytes, bytes + values.size() * sizeof( T ) );
+	}
+	void Write( const std::string& value ) {
+		Write( static_cast<uint64_t>( value.size() ) );
+		m_Data.insert( m_Data.end(), value.begin(), value.end() );
+	}
+
+	std::vector<uint8_t>& GetData() {
+		return m_Data;
+	}
+private:
+	std::vector<uint8_t> m_Data;
+};
+
+// every read checks the remaining size, so a truncated cache only fails
+class CacheReader {
+public:
+	CacheReader( const uint8_t* data, size_t size )
+		: m_Ptr( data ), m_End( data + size ) {
+	}
+
+	template<typename T>
+	bool Read( T& value ) {
+		if( static_cast<size_t>( m_End - m_Ptr ) < sizeof( T ) )
+			return false;
+		memcpy( &value, m_Ptr, sizeof( T ) );
+		m_Ptr += sizeof( T );
+		return true;
+	}
+	template<typename T>
+	bool Read( std::vector<T>& values ) {
+		uint64_t size;
+		if( !Read( size ) || size > static_cast<size_t>( m_End - m_Ptr ) / sizeof( T ) )
+			return false;
+		values.resize( static_cast<size_t>( size ) );
+		memcpy( values.data(), m_Ptr, values.size() * sizeof( T ) );
+		m_Ptr += values.size() * sizeof( T );
+		return true;
+	}
+	bool Read( std::string& value ) {
+		uint64_t size;
+		if( !Read( size ) || size > static_cast<size_t>( m_End - m_Ptr ) )
+			return false;
+		value.assign( reinterpret_cast<const char*>( m_Ptr ), static_cast<size_t>( size ) );
+		m_Ptr += size;
+		return true;
+	}
+private:
+	const uint8_t* m_Ptr;
+	const uint8_t* m_End;
+};
+
+void WriteMaterial( CacheWriter& writer, const tinyobj::material_t& material ) {
+	writer.Write( material.name );
+	writer.Write( material.ambient );
+	writer.Write( material.diffuse );
+	writer.Write( material.specular );
+	writer.Write( material.transmittance );
+	writer.Write( material.emission );
+	writer.Write( material.shininess );
+	writer.Write( material.ior );
+	writer.Write( material.dissolve );
+	writer.Write( material.illum );
+	writer.Write( material.ambient_texname );
+	writer.Write( material.diffuse_texname );
+	writer.Write( material.specular_texname );
+	writer.Write( material.specular_highlight_texname );
+	writer.Write( material.bump_texname );
+	writer.Write( material.displacement_texname );
+	writer.Write( material.alpha_texname );
+	writer.Write( static_cast<uint64_t>( material.unknown_parameter.size() ) );
+	for( auto& parameter : material.unknown_parameter ) {
+		writer.Write( parameter.first );
+		writer.Write( parameter.second );
+	}
+}
+
+bool ReadMaterial( CacheReader& reader, tinyobj::material_t& material ) {
+	uint64_t numParameters;
+	if( !reader.Read( material.name ) || !reader.Read( material.ambient ) || !reader.Read( material.diffuse ) || !reader.Read( material.specular )
+		|| !reader.Read( material.transmittance ) || !reader.Read( material.emission ) || !reader.Read( material.shininess ) || !reader.Read( material.ior )
+		|| !reader.Read( material.dissolve ) || !reader.Read( material.illum ) || !reader.Read( material.ambient_texname ) || !reader.Read( material.diffuse_texname )
+		|| !reader.Read( material.specular_texname ) || !reader.Read( material.specular_highlight_texname ) || !reader.Read( material.bump_texname )
+		|| !reader.Read( material.displacement_texname ) || !reader.Read( material.alpha_texname ) || !reader.Read( numParameters ) )
+		return false;
+
+	material.unknown_parameter.clear();
+	for( uint64_t i = 0; i < numParameters; i++ ) {
+		std::string key, value;
+		if( !reader.Read( key ) || !reader.Read( value ) )
+			return false;
+		material.unknown_parameter[key] = value;
+	}
+	return true;
+}
+}
+
+bool ReadObjCache( const std::wstring & cacheName, const std::wstring & sourceName, const std::wstring & materialPath, ObjFileData & data ) {
+	MappedFile file;
+	if( !file.Open( cacheName ) )
+		return false;
+
+	ObjCacheHeader header{};
+	CacheReader reader( file.GetData(), file.GetSize() );
+	if( !reader.Read( header ) || header.Magic != ObjCacheMagic || header.Version != ObjCacheVersion )
+		return false;
+
+	if( !IsFileUnchanged( sourceName, header.SourceSize, header.SourceWriteTime, header.SourceHash ) )
+		return false;
+
+	// the materials get stale if a library changed, even if the .obj file didn't
+	for( uint32_t i = 0; i < header.NumMaterialLibs; i++ ) {
+		std::string libName;
+		uint64_t libSize, libWriteTime, libHash;
+		if( !reader.Read( libName ) || !reader.Read( libSize ) || !reader.Read( libWriteTime ) || !reader.Read( libHash ) ) {
+			Game::GetLogger().Log( L"Loader", L"Cache \"" + cacheName + L"\" is corrupted." );
+			return false;
+		}
+		if( !IsFileUnchanged( materialPath + s2ws( libName ), libSize, libWriteTime, libHash ) )
+			return false;
+	}
+
+	ObjFileData cached;
+	cached.Shapes.resize( header.NumShapes );
+	for( tinyobj::shape_t& shape : cached.Shapes ) {
+		if( !reader.Read( shape.name ) || !reader.Read( shape.mesh.positions ) || !reader.Read( shape.mesh.normals ) || !reader.Read( shape.mesh.texcoords )
+			|| !reader.Read( shape.mesh.indices ) || !reader.Read( shape.mesh.num_vertices ) || !reader.Read( shape.mesh.material_ids ) ) {
+			Game::GetLogger().Log( L"Loader", L"Cache \"" + cacheName + L"\" is corrupted." );
+			return false;
+		}
+	}
+	cached.Materials.resize( header.NumMaterials );
+	for( tinyobj::material_t& material : cached.Materials ) {
+		if( !ReadMaterial( reader, material ) ) {
+			Game::GetLogger().Log( L"Loader", L"Cache \"" + cacheName + L"\" is corrupted." );
+			return false;
+		}
+	}
+
+	data = std::move( cached );
+	return true;
+}
+
+bool WriteObjCache( const std::wstring & cacheName, const std::wstring & sourceName, const std::wstring & materialPath, const ObjFileData & data ) {
+	ObjCacheHeader header{};
+	header.Magic = ObjCacheMagic;
+	header.Version = ObjCacheVersion;
+	header.NumShapes = static_cast<uint32_t>( data.Shapes.size() );
+	header.NumMaterials = static_cast<uint32_t>( data.Materials.size() );
+	if( !GetSourceInfo( sourceName, header.SourceSize, header.SourceWriteTime ) )
+		return false;
+
+	std::vector<std::string> materialLibs;
+	{
+		MappedFile source;
+		if( !source.Open( sourceName ) )
+			return false;
+		header.SourceHash = HashData( source.GetData(), source.GetSize() );
+		materialLibs = FindMaterialLibs( source.GetData(), source.GetSize() );
+	}
+	header.NumMaterialLibs = static_cast<uint32_t>( materialLibs.size() );
+
+	CacheWriter writer;
+	writer.Write( header );
+	for( const std::string& libName : materialLibs ) {
+		uint64_t libSize, libWriteTime, libHash;
+		if( !GetFileStamp( materialPath + s2ws( libName ), libSize, libWriteTime, libHash ) )
+			return false;
+		writer.Write( libName );
+		writer.Write( libSize );
+		writer.Write( libWriteTime );
+		writer.Write( libHash );
+	}
+	for( const tinyobj::shape_t& shape : data.Shapes ) {
+		writer.Write( shape.name );
+		writer.Write( shape.mesh.positions );
+		writer.Write( shape.mesh.normals );
+		writer.Write( shape.mesh.texcoords );
+		writer.Write( shape.mesh.indices );
+		writer.Write( shape.mesh.num_vertices );
+		writer.Write( shape.mesh.material_ids );
+	}
+	for( const tinyobj::material_t& material : data.Materials )
+		WriteMaterial( writer, material );
+
+	std::ofstream file( cacheName, std::ios::out | std::ios::trunc | std::ios::binary );
+	if( !file.is_open() ) {
+		Game::GetLogger().Log( L"Loader", L"Creating cache \"" + cacheName + L"\" failed." );
+		return false;
+	}
+	file.write( reinterpret_cast<const char*>( writer.GetData().data() ), writer.GetData().size() );
+	file.close();
+
+	if( file.bad() ) {
+		Game::GetLogger().Log( L"Loader", L"Storing cache \"" + cacheName + L"\" failed." );
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+
+#include "FileLoader.h"
+
+// binary copy of the shapes and materials of a parsed .obj file.
+// the cache is valid if the source and every material library it references have the stored size and either the stored write time or content hash.
+// the header is followed by the name, size, write time and hash of each material library
+struct ObjCacheHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t SourceSize;
+	uint64_t SourceWriteTime;
+	uint64_t SourceHash;
+	uint32_t NumShapes;
+	uint32_t NumMaterials;
+	uint32_t NumMaterialLibs;
+};
+
+// material libraries are looked up in materialPath like tinyobj does
+bool ReadObjCache( const std::wstring& cacheName, const std::wstring& sourceName, const std::wstring& materialPath, ObjFileData& data );
+bool WriteObjCache( const std::wstring& cacheName, const std::wstring& sourceName, const std::wstring& materialPath, const ObjFileData& data );
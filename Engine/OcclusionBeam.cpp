@@ -0,0 +1,166 @@
+#include "OcclusionQuery.h"
+
+#include <ppl.h>
+#include <atomic>
+#include <algorithm>
+
+#include "Makros.h"
+#include "Math.h"
+#include "Voxelizer.h"
+
+namespace {
+// same blocks as TraceBatch, a multiple of the beam size
+const size_t RaysPerTask = 256;
+// levels between the beam and the bricks, the rays of a tile seldom share the cells further down
+const uint32_t BeamLevelsBelow = 2;
+// the key has 6 bits per level like Encode in TreeTraverse.hlsli
+const uint32_t MaxBeamLevel = 5;
+// the rays of a beam with more entries are too far apart to share much
+const size_t MaxBeamEntries = 1024;
+// the cells get a bit larger, so rounding doesn't let a ray leave the beam
+const float BeamEpsilon = 1.f / 1024.f;
+
+struct BeamCell {
+	uint32_t Pointer;
+	uint32_t Level;
+	uint32_t Key;
+	// in bricks
+	uint32_t Pos[3];
+};
+
+// position of child i inside of its parent, the inverse of GetNodePos
+void GetChildPos( uint32_t child, uint32_t pos[3] ) {
+	pos[0] = ( child & 1 ) | ( ( child >> 2 ) & 2 );
+	pos[1] = ( ( child >> 1 ) & 1 ) | ( ( child >> 3 ) & 2 );
+	pos[2] = ( ( child >> 2 ) & 1 ) | ( ( child >> 4 ) & 2 );
+}
+}
+
+bool OcclusionQuery::BuildBeam( const float minOrigin[3], const float maxOrigin[3], const float minDir[3], const float maxDir[3], const bool negative[3], OcclusionBeam & beam, uint32_t & nodes ) const {
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+	beam.Entries.clear();
+
+	std::vector<BeamCell> stack;
+	stack.push_back( { m_Pointers[0], 0, 0, { 0, 0, 0 } } );
+	while( !stack.empty() ) {
+		BeamCell cell = stack.back();
+		stack.pop_back();
+		const Node& current = m_Nodes[cell.Pointer];
+		nodes++;
+
+		uint32_t level = cell.Level + 1;
+		uint32_t childSize = 1 << ( 2 * ( m_TreeSize - level ) );
+		uint32_t offset = 0;
+		for( uint32_t child = 0; child < 64; child++ ) {
+			uint32_t childPos[3];
+			GetChildPos( child, childPos );
+			for( int a = 0; a < 3; a++ )
+				childPos[a] = cell.Pos[a] + childPos[a] * childSize;
+
+			uint32_t data = child < 32 ? current.Data.x : current.Data.y;
+			bool filled = ( ( data >> ( child & 0x1f ) ) & 1 ) != 0;
+			uint32_t pointer = filled ? m_Pointers[current.Pointer + offset++] : 0xFFFFFFFF;
+
+			// interval test of the box against all rays between the bounds, the rays run into positive direction in the mirrored grid
+			float tMin = 0.f, tMax = FLT_MAX;
+			for( int a = 0; a < 3; a++ ) {
+				float boxMin = negative[a] ? resolution[a] - childPos[a] - childSize : static_cast<float>( childPos[a] );
+				float boxMax = boxMin + childSize + BeamEpsilon;
+				boxMin -= BeamEpsilon;
+				if( maxDir[a] > 0.f )
+					tMin = Max( tMin, ( boxMin - maxOrigin[a] ) / maxDir[a] );
+				else if( maxOrigin[a] < boxMin )
+					tMin = FLT_MAX;
+				if( minDir[a] > 0.f )
+					tMax = Min( tMax, ( boxMax - minOrigin[a] ) / minDir[a] );
+				else if( minOrigin[a] > boxMax )
+					tMax = -1.f;
+			}
+			if( tMin > tMax )
+				continue;
+
+			uint32_t key = ( cell.Key << 6 ) | child;
+			if( !filled || pointer == 0xFFFFFFFF || level == beam.Level ) {
+				// empty and filled cells cover all cells below them on the beam level
+				beam.Entries.push_back( { key << ( 6 * ( beam.Level - level ) ), level, filled ? ( pointer == 0xFFFFFFFF ? 0 : pointer ) : 0xFFFFFFFF } );
+				if( beam.Entries.size() > MaxBeamEntries )
+					return false;
+			}
+			else
+				stack.push_back( { pointer, level, key, { childPos[0], childPos[1], childPos[2] } } );
+		}
+	}
+
+	// cells above the beam level are added before the nodes of their earlier siblings are expanded, GetBrickBeam needs them in order
+	std::sort( beam.Entries.begin(), beam.Entries.end(), []( const OcclusionBeam::Entry& a, const OcclusionBeam::Entry& b ) {
+		return a.Key < b.Key;
+	} );
+	return true;
+}
+
+uint32_t OcclusionQuery::TraceBeam( const OcclusionRay * rays, OcclusionHit * hits, uint32_t numRays ) const {
+	numRays = Min( numRays, OcclusionBeamSize );
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+
+	// bounds of the origins and directions in the mirrored grid like in TraceGrid
+	float minOrigin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxOrigin[3] = { 0.f, 0.f, 0.f };
+	float minDir[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxDir[3] = { 0.f, 0.f, 0.f };
+	bool negative[3] = { false, false, false };
+	uint32_t numInside = 0;
+	bool sameSigns = true;
+	for( uint32_t i = 0; i < numRays; i++ ) {
+		float3 pos, dir;
+		float entryDistance;
+		if( !ToGridSpace( rays[i], pos, dir, entryDistance ) )
+			continue;
+		float rayPos[3] = { pos.x, pos.y, pos.z };
+		float rayDir[3] = { dir.x, dir.y, dir.z };
+		float maxComponent = Max( abs( dir.x ), Max( abs( dir.y ), abs( dir.z ) ) );
+		if( !( maxComponent > 0.f ) )
+			continue;
+		for( int a = 0; a < 3; a++ ) {
+			bool isNegative = rayDir[a] < 0.f;
+			if( numInside == 0 )
+				negative[a] = isNegative;
+			sameSigns &= negative[a] == isNegative;
+			float mirrored = ( isNegative ? 1.f - rayPos[a] : rayPos[a] ) * resolution[a];
+			float component = abs( rayDir[a] ) / maxComponent;
+			minOrigin[a] = Min( minOrigin[a], mirrored );
+			maxOrigin[a] = Max( maxOrigin[a], mirrored );
+			minDir[a] = Min( minDir[a], component );
+			maxDir[a] = Max( maxDir[a], component );
+		}
+		numInside++;
+	}
+
+	OcclusionBeam beam;
+	beam.Level = m_TreeSize > BeamLevelsBelow ? Min( m_TreeSize - BeamLevelsBelow, MaxBeamLevel ) : 0;
+	uint32_t nodes = 0;
+	if( numInside < 2 || !sameSigns || beam.Level == 0 || !BuildBeam( minOrigin, maxOrigin, minDir, maxDir, negative, beam, nodes ) ) {
+		for( uint32_t i = 0; i < numRays; i++ )
+			hits[i] = Trace( rays[i] );
+		return nodes;
+	}
+
+	for( uint32_t i = 0; i < numRays; i++ )
+		hits[i] = TraceRay( rays[i], &beam );
+	return nodes;
+}
+
+uint64_t OcclusionQuery::TraceBeamBatch( const OcclusionRay * rays, OcclusionHit * hits, size_t numRays ) const {
+	std::atomic<uint64_t> nodes( 0 );
+	size_t numTasks = ( numRays + RaysPerTask - 1 ) / RaysPerTask;
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		uint64_t taskNodes = 0;
+		for( size_t i = task * RaysPerTask; i < end; i += OcclusionBeamSize )
+			taskNodes += TraceBeam( rays + i, hits + i, static_cast<uint32_t>( Min( end - i, size_t( OcclusionBeamSize ) ) ) );
+		nodes += taskNodes;
+	} );
+	return nodes;
+}
+
+uint64_t OcclusionQuery::TraceBeamBatch( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits ) const {
+	hits.resize( rays.size() );
+	return TraceBeamBatch( rays.data(), hits.data(), rays.size() );
+}
@@ -0,0 +1,280 @@
+#include "OcclusionQuery.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+
+#include "Voxelizer.h"
+
+// this file is compiled with /arch:AVX2 and only called after HasPacketSupport. it must not use inline functions of shared headers
+// (Min, Max, the float3 operators, Span::operator[]), the linker could keep their avx2 version for the whole program
+
+namespace {
+// a packet continues as single rays once fewer rays than this are active per visited cell on average
+const uint32_t MinActiveRays = 3;
+const uint32_t MinCoherenceVisits = 64;
+const uint32_t MaxTreeSize = 16;
+
+// the 4x4x4 cells of a node or brick in the order a ray with the direction signs of the octant passes them,
+// each cell comes after all cells that can be in front of it
+struct VisitOrder {
+	uint8_t Cells[8][64];
+
+	VisitOrder() {
+		for( uint32_t octant = 0; octant < 8; octant++ ) {
+			uint32_t i = 0;
+			for( uint32_t z = 0; z < 4; z++ ) {
+				for( uint32_t y = 0; y < 4; y++ ) {
+					for( uint32_t x = 0; x < 4; x++ ) {
+						uint32_t cx = octant & 1 ? 3 - x : x;
+						uint32_t cy = octant & 2 ? 3 - y : y;
+						uint32_t cz = octant & 4 ? 3 - z : z;
+						Cells[octant][i++] = static_cast<uint8_t>( ( cx & 1 ) | ( ( cy & 1 ) << 1 ) | ( ( cz & 1 ) << 2 ) | ( ( cx >> 1 ) << 3 ) | ( ( cy >> 1 ) << 4 ) | ( ( cz >> 1 ) << 5 ) );
+					}
+				}
+			}
+		}
+	}
+};
+const VisitOrder Order;
+
+struct Frame {
+	uint32_t Node;
+	uint32_t Cursor;
+	uint32_t Mask;
+	// corner of the node in bricks
+	float Min[3];
+};
+
+bool IsSet( const Node& node, uint32_t cell ) {
+	uint32_t data = cell < 32 ? node.Data.x : node.Data.y;
+	return ( data & ( 1u << ( cell & 0x1f ) ) ) != 0;
+}
+
+// same popcount indexing as Traverse in TreeTraverse.hlsli
+uint32_t GetChildOffset( const Node& node, uint32_t cell ) {
+	if( cell < 32 )
+		return __popcnt( node.Data.x & ( ( 1u << cell ) - 1 ) );
+	return __popcnt( node.Data.x ) + __popcnt( node.Data.y & ( ( 1u << ( cell - 32 ) ) - 1 ) );
+}
+
+void GetCellPos( uint32_t cell, uint32_t pos[3] ) {
+	pos[0] = ( cell & 1 ) | ( ( cell >> 2 ) & 2 );
+	pos[1] = ( ( cell >> 1 ) & 1 ) | ( ( cell >> 3 ) & 2 );
+	pos[2] = ( ( cell >> 2 ) & 1 ) | ( ( cell >> 4 ) & 2 );
+}
+
+// rays in brick space with the world space distance as ray parameter
+struct Packet {
+	__m256 Origin[3];
+	__m256 InvDir[3];
+	__m256 TMin;
+	__m256 TMax;
+	bool Negative[3];
+
+	// slab test of all rays in mask against an axis aligned cell, returns the rays that pass it
+	uint32_t Intersect( const float cellMin[3], float cellSize, uint32_t mask, float tNear[8] ) const {
+		__m256 tEnter = TMin;
+		__m256 tExit = TMax;
+		for( int a = 0; a < 3; a++ ) {
+			__m256 lower = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( cellMin[a] ), Origin[a] ), InvDir[a] );
+			__m256 upper = _mm256_mul_ps( _mm256_sub_ps( _mm256_set1_ps( cellMin[a] + cellSize ), Origin[a] ), InvDir[a] );
+			tEnter = _mm256_max_ps( tEnter, Negative[a] ? upper : lower );
+			tExit = _mm256_min_ps( tExit, Negative[a] ? lower : upper );
+		}
+		uint32_t hitMask = static_cast<uint32_t>( _mm256_movemask_ps( _mm256_cmp_ps( tEnter, tExit, _CMP_LT_OQ ) ) ) & mask;
+		if( hitMask )
+			_mm256_storeu_ps( tNear, tEnter );
+		return hitMask;
+	}
+};
+
+void SetHits( OcclusionHit* hits, uint32_t mask, const float tNear[8] ) {
+	for( uint32_t i = 0; i < OcclusionPacketSize; i++ ) {
+		if( mask & ( 1 << i ) ) {
+			hits[i].Hit = true;
+			hits[i].Distance = tNear[i];
+		}
+	}
+}
+
+// voxels of a brick in the same order as the children of a node, returns the rays that hit one
+uint32_t TraceBrick( const Packet& packet, const Node& brick, const uint8_t* order, const float brickMin[3], uint32_t mask, OcclusionHit* hits ) {
+	uint32_t hitMask = 0;
+	float tNear[8];
+	for( uint32_t i = 0; i < 64 && mask; i++ ) {
+		uint32_t voxel = order[i];
+		if( !IsSet( brick, voxel ) )
+			continue;
+		uint32_t pos[3];
+		GetCellPos( voxel, pos );
+		float voxelMin[3] = { brickMin[0] + 0.25f * pos[0], brickMin[1] + 0.25f * pos[1], brickMin[2] + 0.25f * pos[2] };
+		uint32_t voxelHits = packet.Intersect( voxelMin, 0.25f, mask, tNear );
+		SetHits( hits, voxelHits, tNear );
+		hitMask |= voxelHits;
+		mask &= ~voxelHits;
+	}
+	return hitMask;
+}
+}
+
+void OcclusionQuery::TracePacketAvx2( const OcclusionRay * rays, OcclusionHit * hits, uint32_t numRays ) const {
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+	float brickSize[3] = { m_BrickSize.x, m_BrickSize.y, m_BrickSize.z };
+	float minGridPos[3] = { m_MinGridPos.x, m_MinGridPos.y, m_MinGridPos.z };
+
+	float origin[3][8], invDir[3][8], tMin[8], tMax[8];
+	uint32_t active = 0;
+	uint32_t octant = 8;
+	for( uint32_t i = 0; i < OcclusionPacketSize; i++ ) {
+		// unused lanes never pass a slab test
+		for( int a = 0; a < 3; a++ ) {
+			origin[a][i] = 0.f;
+			invDir[a][i] = 1.f;
+		}
+		tMin[i] = 0.f;
+		tMax[i] = -1.f;
+		if( i >= numRays )
+			continue;
+
+		hits[i].Hit = false;
+		hits[i].Distance = FLT_MAX;
+		hits[i].Steps = 0;
+		hits[i].Nodes = 0;
+
+		const OcclusionRay& ray = rays[i];
+		float pos[3] = { ray.Origin.x, ray.Origin.y, ray.Origin.z };
+		float dir[3] = { ray.Direction.x, ray.Direction.y, ray.Direction.z };
+		float length = _mm_cvtss_f32( _mm_sqrt_ss( _mm_set_ss( dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2] ) ) );
+		if( !( length > 0.f ) )
+			continue;
+
+		uint32_t rayOctant = ( dir[0] < 0.f ? 1 : 0 ) | ( dir[1] < 0.f ? 2 : 0 ) | ( dir[2] < 0.f ? 4 : 0 );
+		if( octant == 8 )
+			octant = rayOctant;
+		if( rayOctant != octant ) {
+			hits[i] = Trace( ray );
+			continue;
+		}
+
+		// brick space scaled so that the ray parameter is the world space distance, clipped to the grid
+		float enter = 0.f;
+		float exit = ray.MaxDistance;
+		for( int a = 0; a < 3; a++ ) {
+			float brickPos = ( pos[a] - minGridPos[a] ) / brickSize[a];
+			float brickDir = dir[a] / ( length * brickSize[a] );
+			// rays parallel to an axis get a tiny slope instead of infinite slab distances
+			if( brickDir == 0.f )
+				brickDir = 1e-20f;
+			float inv = 1.f / brickDir;
+			float t0 = -brickPos * inv;
+			float t1 = ( resolution[a] - brickPos ) * inv;
+			enter = t0 < t1 ? ( t0 > enter ? t0 : enter ) : ( t1 > enter ? t1 : enter );
+			exit = t0 < t1 ? ( t1 < exit ? t1 : exit ) : ( t0 < exit ? t0 : exit );
+			origin[a][i] = brickPos;
+			invDir[a][i] = inv;
+		}
+		if( enter >= exit )
+			continue;
+		tMin[i] = enter;
+		tMax[i] = exit;
+		active |= 1 << i;
+	}
+	if( !active )
+		return;
+
+	if( m_TreeSize == 0 || m_TreeSize > MaxTreeSize ) {
+		for( uint32_t i = 0; i < numRays; i++ ) {
+			if( active & ( 1 << i ) )
+				hits[i] = Trace( rays[i] );
+		}
+		return;
+	}
+
+	Packet packet;
+	for( int a = 0; a < 3; a++ ) {
+		packet.Origin[a] = _mm256_loadu_ps( origin[a] );
+		packet.InvDir[a] = _mm256_loadu_ps( invDir[a] );
+		packet.Negative[a] = ( octant & ( 1 << a ) ) != 0;
+	}
+	packet.TMin = _mm256_loadu_ps( tMin );
+	packet.TMax = _mm256_loadu_ps( tMax );
+	const uint8_t* order = Order.Cells[octant];
+
+	// a frame per level, each one walks through the children of its node in visiting order
+	Frame stack[MaxTreeSize];
+	stack[0].Node = m_Pointers.Data[0];
+	stack[0].Cursor = 0;
+	stack[0].Mask = active;
+	stack[0].Min[0] = stack[0].Min[1] = stack[0].Min[2] = 0.f;
+	int depth = 0;
+
+	uint32_t done = 0;
+	// rays finished with Trace, they keep its steps and nodes
+	uint32_t singleRays = 0;
+	uint32_t visits = 0, activeRays = 0, nodes = 1;
+	float tNear[8];
+	while( depth >= 0 ) {
+		Frame& frame = stack[depth];
+		frame.Mask &= ~done;
+		if( !frame.Mask || frame.Cursor == 64 ) {
+			depth--;
+			continue;
+		}
+
+		const Node& node = m_Nodes.Data[frame.Node];
+		uint32_t cell = order[frame.Cursor++];
+		if( !IsSet( node, cell ) )
+			continue;
+
+		// the rays have drifted apart, the rest is faster one by one
+		visits++;
+		activeRays += __popcnt( frame.Mask );
+		if( visits >= MinCoherenceVisits && activeRays < MinActiveRays * visits ) {
+			singleRays = active & ~done;
+			for( uint32_t i = 0; i < numRays; i++ ) {
+				if( singleRays & ( 1 << i ) )
+					hits[i] = Trace( rays[i] );
+			}
+			done = active;
+			break;
+		}
+
+		uint32_t level = depth + 1;
+		float cellSize = static_cast<float>( 1u << ( 2 * ( m_TreeSize - level ) ) );
+		uint32_t pos[3];
+		GetCellPos( cell, pos );
+		float cellMin[3] = { frame.Min[0] + pos[0] * cellSize, frame.Min[1] + pos[1] * cellSize, frame.Min[2] + pos[2] * cellSize };
+		uint32_t mask = packet.Intersect( cellMin, cellSize, frame.Mask, tNear );
+		if( !mask )
+			continue;
+
+		uint32_t child = m_Pointers.Data[node.Pointer + GetChildOffset( node, cell )];
+		// completely filled child
+		if( child == 0xFFFFFFFF ) {
+			SetHits( hits, mask, tNear );
+			done |= mask;
+			continue;
+		}
+		nodes++;
+		if( level == m_TreeSize ) {
+			done |= TraceBrick( packet, m_Nodes.Data[child], order, cellMin, mask, hits );
+			continue;
+		}
+
+		Frame& next = stack[depth + 1];
+		next.Node = child;
+		next.Cursor = 0;
+		next.Mask = mask;
+		next.Min[0] = cellMin[0];
+		next.Min[1] = cellMin[1];
+		next.Min[2] = cellMin[2];
+		depth++;
+	}
+
+	for( uint32_t i = 0; i < numRays; i++ ) {
+		if( ( active & ~singleRays ) & ( 1 << i ) ) {
+			hits[i].Steps = visits;
+			hits[i].Nodes = nodes;
+		}
+	}
+}
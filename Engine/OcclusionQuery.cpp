@@ -0,0 +1,499 @@
+#include "OcclusionQuery.h"
+
+#include <ppl.h>
+#include <intrin.h>
+#include <immintrin.h>
+#include <cmath>
+#include <algorithm>
+
+#include "Makros.h"
+#include "Math.h"
+#include "Morton.h"
+#include "TreeFile.h"
+#include "EmptyDistance.h"
+#include "Voxelizer.h"
+
+namespace {
+// rays per parallel work item, a multiple of the packet size
+const size_t RaysPerTask = 256;
+// same limit as the loop of CheckBrick
+const uint32_t MaxBrickSteps = 100;
+// levels below the split of GetBrick, SHORT_STACK_SIZE in TreeTraverse.hlsli
+const uint32_t ShortStackSize = 5;
+// digits of the ray sort
+const uint32_t RadixBits = 8;
+const uint32_t RadixSize = 1 << RadixBits;
+
+// the 6 bits of a level in the morton code of pos, like Encode( pos ) >> shift * 3 & 0x3f in TreeTraverse.hlsli
+uint32_t GetNodePos( const uint32_t pos[3], uint32_t shift ) {
+	return ( ( pos[0] >> shift ) & 1 ) | ( ( ( pos[1] >> shift ) & 1 ) << 1 ) | ( ( ( pos[2] >> shift ) & 1 ) << 2 )
+		| ( ( ( pos[0] >> ( shift + 1 ) ) & 1 ) << 3 ) | ( ( ( pos[1] >> ( shift + 1 ) ) & 1 ) << 4 ) | ( ( ( pos[2] >> ( shift + 1 ) ) & 1 ) << 5 );
+}
+
+// moves pos to the next edge of the grid with the given cell size, only the axis that is hit gets snapped.
+// with skip the edge is that many cells further, but at most the edge of the node of the cell
+void StepToEdge( float pos[3], const float dir[3], const float invDir[3], float cellSize, uint32_t skip = 0 ) {
+	float edges[3], t[3];
+	for( int a = 0; a < 3; a++ ) {
+		edges[a] = ( floor( pos[a] / cellSize ) + 1.f ) * cellSize;
+		if( skip > 0 ) {
+			float nodeEdge = ( floor( pos[a] / ( 4.f * cellSize ) ) + 1.f ) * 4.f * cellSize;
+			edges[a] = Min( edges[a] + skip * cellSize, nodeEdge );
+		}
+		t[a] = ( edges[a] - pos[a] ) * invDir[a];
+	}
+	float tMin = Min( t[0], Min( t[1], t[2] ) );
+
+	for( int a = 0; a < 3; a++ )
+		pos[a] += dir[a] * tMin;
+	if( tMin == t[0] )
+		pos[0] = edges[0];
+	else if( tMin == t[1] )
+		pos[1] = edges[1];
+	else
+		pos[2] = edges[2];
+}
+
+// avx2 and fma also need the os to save the ymm registers
+bool CheckAvx2() {
+	int info[4];
+	__cpuid( info, 0 );
+	if( info[0] < 7 )
+		return false;
+	__cpuid( info, 1 );
+	bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+	bool fma = ( info[2] & ( 1 << 12 ) ) != 0;
+	if( !osxsave || !fma || ( _xgetbv( 0 ) & 6 ) != 6 )
+		return false;
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & ( 1 << 5 ) ) != 0;
+}
+
+float GetDistance( const float from[3], const float to[3], const float3& brickSize ) {
+	float3 delta( ( to[0] - from[0] ) * brickSize.x, ( to[1] - from[1] ) * brickSize.y, ( to[2] - from[2] ) * brickSize.z );
+	return sqrt( Dot( delta, delta ) );
+}
+
+// octant of the direction, 10 bit morton code of the origin in the grid and 10 bit morton code of the direction.
+// rays of a packet get the same direction signs, rays next to each other start close together
+uint64_t GetSortKey( const OcclusionRay& ray, const float3& minGridPos, const float3& gridSize ) {
+	float3 gridPos = ( ray.Origin - minGridPos ) / gridSize;
+	float length = sqrt( Dot( ray.Direction, ray.Direction ) );
+	float3 dir = length > 0.f ? ray.Direction / length : float3( 0.f, 0.f, 0.f );
+	float pos[3] = { gridPos.x, gridPos.y, gridPos.z };
+	float direction[3] = { dir.x * 0.5f + 0.5f, dir.y * 0.5f + 0.5f, dir.z * 0.5f + 0.5f };
+	uint32_t quantizedPos[3], quantizedDir[3];
+	for( int a = 0; a < 3; a++ ) {
+		quantizedPos[a] = static_cast<uint32_t>( Min( Max( pos[a] * 1024.f, 0.f ), 1023.f ) );
+		quantizedDir[a] = static_cast<uint32_t>( Min( Max( direction[a] * 1024.f, 0.f ), 1023.f ) );
+	}
+	uint64_t octant = ( dir.x < 0.f ? 1 : 0 ) | ( dir.y < 0.f ? 2 : 0 ) | ( dir.z < 0.f ? 4 : 0 );
+	uint64_t posCode = MortonEncode( uint3( quantizedPos[0], quantizedPos[1], quantizedPos[2] ) );
+	uint64_t dirCode = MortonEncode( uint3( quantizedDir[0], quantizedDir[1], quantizedDir[2] ) );
+	return ( octant << 60 ) | ( posCode << 30 ) | dirCode;
+}
+
+// lsd radix sort, order gets the indices of the keys in sorted order
+void RadixSort( std::vector<uint64_t>& keys, std::vector<uint32_t>& order ) {
+	size_t numKeys = keys.size();
+	order.resize( numKeys );
+	for( size_t i = 0; i < numKeys; i++ )
+		order[i] = static_cast<uint32_t>( i );
+	if( numKeys == 0 )
+		return;
+
+	std::vector<uint64_t> sortedKeys( numKeys );
+	std::vector<uint32_t> sortedOrder( numKeys );
+	for( uint32_t shift = 0; shift < 64; shift += RadixBits ) {
+		size_t offsets[RadixSize] = {};
+		for( uint64_t key : keys )
+			offsets[( key >> shift ) & ( RadixSize - 1 )]++;
+		// all keys have the same digit
+		if( offsets[( keys[0] >> shift ) & ( RadixSize - 1 )] == numKeys )
+			continue;
+
+		size_t offset = 0;
+		for( size_t& digitOffset : offsets ) {
+			size_t count = digitOffset;
+			digitOffset = offset;
+			offset += count;
+		}
+		for( size_t i = 0; i < numKeys; i++ ) {
+			size_t target = offsets[( keys[i] >> shift ) & ( RadixSize - 1 )]++;
+			sortedKeys[target] = keys[i];
+			sortedOrder[target] = order[i];
+		}
+		keys.swap( sortedKeys );
+		order.swap( sortedOrder );
+	}
+}
+}
+
+OcclusionQuery::OcclusionQuery( const TreeView & tree )
+	: OcclusionQuery( tree.Nodes, tree.Pointers, tree.Resolution, tree.Position, tree.Size ) {
+}
+
+OcclusionQuery::OcclusionQuery( Span<Node> nodes, Span<uint32_t> pointers, uint32_t resolution, float3 position, float3 size )
+	: m_Nodes( nodes ), m_Pointers( pointers ) {
+	// same values the voxelizer puts into GridData
+	m_TreeSize = resolution > 4 ? static_cast<uint32_t>( ceil( log2( resolution ) / 2.f ) - 1 ) : 0;
+	m_GridResolution = { resolution / 4, resolution / 4, resolution / 4 };
+	m_MinGridPos = position - 0.5f * size;
+	m_GridSize = size;
+	m_BrickSize = size / make_float3( m_GridResolution );
+}
+
+uint32_t OcclusionQuery::Traverse( const uint32_t pos[3], uint32_t pointer, uint32_t minLevel, uint32_t & size, uint32_t & skip, uint32_t & nodes ) const {
+	size = 1;
+	skip = 0;
+	for( uint32_t level = minLevel; level <= m_TreeSize; level++ ) {
+		const Node& current = m_Nodes[pointer];
+		nodes++;
+
+		uint32_t nodePos = GetNodePos( pos, 2 * ( m_TreeSize - level ) );
+		uint32_t data = nodePos < 32 ? current.Data.x : current.Data.y;
+		uint32_t dataPos = nodePos & 0x1f;
+
+		if( !( data & ( 1u << dataPos ) ) ) {
+			size = 1 << ( 2 * ( m_TreeSize - level ) );
+			if( m_EmptyDistances.Size > 0 )
+				skip = GetEmptyDistance( m_EmptyDistances[pointer], nodePos );
+			return 0xFFFFFFFF;
+		}
+		uint32_t offset = __popcnt( data & ( ( 1u << dataPos ) - 1 ) );
+		if( nodePos > 31 )
+			offset += __popcnt( current.Data.x );
+		pointer = m_Pointers[current.Pointer + offset];
+		// completely filled child
+		if( pointer == 0xFFFFFFFF )
+			return 0;
+	}
+	return pointer;
+}
+
+uint32_t OcclusionQuery::GetBrick( const uint32_t pos[3], uint32_t & size, uint32_t & skip, uint32_t & nodes ) const {
+	return Traverse( pos, m_Pointers[0], 1, size, skip, nodes );
+}
+
+uint32_t OcclusionQuery::GetBrickBeam( const uint32_t pos[3], const OcclusionBeam & beam, uint32_t & size, uint32_t & skip, uint32_t & nodes, uint32_t & misses ) const {
+	uint32_t key = 0;
+	for( uint32_t level = 1; level <= beam.Level; level++ )
+		key = ( key << 6 ) | GetNodePos( pos, 2 * ( m_TreeSize - level ) );
+
+	// last entry that starts at or before the cell
+	auto entry = std::upper_bound( beam.Entries.begin(), beam.Entries.end(), key, []( uint32_t value, const OcclusionBeam::Entry& e ) {
+		return value < e.Key;
+	} );
+	// cells outside of the beam, e.g. of a ray that leaves the frustum because of rounding
+	if( entry == beam.Entries.begin() || key - ( entry - 1 )->Key >= ( 1u << ( 6 * ( beam.Level - ( entry - 1 )->Level ) ) ) ) {
+		misses++;
+		return GetBrick( pos, size, skip, nodes );
+	}
+	--entry;
+
+	if( entry->Pointer == 0xFFFFFFFF ) {
+		size = 1 << ( 2 * ( m_TreeSize - entry->Level ) );
+		skip = 0;
+		return 0xFFFFFFFF;
+	}
+	if( entry->Pointer == 0 )
+		return 0;
+	return Traverse( pos, entry->Pointer, beam.Level + 1, size, skip, nodes );
+}
+
+uint32_t OcclusionQuery::GetBrickShortStack( const uint32_t pos[3], const uint32_t lastPos[3], uint32_t * stack, uint32_t & validLevel, uint32_t & size, uint32_t & skip, uint32_t & nodes ) const {
+	size = 1;
+	skip = 0;
+	uint32_t minLevel = m_TreeSize > 5 ? m_TreeSize - 4 : 1;
+	uint32_t diff = ( pos[0] ^ lastPos[0] ) | ( pos[1] ^ lastPos[1] ) | ( pos[2] ^ lastPos[2] );
+
+	uint32_t startLevel;
+	uint32_t pointer = m_Pointers[0];
+	// the levels above the split only change with the upper bits
+	if( validLevel == 0 || ( diff >> 10 ) != 0 ) {
+		startLevel = 1;
+		validLevel = 0;
+	}
+	else {
+		// first level whose 2 bits of the position changed
+		unsigned long highestBit;
+		startLevel = _BitScanReverse( &highestBit, diff ) ? m_TreeSize - highestBit / 2 : m_TreeSize;
+		startLevel = Min( Max( startLevel, minLevel ), validLevel );
+		pointer = stack[startLevel - minLevel];
+	}
+
+	for( uint32_t level = startLevel; level <= m_TreeSize; level++ ) {
+		if( level >= minLevel ) {
+			stack[level - minLevel] = pointer;
+			validLevel = level;
+		}
+		const Node& current = m_Nodes[pointer];
+		nodes++;
+
+		uint32_t nodePos = GetNodePos( pos, 2 * ( m_TreeSize - level ) );
+		uint32_t data = nodePos < 32 ? current.Data.x : current.Data.y;
+		uint32_t dataPos = nodePos & 0x1f;
+
+		if( !( data & ( 1u << dataPos ) ) ) {
+			size = 1 << ( 2 * ( m_TreeSize - level ) );
+			if( m_EmptyDistances.Size > 0 )
+				skip = GetEmptyDistance( m_EmptyDistances[pointer], nodePos );
+			return 0xFFFFFFFF;
+		}
+		uint32_t offset = __popcnt( data & ( ( 1u << dataPos ) - 1 ) );
+		if( nodePos > 31 )
+			offset += __popcnt( current.Data.x );
+		pointer = m_Pointers[current.Pointer + offset];
+		// completely filled child
+		if( pointer == 0xFFFFFFFF )
+			return 0;
+	}
+	return pointer;
+}
+
+uint32_t OcclusionQuery::GetCell( const uint32_t pos[3], uint32_t cellLevel, uint32_t & emptyLevel ) const {
+	uint32_t pointer = m_Pointers[0];
+	uint32_t maxLevel = m_TreeSize - cellLevel;
+	for( uint32_t level = 1; level <= maxLevel; level++ ) {
+		const Node& current = m_Nodes[pointer];
+
+		uint32_t nodePos = GetNodePos( pos, 2 * ( maxLevel - level ) );
+		uint32_t data = nodePos < 32 ? current.Data.x : current.Data.y;
+		uint32_t dataPos = nodePos & 0x1f;
+
+		if( !( data & ( 1u << dataPos ) ) ) {
+			emptyLevel = m_TreeSize - level;
+			return 0xFFFFFFFF;
+		}
+		uint32_t offset = __popcnt( data & ( ( 1u << dataPos ) - 1 ) );
+		if( nodePos > 31 )
+			offset += __popcnt( current.Data.x );
+		pointer = m_Pointers[current.Pointer + offset];
+		if( pointer == 0xFFFFFFFF )
+			return 0;
+	}
+	return pointer;
+}
+
+bool OcclusionQuery::CheckBrick( uint32_t brickIdx, float pos[3], const float dir[3], const float invDir[3], const int mirror[3], const int offset[3] ) const {
+	uint2 brick = m_Nodes[brickIdx].Data;
+	for( uint32_t i = 0; i < MaxBrickSteps; i++ ) {
+		uint32_t voxelPos[3];
+		for( int a = 0; a < 3; a++ )
+			voxelPos[a] = offset[a] + mirror[a] * static_cast<int>( pos[a] );
+		uint32_t bitIdx = GetNodePos( voxelPos, 0 );
+		uint32_t bits = bitIdx < 32 ? brick.x : brick.y;
+		if( ( bits >> ( bitIdx & 0x1f ) ) & 1 )
+			return true;
+
+		StepToEdge( pos, dir, invDir, 1.f );
+		if( pos[0] >= 4.f || pos[1] >= 4.f || pos[2] >= 4.f )
+			break;
+	}
+	return false;
+}
+
+OcclusionHit OcclusionQuery::TraceGrid( float3 pos, float3 dir, float maxDistance ) const {
+	return TraverseGrid( pos, dir, maxDistance, nullptr );
+}
+
+OcclusionHit OcclusionQuery::TraverseGrid( float3 pos, float3 dir, float maxDistance, const OcclusionBeam * beam ) const {
+	OcclusionHit hit;
+	float maxDir = Max( abs( dir.x ), Max( abs( dir.y ), abs( dir.z ) ) );
+	if( m_Pointers.Size == 0 || !( maxDir > 0.f ) )
+		return hit;
+
+	// like TraverseTree the ray gets mirrored, so it always runs into positive direction
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+	float rayPos[3] = { pos.x, pos.y, pos.z };
+	float rayDir[3] = { dir.x / maxDir, dir.y / maxDir, dir.z / maxDir };
+	float invDir[3], offset[3], start[3];
+	int mirror[3], brickOffset[3];
+	for( int a = 0; a < 3; a++ ) {
+		bool negative = rayDir[a] < 0.f;
+		mirror[a] = negative ? -1 : 1;
+		brickOffset[a] = negative ? 3 : 0;
+		offset[a] = negative ? resolution[a] - ( 1.f / 1024.f ) : 0.f;
+		rayPos[a] = ( negative ? 1.f - rayPos[a] : rayPos[a] ) * resolution[a];
+		invDir[a] = abs( 1.f / rayDir[a] );
+		rayDir[a] = abs( rayDir[a] );
+		start[a] = rayPos[a];
+	}
+
+	uint32_t size = 1;
+	uint32_t skip = 0;
+	uint32_t stack[ShortStackSize];
+	uint32_t validLevel = 0;
+	uint32_t lastPos[3] = { 0, 0, 0 };
+	for( uint32_t i = 0; true; i++ ) {
+		hit.Steps = i;
+		uint32_t samplePos[3];
+		for( int a = 0; a < 3; a++ )
+			samplePos[a] = static_cast<uint32_t>( offset[a] + mirror[a] * floor( rayPos[a] ) );
+
+		uint32_t brick;
+		if( beam )
+			brick = GetBrickBeam( samplePos, *beam, size, skip, hit.Nodes, hit.BeamMisses );
+		else if( m_UseShortStack ) {
+			brick = GetBrickShortStack( samplePos, lastPos, stack, validLevel, size, skip, hit.Nodes );
+			for( int a = 0; a < 3; a++ )
+				lastPos[a] = samplePos[a];
+		}
+		else
+			brick = GetBrick( samplePos, size, skip, hit.Nodes );
+		if( brick == 0 ) {
+			hit.Hit = true;
+			hit.Distance = GetDistance( start, rayPos, m_BrickSize );
+			break;
+		}
+		if( brick != 0xFFFFFFFF ) {
+			hit.Nodes++;
+			float inBrickPos[3];
+			for( int a = 0; a < 3; a++ )
+				inBrickPos[a] = ( rayPos[a] - floor( rayPos[a] ) ) * 4.f;
+			if( CheckBrick( brick, inBrickPos, rayDir, invDir, mirror, brickOffset ) ) {
+				float hitPos[3];
+				for( int a = 0; a < 3; a++ )
+					hitPos[a] = floor( rayPos[a] ) + 0.25f * inBrickPos[a];
+				hit.Hit = true;
+				hit.Distance = GetDistance( start, hitPos, m_BrickSize );
+				break;
+			}
+		}
+
+		StepToEdge( rayPos, rayDir, invDir, static_cast<float>( size ), skip );
+
+		// test if still in box
+		if( rayPos[0] >= resolution[0] || rayPos[1] >= resolution[1] || rayPos[2] >= resolution[2] )
+			break;
+		if( maxDistance < FLT_MAX && GetDistance( start, rayPos, m_BrickSize ) > maxDistance )
+			break;
+	}
+
+	if( hit.Hit && hit.Distance > maxDistance ) {
+		hit.Hit = false;
+		hit.Distance = FLT_MAX;
+	}
+	return hit;
+}
+
+bool OcclusionQuery::ToGridSpace( const OcclusionRay & ray, float3 & pos, float3 & dir, float & entryDistance ) const {
+	// grid space like GetShadowVal in psShadow.hlsl, the direction is scaled too so non cubic grids keep the ray
+	pos = ( ray.Origin - m_MinGridPos ) / m_GridSize;
+	dir = ray.Direction / m_GridSize;
+
+	float origin[3] = { pos.x, pos.y, pos.z };
+	float direction[3] = { dir.x, dir.y, dir.z };
+	float tEnter = 0.f, tExit = FLT_MAX;
+	for( int a = 0; a < 3; a++ ) {
+		if( direction[a] == 0.f ) {
+			if( origin[a] < 0.f || origin[a] >= 1.f )
+				return false;
+			continue;
+		}
+		float t0 = -origin[a] / direction[a];
+		float t1 = ( 1.f - origin[a] ) / direction[a];
+		tEnter = Max( tEnter, Min( t0, t1 ) );
+		tExit = Min( tExit, Max( t0, t1 ) );
+	}
+	if( tEnter >= tExit )
+		return false;
+
+	entryDistance = 0.f;
+	if( tEnter > 0.f ) {
+		float3 delta = dir * tEnter * m_GridSize;
+		entryDistance = sqrt( Dot( delta, delta ) );
+		if( entryDistance > ray.MaxDistance )
+			return false;
+		// the ray has to start inside, the exit test of the traversal is >= 1
+		pos = pos + dir * tEnter;
+		pos = float3( Min( Max( pos.x, 0.f ), 0.9999999f ), Min( Max( pos.y, 0.f ), 0.9999999f ), Min( Max( pos.z, 0.f ), 0.9999999f ) );
+	}
+	return true;
+}
+
+OcclusionHit OcclusionQuery::TraceRay( const OcclusionRay & ray, const OcclusionBeam * beam ) const {
+	float3 pos, dir;
+	float entryDistance;
+	if( !ToGridSpace( ray, pos, dir, entryDistance ) )
+		return OcclusionHit();
+
+	OcclusionHit hit = TraverseGrid( pos, dir, ray.MaxDistance < FLT_MAX ? ray.MaxDistance - entryDistance : FLT_MAX, beam );
+	if( hit.Hit )
+		hit.Distance += entryDistance;
+	return hit;
+}
+
+OcclusionHit OcclusionQuery::Trace( const OcclusionRay & ray ) const {
+	return TraceRay( ray, nullptr );
+}
+
+bool OcclusionQuery::HasPacketSupport() {
+	static bool hasAvx2 = CheckAvx2();
+	return hasAvx2;
+}
+
+void OcclusionQuery::TracePacket( const OcclusionRay * rays, OcclusionHit * hits, uint32_t numRays ) const {
+	if( numRays > 1 && HasPacketSupport() ) {
+		TracePacketAvx2( rays, hits, Min( numRays, OcclusionPacketSize ) );
+		return;
+	}
+	for( uint32_t i = 0; i < numRays; i++ )
+		hits[i] = Trace( rays[i] );
+}
+
+void OcclusionQuery::TraceBatch( const OcclusionRay * rays, OcclusionHit * hits, size_t numRays, bool usePackets ) const {
+	size_t numTasks = ( numRays + RaysPerTask - 1 ) / RaysPerTask;
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		if( usePackets ) {
+			for( size_t i = task * RaysPerTask; i < end; i += OcclusionPacketSize )
+				TracePacket( rays + i, hits + i, static_cast<uint32_t>( Min( end - i, size_t( OcclusionPacketSize ) ) ) );
+		}
+		else {
+			for( size_t i = task * RaysPerTask; i < end; i++ )
+				hits[i] = Trace( rays[i] );
+		}
+	} );
+}
+
+void OcclusionQuery::TraceBatch( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits, bool usePackets ) const {
+	hits.resize( rays.size() );
+	TraceBatch( rays.data(), hits.data(), rays.size(), usePackets );
+}
+
+void OcclusionQuery::SortRays( const OcclusionRay * rays, size_t numRays, std::vector<uint32_t>& order ) const {
+	std::vector<uint64_t> keys( numRays );
+	size_t numTasks = ( numRays + RaysPerTask - 1 ) / RaysPerTask;
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		for( size_t i = task * RaysPerTask; i < end; i++ )
+			keys[i] = GetSortKey( rays[i], m_MinGridPos, m_GridSize );
+	} );
+	RadixSort( keys, order );
+}
+
+void OcclusionQuery::TraceSorted( const OcclusionRay * rays, OcclusionHit * hits, size_t numRays, bool usePackets ) const {
+	std::vector<uint32_t> order;
+	SortRays( rays, numRays, order );
+
+	std::vector<OcclusionRay> sortedRays( numRays );
+	std::vector<OcclusionHit> sortedHits( numRays );
+	size_t numTasks = ( numRays + RaysPerTask - 1 ) / RaysPerTask;
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		for( size_t i = task * RaysPerTask; i < end; i++ )
+			sortedRays[i] = rays[order[i]];
+	} );
+	TraceBatch( sortedRays.data(), sortedHits.data(), numRays, usePackets );
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		for( size_t i = task * RaysPerTask; i < end; i++ )
+			hits[order[i]] = sortedHits[i];
+	} );
+}
+
+void OcclusionQuery::TraceSorted( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits, bool usePackets ) const {
+	hits.resize( rays.size() );
+	TraceSorted( rays.data(), hits.data(), rays.size(), usePackets );
+}
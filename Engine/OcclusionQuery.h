@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+#include <cfloat>
+
+#include "Types.h"
+#include "MappedFile.h"
+
+struct Node;
+struct TreeView;
+
+struct OcclusionRay {
+	float3 Origin;
+	float3 Direction;
+	// hits further away count as misses, e.g. the distance to a point light
+	float MaxDistance = FLT_MAX;
+};
+
+// rays traced together by TracePacket
+const uint32_t OcclusionPacketSize = 8;
+// rays of a beam, e.g. the shadow rays of a tile of 8x8 pixels
+const uint32_t OcclusionBeamSize = 64;
+
+// soft shadow traversals of TreeTraverse.hlsli
+enum class SoftShadowMethod {
+	// steps through the approximation of the nodes with a level that grows with the cone, SOFTSHADOW
+	SmoothTraverse1,
+	// single ray that ends at the first filled cell of a level that grows with the cone, the shadow of TEMPORAL without bUseNormal
+	SmoothTraverse2
+};
+
+struct OcclusionHit {
+	bool Hit = false;
+	// world space distance from the origin to the first filled voxel
+	float Distance = FLT_MAX;
+	// iterations of the traversal loop like the counter of TraverseTree, for packets the cells visited by the whole packet
+	uint32_t Steps = 0;
+	// nodes read from the tree including the brick, for packets the nodes read by the whole packet. for beams only the nodes
+	// below the beam, the nodes of the beam itself are returned by TraceBeam
+	uint32_t Nodes = 0;
+	// lookups of a beam ray in cells the beam didn't cover, they start at the root instead
+	uint32_t BeamMisses = 0;
+};
+
+// the cells of the upper levels of the tree that a beam of rays passes, sorted by Key
+struct OcclusionBeam {
+	struct Entry {
+		// first cell on the beam level covered by the entry, 6 bits per level from the root down like GetNodePos
+		uint32_t Key;
+		// of the cell, the beam level for nodes and the beam level or above for empty and filled cells
+		uint32_t Level;
+		// node of the cell, 0 for a filled and 0xFFFFFFFF for an empty cell like the result of GetBrick
+		uint32_t Pointer;
+	};
+	std::vector<Entry> Entries;
+	uint32_t Level = 0;
+};
+
+// cpu version of TraverseTree from TreeTraverse.hlsli on the same node and pointer layout, for visibility tests without a device.
+// the tree isn't copied and has to stay valid as long as the query is used
+class OcclusionQuery {
+public:
+	OcclusionQuery( const TreeView& tree );
+	OcclusionQuery( Span<Node> nodes, Span<uint32_t> pointers, uint32_t resolution, float3 position, float3 size );
+
+	// world space ray, origins outside of the grid get moved onto it first
+	OcclusionHit Trace( const OcclusionRay& ray ) const;
+	// ray in grid space [0,1] like vInGridPos of psShadow.hlsl, follows TraverseTree step by step. distances are in world units
+	OcclusionHit TraceGrid( float3 pos, float3 dir, float maxDistance = FLT_MAX ) const;
+	// up to 8 rays whose directions have the same signs, e.g. shadow rays to a directional light. they visit the tree together with avx2,
+	// rays with other signs, cpus without avx2 and packets whose rays drift apart fall back to Trace
+	void TracePacket( const OcclusionRay* rays, OcclusionHit* hits, uint32_t numRays ) const;
+	// the rays are split into blocks which are traced in parallel, with usePackets every 8 consecutive rays form a packet
+	void TraceBatch( const OcclusionRay* rays, OcclusionHit* hits, size_t numRays, bool usePackets = true ) const;
+	void TraceBatch( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits, bool usePackets = true ) const;
+	// like TraceBatch but the rays are traced in the order of SortRays, the hits are in the order of the rays again.
+	// incoherent rays like jittered shadow rays then share nodes in the cache with their neighbours
+	void TraceSorted( const OcclusionRay* rays, OcclusionHit* hits, size_t numRays, bool usePackets = true ) const;
+	void TraceSorted( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits, bool usePackets = true ) const;
+	// up to 64 rays whose directions have the same signs, e.g. the shadow rays of a tile. the frustum around the rays is traced through
+	// the upper levels once and every ray starts below the cells it found instead of at the root. returns the nodes read by the beam,
+	// rays with other signs and beams that spread too far are traced alone
+	uint32_t TraceBeam( const OcclusionRay* rays, OcclusionHit* hits, uint32_t numRays ) const;
+	// every 64 consecutive rays form a beam, the beams are traced in parallel. returns the nodes read by all beams
+	uint64_t TraceBeamBatch( const OcclusionRay* rays, OcclusionHit* hits, size_t numRays ) const;
+	uint64_t TraceBeamBatch( const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits ) const;
+	// indices of the rays sorted by direction signs, morton code of the origin and morton code of the direction
+	void SortRays( const OcclusionRay* rays, size_t numRays, std::vector<uint32_t>& order ) const;
+
+	static bool HasPacketSupport();
+
+	// values of ComputeApproximation, the float or the anisotropic version like ANISOTROPIC. SmoothTraverse1 needs them, they have
+	// to stay valid like the tree
+	void SetApproximation( Span<float> approx );
+	void SetApproximation( Span<uint32_t> anisotropicApprox );
+	// occlusion in [0,1] of a light in ray.Direction whose angular size is lightAngle in radians, like fLightAngle of psShadow.hlsl.
+	// origins outside of the grid are lit like in GetShadowVal, MaxDistance is ignored
+	float TraceSoft( const OcclusionRay& ray, float lightAngle, SoftShadowMethod method ) const;
+	// the rays are split into blocks which are traced in parallel
+	void TraceSoftBatch( const OcclusionRay* rays, float* occlusion, size_t numRays, float lightAngle, SoftShadowMethod method ) const;
+	// grid space versions like TraceGrid
+	float SmoothTraverse1( float3 pos, float3 dir, float lightAngle ) const;
+	float SmoothTraverse2( float3 pos, float3 dir, float lightAngle ) const;
+
+	// with the short stack a step starts at the deepest node that still contains the new position like TraverseTree with
+	// SHORT_STACK_TRAVERSE, otherwise every step starts at the root. on by default
+	void SetShortStack( bool useShortStack ) {
+		m_UseShortStack = useShortStack;
+	}
+	// one entry per node from ComputeEmptyDistances, empty cells are left in one step together with the empty cells around them
+	// like TraverseTree with EMPTY_DISTANCE. packets don't use them. an empty span turns it off, it has to stay valid like the tree
+	void SetEmptyDistances( Span<uint4> distances ) {
+		m_EmptyDistances = distances;
+	}
+
+	uint32_t GetTreeSize() const {
+		return m_TreeSize;
+	}
+	uint3 GetGridResolution() const {
+		return m_GridResolution;
+	}
+private:
+	// grid space origin and direction of a world space ray, the origin is moved onto the grid first. false if the ray misses the grid
+	bool ToGridSpace( const OcclusionRay& ray, float3& pos, float3& dir, float& entryDistance ) const;
+	// Trace and TraceGrid, with a beam the bricks are looked up from the beam
+	OcclusionHit TraceRay( const OcclusionRay& ray, const OcclusionBeam* beam ) const;
+	OcclusionHit TraverseGrid( float3 pos, float3 dir, float maxDistance, const OcclusionBeam* beam ) const;
+	// walks down from the node pointer whose children are on minLevel, skip is the empty distance of an empty cell or 0
+	uint32_t Traverse( const uint32_t pos[3], uint32_t pointer, uint32_t minLevel, uint32_t& size, uint32_t& skip, uint32_t& nodes ) const;
+	uint32_t GetBrick( const uint32_t pos[3], uint32_t& size, uint32_t& skip, uint32_t& nodes ) const;
+	// starts at the entry of the beam that contains pos, positions the beam doesn't cover start at the root
+	uint32_t GetBrickBeam( const uint32_t pos[3], const OcclusionBeam& beam, uint32_t& size, uint32_t& skip, uint32_t& nodes, uint32_t& misses ) const;
+	// stack has ShortStackSize entries
+	uint32_t GetBrickShortStack( const uint32_t pos[3], const uint32_t lastPos[3], uint32_t* stack, uint32_t& validLevel, uint32_t& size, uint32_t& skip, uint32_t& nodes ) const;
+	bool CheckBrick( uint32_t brickIdx, float pos[3], const float dir[3], const float invDir[3], const int mirror[3], const int offset[3] ) const;
+	// node of the cell at pos on the given level above the bricks, pos is in cells of that level. 0 for a filled cell, for an empty one
+	// 0xFFFFFFFF and emptyLevel is the level above the bricks of the empty cell. like Traverse1 without the split at level 5
+	uint32_t GetCell( const uint32_t pos[3], uint32_t cellLevel, uint32_t& emptyLevel ) const;
+	// OcclusionSoftShadow.cpp, ports of GetApproxVal, GetValue and GetValue1
+	float GetApproxValue( const uint32_t pos[3], const float dir[3], uint32_t level ) const;
+	float GetValue( const float pos[3], const float dir[3], uint32_t level ) const;
+	float GetValue1( const float pos[3], const float dir[3], float level, float& delta, int& iLevel ) const;
+	// OcclusionBeam.cpp, the cells of the box around the mirrored origins and directions of a beam down to beam.Level. false if
+	// there are too many
+	bool BuildBeam( const float minOrigin[3], const float maxOrigin[3], const float minDir[3], const float maxDir[3], const bool negative[3], OcclusionBeam& beam, uint32_t& nodes ) const;
+	// OcclusionPacket.cpp, the only file compiled with avx2
+	void TracePacketAvx2( const OcclusionRay* rays, OcclusionHit* hits, uint32_t numRays ) const;
+
+	Span<Node> m_Nodes;
+	Span<uint32_t> m_Pointers;
+	Span<uint4> m_EmptyDistances;
+	Span<float> m_Approx;
+	Span<uint32_t> m_AnisotropicApprox;
+	uint32_t m_TreeSize;
+	// in bricks like viGridResolution
+	uint3 m_GridResolution;
+	float3 m_MinGridPos;
+	float3 m_GridSize;
+	// world space size of a brick
+	float3 m_BrickSize;
+	bool m_UseShortStack = true;
+};
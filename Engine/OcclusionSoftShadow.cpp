@@ -0,0 +1,237 @@
+#include "OcclusionQuery.h"
+
+#include <ppl.h>
+#include <cmath>
+
+#include "Makros.h"
+#include "Math.h"
+#include "Approximation.h"
+#include "Voxelizer.h"
+
+namespace {
+// same blocks as TraceBatch
+const size_t RaysPerTask = 256;
+// SmoothTraverse1 stops once the cone is covered this much
+const float MaxOcclusion = 0.99f;
+// cells whose interpolated value is below get skipped by GetValue1
+const float MinApproxValue = 0.00001f;
+
+float Lerp( float a, float b, float t ) {
+	return a + ( b - a ) * t;
+}
+
+// like StepToEdge of OcclusionQuery.cpp but without the empty distances, returns the length of the step
+float StepToCellEdge( float pos[3], const float dir[3], const float invDir[3], float cellSize ) {
+	float edges[3], t[3];
+	for( int a = 0; a < 3; a++ ) {
+		edges[a] = ( floor( pos[a] / cellSize ) + 1.f ) * cellSize;
+		t[a] = ( edges[a] - pos[a] ) * invDir[a];
+	}
+	float tMin = Min( t[0], Min( t[1], t[2] ) );
+
+	for( int a = 0; a < 3; a++ )
+		pos[a] += dir[a] * tMin;
+	if( tMin == t[0] )
+		pos[0] = edges[0];
+	else if( tMin == t[1] )
+		pos[1] = edges[1];
+	else
+		pos[2] = edges[2];
+	return tMin;
+}
+}
+
+void OcclusionQuery::SetApproximation( Span<float> approx ) {
+	m_Approx = approx;
+	m_AnisotropicApprox = Span<uint32_t>();
+}
+
+void OcclusionQuery::SetApproximation( Span<uint32_t> anisotropicApprox ) {
+	m_AnisotropicApprox = anisotropicApprox;
+	m_Approx = Span<float>();
+}
+
+float OcclusionQuery::GetApproxValue( const uint32_t pos[3], const float dir[3], uint32_t level ) const {
+	// cells outside of the grid are empty like in GetApproxVal of TreeTraverse.hlsli
+	if( ( pos[0] << ( 2 * level ) ) >= m_GridResolution.x || ( pos[1] << ( 2 * level ) ) >= m_GridResolution.y || ( pos[2] << ( 2 * level ) ) >= m_GridResolution.z )
+		return 0.f;
+
+	uint32_t pointer = m_Pointers[0];
+	if( level < m_TreeSize ) {
+		uint32_t emptyLevel;
+		pointer = GetCell( pos, level, emptyLevel );
+		if( pointer == 0 )
+			return 1.f;
+		if( pointer == 0xFFFFFFFF )
+			return 0.f;
+	}
+
+	if( m_AnisotropicApprox.Size > 0 ) {
+		float3 approx = UintToFloat3( m_AnisotropicApprox[pointer] );
+		float value = ( dir[0] * approx.x + dir[1] * approx.y + dir[2] * approx.z ) / ( dir[0] + dir[1] + dir[2] );
+		return clamp( value, 0.f, 1.f );
+	}
+	return m_Approx[pointer];
+}
+
+float OcclusionQuery::GetValue( const float pos[3], const float dir[3], uint32_t level ) const {
+	float size = static_cast<float>( 1u << ( 2 * level ) );
+	uint32_t cell[3];
+	float coord[3];
+	for( int a = 0; a < 3; a++ ) {
+		float cellPos = pos[a] / size - 0.5f;
+		cell[a] = cellPos > 0.f ? static_cast<uint32_t>( cellPos ) : 0;
+		coord[a] = pos[a] / size - ( cell[a] + 0.5f );
+	}
+
+	// trilinear interpolation between the eight surrounding values
+	float values[8];
+	for( uint32_t i = 0; i < 8; i++ ) {
+		uint32_t neighbour[3] = { cell[0] + ( i & 1 ), cell[1] + ( ( i >> 1 ) & 1 ), cell[2] + ( ( i >> 2 ) & 1 ) };
+		values[i] = GetApproxValue( neighbour, dir, level );
+	}
+	float value0123 = Lerp( Lerp( values[0], values[1], coord[0] ), Lerp( values[2], values[3], coord[0] ), coord[1] );
+	float value4567 = Lerp( Lerp( values[4], values[5], coord[0] ), Lerp( values[6], values[7], coord[0] ), coord[1] );
+	return Lerp( value0123, value4567, coord[2] );
+}
+
+float OcclusionQuery::GetValue1( const float pos[3], const float dir[3], float level, float & delta, int & iLevel ) const {
+	delta = 1.f;
+	float lastValue = 0.f;
+	while( iLevel > level - 1.f ) {
+		lastValue = GetValue( pos, dir, iLevel );
+		if( lastValue < MinApproxValue ) {
+			delta = static_cast<float>( 1u << ( 2 * ( iLevel - 1 ) ) );
+			return 0.f;
+		}
+		iLevel--;
+	}
+	float newValue = GetValue( pos, dir, iLevel );
+	float interpValue = level - floor( level );
+	interpValue *= interpValue;
+
+	// the anisotropic values are only the projection along the direction, so a step counts more
+	float weight = m_AnisotropicApprox.Size > 0 ? 1.f / 2.f : 1.f / 3.f;
+	delta = pow( 2.f, ( level - 1.f ) * 2.f ) * weight;
+	return weight * Lerp( newValue, lastValue, interpValue );
+}
+
+float OcclusionQuery::SmoothTraverse1( float3 pos, float3 dir, float lightAngle ) const {
+	float length = sqrt( Dot( dir, dir ) );
+	if( m_Pointers.Size == 0 || !( length > 0.f ) || ( m_Approx.Size == 0 && m_AnisotropicApprox.Size == 0 ) )
+		return 0.f;
+
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+	float rayPos[3] = { pos.x, pos.y, pos.z };
+	float rayDir[3] = { dir.x / length, dir.y / length, dir.z / length };
+	float mirror[3], offset[3];
+	for( int a = 0; a < 3; a++ ) {
+		bool negative = rayDir[a] < 0.f;
+		mirror[a] = negative ? -1.f : 1.f;
+		offset[a] = negative ? resolution[a] - ( 1.f / 1024.f ) : 0.f;
+		rayPos[a] = ( negative ? 1.f - rayPos[a] : rayPos[a] ) * resolution[a];
+		rayDir[a] = abs( rayDir[a] );
+	}
+
+	float angleToDistance = 2.f * tan( 0.5f * lightAngle );
+	float level = 1.f;
+	float distance = 0.f;
+	float occlusion = 0.f;
+	int iLevel = static_cast<int>( m_TreeSize );
+	while( rayPos[0] < resolution[0] && rayPos[1] < resolution[1] && rayPos[2] < resolution[2] ) {
+		float samplePos[3];
+		for( int a = 0; a < 3; a++ )
+			samplePos[a] = offset[a] + mirror[a] * rayPos[a];
+		float delta;
+		occlusion += ( 1.f - occlusion ) * GetValue1( samplePos, rayDir, level, delta, iLevel );
+		if( occlusion > MaxOcclusion )
+			break;
+
+		for( int a = 0; a < 3; a++ )
+			rayPos[a] += delta * rayDir[a];
+		distance += delta;
+
+		// the level follows the diameter of the cone
+		float coneLevel = log2( distance * angleToDistance ) / 2.f + 1.f;
+		level = Max( coneLevel, 1.f );
+		iLevel = Min( iLevel + 1, static_cast<int>( m_TreeSize ) );
+	}
+	return clamp( occlusion, 0.f, 1.f );
+}
+
+float OcclusionQuery::SmoothTraverse2( float3 pos, float3 dir, float lightAngle ) const {
+	float length = sqrt( Dot( dir, dir ) );
+	if( m_Pointers.Size == 0 || !( length > 0.f ) )
+		return 0.f;
+
+	float resolution[3] = { static_cast<float>( m_GridResolution.x ), static_cast<float>( m_GridResolution.y ), static_cast<float>( m_GridResolution.z ) };
+	float rayPos[3] = { pos.x, pos.y, pos.z };
+	float rayDir[3] = { dir.x / length, dir.y / length, dir.z / length };
+	float invDir[3], offset[3];
+	int mirror[3], brickOffset[3];
+	for( int a = 0; a < 3; a++ ) {
+		bool negative = rayDir[a] < 0.f;
+		mirror[a] = negative ? -1 : 1;
+		brickOffset[a] = negative ? 3 : 0;
+		offset[a] = negative ? resolution[a] - ( 1.f / 1024.f ) : 0.f;
+		rayPos[a] = ( negative ? 1.f - rayPos[a] : rayPos[a] ) * resolution[a];
+		invDir[a] = abs( 1.f / rayDir[a] );
+		rayDir[a] = abs( rayDir[a] );
+	}
+
+	float angleToDistance = 2.f * tan( 0.25f * lightAngle );
+	float distance = 0.f;
+	uint32_t level = 0;
+	while( true ) {
+		uint32_t sampleLevel = Min( level > 0 ? level - 1 : 0, m_TreeSize );
+		uint32_t cellPos[3];
+		for( int a = 0; a < 3; a++ )
+			cellPos[a] = static_cast<uint32_t>( offset[a] + mirror[a] * floor( rayPos[a] ) ) >> ( 2 * sampleLevel );
+		uint32_t emptyLevel;
+		uint32_t cell = GetCell( cellPos, sampleLevel, emptyLevel );
+		if( cell == 0 )
+			return 1.f;
+		if( cell != 0xFFFFFFFF ) {
+			// a cell that isn't empty counts as filled once the cone is wider than a brick
+			if( level > 0 )
+				return 1.f;
+			float inBrickPos[3];
+			for( int a = 0; a < 3; a++ )
+				inBrickPos[a] = ( rayPos[a] - floor( rayPos[a] ) ) * 4.f;
+			if( CheckBrick( cell, inBrickPos, rayDir, invDir, mirror, brickOffset ) )
+				return 1.f;
+		}
+		else
+			sampleLevel = emptyLevel;
+
+		distance += StepToCellEdge( rayPos, rayDir, invDir, static_cast<float>( 1u << ( 2 * sampleLevel ) ) );
+		float coneLevel = log2( distance * angleToDistance ) / 2.f + 1.f;
+		level = static_cast<uint32_t>( Max( coneLevel, 0.f ) );
+
+		// test if still in box
+		if( rayPos[0] >= resolution[0] || rayPos[1] >= resolution[1] || rayPos[2] >= resolution[2] )
+			break;
+	}
+	return 0.f;
+}
+
+float OcclusionQuery::TraceSoft( const OcclusionRay & ray, float lightAngle, SoftShadowMethod method ) const {
+	// grid space like GetShadowVal in psShadow.hlsl, which only shades points inside of the grid
+	float3 pos = ( ray.Origin - m_MinGridPos ) / m_GridSize;
+	float3 dir = ray.Direction / m_GridSize;
+	if( !( pos.x > 0.f && pos.y > 0.f && pos.z > 0.f && pos.x < 1.f && pos.y < 1.f && pos.z < 1.f ) )
+		return 0.f;
+
+	if( method == SoftShadowMethod::SmoothTraverse1 )
+		return SmoothTraverse1( pos, dir, lightAngle );
+	return SmoothTraverse2( pos, dir, lightAngle );
+}
+
+void OcclusionQuery::TraceSoftBatch( const OcclusionRay * rays, float * occlusion, size_t numRays, float lightAngle, SoftShadowMethod method ) const {
+	size_t numTasks = ( numRays + RaysPerTask - 1 ) / RaysPerTask;
+	concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+		size_t end = Min( ( task + 1 ) * RaysPerTask, numRays );
+		for( size_t i = task * RaysPerTask; i < end; i++ )
+			occlusion[i] = TraceSoft( rays[i], lightAngle, method );
+	} );
+}
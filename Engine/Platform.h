@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// the CPU tree build (TreeBuilder) also compiles with gcc and clang,
+// there the few PPL and intrinsic parts it uses are replaced by the standard library
+#ifdef _MSC_VER
+#include <ppl.h>
+#include <intrin.h>
+
+// streams and the file mapping take the wide path as is
+inline const std::wstring& FilePath( const std::wstring& fileName ) {
+	return fileName;
+}
+#else
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <codecvt>
+#include <locale>
+
+inline uint32_t __popcnt( uint32_t value ) {
+	return static_cast<uint32_t>( __builtin_popcount( value ) );
+}
+
+// utf-8 path for the standard streams and open()
+inline std::string FilePath( const std::wstring& fileName ) {
+	std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> converter;
+	return converter.to_bytes( fileName );
+}
+
+namespace concurrency {
+// every thread takes the next index until all are done, like the PPL version the calls run in any order
+template<typename Index, typename Function>
+void parallel_for( Index first, Index last, const Function& function ) {
+	if( first >= last )
+		return;
+	uint32_t numThreads = std::thread::hardware_concurrency();
+	uint64_t count = static_cast<uint64_t>( last - first );
+	if( numThreads == 0 )
+		numThreads = 1;
+	if( count < numThreads )
+		numThreads = static_cast<uint32_t>( count );
+
+	std::atomic<uint64_t> next( 0 );
+	auto worker = [&]() {
+		for( uint64_t i = next++; i < count; i = next++ )
+			function( static_cast<Index>( first + i ) );
+	};
+	std::vector<std::thread> threads;
+	for( uint32_t i = 1; i < numThreads; i++ )
+		threads.emplace_back( worker );
+	worker();
+	for( std::thread& thread : threads )
+		thread.join();
+}
+
+// one value per thread that called local()
+template<typename T>
+class combinable {
+public:
+	T& local() {
+		std::lock_guard<std::mutex> lock( m_Mutex );
+		std::unique_ptr<T>& value = m_Values[std::this_thread::get_id()];
+		if( !value )
+			value.reset( new T() );
+		return *value;
+	}
+	template<typename Function>
+	void combine_each( const Function& function ) {
+		for( auto& value : m_Values )
+			function( *value.second );
+	}
+private:
+	std::mutex m_Mutex;
+	std::unordered_map<std::thread::id, std::unique_ptr<T>> m_Values;
+};
+}
+#endif
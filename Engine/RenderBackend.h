@@ -105,6 +105,8 @@ public:
 	virtual Buffer* CreateBuffer( const void* data, const BufferDesc& desc ) = 0;
 
 	virtual void CopyResource( Resource* dst, Resource* src ) = 0;
+	// copies size bytes starting at srcOffset to the beginning of dst
+	virtual void CopyBufferRegion( Buffer* dst, Buffer* src, UINT srcOffset, UINT size ) = 0;
 	virtual void UpdateBuffer( Buffer* buffer, void* data, UINT bufferSize, UINT subresource, MapType mapType, bool doNotWait = false ) = 0;
 	virtual void ReadBuffer( Buffer * buffer, UINT bufferSize, void* out, UINT cpySize, UINT subresource ) = 0;
 	virtual void MapBuffer( Buffer * buffer, void ** out, UINT subresource, MapType mapType ) = 0;
@@ -119,6 +121,8 @@ public:
 	virtual void NotifyChangeInVisibility() = 0;
 
 	virtual void SaveTexture( TextureResource* res, const std::wstring& fileName ) = 0;
+	// copies a single channel float texture row by row, false for other formats
+	virtual bool ReadTexture( TextureResource* res, std::vector<float>& out ) = 0;
 	virtual void TakeScreenShot( const std::wstring& fileName = L"ScreenShot" ) = 0;
 
 	virtual void SetLightSizeAngle( float angle ) = 0;
@@ -0,0 +1,51 @@
+#include "SampleTable.h"
+
+#include <random>
+#include <algorithm>
+
+#include "Makros.h"
+#include "Shader\VoxelDefines.hlsli"
+
+float GetHaltonNumber( int index, int base ) {
+	float result = 0.f;
+	float f = 1.f;
+	int i = index;
+	while( i > 0 ) {
+		f = f / base;
+		result = result + f * ( i % base );
+		i = i / base;
+	}
+	return result;
+}
+
+void ComputeSampleTable( float2* table ) {
+	const int maxSamples = 10;
+	for( int set = 0; set < SAMPLE_TABLE_SETS; set++ ) {
+		std::default_random_engine engine( set );
+		for( int iN = 1; iN <= maxSamples; iN++ ) {
+			float fN = static_cast<float>( iN );
+			float2* p = table + set * SAMPLE_TABLE_SIZE + GetSampleTableOffset( iN );
+			// the sets use different parts of the sequence, so their cells aren't jittered the same
+			int haltonIndex = ( set * maxSamples + iN ) * iN * iN;
+			for( int j = 0; j < iN; ++j ) {
+				for( int i = 0; i < iN; ++i ) {
+					float randX = GetHaltonNumber( haltonIndex + j * iN + i, 2 );
+					float randY = GetHaltonNumber( haltonIndex + j * iN + i, 3 );
+					p[j * iN + i].x = ( i + ( j + randX ) / fN ) / fN;
+					p[j * iN + i].y = ( j + ( i + randY ) / fN ) / fN;
+				}
+			}
+			std::uniform_real_distribution<float> distr( 0.f, 1.f );
+			for( int j = 0; j < iN; ++j ) {
+				int k = Min( static_cast<int>( j + distr( engine ) * ( iN - j ) ), iN - 1 );
+				for( int i = 0; i < iN; ++i )
+					std::swap( p[j * iN + i].x, p[k * iN + i].x );
+			}
+			for( int i = 0; i < iN; ++i ) {
+				int k = Min( static_cast<int>( i + distr( engine ) * ( iN - i ) ), iN - 1 );
+				for( int j = 0; j < iN; ++j )
+					std::swap( p[j * iN + i].y, p[j * iN + k].y );
+			}
+		}
+	}
+}
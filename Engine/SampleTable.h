@@ -0,0 +1,11 @@
+#pragma once
+#include "Types.h"
+
+float GetHaltonNumber( int index, int base );
+// first point of the set of NumSamples x NumSamples rays in a table set, the sets for 1 to 10 rays per axis follow each other
+inline uint32_t GetSampleTableOffset( uint32_t samplesPerAxis ) {
+	return ( samplesPerAxis - 1 ) * samplesPerAxis * ( 2 * samplesPerAxis - 1 ) / 6;
+}
+// SAMPLE_TABLE_SETS sets of SAMPLE_TABLE_SIZE points in [0, 1)^2, set after set. they are multi-jittered like the per pixel ones of JITTER in psShadow.hlsl,
+// but the jitter inside the cells comes from the halton sequence of bases 2 and 3 and the rows and columns are shuffled once per set
+void ComputeSampleTable( float2* table );
@@ -22,6 +22,22 @@ Buffer<float3> Approx : register( t4 );
 #else
 Buffer<float> Approx : register( t4 );
 #endif
+#ifdef EMPTY_DISTANCE
+// 2 bits per child, see EmptyDistance.h
+Buffer<uint4> EmptyDistances : register( t6 );
+#endif
+#ifdef BEAM_TRAVERSE
+struct BeamEntry {
+	uint Key;
+	uint Level;
+	uint Pointer;
+};
+
+// BEAM_SIZE entries per tile written by csBeam, sorted by Key like OcclusionBeam::Entries
+StructuredBuffer<BeamEntry> Beams : register( t7 );
+// tile of the current pixel, -1 traverses from the root
+static uint BeamTile = -1;
+#endif
 
 uint Encode( uint3 pos ) {
 	// Generate Morten Code
@@ -86,9 +102,11 @@ bool CheckBrick( uint uiBrickIdx, float3 vPos, float3 vDir, float3 vDir_1, int3
 	return false;
 }
 
-uint Traverse( uint3 viPos, uint uiPointer, uint minLevel, uint maxLevel, out uint uiSize ) {
+// uiSkip is the empty distance of an empty cell with EMPTY_DISTANCE, 0 otherwise
+uint Traverse( uint3 viPos, uint uiPointer, uint minLevel, uint maxLevel, out uint uiSize, out uint uiSkip ) {
 	uint uiPackedPos = Encode( viPos );
 	uiSize = 1;
+	uiSkip = 0;
 	for( uint level = minLevel; level <= maxLevel; level++ ) {
 		Node current = Tree[uiPointer];
 
@@ -108,28 +126,145 @@ uint Traverse( uint3 viPos, uint uiPointer, uint minLevel, uint maxLevel, out ui
 		}
 		else {
 			uiSize = 1 << ( 2 * ( uiTreeSize - level ) );
+#ifdef EMPTY_DISTANCE
+			uiSkip = ( EmptyDistances[uiPointer][uiNodePos >> 4] >> ( ( uiNodePos & 0xf ) * 2 ) ) & 3;
+#endif
 			return -1;
 		}
 	}
 	return uiPointer;
 }
 
-uint GetBrick( uint3 viPos, out uint uiSize ) {
+uint Traverse( uint3 viPos, uint uiPointer, uint minLevel, uint maxLevel, out uint uiSize ) {
+	uint uiSkip;
+	return Traverse( viPos, uiPointer, minLevel, maxLevel, uiSize, uiSkip );
+}
+
+uint GetBrick( uint3 viPos, out uint uiSize, out uint uiSkip ) {
 	uiSize = 1;
+	uiSkip = 0;
 
 	uint uiPointer = Pointers[0];
 
 	if( uiTreeSize > 5 ) {
-		uiPointer = Traverse( viPos >> 10, uiPointer, 1, uiTreeSize - 5, uiSize );
+		uiPointer = Traverse( viPos >> 10, uiPointer, 1, uiTreeSize - 5, uiSize, uiSkip );
 		if( uiPointer != -1 ) {
-			return Traverse( viPos, uiPointer, uiTreeSize - 4, uiTreeSize, uiSize );
+			return Traverse( viPos, uiPointer, uiTreeSize - 4, uiTreeSize, uiSize, uiSkip );
 		}
 		return -1;
 	}
 	else {
-		return Traverse( viPos, uiPointer, 1, uiTreeSize, uiSize );
+		return Traverse( viPos, uiPointer, 1, uiTreeSize, uiSize, uiSkip );
+	}
+}
+
+uint GetBrick( uint3 viPos, out uint uiSize ) {
+	uint uiSkip;
+	return GetBrick( viPos, uiSize, uiSkip );
+}
+
+// levels below the split of GetBrick
+#define SHORT_STACK_SIZE 5
+
+// like GetBrick, but it starts at the deepest node on the path to viLastPos that also contains viPos instead of the root.
+// Stack keeps the nodes of the levels below the split, up to uiValidLevel, the levels above are only traversed again
+// if the position leaves their node. uiValidLevel 0 means there is no path yet
+uint GetBrickShortStack( uint3 viPos, uint3 viLastPos, inout uint Stack[SHORT_STACK_SIZE], inout uint uiValidLevel, out uint uiSize, out uint uiSkip ) {
+	uiSize = 1;
+	uiSkip = 0;
+	uint uiMinLevel = uiTreeSize > 5 ? uiTreeSize - 4 : 1;
+	uint3 viDifference = viPos ^ viLastPos;
+	uint uiDiff = viDifference.x | viDifference.y | viDifference.z;
+
+	uint uiLevel;
+	uint uiPointer;
+	if( uiValidLevel == 0 || ( uiDiff >> 10 ) != 0 ) {
+		uiPointer = Pointers[0];
+		if( uiTreeSize > 5 ) {
+			uiPointer = Traverse( viPos >> 10, uiPointer, 1, uiTreeSize - 5, uiSize, uiSkip );
+			if( uiPointer == -1 || uiPointer == 0 ) {
+				uiValidLevel = 0;
+				return uiPointer;
+			}
+		}
+		uiLevel = uiMinLevel;
+	}
+	else {
+		// first level whose 2 bits of the position changed
+		uiLevel = uiDiff == 0 ? uiTreeSize : uiTreeSize - ( firstbithigh( uiDiff ) >> 1 );
+		uiLevel = clamp( uiLevel, uiMinLevel, uiValidLevel );
+		uiPointer = Stack[uiLevel - uiMinLevel];
+	}
+
+	uint uiPackedPos = Encode( viPos );
+	for( uint level = uiLevel; level <= uiTreeSize; level++ ) {
+		Stack[level - uiMinLevel] = uiPointer;
+		uiValidLevel = level;
+		Node current = Tree[uiPointer];
+
+		uint uiNodePos = ( uiPackedPos >> ( ( uiTreeSize - level ) * 6 ) ) & 0x3f;
+		uint uiData = uiNodePos < 32 ? current.Data.x : current.Data.y;
+		uint uiDataPos = uiNodePos < 32 ? uiNodePos : uiNodePos - 32;
+
+		if( uiData & ( 1 << uiDataPos ) ) {
+			uint uiCompVal = 0x7fffffff >> ( 31 - uiDataPos );
+			uint offset = countbits( uint( uiData & uiCompVal ) );
+			if( uiNodePos > 31 ) {
+				offset += countbits( current.Data.x );
+			}
+			uiPointer = Pointers[current.Pointer + offset];
+			if( uiPointer == -1 )
+				return 0;
+		}
+		else {
+			uiSize = 1 << ( 2 * ( uiTreeSize - level ) );
+#ifdef EMPTY_DISTANCE
+			uiSkip = ( EmptyDistances[uiPointer][uiNodePos >> 4] >> ( ( uiNodePos & 0xf ) * 2 ) ) & 3;
+#endif
+			return -1;
+		}
+	}
+	return uiPointer;
+}
+
+#ifdef BEAM_TRAVERSE
+// like GetBrick, but it starts at the entry of the beam of BeamTile that contains viPos. positions the beam doesn't cover start at the root
+uint GetBrickBeam( uint3 viPos, out uint uiSize, out uint uiSkip ) {
+	uiSize = 1;
+	uiSkip = 0;
+	if( BeamTile == -1 )
+		return GetBrick( viPos, uiSize, uiSkip );
+
+	uint uiBase = BeamTile * BEAM_SIZE;
+	uint uiNumEntries = Beams[uiBase].Key;
+	uint uiBeamLevel = Beams[uiBase].Level;
+	uint uiKey = Encode( viPos >> ( 2 * ( uiTreeSize - uiBeamLevel ) ) );
+
+	// first entry that starts after the cell
+	uint uiLow = 1;
+	uint uiHigh = uiNumEntries + 1;
+	while( uiLow < uiHigh ) {
+		uint uiMid = ( uiLow + uiHigh ) >> 1;
+		if( Beams[uiBase + uiMid].Key <= uiKey )
+			uiLow = uiMid + 1;
+		else
+			uiHigh = uiMid;
+	}
+	if( uiLow > 1 ) {
+		BeamEntry entry = Beams[uiBase + uiLow - 1];
+		if( uiKey - entry.Key < ( 1u << ( 6 * ( uiBeamLevel - entry.Level ) ) ) ) {
+			if( entry.Pointer == -1 ) {
+				uiSize = 1 << ( 2 * ( uiTreeSize - entry.Level ) );
+				return -1;
+			}
+			if( entry.Pointer == 0 )
+				return 0;
+			return Traverse( viPos, entry.Pointer, uiBeamLevel + 1, uiTreeSize, uiSize, uiSkip );
+		}
 	}
+	return GetBrick( viPos, uiSize, uiSkip );
 }
+#endif
 
 uint Traverse1( uint3 viPos, uint uiPointer, uint minLevel, uint maxLevel, inout uint uiLevel ) {
 	uint uiPackedPos = Encode( viPos );
@@ -174,12 +309,18 @@ uint GetBrick1( uint3 viPos, inout uint uiLevel ) {
 }
 
 float GetApproxVal( uint3 viPos, float3 vDir, uint uiLevel ) {
+	// cells outside of the grid are empty, Encode would wrap them around to the other side
+	if( any( ( viPos << ( 2 * uiLevel ) ) >= viGridResolution ) )
+		return 0.f;
+
 	uint uiOutSize = 1;
 
 	uint uiPointer = Pointers[0];
 
-	if( uiTreeSize > 5 ) {
-		uiPointer = Traverse( viPos >> 10, uiPointer, 1, uiTreeSize - 5, uiOutSize );
+	// viPos is in cells of uiLevel, the levels above the split of GetBrick start at brick position bit 10.
+	// from level 5 on the whole cell position fits into Encode
+	if( uiTreeSize > 5 && uiLevel < 5 ) {
+		uiPointer = Traverse( viPos >> ( 10 - 2 * uiLevel ), uiPointer, 1, uiTreeSize - 5, uiOutSize );
 		if( uiPointer != -1 && uiPointer != 0 ) {
 			uiPointer = Traverse( viPos, uiPointer, uiTreeSize - 4, uiTreeSize - uiLevel, uiOutSize );
 		}
@@ -410,10 +551,23 @@ bool TraverseTree( float3 vPos, float3 vDir, out float3 color ) {
 
 
 	uint uiSize = 1;
+	uint uiSkip = 0;
 	uint i;
+#ifdef SHORT_STACK_TRAVERSE
+	uint Stack[SHORT_STACK_SIZE];
+	uint uiValidLevel = 0;
+	uint3 viLastPos = 0;
+#endif
 	for( i = 0; true; ++i ) {
 		uint3 viSamplePos = vOffset + vMirror * floor( vPos );
-		uint uiBrick = GetBrick( viSamplePos, uiSize );
+#if defined( BEAM_TRAVERSE )
+		uint uiBrick = GetBrickBeam( viSamplePos, uiSize, uiSkip );
+#elif defined( SHORT_STACK_TRAVERSE )
+		uint uiBrick = GetBrickShortStack( viSamplePos, viLastPos, Stack, uiValidLevel, uiSize, uiSkip );
+		viLastPos = viSamplePos;
+#else
+		uint uiBrick = GetBrick( viSamplePos, uiSize, uiSkip );
+#endif
 		if( uiBrick == 0 ) {
 			float val = i / fMaxItVal;
 			color = float3( val, 0, 0 );
@@ -430,6 +584,11 @@ bool TraverseTree( float3 vPos, float3 vDir, out float3 color ) {
 
 		float fSize = uiSize;
 		float3 vEdges = ( floor( vPos / fSize ) + float3( 1, 1, 1 ) ) * fSize;
+#ifdef EMPTY_DISTANCE
+		// the empty cells around an empty cell only reach to the edge of its node
+		float3 vNodeEdges = ( floor( vPos / ( 4.f * fSize ) ) + float3( 1, 1, 1 ) ) * 4.f * fSize;
+		vEdges = min( vEdges + uiSkip * fSize, vNodeEdges );
+#endif
 		float3 t = ( vEdges - vPos ) * vDir_1;
 		float fTMin = min( t.x, min( t.y, t.z ) );
 
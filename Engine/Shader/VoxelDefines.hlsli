@@ -1,7 +1,29 @@
 //#define ADVANCED_TRAVERSE
 //#define SMOOTH_TRAVERSE
+// the lookup of the next brick resumes from the nodes of the last path instead of the root
+//#define SHORT_STACK_TRAVERSE
+// per node distances to the filled children, empty space is skipped in larger steps
+//#define EMPTY_DISTANCE
+// the shadow rays of a tile of pixels start below the upper tree levels that csBeam traced once for the whole tile, see OcclusionBeam.
+// replaces SHORT_STACK_TRAVERSE in TraverseTree
+//#define BEAM_TRAVERSE
+#define BEAM_TILE_SIZE 8
+// entries per tile, the first one holds the number of entries and the beam level
+#define BEAM_SIZE 128
+// the stratified rays of JITTER take their directions from a precomputed table of low discrepancy sets instead of shuffling them per pixel, see SampleTable.h
+//#define SAMPLE_TABLE
+// every pixel of a tile has its own set, the sets move by one pixel per frame
+#define SAMPLE_TABLE_TILE 8
+#define SAMPLE_TABLE_SETS ( SAMPLE_TABLE_TILE * SAMPLE_TABLE_TILE )
+// points per set, the sets of 1x1 up to 10x10 rays of JITTER
+#define SAMPLE_TABLE_SIZE 385
 #define VOXEL_VIEW
 #define PERSPECTIVE_VIEW
 #define TEMPORAL
 //#define SOFTSHADOW
 //#define ANISOTROPIC
+
+// voxelization modes, the separating ones only set voxels overlapping the inner diamond of the voxel
+#define VOXEL_MODE_CONSERVATIVE 0
+#define VOXEL_MODE_26_SEPARATING 1
+#define VOXEL_MODE_6_SEPARATING 2
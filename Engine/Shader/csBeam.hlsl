@@ -0,0 +1,188 @@
+#include "TreeTraverse.hlsli"
+
+// beams of the shadow rays of BEAM_TILE_SIZE x BEAM_TILE_SIZE pixels for GetBrickBeam, the gpu version of OcclusionQuery::BuildBeam.
+// every thread reconstructs the position of its pixel like psShadow, the first one walks the upper tree levels for the whole tile
+struct Entry {
+	uint Key;
+	uint Level;
+	uint Pointer;
+};
+
+Texture2D<float2> dsvTex : register( t0 );
+Texture2D<float4> normalTex : register( t1 );
+
+RWStructuredBuffer<Entry> BeamOut : register( u0 );
+
+cbuffer BeamData : register( b0 ) {
+	float4x4 invViewProjMat;
+	float3 InvLightDir;
+	float JitterRad;
+	uint2 ScreenSize;
+	uint NumTilesX;
+};
+
+// the cells get a bit larger, so rounding doesn't let a ray leave the beam
+static const float BeamEpsilon = 1.f / 1024.f;
+
+// bounds of the mirrored origins as uint, the origins are positive
+groupshared uint MinOrigin[3];
+groupshared uint MaxOrigin[3];
+groupshared uint NumPoints;
+
+// position of child i inside of its parent, the inverse of Encode
+uint3 GetChildPos( uint child ) {
+	return uint3( ( child & 1 ) | ( ( child >> 2 ) & 2 ), ( ( child >> 1 ) & 1 ) | ( ( child >> 3 ) & 2 ), ( ( child >> 2 ) & 1 ) | ( ( child >> 4 ) & 2 ) );
+}
+
+// interval test of the cell against all rays between the bounds, the rays run into positive direction in the mirrored grid
+bool IntersectsBeam( uint3 viCellPos, uint uiCellSize, float3 vMinOrigin, float3 vMaxOrigin, float3 vMinDir, float3 vMaxDir, bool3 bNegative ) {
+	float3 vBoxMin = bNegative ? float3( viGridResolution ) - float3( viCellPos ) - uiCellSize : float3( viCellPos );
+	float3 vBoxMax = vBoxMin + uiCellSize + BeamEpsilon;
+	vBoxMin -= BeamEpsilon;
+
+	float fTMin = 0.f;
+	float fTMax = 1e30f;
+	for( uint a = 0; a < 3; ++a ) {
+		if( vMaxDir[a] > 0.f )
+			fTMin = max( fTMin, ( vBoxMin[a] - vMaxOrigin[a] ) / vMaxDir[a] );
+		else if( vMaxOrigin[a] < vBoxMin[a] )
+			return false;
+		if( vMinDir[a] > 0.f )
+			fTMax = min( fTMax, ( vBoxMax[a] - vMinOrigin[a] ) / vMinDir[a] );
+		else if( vMinOrigin[a] > vBoxMax[a] )
+			return false;
+	}
+	return fTMin <= fTMax;
+}
+
+[numthreads( BEAM_TILE_SIZE, BEAM_TILE_SIZE, 1 )]
+void main( uint2 groupId : SV_GroupID, uint2 threadId : SV_GroupThreadID, uint threadIdx : SV_GroupIndex ) {
+	if( threadIdx == 0 ) {
+		for( uint a = 0; a < 3; ++a ) {
+			MinOrigin[a] = 0xffffffff;
+			MaxOrigin[a] = 0;
+		}
+		NumPoints = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// same positions as GetShadowVal, the origins move along the light direction before the jitter
+	uint2 pixel = groupId * BEAM_TILE_SIZE + threadId;
+	if( all( pixel < ScreenSize ) ) {
+		float depth = dsvTex[pixel].x;
+		float4 normal = normalTex[pixel];
+		if( depth <= 0.9999 && dot( normal.xyz, InvLightDir ) >= 0.f ) {
+			float2 texCoord = ( float2( pixel ) + 0.5f ) / float2( ScreenSize );
+			float4 vProjPosition = float4( texCoord, depth, 1.f );
+			vProjPosition.xy = ( vProjPosition.xy * 2.f ) - 1.f;
+			vProjPosition.y = -vProjPosition.y;
+			float4 vPosition = mul( invViewProjMat, vProjPosition );
+			vPosition.xyz /= vPosition.w;
+
+			float3 vInGridPos = ( vPosition.xyz - vMinGridPos ) / vGridSize;
+			vInGridPos += 2 * InvLightDir / viGridResolution;
+			if( all( vInGridPos > 0 && vInGridPos < 1 ) ) {
+				float3 vOrigin = ( InvLightDir < 0 ? 1 - vInGridPos : vInGridPos ) * viGridResolution;
+				for( uint a = 0; a < 3; ++a ) {
+					InterlockedMin( MinOrigin[a], asuint( vOrigin[a] ) );
+					InterlockedMax( MaxOrigin[a], asuint( vOrigin[a] ) );
+				}
+				InterlockedAdd( NumPoints, 1 );
+			}
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if( threadIdx != 0 )
+		return;
+
+	uint uiBase = ( groupId.y * NumTilesX + groupId.x ) * BEAM_SIZE;
+	uint uiBeamLevel = min( uiTreeSize - 2, 5 );
+	// the key of Encode has 5 levels and Traverse only reaches 4 levels below the split of GetBrick
+	bool bValid = NumPoints > 0 && uiTreeSize >= 3 && uiTreeSize <= 10;
+
+	// directions of the jitter like GetShadowVal, the square of JITTER contains the circle of TEMPORAL
+	float3 vDir1;
+	if( abs( InvLightDir.x ) < 0.9 )
+		vDir1 = normalize( cross( InvLightDir, float3( 1, 0, 0 ) ) );
+	else
+		vDir1 = normalize( cross( InvLightDir, float3( 0, 1, 0 ) ) );
+	float3 vDir2 = normalize( cross( InvLightDir, vDir1 ) );
+	float3 vSpread = JitterRad * ( abs( vDir1 ) + abs( vDir2 ) );
+	float3 vLowDir = InvLightDir - vSpread;
+	float3 vHighDir = InvLightDir + vSpread;
+	// all rays need the same mirroring
+	bValid = bValid && all( vLowDir > 0 || vHighDir < 0 );
+
+	// the directions of TraverseTree are divided by their largest component
+	float3 vAbsMin = min( abs( vLowDir ), abs( vHighDir ) );
+	float3 vAbsMax = max( abs( vLowDir ), abs( vHighDir ) );
+	float3 vMinDir = vAbsMin / max( vAbsMax.x, max( vAbsMax.y, vAbsMax.z ) );
+	float3 vMaxDir = vAbsMax / max( vAbsMin.x, max( vAbsMin.y, vAbsMin.z ) );
+	float3 vMinOrigin = asfloat( uint3( MinOrigin[0], MinOrigin[1], MinOrigin[2] ) );
+	float3 vMaxOrigin = asfloat( uint3( MaxOrigin[0], MaxOrigin[1], MaxOrigin[2] ) );
+	bool3 bNegative = InvLightDir < 0;
+
+	// depth first with one node per level, the entries are sorted by their key
+	uint Pointer[5];
+	uint NextChild[5];
+	uint ChildOffset[5];
+	uint Key[5];
+	uint3 CellPos[5];
+	Pointer[0] = Pointers[0];
+	NextChild[0] = 0;
+	ChildOffset[0] = 0;
+	Key[0] = 0;
+	CellPos[0] = 0;
+
+	uint uiNumEntries = 0;
+	uint level = bValid ? 1 : 0;
+	while( level > 0 ) {
+		uint i = level - 1;
+		if( NextChild[i] == 64 ) {
+			--level;
+			continue;
+		}
+		uint child = NextChild[i]++;
+		Node current = Tree[Pointer[i]];
+		uint uiData = child < 32 ? current.Data.x : current.Data.y;
+		bool bFilled = ( uiData >> ( child & 0x1f ) ) & 1;
+		uint uiPointer = -1;
+		if( bFilled )
+			uiPointer = Pointers[current.Pointer + ChildOffset[i]++];
+
+		uint uiCellSize = 1 << ( 2 * ( uiTreeSize - level ) );
+		uint3 viCellPos = CellPos[i] + GetChildPos( child ) * uiCellSize;
+		if( !IntersectsBeam( viCellPos, uiCellSize, vMinOrigin, vMaxOrigin, vMinDir, vMaxDir, bNegative ) )
+			continue;
+
+		uint uiKey = ( Key[i] << 6 ) | child;
+		if( !bFilled || uiPointer == -1 || level == uiBeamLevel ) {
+			// too many cells, the whole tile starts at the root
+			if( uiNumEntries + 1 >= BEAM_SIZE ) {
+				bValid = false;
+				break;
+			}
+			Entry entry;
+			entry.Key = uiKey << ( 6 * ( uiBeamLevel - level ) );
+			entry.Level = level;
+			entry.Pointer = bFilled ? ( uiPointer == -1 ? 0 : uiPointer ) : -1;
+			BeamOut[uiBase + 1 + uiNumEntries] = entry;
+			++uiNumEntries;
+		}
+		else {
+			Pointer[level] = uiPointer;
+			NextChild[level] = 0;
+			ChildOffset[level] = 0;
+			Key[level] = uiKey;
+			CellPos[level] = viCellPos;
+			++level;
+		}
+	}
+
+	Entry header;
+	header.Key = bValid ? uiNumEntries : 0;
+	header.Level = uiBeamLevel;
+	header.Pointer = 0;
+	BeamOut[uiBase] = header;
+}
@@ -0,0 +1,24 @@
+#include "TreeTraverse.hlsli"
+
+// traces the rays of TraversalVectors.h with TraverseTree, TreeInspector -v compares OcclusionQuery to the results
+struct TraversalRay {
+	float3 Pos;
+	float3 Dir;
+};
+
+StructuredBuffer<TraversalRay> Rays : register( t0 );
+// hit and steps of every ray
+RWStructuredBuffer<uint2> Results : register( u0 );
+
+[numthreads( 64, 1, 1 )]
+void main( uint id : SV_DispatchThreadID ) {
+	uint uiNumRays, uiStride;
+	Rays.GetDimensions( uiNumRays, uiStride );
+	if( id >= uiNumRays )
+		return;
+
+	// TraverseTree only returns the iterations as the red channel of a hit, i / fMaxItVal
+	float3 color;
+	bool bHit = TraverseTree( Rays[id].Pos, Rays[id].Dir, color );
+	Results[id] = uint2( bHit ? 1 : 0, bHit ? uint( round( color.x * fMaxItVal ) ) : 0 );
+}
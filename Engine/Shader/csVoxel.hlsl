@@ -14,6 +14,7 @@ RWBuffer<uint> Counter : register( u2 );
 
 cbuffer Constants : register( c0 ) {
 	uint3 gridSize;
+	uint voxelMode;
 	uint3 numTexels;
 	float3 deltaGrid;
 	float3 invDeltaGrid;
@@ -44,6 +45,17 @@ struct TriangleVals {
 	float d_yzT[3];
 };
 
+// half extent of the inner diamond of a voxel along the normal
+float DiamondExtent( float3 n, float3 delta ) {
+	float3 extent = abs( n ) * delta;
+	return 0.5f * max( extent.x, max( extent.y, extent.z ) );
+}
+
+float DiamondExtent( float2 n, float2 delta ) {
+	float2 extent = abs( n ) * delta;
+	return 0.5f * max( extent.x, extent.y );
+}
+
 TriangleVals CalculateTriangleVals( float3 tri[3] ) {
 	TriangleVals vals;
 
@@ -74,6 +86,14 @@ TriangleVals CalculateTriangleVals( float3 tri[3] ) {
 	vals.d1T = dot( vals.n, c - tri[0] );
 	vals.d2T = dot( vals.n, ( deltaTex - c ) - tri[0] );
 
+	// the thin mode only needs the plane to cross the diamond, tested from the voxel center
+	float3 halfDelta = 0.5f * deltaGrid;
+	if( voxelMode == VOXEL_MODE_6_SEPARATING ) {
+		float center = dot( vals.n, halfDelta - tri[0] );
+		vals.d1 = center - DiamondExtent( vals.n, deltaGrid );
+		vals.d2 = center + DiamondExtent( vals.n, deltaGrid );
+	}
+
 	[unroll]
 	for( uint i = 0; i < 3; ++i ) {
 		// ns and ds for bit width
@@ -96,6 +116,27 @@ TriangleVals CalculateTriangleVals( float3 tri[3] ) {
 		vals.d_xyT[i] = -dot( vals.n_xy[i], tri[i].xy ) + max( 0, deltaTex.x * vals.n_xy[i].x ) + max( 0, deltaTex.y * vals.n_xy[i].y );
 		vals.d_xzT[i] = -dot( vals.n_xz[i], tri[i].xz ) + max( 0, deltaTex.x * vals.n_xz[i].x ) + max( 0, deltaTex.z * vals.n_xz[i].y );
 		vals.d_yzT[i] = -dot( vals.n_yz[i], tri[i].yz ) + max( 0, deltaTex.y * vals.n_yz[i].x ) + max( 0, deltaTex.z * vals.n_yz[i].y );
+
+		// the texel tests stay conservative, they only prefilter the voxel tests
+		if( voxelMode != VOXEL_MODE_CONSERVATIVE ) {
+			vals.d_xy[i] = -dot( vals.n_xy[i], tri[i].xy - halfDelta.xy ) + DiamondExtent( vals.n_xy[i], deltaGrid.xy );
+			vals.d_xz[i] = -dot( vals.n_xz[i], tri[i].xz - halfDelta.xz ) + DiamondExtent( vals.n_xz[i], deltaGrid.xz );
+			vals.d_yz[i] = -dot( vals.n_yz[i], tri[i].yz - halfDelta.yz ) + DiamondExtent( vals.n_yz[i], deltaGrid.yz );
+		}
+	}
+
+	// for 6-separation only the projection along the dominant axis is tested
+	if( voxelMode == VOXEL_MODE_6_SEPARATING ) {
+		float3 absN = abs( vals.n );
+		[unroll]
+		for( uint j = 0; j < 3; ++j ) {
+			if( absN.z < absN.x || absN.z < absN.y )
+				vals.d_xy[j] = 1e30f;
+			if( absN.y < absN.x || absN.y <= absN.z )
+				vals.d_xz[j] = 1e30f;
+			if( absN.x <= absN.y || absN.x <= absN.z )
+				vals.d_yz[j] = 1e30f;
+		}
 	}
 
 
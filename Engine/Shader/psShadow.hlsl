@@ -8,6 +8,10 @@ Texture2D<float> oldShadowTex : register( t5 );
 
 RWTexture2D<float> newShadowTex: register( u1 );
 
+#ifdef SAMPLE_TABLE
+Buffer<float2> SampleTable : register( t8 );
+#endif
+
 SamplerState defaultSampler : register( s0 );
 
 cbuffer CameraBuffer : register( b0 ) {
@@ -154,9 +158,6 @@ float GetShadowVal( float3 vPos, float3 vDir, float2 screenPos ) {
 		fShadowVal = ( 1 - SmoothTraverse1( vInGridPos, vDir, fLightAngle ) );
 #else
 #ifdef JITTER
-		NumberGenerator randGen;
-		randGen.SetSeed( uint2( asuint( vPos.x ) ^ asuint( vPos.y ), asuint( vPos.z ) ) );
-
 		float3 vDir1;
 		float3 vDir2;
 		if( abs( vDir.x ) < 0.9 )
@@ -166,6 +167,17 @@ float GetShadowVal( float3 vPos, float3 vDir, float2 screenPos ) {
 		vDir2 = normalize( cross( vDir, vDir1 ) );
 		float3 vInitialDir = vDir;
 
+#ifdef SAMPLE_TABLE
+		// the set of the pixel in this frame, its points for NumSamples x NumSamples rays start at GetSampleTableOffset
+		int iN = min( NumSamples, 10u );
+		float fN = iN;
+		uint2 tilePos = uint2( screenPos ) % SAMPLE_TABLE_TILE;
+		uint uiSet = ( tilePos.y * SAMPLE_TABLE_TILE + tilePos.x + FilterSeed ) % SAMPLE_TABLE_SETS;
+		uint uiFirst = uiSet * SAMPLE_TABLE_SIZE + ( iN - 1 ) * iN * ( 2 * iN - 1 ) / 6;
+#else
+		NumberGenerator randGen;
+		randGen.SetSeed( uint2( asuint( vPos.x ) ^ asuint( vPos.y ), asuint( vPos.z ) ) );
+
 		// make room for maximum value
 		float2 p[100];
 
@@ -197,11 +209,17 @@ float GetShadowVal( float3 vPos, float3 vDir, float2 screenPos ) {
 				p[j * iN + k].y = temp;
 			}
 		}
+#endif
 
 		for( int i = 0; i < iN; ++i ) {
 			for( int j = 0; j < iN; ++j ) {
-				float randX = ( ( ( p[iN * j + i].x ) * 2.f ) - 1.f ) * fJitterRad;
-				float randY = ( ( ( p[iN * j + i].y ) * 2.f ) - 1.f ) * fJitterRad;
+#ifdef SAMPLE_TABLE
+				float2 vSample = SampleTable[uiFirst + iN * j + i];
+#else
+				float2 vSample = p[iN * j + i];
+#endif
+				float randX = ( vSample.x * 2.f - 1.f ) * fJitterRad;
+				float randY = ( vSample.y * 2.f - 1.f ) * fJitterRad;
 				vDir = vInitialDir + vDir1 * randX + vDir2 * randY;
 #endif
 				float3 vTestColor;
@@ -247,5 +265,12 @@ void main( float2 texCoord : TEXCOORD, float4 svPos : SV_POSITION ) {
 	vPosition.xyz /= vPosition.w;
 	vPosition.w = 1.f;
 
+#ifdef BEAM_TRAVERSE
+	uint2 screenSize;
+	newShadowTex.GetDimensions( screenSize.x, screenSize.y );
+	uint2 tile = uint2( svPos.xy ) / BEAM_TILE_SIZE;
+	BeamTile = tile.y * ( ( screenSize.x + BEAM_TILE_SIZE - 1 ) / BEAM_TILE_SIZE ) + tile.x;
+#endif
+
 	newShadowTex[svPos.xy] = GetShadowVal( vPosition.xyz, InvLightDir, svPos.xy );
 }
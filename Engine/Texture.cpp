@@ -1,10 +1,13 @@
 #include "Texture.h"
 
+#include <ppl.h>
+
 #include "Game.h"
 #include "Logger.h"
 #include "Makros.h"
 #include "RenderBackend.h"
 #include "FileLoader.h"
+#include "BoundedQueue.h"
 
 TextureManager* Texture::s_TextureManager = nullptr;
 
@@ -190,6 +193,10 @@ Texture * Texture::CreateFromFile( const std::wstring& fileName, const std::wstr
 	return s_TextureManager->CreateTextureFromFile( fileName, uniqueName );
 }
 
+std::vector<Texture*> Texture::CreateFromFiles( const std::vector<std::wstring>& fileNames ) {
+	return s_TextureManager->CreateTexturesFromFiles( fileNames );
+}
+
 Texture * Texture::Get( const std::wstring & name ) {
 	return s_TextureManager->GetTexture( name );
 }
@@ -265,6 +272,39 @@ Texture * TextureManager::CreateTexture( const std::wstring& uniqueName, Texture
 }
 
 Texture* TextureManager::CreateTextureFromFile( const std::wstring& fileName, const std::wstring& uniqueName ) {
+	return CreateTextureFromFile( fileName, uniqueName, nullptr );
+}
+
+std::vector<Texture*> TextureManager::CreateTexturesFromFiles( const std::vector<std::wstring>& fileNames ) {
+	// files that are already loaded aren't read again
+	std::vector<uint8_t> needsRead( fileNames.size() );
+	for( size_t i = 0; i < fileNames.size(); i++ )
+		needsRead[i] = m_TextureNameToID.count( fileNames[i] ) == 0;
+
+	// creating the textures needs the immediate context for the mip maps, so only the reads run on the worker
+	std::vector<std::vector<uint8_t>> fileData( fileNames.size() );
+	BoundedQueue<size_t> readFiles( 4 );
+	concurrency::task_group readTask;
+	readTask.run( [&]() {
+		for( size_t i = 0; i < fileNames.size(); i++ ) {
+			if( needsRead[i] )
+				Game::GetFileLoader().ReadTexFile( m_TexturePath + fileNames[i], fileData[i] );
+			readFiles.Push( i );
+		}
+		readFiles.Close();
+	} );
+
+	std::vector<Texture*> textures;
+	size_t i;
+	while( readFiles.Pop( i ) ) {
+		textures.push_back( CreateTextureFromFile( fileNames[i], L"", needsRead[i] ? &fileData[i] : nullptr ) );
+		fileData[i] = std::vector<uint8_t>();
+	}
+	readTask.wait();
+	return textures;
+}
+
+Texture* TextureManager::CreateTextureFromFile( const std::wstring& fileName, const std::wstring& uniqueName, const std::vector<uint8_t>* fileData ) {
 	if( m_TextureNameToID.count( fileName ) > 0 ) {
 		Texture* existingTex = m_Textures[m_TextureNameToID[fileName]];
 		if( uniqueName == existingTex->GetName() ) {
@@ -293,7 +333,11 @@ Texture* TextureManager::CreateTextureFromFile( const std::wstring& fileName, co
 	TextureResource* tex = nullptr;
 	ShaderResourceView* srv = nullptr;
 
-	bool success = Game::GetFileLoader().LoadTexFile( m_TexturePath + fileName, tex, srv );
+	bool success;
+	if( fileData )
+		success = Game::GetFileLoader().LoadTexFile( m_TexturePath + fileName, *fileData, tex, srv );
+	else
+		success = Game::GetFileLoader().LoadTexFile( m_TexturePath + fileName, tex, srv );
 
 	if( !success ) {
 		Game::GetLogger().Log( L"Texture", L"Loading of Texture with file name \"" + fileName + L"\" and unique name \"" + uniqueName + L"\" failed. Returning dummy texture" );
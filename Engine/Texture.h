@@ -91,6 +91,7 @@ public:
 	static Texture* Create( const std::wstring& uniqueName, TextureResource* texRes, TextureType texType, ShaderResourceView* srv = nullptr,
 							RenderTargetView* rtv = nullptr, DepthStencilView* dsv = nullptr );
 	static Texture* CreateFromFile( const std::wstring& fileName, const std::wstring& uniqueName = L"" );
+	static std::vector<Texture*> CreateFromFiles( const std::vector<std::wstring>& fileNames );
 	static Texture* Get( const std::wstring& name );
 	static Texture* Get( size_t id );
 
@@ -127,6 +128,8 @@ public:
 	Texture* CreateTexture( const std::wstring& uniqueName, TextureResource* texRes, TextureType texType, ShaderResourceView* srv = nullptr, 
 							RenderTargetView* rtv = nullptr, DepthStencilView* dsv = nullptr );
 	Texture* CreateTextureFromFile( const std::wstring& fileName, const std::wstring& uniqueName = L"" );
+	// a worker reads the next files while the textures of the previous ones get created
+	std::vector<Texture*> CreateTexturesFromFiles( const std::vector<std::wstring>& fileNames );
 
 	Texture* GetDummyTexture();
 	void CreateDummyTexture();
@@ -138,6 +141,8 @@ private:
 	TextureManager();
 	virtual ~TextureManager();
 
+	Texture* CreateTextureFromFile( const std::wstring& fileName, const std::wstring& uniqueName, const std::vector<uint8_t>* fileData );
+
 
 	std::vector<Texture*> m_Textures;
 	std::unordered_map<std::wstring, size_t> m_TextureNameToID;
@@ -128,7 +128,8 @@ void Transform::SetPosition( const float3 & pos, TSpace tSpace ) {
 			m_WorldPosition = pos;
 		m_IsLocalPosValid = true;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -149,7 +150,8 @@ void Transform::SetRotation( const Quaternion & rotation, TSpace tSpace ) {
 			m_WorldRotation = rotation;
 		m_IsLocalRotValid = true;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -171,7 +173,8 @@ void Transform::SetRotation( const float3 & eulerAngles, TSpace tSpace ) {
 			m_WorldRotation = rotation;
 		m_IsLocalRotValid = true;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -192,7 +195,8 @@ void Transform::SetScale( const float3 & scale, TSpace tSpace ) {
 			m_WorldScale = scale;
 		m_IsLocalScaleValid = true;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -212,7 +216,8 @@ void Transform::Translate( const float3 & vec, TSpace tSpace ) {
 		else
 			m_WorldPosition = m_LocalPosition;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -231,8 +236,8 @@ void Transform::Rotate( const Quaternion & quat, TSpace tSpace ) {
 		else
 			m_WorldRotation = m_LocalRotation;
 	}
-	if( m_OnInvalidate )
-		m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -252,7 +257,8 @@ void Transform::Scale( const float3 & scale, TSpace tSpace ) {
 		else
 			m_WorldScale = m_LocalScale;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
@@ -272,7 +278,8 @@ void Transform::Scale( float scale, TSpace tSpace ) {
 		else
 			m_WorldScale = m_LocalScale;
 	}
-	m_OnInvalidate();
+	for( auto& onInvalidate : m_OnInvalidate )
+		onInvalidate();
 	m_IsMatrixValid = false;
 }
 
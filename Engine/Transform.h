@@ -82,9 +82,9 @@ public:
 		}
 	}
 
-	// for now used for the camera view matrix invalidation on change
-	void SetOnInvalidateFunction( std::function<void()> function ) {
-		m_OnInvalidate = function;
+	// used for the camera view matrix and the dynamic voxelization invalidation on change, all added functions get called
+	void AddOnInvalidateFunction( std::function<void()> function ) {
+		m_OnInvalidate.push_back( function );
 	}
 private:
 	GameObject& m_Owner;
@@ -110,6 +110,6 @@ private:
 	bool m_IsLocalScaleValid = true;
 	bool m_IsWorldScaleValid = true;
 
-	std::function<void()> m_OnInvalidate;
+	std::vector<std::function<void()>> m_OnInvalidate;
 };
 
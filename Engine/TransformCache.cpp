@@ -0,0 +1,123 @@
+#include "TransformCache.h"
+
+#include <ppl.h>
+#include <cfloat>
+
+#include "Geometry.h"
+#include "Makros.h"
+
+void TransformPositions( const float3a* positions, size_t numPositions, const Matrix& transform, float4a* out ) {
+	using namespace DirectX;
+
+	const size_t chunkSize = 4096;
+	size_t numChunks = ( numPositions + chunkSize - 1 ) / chunkSize;
+	XMMATRIX mat = XMLoadFloat4x4( &transform );
+
+	concurrency::parallel_for( size_t( 0 ), numChunks, [&]( size_t chunk ) {
+		size_t start = chunk * chunkSize;
+		size_t count = Min( chunkSize, numPositions - start );
+		// w is taken as 1, so this matches Mult( transform, { x, y, z, 1 } ) for affine matrices
+		XMVector3TransformStream( &out[start], sizeof( float4a ), &positions[start], sizeof( float3a ), count, mat );
+	} );
+}
+
+void TransformBoundingBox( const float3& boxMin, const float3& boxMax, const Matrix& transform, float3& worldMin, float3& worldMax ) {
+	using namespace DirectX;
+
+	worldMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+	worldMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	if( boxMin.x > boxMax.x || boxMin.y > boxMax.y || boxMin.z > boxMax.z )
+		return;
+
+	float3a corners[8];
+	for( int i = 0; i < 8; i++ )
+		corners[i] = float3a( i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z );
+	float4a worldCorners[8];
+	XMVector3TransformStream( worldCorners, sizeof( float4a ), corners, sizeof( float3a ), 8, XMLoadFloat4x4( &transform ) );
+
+	for( const float4a& pos : worldCorners ) {
+		worldMin = { Min( worldMin.x, pos.x ), Min( worldMin.y, pos.y ), Min( worldMin.z, pos.z ) };
+		worldMax = { Max( worldMax.x, pos.x ), Max( worldMax.y, pos.y ), Max( worldMax.z, pos.z ) };
+	}
+}
+
+TransformCache::TransformCache() {
+}
+
+TransformCache::~TransformCache() {
+}
+
+const std::vector<float4a>& TransformCache::GetWorldPositions( const Geometry& geometry, const Matrix& transform ) {
+	Instance* instance = FindInstance( geometry, transform );
+	if( instance )
+		return instance->Positions;
+
+	const std::vector<float3a>& positions = geometry.GetAlignedPositions();
+
+	m_Instances[&geometry].push_back( Instance() );
+	Instance& newInstance = m_Instances[&geometry].back();
+	newInstance.Transform = transform;
+	newInstance.Positions.resize( positions.size() );
+	TransformPositions( positions.data(), positions.size(), transform, newInstance.Positions.data() );
+
+	return newInstance.Positions;
+}
+
+void TransformCache::Prepare( const std::vector<std::pair<const Geometry*, Matrix>>& elements ) {
+	// create all missing instances first, then transform them in parallel
+	std::vector<std::pair<const Geometry*, Instance*>> missing;
+	for( const auto& element : elements ) {
+		if( FindInstance( *element.first, element.second ) )
+			continue;
+		m_Instances[element.first].push_back( Instance() );
+		Instance& instance = m_Instances[element.first].back();
+		instance.Transform = element.second;
+		instance.Positions.resize( element.first->GetAlignedPositions().size() );
+		missing.push_back( { element.first, &instance } );
+	}
+
+	concurrency::parallel_for( size_t( 0 ), missing.size(), [&]( size_t i ) {
+		const std::vector<float3a>& positions = missing[i].first->GetAlignedPositions();
+		Instance& instance = *missing[i].second;
+		TransformPositions( positions.data(), positions.size(), instance.Transform, instance.Positions.data() );
+	} );
+}
+
+void TransformCache::Remove( const Geometry& geometry, const Matrix& transform ) {
+	auto it = m_Instances.find( &geometry );
+	if( it == m_Instances.end() )
+		return;
+
+	it->second.remove_if( [&]( const Instance& instance ) {
+		return memcmp( &instance.Transform, &transform, sizeof( Matrix ) ) == 0;
+	} );
+	if( it->second.empty() )
+		m_Instances.erase( it );
+}
+
+void TransformCache::Invalidate( const Geometry& geometry ) {
+	m_Instances.erase( &geometry );
+}
+
+void TransformCache::Clear() {
+	m_Instances.clear();
+}
+
+size_t TransformCache::GetNumInstances() const {
+	size_t numInstances = 0;
+	for( const auto& instances : m_Instances )
+		numInstances += instances.second.size();
+	return numInstances;
+}
+
+TransformCache::Instance* TransformCache::FindInstance( const Geometry& geometry, const Matrix& transform ) {
+	auto it = m_Instances.find( &geometry );
+	if( it == m_Instances.end() )
+		return nullptr;
+
+	for( Instance& instance : it->second ) {
+		if( memcmp( &instance.Transform, &transform, sizeof( Matrix ) ) == 0 )
+			return &instance;
+	}
+	return nullptr;
+}
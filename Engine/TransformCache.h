@@ -0,0 +1,40 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include "Types.h"
+
+class Geometry;
+
+// transforms positions with an affine matrix, output w is always 1
+void TransformPositions( const float3a* positions, size_t numPositions, const Matrix& transform, float4a* out );
+// world space box around the transformed corners of an object space box, an empty box stays empty
+void TransformBoundingBox( const float3& boxMin, const float3& boxMax, const Matrix& transform, float3& worldMin, float3& worldMax );
+
+// keeps world space positions per geometry instance so the voxelizer and embree don't transform them separately
+class TransformCache {
+public:
+	TransformCache();
+	~TransformCache();
+
+	const std::vector<float4a>& GetWorldPositions( const Geometry& geometry, const Matrix& transform );
+	void Prepare( const std::vector<std::pair<const Geometry*, Matrix>>& elements );
+
+	void Remove( const Geometry& geometry, const Matrix& transform );
+	void Invalidate( const Geometry& geometry );
+	void Clear();
+
+	size_t GetNumInstances() const;
+private:
+	struct Instance {
+		Matrix Transform;
+		std::vector<float4a> Positions;
+	};
+
+	Instance* FindInstance( const Geometry& geometry, const Matrix& transform );
+
+	// list keeps the returned position vectors valid when new instances are added
+	std::unordered_map<const Geometry*, std::list<Instance>> m_Instances;
+};
@@ -0,0 +1,133 @@
+#include "TraversalVectors.h"
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+
+#include "Platform.h"
+#include "Makros.h"
+#include "Math.h"
+#include "Game.h"
+#include "Logger.h"
+
+namespace {
+const uint32_t TraversalVectorsVersion = 1;
+
+// the distributions of the standard library differ between compilers, mt19937 itself doesn't
+float Random( std::mt19937& random ) {
+	return ( random() >> 8 ) * ( 1.f / 16777216.f );
+}
+
+uint32_t FloatBits( float value ) {
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	return bits;
+}
+
+float BitsFloat( uint32_t bits ) {
+	float value;
+	memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+bool ReadFloat( std::istream& stream, float& value ) {
+	uint32_t bits;
+	if( !( stream >> std::hex >> bits >> std::dec ) )
+		return false;
+	value = BitsFloat( bits );
+	return true;
+}
+
+// "Key value" line, the value is the rest of the line. files written on windows keep the \r on other platforms
+bool ReadLine( std::istream& stream, const std::string& key, std::string& value ) {
+	std::string line;
+	if( !std::getline( stream, line ) || line.compare( 0, key.size() + 1, key + " " ) != 0 )
+		return false;
+	if( !line.empty() && line.back() == '\r' )
+		line.pop_back();
+	value = line.substr( key.size() + 1 );
+	return true;
+}
+}
+
+void CreateTraversalRays( uint32_t numRays, uint32_t seed, std::vector<TraversalVector>& vectors ) {
+	std::mt19937 random( seed );
+	vectors.resize( numRays );
+	for( TraversalVector& vector : vectors ) {
+		vector.Pos = float3( Random( random ), Random( random ), Random( random ) );
+		// uniform on the sphere by rejection
+		float length;
+		do {
+			vector.Dir = float3( 2.f * Random( random ) - 1.f, 2.f * Random( random ) - 1.f, 2.f * Random( random ) - 1.f );
+			length = sqrt( vector.Dir.x * vector.Dir.x + vector.Dir.y * vector.Dir.y + vector.Dir.z * vector.Dir.z );
+		} while( length > 1.f || length < 0.01f );
+		vector.Dir = vector.Dir / length;
+		vector.Hit = false;
+		vector.Steps = 0;
+	}
+}
+
+bool StoreTraversalVectors( const std::wstring & fileName, const TraversalVectors & vectors ) {
+	std::ofstream file( FilePath( fileName ), std::ios::out | std::ios::trunc );
+	if( !file.is_open() ) {
+		Game::GetLogger().Log( L"TraversalVectors", L"Creating \"" + fileName + L"\" failed." );
+		return false;
+	}
+	file << "TraversalVectors " << TraversalVectorsVersion << "\n";
+	file << "Tree " << ws2s( vectors.TreeFile ) << "\n";
+	file << "Source " << ws2s( vectors.Source ) << "\n";
+	file << "ShortStack " << ( vectors.ShortStack ? 1 : 0 ) << "\n";
+	file << "EmptyDistance " << ( vectors.EmptyDistance ? 1 : 0 ) << "\n";
+	file << "Rays " << vectors.Vectors.size() << "\n";
+	// pos.xyz dir.xyz as float bits, hit, steps
+	file << std::hex << std::setfill( '0' );
+	for( const TraversalVector& vector : vectors.Vectors ) {
+		const float values[6] = { vector.Pos.x, vector.Pos.y, vector.Pos.z, vector.Dir.x, vector.Dir.y, vector.Dir.z };
+		for( float value : values )
+			file << std::setw( 8 ) << FloatBits( value ) << " ";
+		file << std::dec << ( vector.Hit ? 1 : 0 ) << " " << vector.Steps << std::hex << "\n";
+	}
+	file.close();
+
+	if( file.bad() ) {
+		Game::GetLogger().Log( L"TraversalVectors", L"Storing \"" + fileName + L"\" failed." );
+		return false;
+	}
+	return true;
+}
+
+bool LoadTraversalVectors( const std::wstring & fileName, TraversalVectors & vectors ) {
+	std::ifstream file( FilePath( fileName ) );
+	if( !file.is_open() ) {
+		Game::GetLogger().Log( L"TraversalVectors", L"Opening \"" + fileName + L"\" failed." );
+		return false;
+	}
+
+	std::string version, tree, source, shortStack, emptyDistance, rays;
+	if( !ReadLine( file, "TraversalVectors", version ) || strtoul( version.c_str(), nullptr, 10 ) != TraversalVectorsVersion || !ReadLine( file, "Tree", tree )
+		|| !ReadLine( file, "Source", source ) || !ReadLine( file, "ShortStack", shortStack ) || !ReadLine( file, "EmptyDistance", emptyDistance )
+		|| !ReadLine( file, "Rays", rays ) ) {
+		Game::GetLogger().Log( L"TraversalVectors", L"\"" + fileName + L"\" has no valid header." );
+		return false;
+	}
+	vectors.TreeFile = s2ws( tree );
+	vectors.Source = s2ws( source );
+	vectors.ShortStack = shortStack == "1";
+	vectors.EmptyDistance = emptyDistance == "1";
+
+	size_t numRays = strtoul( rays.c_str(), nullptr, 10 );
+	vectors.Vectors.resize( numRays );
+	for( TraversalVector& vector : vectors.Vectors ) {
+		uint32_t hit;
+		if( !ReadFloat( file, vector.Pos.x ) || !ReadFloat( file, vector.Pos.y ) || !ReadFloat( file, vector.Pos.z ) || !ReadFloat( file, vector.Dir.x )
+			|| !ReadFloat( file, vector.Dir.y ) || !ReadFloat( file, vector.Dir.z ) || !( file >> hit >> vector.Steps ) ) {
+			Game::GetLogger().Log( L"TraversalVectors", L"\"" + fileName + L"\" is truncated." );
+			return false;
+		}
+		vector.Hit = hit != 0;
+	}
+	return true;
+}
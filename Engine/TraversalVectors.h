@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+// grid space ray like vInGridPos of psShadow.hlsl and what TraverseTree of TreeTraverse.hlsli returned for it
+struct TraversalVector {
+	float3 Pos;
+	float3 Dir;
+	bool Hit = false;
+	// iterations of the traversal loop until the hit like OcclusionHit::Steps, the shader doesn't return them for misses
+	uint32_t Steps = 0;
+};
+
+// recorded by the engine on the gpu (TraversalVectorPath in the config), TreeInspector -v checks OcclusionQuery against them
+struct TraversalVectors {
+	// the rays were traced through this tree file
+	std::wstring TreeFile;
+	// what traced them, e.g. the adapter
+	std::wstring Source;
+	// traversal defines of VoxelDefines.hlsli while recording, the cpu traversal has to use the same
+	bool ShortStack = false;
+	bool EmptyDistance = false;
+	std::vector<TraversalVector> Vectors;
+};
+
+// rays with random origins inside of the grid and random directions, the same for a seed with every compiler
+void CreateTraversalRays( uint32_t numRays, uint32_t seed, std::vector<TraversalVector>& vectors );
+// text file, the floats are stored as their bits so they are read back exactly
+bool StoreTraversalVectors( const std::wstring& fileName, const TraversalVectors& vectors );
+bool LoadTraversalVectors( const std::wstring& fileName, TraversalVectors& vectors );
@@ -10,9 +10,13 @@
 #include "Logger.h"
 #include "Time.h"
 #include "Distance.h"
+#include "Approximation.h"
 #include "emd.h"
+#include "Makros.h"
 #include "Math.h"
-#include "Voxelizer.h"
+#include "Morton.h"
+#include "Platform.h"
+#include "TreeNode.h"
 #include "ConfigManager.h"
 #include "json.hpp"
 
@@ -53,131 +57,6 @@ uint32_t PackPosition( uint3 pos ) {
 	return pos.x | ( pos.y << 1 ) | ( pos.z << 2 );
 }
 
-float3 UintToFloat3( uint32_t val ) {
-	float3 out;
-	out.x = ( val & 1023 ) / 1023.f;
-	out.y = ( ( val >> 10 ) & 1023 ) / 1023.f;
-	out.z = ( ( val >> 20 ) & 1023 ) / 1023.f;
-	return out;
-}
-
-uint32_t Float3ToUint( float3 val ) {
-	uint32_t x = static_cast<uint32_t>( Min( val.x, 1.f ) * 1023.f );
-	uint32_t y = static_cast<uint32_t>( Min( val.y, 1.f ) * 1023.f );
-	uint32_t z = static_cast<uint32_t>( Min( val.z, 1.f ) * 1023.f );
-
-	return ( z << 20 ) + ( y << 10 ) + x;
-}
-
-uint32_t GetAnisotropicValue( uint2 uiBrick ) {
-	float3 value = float3( 0.f, 0.f, 0.f );
-	// X-Face
-	for( uint32_t i : { 0, 2, 4, 6, 16, 20, 18, 22 } ) {
-		if( uiBrick.x & ( 0x303 << i ) )
-			value.x += 1.f / 16.f;
-		if( uiBrick.y & ( 0x303 << i ) )
-			value.x += 1.f / 16.f;
-	}
-	//Y-Face
-	for( uint32_t j : { 0, 1, 4, 5, 8, 9, 12, 13 } ) {
-		if( uiBrick.x & ( 0x50005 << j ) )
-			value.y += 1.f / 16.f;
-		if( uiBrick.y & ( 0x50005 << j ) )
-			value.y += 1.f / 16.f;
-	}
-	// Z-Face
-	for( uint32_t k : { 0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27 } ) {
-		if( uiBrick.x & ( 0x11 << k ) || uiBrick.y & ( 0x11 << k ) )
-			value.z += 1.f / 16.f;
-	}
-
-	return Float3ToUint( value );
-}
-
-
-
-uint32_t GetInnerApproxVal( const Node& node, uint32_t *approx, const uint32_t *pointer ) {
-	float3 approxVal = { 0.f, 0.f, 0.f };
-	for( uint32_t z = 0; z < 4; z++ ) {
-		for( uint32_t y = 0; y < 4; y++ ) {
-			float sum = 0.f;
-			for( uint32_t x = 0; x < 4; x++ ) {
-				uint32_t mortonPos = MortonEncode( { x,y,z } );
-
-				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
-				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
-				if( data & ( 1 << dataPos ) ) {
-					// offset determined via counting of previous set bits
-					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
-					uint32_t offset = __popcnt( data & compVal );
-					if( mortonPos > 31 )
-						offset += __popcnt( node.Data.x );
-
-					uint32_t ptr = pointer[node.Pointer + offset];
-					if( ptr == -1 )
-						sum = 1.f;
-					else
-						sum = Max( UintToFloat3( approx[ptr] ).x, sum );
-				}
-			}
-			approxVal.x += 1.f / 16.f * Min( sum, 1.f );
-		}
-	}
-
-	for( uint32_t z = 0; z < 4; z++ ) {
-		for( uint32_t x = 0; x < 4; x++ ) {
-			float sum = 0.f;
-			for( uint32_t y = 0; y < 4; y++ ) {
-				uint32_t mortonPos = MortonEncode( { x,y,z } );
-
-				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
-				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
-				if( data & ( 1 << dataPos ) ) {
-					// offset determined via counting of previous set bits
-					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
-					uint32_t offset = __popcnt( data & compVal );
-					if( mortonPos > 31 )
-						offset += __popcnt( node.Data.x );
-
-					uint32_t ptr = pointer[node.Pointer + offset];
-					if( ptr == -1 )
-						sum = 1.f;
-					else
-						sum = Max( UintToFloat3( approx[ptr] ).y, sum );
-				}
-			}
-			approxVal.y += 1.f / 16.f * Min( sum, 1.f );
-		}
-	}
-
-	for( uint32_t y = 0; y < 4; y++ ) {
-		for( uint32_t x = 0; x < 4; x++ ) {
-			float sum = 0.f;
-			for( uint32_t z = 0; z < 4; z++ ) {
-				uint32_t mortonPos = MortonEncode( { x,y,z } );
-
-				uint32_t data = mortonPos < 32 ? node.Data.x : node.Data.y;
-				uint32_t dataPos = mortonPos < 32 ? mortonPos : mortonPos - 32;
-				if( data & ( 1 << dataPos ) ) {
-					// offset determined via counting of previous set bits
-					uint32_t compVal = 0x7fffffff >> ( 31 - dataPos );
-					uint32_t offset = __popcnt( data & compVal );
-					if( mortonPos > 31 )
-						offset += __popcnt( node.Data.x );
-
-					uint32_t ptr = pointer[node.Pointer + offset];
-					if( ptr == -1 )
-						sum = 1.f;
-					else
-						sum = Max( UintToFloat3( approx[ptr] ).z, sum );
-				}
-			}
-			approxVal.z += 1.f / 16.f * Min( sum, 1.f );
-		}
-	}
-	return Float3ToUint( approxVal );
-}
-
 void SortAndOptimize( Node* bricks, uint32_t& numBricks ) {
 	// sort the voxel bricks by position
 	std::sort( &bricks[0], &bricks[numBricks], []( Node a, Node b )->bool {
@@ -732,9 +611,9 @@ void BuildTree( Node* nodes, uint32_t* pointers, uint32_t &numBricks, uint32_t m
 	std::sort( bricks.begin(), bricks.end(), sortFunc );
 
 	std::array<uint32_t, 64> allBricksHistogramm;
-	allBricksHistogramm.assign( 0 );
+	allBricksHistogramm.fill( 0 );
 	std::array<uint32_t, 64> individBricksHistogramm;
-	individBricksHistogramm.assign( 0 );
+	individBricksHistogramm.fill( 0 );
 
 	uint2 currentData = bricks[0].Data;
 	uint32_t numIndividualLeaves = 1;
@@ -887,9 +766,9 @@ void BuildTree( Node* nodes, uint32_t* pointers, uint32_t &numBricks, uint32_t m
 	};
 
 	struct SortElement {
-		SortElement( const Node& node, uint32_t pos ) : Node( node ), OldPos( pos ) {
+		SortElement( const ::Node& node, uint32_t pos ) : Node( node ), OldPos( pos ) {
 		}
-		Node Node;
+		::Node Node;
 		uint32_t OldPos;
 	};
 
@@ -1183,36 +1062,85 @@ void MergeTrees( Node* nodes1, uint32_t* pointers1, Node* nodes2, uint32_t* poin
 	}
 }
 
-#ifdef ANISOTROPIC
-void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t* approx ) {
+void AddDebugData( DebugData& target, const DebugData& source, uint32_t levelOffset ) {
+	for( size_t i = 0; i < source.TotalNodes.size(); i++ ) {
+		target.TotalNodes[i + levelOffset] += source.TotalNodes[i];
+		target.IndvNodes[i + levelOffset] += source.IndvNodes[i];
+	}
+	for( size_t i = 0; i < source.NumPointers.size(); i++ )
+		target.NumPointers[i + levelOffset] += source.NumPointers[i];
+
+	target.CompressedLeaves += source.CompressedLeaves;
+	target.SortingTime += source.SortingTime;
+	target.TreeBuildTime += source.TreeBuildTime;
+	target.ClusteringTime += source.ClusteringTime;
+	target.LeaveAddingTime += source.LeaveAddingTime;
+	target.DoubleNodeRemovelTime += source.DoubleNodeRemovelTime;
+}
+
+// puts the trees of the parts below a new root node, the index of a part is its position in the root
+void StitchTreeParts( const std::vector<PartTree>& treeParts, Node* nodes, uint32_t* pointers, uint32_t& nodeSize, uint32_t& pointerSize ) {
+	Node rootNode;
+	rootNode.Data.x = 0;
+	rootNode.Data.y = 0;
+	rootNode.Pointer = 1;
 
-	for( uint32_t i = numNodes - 1; i != -1; i-- ) {
-		if( nodes[i].Pointer == 0 ) {
-			approx[i] = GetAnisotropicValue( nodes[i].Data );
+	uint32_t pointerIdx = 1;
+	uint32_t nodeIdx = 1;
+
+	for( size_t i = 0; i < treeParts.size(); ++i ) {
+		if( !treeParts[i].Nodes.empty() ) {
+			SetBit( rootNode.Data, static_cast<uint32_t>( i ) );
+			++pointerIdx;
 		}
-		else {
-			approx[i] = GetInnerApproxVal( nodes[i], approx, pointers );
+	}
+
+	nodes[0] = rootNode;
+	pointers[0] = 0;
+	uint32_t rootIdx = 1;
+	for( const PartTree& part : treeParts ) {
+		if( part.Nodes.empty() )
+			continue;
+
+		pointers[rootIdx++] = nodeIdx;
+		uint32_t oldNodeIdx = nodeIdx;
+		for( const Node& node : part.Nodes ) {
+			nodes[nodeIdx] = node;
+			// leaves keep their empty pointer, so the approximation can still find them
+			if( node.Pointer != 0 )
+				nodes[nodeIdx].Pointer += pointerIdx;
+			++nodeIdx;
+		}
+		for( uint32_t ptr : part.Pointers ) {
+			pointers[pointerIdx++] = ptr == -1 ? -1 : ptr + oldNodeIdx;
 		}
 	}
+
+	nodeSize = nodeIdx;
+	pointerSize = pointerIdx;
 }
-#else
-void ComputeApproximation( const Node* nodes, uint32_t numNodes, const uint32_t* pointers, float* approx ) {
-	for( uint32_t i = numNodes - 1; i != -1; i-- ) {
-		if( nodes[i].Pointer == 0 ) {
-			approx[i] = Min( __popcnt( nodes[i].Data.x ) + __popcnt( nodes[i].Data.y ), 64u ) / 64.f;
-		}
-		else {
-			uint32_t numChildren = __popcnt( nodes[i].Data.x ) + __popcnt( nodes[i].Data.y );
-			float val = 0.f;
-			uint32_t ptr = nodes[i].Pointer;
-			for( uint32_t j = 0; j < numChildren; j++ ) {
-				if( pointers[ptr + j] == -1 )
-					val += 1.f;
-				else
-					val += approx[pointers[ptr + j]];
-			}
-			approx[i] = val / 64.f;
+
+// replaces the children of a subdivided part by a single tree
+void MergePartTree( PartTree& part ) {
+	if( part.Children.empty() )
+		return;
+
+	size_t nodeSize = 1;
+	size_t pointerSize = 1;
+	for( PartTree& child : part.Children ) {
+		MergePartTree( child );
+		if( !child.Nodes.empty() ) {
+			nodeSize += child.Nodes.size();
+			pointerSize += child.Pointers.size() + 1;
 		}
 	}
+
+	if( nodeSize > 1 ) {
+		part.Nodes.resize( nodeSize );
+		part.Pointers.resize( pointerSize );
+
+		uint32_t numNodes, numPointers;
+		StitchTreeParts( part.Children, part.Nodes.data(), part.Pointers.data(), numNodes, numPointers );
+	}
+	part.Children.clear();
 }
-#endif // ANISOTROPIC
@@ -0,0 +1,622 @@
+#include "TreeCompression.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+
+#include "Makros.h"
+#include "Platform.h"
+#include "TreeNode.h"
+
+namespace {
+const uint32_t CompressedTreeMagic = 'V' | ( 'X' << 8 ) | ( 'T' << 16 ) | ( 'C' << 24 );
+const uint32_t CompressedTreeVersion = 3;
+
+const uint32_t RansScaleBits = 12;
+const uint32_t RansScale = 1 << RansScaleBits;
+// 64 bit states are renormalized with 32 bit words, so a state takes at most one word per symbol
+const uint64_t RansLowerBound = 1ull << 31;
+const size_t RansChunkSize = 1 << 20;
+const uint32_t RansStates = 8;
+const uint32_t TreeBlockSize = 1 << 16;
+// one index symbol is left for the masks that are stored byte by byte
+const uint32_t MaxMaskTableSize = 255;
+
+enum TreeStream {
+	NodePointerStream = 0,
+	MaskIndexStream = 1,
+	MaskByteStream = 2,
+	PointerStream = MaskByteStream + 8,
+	NumTreeStreams
+};
+
+struct RansSymbol {
+	uint32_t Start;
+	uint32_t Freq;
+};
+
+// everything the decoder needs for one slot in a single lookup: frequency in the lowest RansScaleBits bits, the bias above and the symbol in the top byte.
+// only a stream of a single symbol has a frequency of RansScale and that one isn't decoded
+typedef uint32_t RansSlot;
+
+template<typename T>
+void Append( std::vector<uint8_t>& out, const T& value ) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>( &value );
+	out.insert( out.end(), bytes, bytes + sizeof( T ) );
+}
+
+template<typename T>
+bool Read( const uint8_t*& ptr, const uint8_t* end, T& value ) {
+	if( static_cast<size_t>( end - ptr ) < sizeof( T ) )
+		return false;
+	memcpy( &value, ptr, sizeof( T ) );
+	ptr += sizeof( T );
+	return true;
+}
+
+void WriteVarint( std::vector<uint8_t>& out, uint64_t value ) {
+	while( value >= 0x80 ) {
+		out.push_back( static_cast<uint8_t>( value | 0x80 ) );
+		value >>= 7;
+	}
+	out.push_back( static_cast<uint8_t>( value ) );
+}
+
+bool ReadVarint( const uint8_t*& ptr, const uint8_t* end, uint64_t& value ) {
+	// most values are a single byte
+	if( ptr < end && *ptr < 0x80 ) {
+		value = *ptr++;
+		return true;
+	}
+	value = 0;
+	for( uint32_t shift = 0; shift < 64; shift += 7 ) {
+		if( ptr >= end )
+			return false;
+		uint8_t byte = *ptr++;
+		value |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+		if( !( byte & 0x80 ) )
+			return true;
+	}
+	return false;
+}
+
+uint32_t ZigZag( uint32_t delta ) {
+	int32_t value = static_cast<int32_t>( delta );
+	return ( delta << 1 ) ^ static_cast<uint32_t>( value >> 31 );
+}
+
+uint32_t UnZigZag( uint32_t value ) {
+	return ( value >> 1 ) ^ ( 0u - ( value & 1 ) );
+}
+
+// scales the histogram to RansScale, every used symbol keeps at least a frequency of 1
+void NormalizeFrequencies( const uint64_t* counts, uint64_t total, uint32_t* freqs ) {
+	uint32_t sum = 0;
+	uint32_t maxSymbol = 0;
+	for( uint32_t s = 0; s < 256; s++ ) {
+		freqs[s] = 0;
+		if( counts[s] == 0 )
+			continue;
+		freqs[s] = Max( 1u, static_cast<uint32_t>( counts[s] * RansScale / total ) );
+		sum += freqs[s];
+		if( counts[s] > counts[maxSymbol] )
+			maxSymbol = s;
+	}
+
+	if( sum < RansScale )
+		freqs[maxSymbol] += RansScale - sum;
+	// rounding up rare symbols can exceed the scale, take it from the most frequent ones
+	while( sum > RansScale ) {
+		uint32_t largest = 0;
+		for( uint32_t s = 1; s < 256; s++ ) {
+			if( freqs[s] > freqs[largest] )
+				largest = s;
+		}
+		--freqs[largest];
+		--sum;
+	}
+}
+
+inline void EncodeSymbol( uint64_t& x, uint8_t*& ptr, const RansSymbol& symbol ) {
+	uint64_t xMax = ( ( RansLowerBound >> RansScaleBits ) << 32 ) * symbol.Freq;
+	if( x >= xMax ) {
+		ptr -= 4;
+		uint32_t word = static_cast<uint32_t>( x );
+		memcpy( ptr, &word, sizeof( uint32_t ) );
+		x >>= 32;
+	}
+	x = ( ( x / symbol.Freq ) << RansScaleBits ) + ( x % symbol.Freq ) + symbol.Start;
+}
+
+inline void FlushState( uint64_t x, uint8_t*& ptr ) {
+	ptr -= 8;
+	memcpy( ptr, &x, sizeof( uint64_t ) );
+}
+
+inline uint8_t DecodeSymbol( uint64_t& x, const RansSlot* slots ) {
+	RansSlot slot = slots[x & ( RansScale - 1 )];
+	x = ( slot & ( RansScale - 1 ) ) * ( x >> RansScaleBits ) + ( ( slot >> RansScaleBits ) & ( RansScale - 1 ) );
+	return static_cast<uint8_t>( slot >> 24 );
+}
+
+inline void Renormalize( uint64_t& x, const uint8_t*& ptr ) {
+	if( x < RansLowerBound ) {
+		uint32_t word;
+		memcpy( &word, ptr, sizeof( uint32_t ) );
+		x = ( x << 32 ) | word;
+		ptr += 4;
+	}
+}
+
+inline bool RenormalizeChecked( uint64_t& x, const uint8_t*& ptr, const uint8_t* end ) {
+	if( x < RansLowerBound ) {
+		if( end - ptr < 4 )
+			return false;
+		uint32_t word;
+		memcpy( &word, ptr, sizeof( uint32_t ) );
+		x = ( x << 32 ) | word;
+		ptr += 4;
+	}
+	return true;
+}
+
+// eight interleaved states hide the latency of the table lookup and the state update, symbol i uses state i % 8
+void EncodeChunk( const uint8_t* data, size_t size, const RansSymbol* symbols, std::vector<uint8_t>& out ) {
+	// a symbol never takes more than RansScaleBits bits
+	std::vector<uint8_t> buffer( size * 2 + 8 * RansStates + 32 );
+	uint8_t* end = buffer.data() + buffer.size();
+	uint8_t* ptr = end;
+
+	uint64_t states[RansStates];
+	for( uint64_t& x : states )
+		x = RansLowerBound;
+	// encoded backwards, so the decoder reads forward
+	for( size_t i = size; i-- > 0; )
+		EncodeSymbol( states[i % RansStates], ptr, symbols[data[i]] );
+	for( uint32_t k = RansStates; k-- > 0; )
+		FlushState( states[k], ptr );
+
+	out.assign( ptr, end );
+}
+
+bool DecodeChunk( const uint8_t* ptr, const uint8_t* end, const RansSlot* slots, uint8_t* out, size_t size ) {
+	uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+	if( !Read( ptr, end, x0 ) || !Read( ptr, end, x1 ) || !Read( ptr, end, x2 ) || !Read( ptr, end, x3 )
+		|| !Read( ptr, end, x4 ) || !Read( ptr, end, x5 ) || !Read( ptr, end, x6 ) || !Read( ptr, end, x7 ) )
+		return false;
+
+	size_t i = 0;
+	// bounds are only checked close to the end of the chunk, the states are spelled out so they stay in registers
+	for( ; i + RansStates <= size && end - ptr >= 4 * RansStates; i += RansStates ) {
+		uint64_t symbols = static_cast<uint64_t>( DecodeSymbol( x0, slots ) )
+			| static_cast<uint64_t>( DecodeSymbol( x1, slots ) ) << 8
+			| static_cast<uint64_t>( DecodeSymbol( x2, slots ) ) << 16
+			| static_cast<uint64_t>( DecodeSymbol( x3, slots ) ) << 24
+			| static_cast<uint64_t>( DecodeSymbol( x4, slots ) ) << 32
+			| static_cast<uint64_t>( DecodeSymbol( x5, slots ) ) << 40
+			| static_cast<uint64_t>( DecodeSymbol( x6, slots ) ) << 48
+			| static_cast<uint64_t>( DecodeSymbol( x7, slots ) ) << 56;
+		memcpy( out + i, &symbols, sizeof( uint64_t ) );
+		Renormalize( x0, ptr );
+		Renormalize( x1, ptr );
+		Renormalize( x2, ptr );
+		Renormalize( x3, ptr );
+		Renormalize( x4, ptr );
+		Renormalize( x5, ptr );
+		Renormalize( x6, ptr );
+		Renormalize( x7, ptr );
+	}
+	// the states rotate, so x0 always belongs to symbol i
+	for( ; i < size; i++ ) {
+		out[i] = DecodeSymbol( x0, slots );
+		if( !RenormalizeChecked( x0, ptr, end ) )
+			return false;
+		uint64_t x = x0;
+		x0 = x1;
+		x1 = x2;
+		x2 = x3;
+		x3 = x4;
+		x4 = x5;
+		x5 = x6;
+		x6 = x7;
+		x7 = x;
+	}
+	return true;
+}
+
+// the MaxMaskTableSize most frequent masks, ties are broken by the mask so the output doesn't depend on the hash order
+std::vector<uint64_t> FindFrequentMasks( const Node* nodes, uint32_t numNodes ) {
+	std::unordered_map<uint64_t, uint32_t> counts;
+	for( uint32_t i = 0; i < numNodes; i++ )
+		counts[static_cast<uint64_t>( nodes[i].Data.x ) | static_cast<uint64_t>( nodes[i].Data.y ) << 32]++;
+
+	std::vector<std::pair<uint32_t, uint64_t>> sorted;
+	sorted.reserve( counts.size() );
+	for( const auto& count : counts )
+		sorted.push_back( { count.second, count.first } );
+	size_t tableSize = Min( sorted.size(), static_cast<size_t>( MaxMaskTableSize ) );
+	std::partial_sort( sorted.begin(), sorted.begin() + tableSize, sorted.end(), []( const std::pair<uint32_t, uint64_t>& a, const std::pair<uint32_t, uint64_t>& b ) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	} );
+
+	std::vector<uint64_t> table( tableSize );
+	for( size_t i = 0; i < tableSize; i++ )
+		table[i] = sorted[i].second;
+	return table;
+}
+
+// rebuilds the nodes of one block in a single pass over its pointer codes and mask indices,
+// escapeIdx holds the index of its first escaped mask in the byte streams and is advanced to the end of the block
+bool DecodeNodeBlock( const uint8_t* code, const uint8_t* codeEnd, const uint8_t* maskIndices, const std::vector<uint64_t>& maskTable, const uint8_t* const* maskBytes, size_t numEscapes,
+					  size_t& escapeIdx, uint32_t numPointers, Node* nodes, uint32_t numNodes ) {
+	uint32_t tableSize = static_cast<uint32_t>( maskTable.size() );
+	uint32_t nextPointer = 0;
+	for( uint32_t i = 0; i < numNodes; i++ ) {
+		Node& node = nodes[i];
+		uint64_t value;
+		if( !ReadVarint( code, codeEnd, value ) )
+			return false;
+
+		uint64_t mask;
+		if( maskIndices[i] < tableSize ) {
+			mask = maskTable[maskIndices[i]];
+		}
+		else {
+			if( maskIndices[i] != tableSize || escapeIdx >= numEscapes )
+				return false;
+			mask = 0;
+			for( uint32_t b = 0; b < 8; b++ )
+				mask |= static_cast<uint64_t>( maskBytes[b][escapeIdx] ) << ( 8 * b );
+			++escapeIdx;
+		}
+		node.Data.x = static_cast<uint32_t>( mask );
+		node.Data.y = static_cast<uint32_t>( mask >> 32 );
+
+		if( value != 0 ) {
+			node.Pointer = nextPointer + UnZigZag( static_cast<uint32_t>( value - 1 ) );
+			nextPointer = node.Pointer + __popcnt( node.Data.x ) + __popcnt( node.Data.y );
+			// the entropy coder can't detect corruption, so at least keep the traversal inside the buffers
+			if( node.Pointer >= numPointers || nextPointer > numPointers )
+				return false;
+		}
+		else {
+			node.Pointer = 0;
+		}
+	}
+	// a block has to end exactly where the next one starts
+	return code == codeEnd;
+}
+
+bool DecodePointerBlock( const uint8_t* code, const uint8_t* codeEnd, uint32_t numNodes, uint32_t* pointers, uint32_t numPointers ) {
+	uint32_t previous = 0;
+	for( uint32_t i = 0; i < numPointers; i++ ) {
+		uint64_t value;
+		if( !ReadVarint( code, codeEnd, value ) )
+			return false;
+		if( value == 0 ) {
+			pointers[i] = -1;
+			continue;
+		}
+		pointers[i] = previous + UnZigZag( static_cast<uint32_t>( value - 1 ) );
+		previous = pointers[i];
+		if( pointers[i] >= numNodes )
+			return false;
+	}
+	return code == codeEnd;
+}
+}
+
+void RansEncode( const uint8_t * data, size_t size, std::vector<uint8_t>& out ) {
+	uint64_t counts[256] = {};
+	for( size_t i = 0; i < size; i++ )
+		counts[data[i]]++;
+
+	uint32_t freqs[256] = {};
+	if( size > 0 )
+		NormalizeFrequencies( counts, size, freqs );
+
+	RansSymbol symbols[256];
+	uint32_t start = 0;
+	for( uint32_t s = 0; s < 256; s++ ) {
+		symbols[s] = { start, freqs[s] };
+		start += freqs[s];
+	}
+
+	uint32_t numChunks = static_cast<uint32_t>( ( size + RansChunkSize - 1 ) / RansChunkSize );
+	std::vector<std::vector<uint8_t>> chunks( numChunks );
+	concurrency::parallel_for( uint32_t( 0 ), numChunks, [&]( uint32_t chunk ) {
+		size_t chunkStart = chunk * RansChunkSize;
+		EncodeChunk( data + chunkStart, Min( RansChunkSize, size - chunkStart ), symbols, chunks[chunk] );
+	} );
+
+	Append( out, static_cast<uint64_t>( size ) );
+	Append( out, numChunks );
+	for( uint32_t s = 0; s < 256; s++ )
+		Append( out, static_cast<uint16_t>( freqs[s] ) );
+	for( const auto& chunk : chunks )
+		Append( out, static_cast<uint32_t>( chunk.size() ) );
+	for( const auto& chunk : chunks )
+		out.insert( out.end(), chunk.begin(), chunk.end() );
+}
+
+size_t RansDecode( const uint8_t * block, size_t blockSize, std::vector<uint8_t>& out ) {
+	const uint8_t* ptr = block;
+	const uint8_t* end = block + blockSize;
+
+	uint64_t size;
+	uint32_t numChunks;
+	if( !Read( ptr, end, size ) || !Read( ptr, end, numChunks ) )
+		return 0;
+	if( numChunks != ( size + RansChunkSize - 1 ) / RansChunkSize )
+		return 0;
+
+	RansSymbol symbols[256];
+	uint32_t start = 0;
+	for( uint32_t s = 0; s < 256; s++ ) {
+		uint16_t freq;
+		if( !Read( ptr, end, freq ) )
+			return 0;
+		symbols[s] = { start, freq };
+		start += freq;
+	}
+	if( size > 0 && start != RansScale )
+		return 0;
+
+	int32_t singleSymbol = -1;
+	std::vector<RansSlot> slots( RansScale );
+	for( uint32_t s = 0; s < 256; s++ ) {
+		if( symbols[s].Freq == RansScale )
+			singleSymbol = static_cast<int32_t>( s );
+		for( uint32_t slot = symbols[s].Start; slot < symbols[s].Start + symbols[s].Freq; slot++ )
+			slots[slot] = symbols[s].Freq | ( ( slot - symbols[s].Start ) << RansScaleBits ) | ( s << 24 );
+	}
+
+	std::vector<const uint8_t*> chunkStarts( numChunks + 1 );
+	std::vector<uint32_t> chunkBytes( numChunks );
+	for( uint32_t& bytes : chunkBytes ) {
+		if( !Read( ptr, end, bytes ) )
+			return 0;
+	}
+	chunkStarts[0] = ptr;
+	for( uint32_t i = 0; i < numChunks; i++ ) {
+		if( static_cast<size_t>( end - chunkStarts[i] ) < chunkBytes[i] )
+			return 0;
+		chunkStarts[i + 1] = chunkStarts[i] + chunkBytes[i];
+	}
+
+	out.resize( static_cast<size_t>( size ) );
+	if( singleSymbol >= 0 ) {
+		std::fill( out.begin(), out.end(), static_cast<uint8_t>( singleSymbol ) );
+		return chunkStarts[numChunks] - block;
+	}
+	std::vector<uint8_t> valid( numChunks, 0 );
+	concurrency::parallel_for( uint32_t( 0 ), numChunks, [&]( uint32_t chunk ) {
+		size_t chunkStart = chunk * RansChunkSize;
+		size_t chunkSize = Min( RansChunkSize, out.size() - chunkStart );
+		valid[chunk] = DecodeChunk( chunkStarts[chunk], chunkStarts[chunk + 1], slots.data(), out.data() + chunkStart, chunkSize );
+	} );
+
+	for( uint8_t chunkValid : valid ) {
+		if( !chunkValid )
+			return 0;
+	}
+	return chunkStarts[numChunks] - block;
+}
+
+bool IsCompressedTree( const uint8_t * data, size_t size ) {
+	if( size < sizeof( CompressedTreeHeader ) )
+		return false;
+	uint32_t magic;
+	memcpy( &magic, data, sizeof( uint32_t ) );
+	return magic == CompressedTreeMagic;
+}
+
+void CompressTree( uint32_t resolution, float3 position, float3 size, const Node * nodes, uint32_t numNodes, const uint32_t * pointers, uint32_t numPointers, std::vector<uint8_t>& out ) {
+	std::vector<std::vector<uint8_t>> streams( NumTreeStreams );
+
+	uint32_t numNodeBlocks = ( numNodes + TreeBlockSize - 1 ) / TreeBlockSize;
+	uint32_t numPointerBlocks = ( numPointers + TreeBlockSize - 1 ) / TreeBlockSize;
+	std::vector<uint64_t> nodeBlockOffsets( numNodeBlocks );
+	std::vector<uint32_t> nodeBlockEscapes( numNodeBlocks );
+	std::vector<uint64_t> pointerBlockOffsets( numPointerBlocks );
+
+	// few masks make up most of the nodes, those are stored as one index into the table, all others byte by byte
+	std::vector<uint64_t> maskTable = FindFrequentMasks( nodes, numNodes );
+	std::unordered_map<uint64_t, uint8_t> maskIndices;
+	for( size_t i = 0; i < maskTable.size(); i++ )
+		maskIndices[maskTable[i]] = static_cast<uint8_t>( i );
+	uint8_t escape = static_cast<uint8_t>( maskTable.size() );
+
+	// inner nodes mostly point directly behind the children of the previous inner node, so only the difference is stored.
+	// 0 marks nodes without pointer
+	uint32_t nextPointer = 0;
+	uint32_t numEscapes = 0;
+	streams[MaskIndexStream].reserve( numNodes );
+	for( uint32_t i = 0; i < numNodes; i++ ) {
+		if( i % TreeBlockSize == 0 ) {
+			nodeBlockOffsets[i / TreeBlockSize] = streams[NodePointerStream].size();
+			nodeBlockEscapes[i / TreeBlockSize] = numEscapes;
+			nextPointer = 0;
+		}
+		const Node& node = nodes[i];
+		if( node.Pointer == 0 ) {
+			WriteVarint( streams[NodePointerStream], 0 );
+		}
+		else {
+			WriteVarint( streams[NodePointerStream], static_cast<uint64_t>( ZigZag( node.Pointer - nextPointer ) ) + 1 );
+			nextPointer = node.Pointer + __popcnt( node.Data.x ) + __popcnt( node.Data.y );
+		}
+
+		uint64_t mask = static_cast<uint64_t>( node.Data.x ) | static_cast<uint64_t>( node.Data.y ) << 32;
+		auto index = maskIndices.find( mask );
+		if( index != maskIndices.end() ) {
+			streams[MaskIndexStream].push_back( index->second );
+			continue;
+		}
+		streams[MaskIndexStream].push_back( escape );
+		for( uint32_t b = 0; b < 8; b++ )
+			streams[MaskByteStream + b].push_back( static_cast<uint8_t>( mask >> ( 8 * b ) ) );
+		++numEscapes;
+	}
+
+	// children are mostly stored in order, -1 (full child) gets 0
+	uint32_t previous = 0;
+	for( uint32_t i = 0; i < numPointers; i++ ) {
+		if( i % TreeBlockSize == 0 ) {
+			pointerBlockOffsets[i / TreeBlockSize] = streams[PointerStream].size();
+			previous = 0;
+		}
+		if( pointers[i] == -1 ) {
+			WriteVarint( streams[PointerStream], 0 );
+			continue;
+		}
+		WriteVarint( streams[PointerStream], static_cast<uint64_t>( ZigZag( pointers[i] - previous ) ) + 1 );
+		previous = pointers[i];
+	}
+
+	std::vector<std::vector<uint8_t>> encoded( NumTreeStreams );
+	concurrency::parallel_for( uint32_t( 0 ), static_cast<uint32_t>( NumTreeStreams ), [&]( uint32_t stream ) {
+		RansEncode( streams[stream].data(), streams[stream].size(), encoded[stream] );
+	} );
+
+	CompressedTreeHeader header;
+	header.Magic = CompressedTreeMagic;
+	header.Version = CompressedTreeVersion;
+	header.Resolution = resolution;
+	header.NumNodes = numNodes;
+	header.NumPointers = numPointers;
+	header.BlockSize = TreeBlockSize;
+	header.Position = position;
+	header.Size = size;
+
+	out.clear();
+	Append( out, header );
+	for( const auto& stream : encoded )
+		Append( out, static_cast<uint64_t>( stream.size() ) );
+	Append( out, static_cast<uint32_t>( maskTable.size() ) );
+	for( uint64_t mask : maskTable )
+		Append( out, mask );
+	for( uint32_t i = 0; i < numNodeBlocks; i++ ) {
+		Append( out, nodeBlockOffsets[i] );
+		Append( out, nodeBlockEscapes[i] );
+	}
+	for( uint64_t offset : pointerBlockOffsets )
+		Append( out, offset );
+	for( const auto& stream : encoded )
+		out.insert( out.end(), stream.begin(), stream.end() );
+}
+
+bool DecompressTree( const uint8_t * data, size_t dataSize, std::vector<Node>& nodes, std::vector<uint32_t>& pointers, uint32_t & resolution, float3 & position, float3 & size ) {
+	const uint8_t* ptr = data;
+	const uint8_t* end = data + dataSize;
+
+	CompressedTreeHeader header;
+	if( !Read( ptr, end, header ) || header.Magic != CompressedTreeMagic || header.Version != CompressedTreeVersion )
+		return false;
+
+	if( header.BlockSize == 0 )
+		return false;
+
+	std::vector<uint64_t> streamBytes( NumTreeStreams );
+	for( uint64_t& bytes : streamBytes ) {
+		if( !Read( ptr, end, bytes ) )
+			return false;
+	}
+
+	uint32_t maskTableSize;
+	if( !Read( ptr, end, maskTableSize ) || maskTableSize > MaxMaskTableSize )
+		return false;
+	std::vector<uint64_t> maskTable( maskTableSize );
+	for( uint64_t& mask : maskTable ) {
+		if( !Read( ptr, end, mask ) )
+			return false;
+	}
+
+	uint32_t numNodeBlocks = static_cast<uint32_t>( ( static_cast<uint64_t>( header.NumNodes ) + header.BlockSize - 1 ) / header.BlockSize );
+	uint32_t numPointerBlocks = static_cast<uint32_t>( ( static_cast<uint64_t>( header.NumPointers ) + header.BlockSize - 1 ) / header.BlockSize );
+	if( static_cast<uint64_t>( end - ptr ) < numNodeBlocks * ( sizeof( uint64_t ) + sizeof( uint32_t ) ) + numPointerBlocks * sizeof( uint64_t ) )
+		return false;
+	std::vector<uint64_t> nodeBlockOffsets( numNodeBlocks + 1 );
+	std::vector<uint32_t> nodeBlockEscapes( numNodeBlocks + 1 );
+	std::vector<uint64_t> pointerBlockOffsets( numPointerBlocks + 1 );
+	for( uint32_t i = 0; i < numNodeBlocks; i++ ) {
+		if( !Read( ptr, end, nodeBlockOffsets[i] ) || !Read( ptr, end, nodeBlockEscapes[i] ) )
+			return false;
+	}
+	for( uint32_t i = 0; i < numPointerBlocks; i++ ) {
+		if( !Read( ptr, end, pointerBlockOffsets[i] ) )
+			return false;
+	}
+
+	std::vector<const uint8_t*> streamStarts( NumTreeStreams + 1 );
+	streamStarts[0] = ptr;
+	for( uint32_t i = 0; i < NumTreeStreams; i++ ) {
+		if( static_cast<uint64_t>( end - streamStarts[i] ) < streamBytes[i] )
+			return false;
+		streamStarts[i + 1] = streamStarts[i] + streamBytes[i];
+	}
+
+	std::vector<std::vector<uint8_t>> streams( NumTreeStreams );
+	std::vector<uint8_t> valid( NumTreeStreams, 0 );
+	concurrency::parallel_for( uint32_t( 0 ), static_cast<uint32_t>( NumTreeStreams ), [&]( uint32_t stream ) {
+		valid[stream] = RansDecode( streamStarts[stream], streamBytes[stream], streams[stream] ) > 0;
+	} );
+	for( uint8_t streamValid : valid ) {
+		if( !streamValid )
+			return false;
+	}
+	for( uint32_t b = 1; b < 8; b++ ) {
+		if( streams[MaskByteStream + b].size() != streams[MaskByteStream].size() )
+			return false;
+	}
+	if( streams[MaskIndexStream].size() != header.NumNodes )
+		return false;
+
+	// the end of a block is the start of the next one, so every block only has to check its own range
+	nodeBlockOffsets[numNodeBlocks] = streams[NodePointerStream].size();
+	nodeBlockEscapes[numNodeBlocks] = static_cast<uint32_t>( streams[MaskByteStream].size() );
+	pointerBlockOffsets[numPointerBlocks] = streams[PointerStream].size();
+	for( uint32_t i = 0; i < numNodeBlocks; i++ ) {
+		uint32_t numBlockNodes = Min( header.BlockSize, header.NumNodes - i * header.BlockSize );
+		if( nodeBlockOffsets[i] > nodeBlockOffsets[i + 1] || nodeBlockEscapes[i] > nodeBlockEscapes[i + 1] || nodeBlockEscapes[i + 1] - nodeBlockEscapes[i] > numBlockNodes )
+			return false;
+	}
+	for( uint32_t i = 0; i < numPointerBlocks; i++ ) {
+		if( pointerBlockOffsets[i] > pointerBlockOffsets[i + 1] )
+			return false;
+	}
+
+	nodes.resize( header.NumNodes );
+	pointers.resize( header.NumPointers );
+	const uint8_t* nodeCode = streams[NodePointerStream].data();
+	const uint8_t* pointerCode = streams[PointerStream].data();
+	const uint8_t* maskBytes[8];
+	for( uint32_t b = 0; b < 8; b++ )
+		maskBytes[b] = streams[MaskByteStream + b].data();
+	size_t numEscapes = streams[MaskByteStream].size();
+	std::vector<uint8_t> validBlocks( numNodeBlocks + numPointerBlocks, 0 );
+	concurrency::parallel_for( uint32_t( 0 ), numNodeBlocks + numPointerBlocks, [&]( uint32_t block ) {
+		if( block < numNodeBlocks ) {
+			uint32_t first = block * header.BlockSize;
+			uint32_t numBlockNodes = Min( header.BlockSize, header.NumNodes - first );
+			size_t escapeIdx = nodeBlockEscapes[block];
+			validBlocks[block] = DecodeNodeBlock( nodeCode + nodeBlockOffsets[block], nodeCode + nodeBlockOffsets[block + 1], streams[MaskIndexStream].data() + first, maskTable, maskBytes,
+												  numEscapes, escapeIdx, header.NumPointers, nodes.data() + first, numBlockNodes ) && escapeIdx == nodeBlockEscapes[block + 1];
+		}
+		else {
+			uint32_t pointerBlock = block - numNodeBlocks;
+			uint32_t first = pointerBlock * header.BlockSize;
+			validBlocks[block] = DecodePointerBlock( pointerCode + pointerBlockOffsets[pointerBlock], pointerCode + pointerBlockOffsets[pointerBlock + 1], header.NumNodes,
+													 pointers.data() + first, Min( header.BlockSize, header.NumPointers - first ) );
+		}
+	} );
+	for( uint8_t blockValid : validBlocks ) {
+		if( !blockValid )
+			return false;
+	}
+
+	resolution = header.Resolution;
+	position = header.Position;
+	size = header.Size;
+	return true;
+}
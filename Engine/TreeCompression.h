@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+#include "Types.h"
+
+struct Node;
+
+// header of a compressed .tr file, followed by the sizes of the streams, the table of frequent masks, the block offsets and the compressed streams of the tree.
+// the nodes and pointers are split into blocks of BlockSize entries whose deltas start at 0, so the blocks can be rebuilt independently
+struct CompressedTreeHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Resolution;
+	uint32_t NumNodes;
+	uint32_t NumPointers;
+	uint32_t BlockSize;
+	float3 Position;
+	float3 Size;
+};
+
+bool IsCompressedTree( const uint8_t* data, size_t size );
+
+// splits the tree into predictable streams (node pointers, indices into a table of the most frequent masks, bytes of the remaining masks, pointer deltas)
+// and entropy codes each of them with rANS
+void CompressTree( uint32_t resolution, float3 position, float3 size, const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t numPointers,
+				   std::vector<uint8_t>& out );
+// streams and chunks inside them are decoded in parallel, afterwards the node and pointer blocks get rebuilt in parallel
+bool DecompressTree( const uint8_t* data, size_t dataSize, std::vector<Node>& nodes, std::vector<uint32_t>& pointers, uint32_t& resolution, float3& position, float3& size );
+
+// self contained order 0 rANS coder for byte streams, the data is split into chunks that can be decoded independently
+void RansEncode( const uint8_t* data, size_t size, std::vector<uint8_t>& out );
+// returns the number of bytes read from block or 0 on corrupted data
+size_t RansDecode( const uint8_t* block, size_t blockSize, std::vector<uint8_t>& out );
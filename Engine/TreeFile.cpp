@@ -0,0 +1,114 @@
+#include "TreeFile.h"
+
+#include <fstream>
+
+#include "Game.h"
+#include "Logger.h"
+#include "Time.h"
+#include "TreeCompression.h"
+#include "TreeNode.h"
+#include "Voxel_generated.h"
+
+namespace {
+bool WriteTreeFile( const std::wstring& fileName, const uint8_t* data, size_t size ) {
+	std::ofstream file( FilePath( fileName ), std::ios::out | std::ios::trunc | std::ios::binary );
+	if( !file.is_open() ) {
+		Game::GetLogger().Log( L"Loader", L"Creating file \"" + fileName + L"\" failed for storing voxel data." );
+		return false;
+	}
+
+	file.write( reinterpret_cast<const char*>( data ), size );
+	file.close();
+
+	if( file.bad() ) {
+		Game::GetLogger().Log( L"Loader", L"Storing voxel data into file \"" + fileName + L"\" failed." );
+		return false;
+	}
+	return true;
+}
+}
+
+bool StoreTreeFile( uint32_t resolution, float3 position, float3 size, const Node * nodes, uint32_t numNodes, const uint32_t * pointers, uint32_t numPointers, const std::wstring & fileName, bool compress ) {
+	if( compress ) {
+		std::vector<uint8_t> data;
+		CompressTree( resolution, position, size, nodes, numNodes, pointers, numPointers, data );
+		if( !WriteTreeFile( fileName, data.data(), data.size() ) )
+			return false;
+
+		size_t rawSize = numNodes * sizeof( Node ) + numPointers * sizeof( uint32_t );
+		Game::GetLogger().Log( L"Loader", L"Compressed tree from " + std::to_wstring( rawSize ) + L" to " + std::to_wstring( data.size() ) + L" bytes, ratio "
+							   + std::to_wstring( static_cast<float>( rawSize ) / data.size() ) );
+		return true;
+	}
+
+	using namespace Loader::Voxel;
+	flatbuffers::FlatBufferBuilder builder;
+
+	const Loader::Voxel::Node* voxNodes = reinterpret_cast<const Loader::Voxel::Node*>( nodes );
+
+	auto nodeVec = builder.CreateVectorOfStructs( voxNodes, numNodes );
+	auto ptrVec = builder.CreateVector( pointers, numPointers );
+
+	Loader::Voxel::float3* fbPos = reinterpret_cast<Loader::Voxel::float3*>( &position );
+	Loader::Voxel::float3* fbSize = reinterpret_cast<Loader::Voxel::float3*>( &size );
+
+	auto obj = CreateVoxelObject( builder, resolution, fbPos, fbSize, nodeVec, ptrVec );
+
+	FinishVoxelObjectBuffer( builder, obj );
+
+	return WriteTreeFile( fileName, builder.GetBufferPointer(), builder.GetSize() );
+}
+
+bool MapTreeFile( const std::wstring & fileName, MappedFile & file, TreeView & tree ) {
+	using namespace Loader::Voxel;
+	if( !file.Open( fileName ) ) {
+		Game::GetLogger().Log( L"Loader", L"Opening voxel file \"" + fileName + L"\" failed." );
+		return false;
+	}
+
+	if( IsCompressedTree( file.GetData(), file.GetSize() ) ) {
+		float start = Game::GetTime().GetRealTime();
+		if( !DecompressTree( file.GetData(), file.GetSize(), tree.DecodedNodes, tree.DecodedPointers, tree.Resolution, tree.Position, tree.Size ) ) {
+			Game::GetLogger().Log( L"Loader", L"Voxel file \"" + fileName + L"\" is corrupted." );
+			file.Close();
+			return false;
+		}
+		float end = Game::GetTime().GetRealTime();
+
+		size_t rawSize = tree.DecodedNodes.size() * sizeof( ::Node ) + tree.DecodedPointers.size() * sizeof( uint32_t );
+		Game::GetLogger().Log( L"Loader", L"Decompressed tree from " + std::to_wstring( file.GetSize() ) + L" to " + std::to_wstring( rawSize ) + L" bytes in "
+							   + std::to_wstring( ( end - start ) * 1000.f ) + L" ms (" + std::to_wstring( rawSize / ( ( end - start ) * 1e6f ) ) + L" MB/s)" );
+
+		tree.Nodes.Data = tree.DecodedNodes.data();
+		tree.Nodes.Size = tree.DecodedNodes.size();
+		tree.Pointers.Data = tree.DecodedPointers.data();
+		tree.Pointers.Size = tree.DecodedPointers.size();
+		return true;
+	}
+
+	// verify once, afterwards the data is only accessed through the view
+	flatbuffers::Verifier verifier( file.GetData(), file.GetSize() );
+	if( !VerifyVoxelObjectBuffer( verifier ) ) {
+		Game::GetLogger().Log( L"Loader", L"Voxel file \"" + fileName + L"\" is corrupted." );
+		file.Close();
+		return false;
+	}
+
+	auto obj = GetVoxelObject( file.GetData() );
+	if( !obj->Nodes() || !obj->Pointers() || !obj->Position() || !obj->Size() ) {
+		Game::GetLogger().Log( L"Loader", L"Voxel file \"" + fileName + L"\" is incomplete." );
+		file.Close();
+		return false;
+	}
+
+	tree.Nodes.Data = reinterpret_cast<const ::Node*>( obj->Nodes()->Data() );
+	tree.Nodes.Size = obj->Nodes()->size();
+	tree.Pointers.Data = obj->Pointers()->data();
+	tree.Pointers.Size = obj->Pointers()->size();
+
+	tree.Resolution = obj->Resolution();
+	tree.Position = *reinterpret_cast<const ::float3*>( obj->Position() );
+	tree.Size = *reinterpret_cast<const ::float3*>( obj->Size() );
+
+	return true;
+}
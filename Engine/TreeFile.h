@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Types.h"
+#include "MappedFile.h"
+
+struct Node;
+
+// tree data pointing directly into a mapped .tr file
+struct TreeView {
+	Span<Node> Nodes;
+	Span<uint32_t> Pointers;
+	uint32_t Resolution = 0;
+	float3 Position = { 0.f, 0.f, 0.f };
+	float3 Size = { 0.f, 0.f, 0.f };
+	// compressed files get decoded into these, the spans point to them then
+	std::vector<Node> DecodedNodes;
+	std::vector<uint32_t> DecodedPointers;
+};
+
+// reading and writing of .tr files without a device, shared by the file loader and the tools
+bool StoreTreeFile( uint32_t resolution, float3 position, float3 size, const Node* nodes, uint32_t numNodes, const uint32_t* pointers, uint32_t numPointers, const std::wstring& fileName, bool compress );
+// maps and verifies the file, the view stays valid as long as file is open. compressed files are decoded into the view
+bool MapTreeFile( const std::wstring& fileName, MappedFile& file, TreeView& tree );
@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+
+#include "Types.h"
+
+struct Node {
+	uint2 Data;
+	uint32_t Pointer;
+};
+
+// tree of one part of the voxelization, parts with too many bricks get split into 64 children
+struct PartTree {
+	std::vector<Node> Nodes;
+	std::vector<uint32_t> Pointers;
+	std::vector<PartTree> Children;
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include "TreeBuild_Impl.h"
+
+// cpu copy of the uploaded tree, that is used to splice in updated subtrees
+struct DynamicTree {
+	std::vector<Node> Nodes;
+	std::vector<uint32_t> Pointers;
+#ifdef ANISOTROPIC
+	std::vector<uint32_t> Approx;
+#else
+	std::vector<float> Approx;
+#endif // ANISOTROPIC
+	uint32_t MaxLevel = 0;
+};
+
+void ClearBit( uint2& brick, uint32_t pos ) {
+	uint32_t bitDelta = pos & 0x1F;
+	if( pos < 32 )
+		brick.x &= ~( 1 << bitDelta );
+	else
+		brick.y &= ~( 1 << bitDelta );
+}
+
+uint32_t ChildOffset( const uint2& data, uint32_t pos ) {
+	if( pos < 32 )
+		return __popcnt( data.x & ( ( 1u << pos ) - 1 ) );
+	return __popcnt( data.x ) + __popcnt( data.y & ( ( 1u << ( pos - 32 ) ) - 1 ) );
+}
+
+// collects the bricks below a node in morton order, the positions are relative to the node
+void CollectBricks( const DynamicTree& tree, uint32_t nodeIdx, uint32_t levels, uint32_t prefix, std::vector<Node>& bricks ) {
+	const Node& node = tree.Nodes[nodeIdx];
+	uint32_t offset = 0;
+	for( uint32_t i = 0; i < 64; i++ ) {
+		if( !HasBitSet( node.Data, i ) )
+			continue;
+		uint32_t child = tree.Pointers[node.Pointer + offset++];
+		uint32_t code = ( prefix << 6 ) | i;
+		if( levels == 1 )
+			bricks.push_back( { tree.Nodes[child].Data, code } );
+		else
+			CollectBricks( tree, child, levels - 1, code, bricks );
+	}
+}
+
+void ComputeNodeApproximation( DynamicTree& tree, uint32_t idx ) {
+	const Node& node = tree.Nodes[idx];
+#ifdef ANISOTROPIC
+	if( node.Pointer == 0 )
+		tree.Approx[idx] = GetAnisotropicValue( node.Data );
+	else
+		tree.Approx[idx] = GetInnerApproxVal( node, tree.Approx.data(), tree.Pointers.data() );
+#else
+	if( node.Pointer == 0 ) {
+		tree.Approx[idx] = Min( __popcnt( node.Data.x ) + __popcnt( node.Data.y ), 64u ) / 64.f;
+	}
+	else {
+		uint32_t numChildren = __popcnt( node.Data.x ) + __popcnt( node.Data.y );
+		float val = 0.f;
+		for( uint32_t j = 0; j < numChildren; j++ ) {
+			uint32_t ptr = tree.Pointers[node.Pointer + j];
+			val += ptr == -1 ? 1.f : tree.Approx[ptr];
+		}
+		tree.Approx[idx] = val / 64.f;
+	}
+#endif // ANISOTROPIC
+}
+
+// returns the node indices from the root down to the cell at the given depth, -1 where the path doesn't exist yet
+std::vector<uint32_t> GetCellPath( const DynamicTree& tree, uint32_t cellCode, uint32_t depth ) {
+	std::vector<uint32_t> path;
+	uint32_t current = 0;
+	path.push_back( current );
+	for( uint32_t k = 0; k < depth; k++ ) {
+		uint32_t slot = ( cellCode >> ( 6 * ( depth - 1 - k ) ) ) & 0x3f;
+		if( current != -1 && HasBitSet( tree.Nodes[current].Data, slot ) )
+			current = tree.Pointers[tree.Nodes[current].Pointer + ChildOffset( tree.Nodes[current].Data, slot )];
+		else
+			current = -1;
+		path.push_back( current );
+	}
+	return path;
+}
+
+// appends the subtree and copies the nodes on the path to it, so nodes shared with other parts of the tree stay untouched.
+// the old nodes stay in the buffers as garbage until the next full rebuild
+void SpliceSubtree( DynamicTree& tree, uint32_t cellCode, uint32_t depth, const Node* nodes, uint32_t nodeSize, const uint32_t* pointers, uint32_t pointerSize,
+#ifdef ANISOTROPIC
+					const uint32_t* approx ) {
+#else
+					const float* approx ) {
+#endif // ANISOTROPIC
+	std::vector<uint32_t> path = GetCellPath( tree, cellCode, depth );
+
+	uint32_t newChild = -1;
+	if( nodeSize > 0 ) {
+		uint32_t nodeBase = static_cast<uint32_t>( tree.Nodes.size() );
+		uint32_t pointerBase = static_cast<uint32_t>( tree.Pointers.size() );
+		for( uint32_t i = 0; i < nodeSize; i++ ) {
+			Node node = nodes[i];
+			// leaves have no pointer
+			if( node.Pointer != 0 )
+				node.Pointer += pointerBase;
+			tree.Nodes.push_back( node );
+			tree.Approx.push_back( approx[i] );
+		}
+		for( uint32_t i = 0; i < pointerSize; i++ ) {
+			tree.Pointers.push_back( pointers[i] == -1 ? -1 : pointers[i] + nodeBase );
+		}
+		newChild = nodeBase;
+	}
+
+	for( uint32_t k = depth; k-- > 0; ) {
+		uint32_t slot = ( cellCode >> ( 6 * ( depth - 1 - k ) ) ) & 0x3f;
+		Node oldNode = { { 0, 0 }, 0 };
+		if( path[k] != -1 )
+			oldNode = tree.Nodes[path[k]];
+
+		Node newNode;
+		newNode.Data = oldNode.Data;
+		if( newChild != -1 )
+			SetBit( newNode.Data, slot );
+		else
+			ClearBit( newNode.Data, slot );
+
+		// empty inner nodes get removed from their parent, the root always stays
+		if( newNode.Data.x == 0 && newNode.Data.y == 0 && k > 0 ) {
+			newChild = -1;
+			continue;
+		}
+
+		newNode.Pointer = static_cast<uint32_t>( tree.Pointers.size() );
+		uint32_t oldOffset = 0;
+		for( uint32_t i = 0; i < 64; i++ ) {
+			bool hadChild = HasBitSet( oldNode.Data, i );
+			if( i == slot ) {
+				if( newChild != -1 )
+					tree.Pointers.push_back( newChild );
+			}
+			else if( hadChild ) {
+				uint32_t child = tree.Pointers[oldNode.Pointer + oldOffset];
+				tree.Pointers.push_back( child );
+			}
+			if( hadChild )
+				++oldOffset;
+		}
+
+		if( k == 0 ) {
+			tree.Nodes[0] = newNode;
+			ComputeNodeApproximation( tree, 0 );
+		}
+		else {
+			newChild = static_cast<uint32_t>( tree.Nodes.size() );
+			tree.Nodes.push_back( newNode );
+			tree.Approx.push_back( 0 );
+			ComputeNodeApproximation( tree, newChild );
+		}
+	}
+}
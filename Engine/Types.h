@@ -1,11 +1,17 @@
 #pragma once
 
+#ifdef _WIN32
 #include <d3d11.h>
 #include <DirectXMath.h>
+#else
+#include <cstdint>
+#include <cstddef>
+#endif
 
 template <typename T>
 struct Wrapper;
 
+#ifdef _WIN32
 // D3D types
 typedef ID3D11Buffer Buffer;
 typedef ID3D11RasterizerState RasterizerState;
@@ -60,6 +66,7 @@ typedef D3D11_TEX3D_UAV Texture3DUAV;
 typedef DXGI_SAMPLE_DESC SampleDesc;
 typedef D3D11_SUBRESOURCE_DATA SubresourceData;
 typedef D3D11_BOX Box;
+#endif
 
 struct RasterizerDesc;
 struct DepthStencilDesc;
@@ -86,6 +93,7 @@ enum class CPUAccessFlag : unsigned int;
 enum class ResourceMiscFlag : unsigned int;
 
 
+#ifdef _WIN32
 // VectorTypes
 typedef DirectX::XMFLOAT2 float2;
 typedef DirectX::XMFLOAT3 float3;
@@ -106,6 +114,81 @@ typedef DirectX::XMUINT4 uint4;
 
 // Matrices
 typedef DirectX::XMFLOAT4X4 Matrix;
+#else
+// the CPU tools also build without the Windows SDK, these have the layout and constructors of the DirectXMath types
+struct float2 {
+	float x, y;
+	float2() {}
+	float2( float _x, float _y ) : x( _x ), y( _y ) {}
+};
+struct float3 {
+	float x, y, z;
+	float3() {}
+	float3( float _x, float _y, float _z ) : x( _x ), y( _y ), z( _z ) {}
+};
+struct float4 {
+	float x, y, z, w;
+	float4() {}
+	float4( float _x, float _y, float _z, float _w ) : x( _x ), y( _y ), z( _z ), w( _w ) {}
+};
+typedef float4 Quaternion;
+typedef float4 Color;
+
+struct alignas( 16 ) float2a : public float2 {
+	float2a() {}
+	float2a( float _x, float _y ) : float2( _x, _y ) {}
+};
+struct alignas( 16 ) float3a : public float3 {
+	float3a() {}
+	float3a( float _x, float _y, float _z ) : float3( _x, _y, _z ) {}
+};
+struct alignas( 16 ) float4a : public float4 {
+	float4a() {}
+	float4a( float _x, float _y, float _z, float _w ) : float4( _x, _y, _z, _w ) {}
+};
+
+struct int2 {
+	int32_t x, y;
+	int2() {}
+	int2( int32_t _x, int32_t _y ) : x( _x ), y( _y ) {}
+};
+struct int3 {
+	int32_t x, y, z;
+	int3() {}
+	int3( int32_t _x, int32_t _y, int32_t _z ) : x( _x ), y( _y ), z( _z ) {}
+};
+struct int4 {
+	int32_t x, y, z, w;
+	int4() {}
+	int4( int32_t _x, int32_t _y, int32_t _z, int32_t _w ) : x( _x ), y( _y ), z( _z ), w( _w ) {}
+};
+struct uint2 {
+	uint32_t x, y;
+	uint2() {}
+	uint2( uint32_t _x, uint32_t _y ) : x( _x ), y( _y ) {}
+};
+struct uint3 {
+	uint32_t x, y, z;
+	uint3() {}
+	uint3( uint32_t _x, uint32_t _y, uint32_t _z ) : x( _x ), y( _y ), z( _z ) {}
+};
+struct uint4 {
+	uint32_t x, y, z, w;
+	uint4() {}
+	uint4( uint32_t _x, uint32_t _y, uint32_t _z, uint32_t _w ) : x( _x ), y( _y ), z( _z ), w( _w ) {}
+};
+
+struct Matrix {
+	float m[4][4];
+	Matrix() {}
+	float operator()( size_t row, size_t column ) const {
+		return m[row][column];
+	}
+	float& operator()( size_t row, size_t column ) {
+		return m[row][column];
+	}
+};
+#endif
 
 // Rotation
 extern Quaternion QuaternionIdentity;
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "VoxelPartFile.h"
+
+#include "Platform.h"
+
+#include "Game.h"
+#include "Logger.h"
+#include "Voxelizer.h"
+
+namespace {
+const uint32_t VoxelPartFileMagic = 'V' | ( 'X' << 8 ) | ( 'P' << 16 ) | ( 'F' << 24 );
+const uint32_t VoxelPartFileVersion = 1;
+}
+
+VoxelPartWriter::VoxelPartWriter() {
+}
+
+VoxelPartWriter::~VoxelPartWriter() {
+	if( IsOpen() )
+		Close();
+}
+
+bool VoxelPartWriter::Open( const std::wstring & fileName, uint32_t resolution, float3 position, float3 size, uint32_t numParts ) {
+	m_FileName = fileName;
+	m_File.open( fileName, std::ios::out | std::ios::trunc | std::ios::binary );
+	if( !m_File.is_open() ) {
+		Game::GetLogger().Log( L"Loader", L"Creating file \"" + fileName + L"\" failed for storing voxel data." );
+		return false;
+	}
+
+	m_Header.Magic = VoxelPartFileMagic;
+	m_Header.Version = VoxelPartFileVersion;
+	m_Header.Resolution = resolution;
+	m_Header.NumParts = numParts;
+	m_Header.Position = position;
+	m_Header.Size = size;
+
+	m_Index.assign( numParts, { 0, 0, 0, { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } } );
+
+	// reserve the space for header and index, they are written when closing
+	m_File.write( reinterpret_cast<const char*>( &m_Header ), sizeof( VoxelPartFileHeader ) );
+	m_File.write( reinterpret_cast<const char*>( m_Index.data() ), m_Index.size() * sizeof( VoxelPartInfo ) );
+	return m_File.good();
+}
+
+bool VoxelPartWriter::WritePart( uint32_t part, const Node * bricks, uint32_t numBricks, float3 boxMin, float3 boxMax ) {
+	if( !IsOpen() || part >= m_Index.size() )
+		return false;
+
+	VoxelPartInfo& info = m_Index[part];
+	info.Offset = static_cast<uint64_t>( m_File.tellp() );
+	info.NumBricks = numBricks;
+	info.BoxMin = boxMin;
+	info.BoxMax = boxMax;
+
+	m_File.write( reinterpret_cast<const char*>( bricks ), numBricks * sizeof( Node ) );
+	if( m_File.bad() ) {
+		Game::GetLogger().Log( L"Loader", L"Storing voxel part " + std::to_wstring( part ) + L" into file \"" + m_FileName + L"\" failed." );
+		return false;
+	}
+	return true;
+}
+
+bool VoxelPartWriter::Close() {
+	m_File.seekp( 0 );
+	m_File.write( reinterpret_cast<const char*>( &m_Header ), sizeof( VoxelPartFileHeader ) );
+	m_File.write( reinterpret_cast<const char*>( m_Index.data() ), m_Index.size() * sizeof( VoxelPartInfo ) );
+	m_File.close();
+
+	if( m_File.bad() ) {
+		Game::GetLogger().Log( L"Loader", L"Storing voxel data into file \"" + m_FileName + L"\" failed." );
+		return false;
+	}
+	return true;
+}
+
+VoxelPartReader::VoxelPartReader() {
+}
+
+VoxelPartReader::~VoxelPartReader() {
+}
+
+bool VoxelPartReader::Open( const std::wstring & fileName ) {
+	if( !m_File.Open( fileName ) )
+		return false;
+
+	if( m_File.GetSize() < sizeof( VoxelPartFileHeader ) ) {
+		Close();
+		return false;
+	}
+	memcpy( &m_Header, m_File.GetData(), sizeof( VoxelPartFileHeader ) );
+	// not a chunked file, e.g. an old flatbuffer voxelization
+	if( m_Header.Magic != VoxelPartFileMagic || m_Header.Version != VoxelPartFileVersion ) {
+		Close();
+		return false;
+	}
+
+	uint64_t indexEnd = sizeof( VoxelPartFileHeader ) + static_cast<uint64_t>( m_Header.NumParts ) * sizeof( VoxelPartInfo );
+	if( indexEnd > m_File.GetSize() ) {
+		Game::GetLogger().Log( L"Loader", L"Voxel file \"" + fileName + L"\" is corrupted." );
+		Close();
+		return false;
+	}
+	m_Index = reinterpret_cast<const VoxelPartInfo*>( m_File.GetData() + sizeof( VoxelPartFileHeader ) );
+
+	for( uint32_t i = 0; i < m_Header.NumParts; i++ ) {
+		const VoxelPartInfo& info = m_Index[i];
+		if( info.NumBricks > 0 && ( info.Offset < indexEnd || info.Offset + static_cast<uint64_t>( info.NumBricks ) * sizeof( Node ) > m_File.GetSize() ) ) {
+			Game::GetLogger().Log( L"Loader", L"Voxel file \"" + fileName + L"\" is corrupted." );
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void VoxelPartReader::Close() {
+	m_File.Close();
+	m_Index = nullptr;
+}
+
+Span<Node> VoxelPartReader::GetPart( uint32_t part ) const {
+	Span<Node> bricks;
+	const VoxelPartInfo& info = m_Index[part];
+	if( info.NumBricks > 0 ) {
+		bricks.Data = reinterpret_cast<const Node*>( m_File.GetData() + info.Offset );
+		bricks.Size = info.NumBricks;
+	}
+	return bricks;
+}
+
+std::vector<uint32_t> VoxelPartReader::FindParts( float3 boxMin, float3 boxMax ) const {
+	std::vector<uint32_t> parts;
+	for( uint32_t i = 0; i < m_Header.NumParts; i++ ) {
+		const VoxelPartInfo& info = m_Index[i];
+		if( info.NumBricks == 0 )
+			continue;
+		if( info.BoxMin.x > boxMax.x || info.BoxMin.y > boxMax.y || info.BoxMin.z > boxMax.z )
+			continue;
+		if( info.BoxMax.x < boxMin.x || info.BoxMax.y < boxMin.y || info.BoxMax.z < boxMin.z )
+			continue;
+		parts.push_back( i );
+	}
+	return parts;
+}
+
+void VoxelPartReader::LoadParts( const std::vector<uint32_t>& parts, std::vector<std::vector<Node>>& voxelParts ) const {
+	voxelParts.resize( m_Header.NumParts );
+	concurrency::parallel_for( size_t( 0 ), parts.size(), [&]( size_t i ) {
+		Span<Node> bricks = GetPart( parts[i] );
+		voxelParts[parts[i]].assign( bricks.begin(), bricks.end() );
+	} );
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "Types.h"
+#include "MappedFile.h"
+
+struct Node;
+
+// chunked voxelization file: header, index of all parts and the raw bricks of every part.
+// parts can be written one after another and read independently
+struct VoxelPartFileHeader {
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Resolution;
+	uint32_t NumParts;
+	float3 Position;
+	float3 Size;
+};
+
+struct VoxelPartInfo {
+	uint64_t Offset;
+	uint32_t NumBricks;
+	uint32_t Padding;
+	// world space bounds of the bricks
+	float3 BoxMin;
+	float3 BoxMax;
+};
+
+class VoxelPartWriter {
+public:
+	VoxelPartWriter();
+	~VoxelPartWriter();
+
+	bool Open( const std::wstring& fileName, uint32_t resolution, float3 position, float3 size, uint32_t numParts );
+	bool WritePart( uint32_t part, const Node* bricks, uint32_t numBricks, float3 boxMin, float3 boxMax );
+	// writes the index, parts that weren't written stay empty
+	bool Close();
+
+	bool IsOpen() const {
+		return m_File.is_open();
+	}
+private:
+	std::ofstream m_File;
+	std::wstring m_FileName;
+	VoxelPartFileHeader m_Header;
+	std::vector<VoxelPartInfo> m_Index;
+};
+
+class VoxelPartReader {
+public:
+	VoxelPartReader();
+	~VoxelPartReader();
+
+	bool Open( const std::wstring& fileName );
+	void Close();
+
+	bool IsOpen() const {
+		return m_File.IsOpen();
+	}
+	uint32_t GetResolution() const {
+		return m_Header.Resolution;
+	}
+	float3 GetPosition() const {
+		return m_Header.Position;
+	}
+	float3 GetSize() const {
+		return m_Header.Size;
+	}
+	uint32_t GetNumParts() const {
+		return m_Header.NumParts;
+	}
+	const VoxelPartInfo& GetPartInfo( uint32_t part ) const {
+		return m_Index[part];
+	}
+
+	// bricks of the part inside the mapping, pages are only read when accessed
+	Span<Node> GetPart( uint32_t part ) const;
+	// parts with bricks that overlap the box
+	std::vector<uint32_t> FindParts( float3 boxMin, float3 boxMax ) const;
+	// copies the given parts in parallel
+	void LoadParts( const std::vector<uint32_t>& parts, std::vector<std::vector<Node>>& voxelParts ) const;
+private:
+	MappedFile m_File;
+	VoxelPartFileHeader m_Header;
+	const VoxelPartInfo* m_Index = nullptr;
+};
@@ -1,7 +1,9 @@
 
 #include "Math.h"
+#include "Shader\VoxelDefines.hlsli"
 
 #include <set>
+#include <cfloat>
 
 static const uint3 gridSize = { 16, 16, 16 };
 static const uint3 numTexels = { 4, 4, 8 };
@@ -29,7 +31,16 @@ struct TriangleVals {
 	float d_yzT[3];
 };
 
-TriangleVals CalculateTriangleVals( float3 tri[3] ) {
+// half extent of the inner diamond of a voxel along the normal, same as in csVoxel.hlsl
+float DiamondExtent( const float3& n, const float3& delta ) {
+	return 0.5f * max( fabsf( n.x ) * delta.x, max( fabsf( n.y ) * delta.y, fabsf( n.z ) * delta.z ) );
+}
+
+float DiamondExtent( const float2& n, float deltaX, float deltaY ) {
+	return 0.5f * max( fabsf( n.x ) * deltaX, fabsf( n.y ) * deltaY );
+}
+
+TriangleVals CalculateTriangleVals( float3 tri[3], uint32_t mode ) {
 	TriangleVals vals;
 
 	// triangle edges
@@ -59,6 +70,14 @@ TriangleVals CalculateTriangleVals( float3 tri[3] ) {
 	vals.d1T = Dot( vals.n, c - tri[0] );
 	vals.d2T = Dot( vals.n, ( deltaTex - c ) - tri[0] );
 
+	// the thin mode only needs the plane to cross the diamond, tested from the voxel center
+	float3 halfDelta = 0.5f * deltaGrid;
+	if( mode == VOXEL_MODE_6_SEPARATING ) {
+		float center = Dot( vals.n, halfDelta - tri[0] );
+		vals.d1 = center - DiamondExtent( vals.n, deltaGrid );
+		vals.d2 = center + DiamondExtent( vals.n, deltaGrid );
+	}
+
 	for( uint32_t i = 0; i < 3; ++i ) {
 		// ns and ds for bit width
 		vals.n_xy[i] = float2( -e[i].y, e[i].x );
@@ -80,6 +99,27 @@ TriangleVals CalculateTriangleVals( float3 tri[3] ) {
 		vals.d_xyT[i] = -Dot( vals.n_xy[i], float2( tri[i].x, tri[i].y ) ) + max( 0, deltaTex.x * vals.n_xy[i].x ) + max( 0, deltaTex.y * vals.n_xy[i].y );
 		vals.d_xzT[i] = -Dot( vals.n_xz[i], float2( tri[i].x, tri[i].z ) ) + max( 0, deltaTex.x * vals.n_xz[i].x ) + max( 0, deltaTex.z * vals.n_xz[i].y );
 		vals.d_yzT[i] = -Dot( vals.n_yz[i], float2( tri[i].y, tri[i].z ) ) + max( 0, deltaTex.y * vals.n_yz[i].x ) + max( 0, deltaTex.z * vals.n_yz[i].y );
+
+		// the texel tests stay conservative, they only prefilter the voxel tests
+		if( mode != VOXEL_MODE_CONSERVATIVE ) {
+			float3 center = tri[i] - halfDelta;
+			vals.d_xy[i] = -Dot( vals.n_xy[i], float2( center.x, center.y ) ) + DiamondExtent( vals.n_xy[i], deltaGrid.x, deltaGrid.y );
+			vals.d_xz[i] = -Dot( vals.n_xz[i], float2( center.x, center.z ) ) + DiamondExtent( vals.n_xz[i], deltaGrid.x, deltaGrid.z );
+			vals.d_yz[i] = -Dot( vals.n_yz[i], float2( center.y, center.z ) ) + DiamondExtent( vals.n_yz[i], deltaGrid.y, deltaGrid.z );
+		}
+	}
+
+	// for 6-separation only the projection along the dominant axis is tested
+	if( mode == VOXEL_MODE_6_SEPARATING ) {
+		float3 absN = float3( fabsf( vals.n.x ), fabsf( vals.n.y ), fabsf( vals.n.z ) );
+		for( uint32_t j = 0; j < 3; ++j ) {
+			if( absN.z < absN.x || absN.z < absN.y )
+				vals.d_xy[j] = FLT_MAX;
+			if( absN.y < absN.x || absN.y <= absN.z )
+				vals.d_xz[j] = FLT_MAX;
+			if( absN.x <= absN.y || absN.x <= absN.z )
+				vals.d_yz[j] = FLT_MAX;
+		}
 	}
 
 
@@ -145,7 +185,7 @@ void ProcessTexel( uint32_t x, uint32_t y, uint32_t z, uint3 bitStart, uint3 bit
 		grid[bufferPos] |= bits;
 }
 
-void voxelize( uint32_t numTriangles, float3* vertices, uint32_t* indices, uint32_t* grid ) {
+void voxelize( uint32_t numTriangles, float3* vertices, uint32_t* indices, uint32_t mode, uint32_t* grid ) {
 	float3 tri[3];
 
 	for( uint32_t id = 0; id < numTriangles; ++id ) {
@@ -180,7 +220,7 @@ void voxelize( uint32_t numTriangles, float3* vertices, uint32_t* indices, uint3
 		end.y = end.y >> 2;
 		end.z = end.z >> 1;
 
-		TriangleVals vals = CalculateTriangleVals( tri );
+		TriangleVals vals = CalculateTriangleVals( tri, mode );
 
 		uint3 startBit = bitStart;
 		uint3 endBit = uint3( numBits.x - 1, numBits.y - 1, numBits.z - 1 );
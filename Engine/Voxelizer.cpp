@@ -6,6 +6,10 @@
 
 #include "Shader\VoxelDefines.hlsli"
 
+#include <ppl.h>
+#include <mutex>
+#include <memory>
+
 #include "Game.h"
 #include "RenderBackend.h"
 #include "D3DWrapper.h"
@@ -24,21 +28,47 @@
 #include "Morton.h"
 #include "FileLoader.h"
 #include "Window.h"
+#include "TransformCache.h"
+#include "Geometry.h"
+#include "CpuVoxelizer.h"
+#include "VoxelPartFile.h"
+#include "EmptyDistance.h"
+#include "SampleTable.h"
+#include "TraversalVectors.h"
 
 #include "TreeBuild_Impl.h"
+#include "TreeUpdate_Impl.h"
+
+// tree file that gets loaded in the background during startup
+struct PreparedTree {
+	~PreparedTree() {
+		Tasks.wait();
+	}
+
+	std::wstring FileName;
+	MappedFile File;
+	TreeView Tree;
+#ifdef ANISOTROPIC
+	std::vector<uint32_t> Approx;
+#else
+	std::vector<float> Approx;
+#endif // ANISOTROPIC
+	bool IsLoaded = false;
+	float LoadTime = 0.f;
+	concurrency::task_group Tasks;
+};
 
 //#define PREVOXELIZE
 
-float GetHaltonNumber( int index, int base ) {
-	float result = 0.f;
-	float f = 1.f;
-	int i = index;
-	while( i > 0 ) {
-		f = f / base;
-		result = result + f * ( i % base );
-		i = i / base;
+std::wstring GetVoxelModeName( uint32_t mode ) {
+	switch( mode ) {
+		case VOXEL_MODE_26_SEPARATING:
+			return L"26-Separating";
+		case VOXEL_MODE_6_SEPARATING:
+			return L"6-Separating";
+		default:
+			return L"Conservative";
 	}
-	return result;
 }
 
 Voxelizer::Voxelizer( const float3& position, const float3& size, const uint32_t resolution )
@@ -48,6 +78,8 @@ Voxelizer::Voxelizer( const float3& position, const float3& size, const uint32_t
 	, m_Depth( resolution / m_ResolutionMultiplier )
 	, m_Position( position )
 	, m_Size( size ) {
+	m_VoxelMode = static_cast<uint32_t>( Game::GetConfig().GetInt( L"VoxelizationMode", VOXEL_MODE_CONSERVATIVE ) );
+
 	if( !CreateBuffers() )
 		return;
 
@@ -60,6 +92,7 @@ Voxelizer::Voxelizer( const float3& position, const float3& size, const uint32_t
 	VoxelizeData data;
 	data.gridSize = { m_Width, m_Height, m_Depth };
 	data.numBits = { 4, 4, 4 };
+	data.voxelMode = m_VoxelMode;
 	data.numTexels = { m_Width / data.numBits.x, m_Height / data.numBits.y, m_Depth / data.numBits.z };
 	data.deltaGrid = { size.x / static_cast<float>( m_Width ),size.y / static_cast<float>( m_Height ), size.z / static_cast<float>( m_Depth ) };
 	data.invDeltaGrid = { 1.0f / data.deltaGrid.x, 1.0f / data.deltaGrid.y, 1.0f / data.deltaGrid.z };
@@ -87,6 +120,7 @@ Voxelizer::Voxelizer( const float3& position, const float3& size, const uint32_t
 
 Voxelizer::~Voxelizer() {
 	Game::GetRenderBackend().UnRegisterCallBacks( this );
+	delete m_PreparedTree;
 
 	SRelease( m_TreeSRV );
 	SRelease( m_TreeUAV );
@@ -96,6 +130,18 @@ Voxelizer::~Voxelizer() {
 	SRelease( m_PointerSRV );
 	SRelease( m_PointerUAV );
 	SRelease( m_ApproxSRV );
+	SRelease( m_EmptyDistanceSRV );
+	SRelease( m_EmptyDistanceBuffer );
+	SRelease( m_BeamSRV );
+	SRelease( m_BeamUAV );
+	SRelease( m_BeamBuffer );
+	SRelease( m_SampleTableSRV );
+	SRelease( m_SampleTableBuffer );
+	SRelease( m_BrickBuffer );
+	SRelease( m_BrickStagingBuffer );
+
+	delete m_DynamicTree;
+	delete m_PartReader;
 }
 
 void Voxelizer::VoxelizeObject( GameObject& gameObject ) {
@@ -179,33 +225,74 @@ void Voxelizer::VoxelizeObject( GameObject& gameObject ) {
 #endif
 }
 
-VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Matrix>>& elements ) {
-	if( Game::GetConfig().GetBool( L"LoadTree", false ) ) {
+VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Matrix>>& elements, TransformCache& transformCache ) {
+	return VoxelizeElements( elements, transformCache, true );
+}
+
+VoxelGrid * Voxelizer::VoxelizeElements( const std::vector<std::pair<const Geometry*, Matrix>>& elements, TransformCache& transformCache, bool useFiles ) {
+	delete m_DynamicTree;
+	m_DynamicTree = nullptr;
+
+	if( useFiles && Game::GetConfig().GetBool( L"LoadTree", false ) ) {
 		std::wstring path = Game::GetConfig().GetString( L"TreeLoadPath", L"TestTree.vx" );
-		if( LoadTree( path ) )
+		if( LoadTree( path ) ) {
+			std::wstring vectorPath = Game::GetConfig().GetString( L"TraversalVectorPath", L"" );
+			if( !vectorPath.empty() )
+				RecordTraversalVectors( vectorPath, path );
 			return nullptr;
+		}
 	}
 
-	bool loadVoxelization = Game::GetConfig().GetBool( L"LoadVoxelization", false );
+	bool loadVoxelization = useFiles && Game::GetConfig().GetBool( L"LoadVoxelization", false );
+
+	// rebuilds keep the loaded file, the region updates read from it
+	if( useFiles ) {
+		delete m_PartReader;
+		m_PartReader = nullptr;
+	}
 
 	std::vector<std::vector<Node>> voxelizationParts;
 
+	VoxelPartWriter partWriter;
 	bool storeVoxelization = false;
 	if( loadVoxelization ) {
 		std::wstring path = Game::GetConfig().GetString( L"VoxelLoadPath", L"TestVoxel.vx" );
-		Game::GetFileLoader().LoadVoxelData( path, voxelizationParts, m_Width, m_Position, m_Size );
+		// chunked files are mapped and every part is read when it gets built, older files are loaded completely
+		m_PartReader = new VoxelPartReader();
+		if( m_PartReader->Open( path ) ) {
+			m_Width = m_PartReader->GetResolution();
+			m_Position = m_PartReader->GetPosition();
+			m_Size = m_PartReader->GetSize();
+			voxelizationParts.resize( m_PartReader->GetNumParts() );
+		}
+		else {
+			delete m_PartReader;
+			m_PartReader = nullptr;
+			Game::GetFileLoader().LoadVoxelData( path, voxelizationParts, m_Width, m_Position, m_Size );
+		}
 		m_Height = m_Depth = m_Width;
 		m_ResolutionMultiplier = static_cast<uint32_t>( cbrtf( static_cast<float>( voxelizationParts.size() ) ) );
 		UpdateGridData();
 	}
 	else {
 		voxelizationParts.resize( m_ResolutionMultiplier * m_ResolutionMultiplier * m_ResolutionMultiplier );
-		storeVoxelization = Game::GetConfig().GetBool( L"StoreVoxelization", false );
+		storeVoxelization = useFiles && Game::GetConfig().GetBool( L"StoreVoxelization", false );
+		if( storeVoxelization ) {
+			std::wstring path = Game::GetConfig().GetString( L"VoxelStorePath", L"TestVoxel.vx" );
+			storeVoxelization = partWriter.Open( path, m_Width, m_Position, m_Size, static_cast<uint32_t>( voxelizationParts.size() ) );
+		}
 	}
 
 	RenderBackend* renderBackend = &Game::GetRenderBackend();
 
-	std::vector<std::pair<std::vector<Node>, std::vector<uint32_t>>> nodeList;
+	// voxelizes the parts with CpuVoxelizer on the world space positions shared with embree instead of csVoxel.hlsl,
+	// subdivided parts still get voxelized on the gpu
+	bool cpuVoxelization = !loadVoxelization && Game::GetConfig().GetBool( L"CpuVoxelization", false );
+	std::vector<Node> cpuBricks;
+	if( cpuVoxelization )
+		transformCache.Prepare( elements );
+
+	std::vector<PartTree> nodeList;
 	nodeList.resize( voxelizationParts.size() );
 
 	float3 voxelPartSize = m_Size / static_cast<float>( m_ResolutionMultiplier );
@@ -235,59 +322,156 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 
 	DebugData debugData( static_cast<uint32_t>( ceil( log2( m_Width * m_ResolutionMultiplier ) / 2.f ) ) );
 
+	float startTime = Game::GetTime().GetRealTime();
+	size_t totalBricks = 0;
+
+	uint32_t maxLevel = static_cast<uint32_t>( ceil( log2( m_Width ) / 2.f ) ) - 1;
+	// a part has to fit into the tree buffers while its tree gets built
+	uint32_t brickBudget = static_cast<uint32_t>( Game::GetConfig().GetInt( L"PartBrickBudget", static_cast<int>( m_NumTreeNodes / ( maxLevel + 1 ) ) ) );
+
+	// every part voxelizes all elements, but only the triangles of the elements overlapping it can set voxels.
+	// the world bounds come from the object space bounds of the geometry, so no vertex gets transformed for them
+	uint64_t sceneTriangles = 0;
+	std::vector<std::pair<float3, float3>> elementBoxes;
+	if( !loadVoxelization ) {
+		elementBoxes.resize( elements.size() );
+		for( size_t i = 0; i < elements.size(); i++ ) {
+			const Geometry& geometry = *elements[i].first;
+			sceneTriangles += geometry.GetTriangleCount();
+			TransformBoundingBox( geometry.GetBoxMin(), geometry.GetBoxMax(), elements[i].second, elementBoxes[i].first, elementBoxes[i].second );
+		}
+	}
+
+	// metrics of every part are streamed as json lines, so long builds can be monitored
+	auto writePartMetrics = [&]( uint32_t voxelPart, uint32_t numBricks, const DebugData& partStart, float voxelizationTime, size_t bytesWritten ) {
+		size_t numParts = voxelizationParts.size();
+		float elapsed = Game::GetTime().GetRealTime() - startTime;
+		float eta = elapsed / ( voxelPart + 1 ) * ( numParts - voxelPart - 1 );
+
+		float3 partMin = make_float3( MortonDecode( voxelPart ) ) * voxelPartSize + m_Position - 0.5f * m_Size;
+		float3 partMax = partMin + voxelPartSize;
+		uint64_t partTriangles = 0;
+		for( size_t i = 0; i < elementBoxes.size(); i++ ) {
+			const float3& boxMin = elementBoxes[i].first;
+			const float3& boxMax = elementBoxes[i].second;
+			if( boxMax.x < partMin.x || boxMax.y < partMin.y || boxMax.z < partMin.z || boxMin.x > partMax.x || boxMin.y > partMax.y || boxMin.z > partMax.z )
+				continue;
+			partTriangles += elements[i].first->GetTriangleCount();
+		}
+
+		nlohmann::json j;
+		j["Part"] = voxelPart;
+		j["Parts"] = numParts;
+		j["SceneTriangles"] = sceneTriangles;
+		// triangles of the elements whose bounds overlap the part
+		j["PartTriangles"] = partTriangles;
+		j["Bricks"] = numBricks;
+		j["UniqueBricks"] = debugData.TotalNodes[maxLevel] - partStart.TotalNodes[maxLevel];
+		// times in ms
+		j["VoxelizationTime"] = voxelizationTime;
+		j["SortingTime"] = debugData.SortingTime - partStart.SortingTime;
+		j["TreeBuildTime"] = debugData.TreeBuildTime - partStart.TreeBuildTime;
+		j["ClusteringTime"] = debugData.ClusteringTime - partStart.ClusteringTime;
+		j["DoubleNodeRemovelTime"] = debugData.DoubleNodeRemovelTime - partStart.DoubleNodeRemovelTime;
+		j["BytesWritten"] = bytesWritten;
+		// times in s
+		j["Elapsed"] = elapsed;
+		j["ETA"] = eta;
+
+		Game::GetLogger().PrintToSeperateFile( L"VoxelMetrics", s2ws( j.dump() ) );
+		Game::GetLogger().Log( L"Voxelizer", L"Part " + std::to_wstring( voxelPart + 1 ) + L"/" + std::to_wstring( numParts ) + L" done, ETA: " + std::to_wstring( eta ) + L" s" );
+	};
+
 	for( uint32_t voxelPart = 0; voxelPart < voxelizationParts.size(); voxelPart++ ) {
+		bool isSubdivided = false;
+		DebugData partDebugData = debugData;
+		float voxelizationTime = 0.f;
+		uint32_t numVoxelizedBricks = 0;
 #ifndef PREVOXELIZE
 		uint32_t numBricks;
 
 		if( !loadVoxelization ) {
-			uint32_t clearVal[4] = { 0,0,0,0 };
-			renderBackend->ClearUAV( m_TreeUAV, clearVal );
-			renderBackend->ClearUAV( m_CountUAV, clearVal );
+			if( cpuVoxelization ) {
+				float voxelStart = Game::GetTime().GetRealTime();
+				numBricks = VoxelizePartOnCpu( elements, elementBoxes, transformCache, voxelPart, voxelPartSize, cpuBricks );
+				voxelizationTime = ( Game::GetTime().GetRealTime() - voxelStart ) * 1000.f;
 
-			Profiler::GlobalProfiler.StartProfile( L"Voxelize", false );
+				Game::GetLogger().Log( L"Voxelizer", L"CPU Voxelization Time: " + std::to_wstring( voxelizationTime ) + L" ms" );
+			}
+			else {
+				uint32_t clearVal[4] = { 0,0,0,0 };
+				renderBackend->ClearUAV( m_TreeUAV, clearVal );
+				renderBackend->ClearUAV( m_CountUAV, clearVal );
 
-			for( size_t i = 0; i < elements.size(); i++ ) {
-				const Geometry& geometry = *elements[i].first;
-				const Matrix& transform = elements[i].second;
-				m_VoxelShader->SetShader();
+				Profiler::GlobalProfiler.StartProfile( L"Voxelize", false );
 
-				UpdateVoxelizeData( voxelPart, voxelPartSize );
+				for( size_t i = 0; i < elements.size(); i++ ) {
+					const Geometry& geometry = *elements[i].first;
+					const Matrix& transform = elements[i].second;
+					m_VoxelShader->SetShader();
 
-				m_VoxelizeDataBuffer.Bind( ShaderFlag::ComputeShader, 0 );
+					UpdateVoxelizeData( voxelPart, voxelPartSize );
 
-				VoxelObjectData objData;
-				objData.numTriangles = geometry.GetTriangleCount();
-				objData.worldMat = transform;
-				m_ObjectDataBuffer.Update( objData );
-				m_ObjectDataBuffer.Bind( ShaderFlag::ComputeShader, 1 );
+					m_VoxelizeDataBuffer.Bind( ShaderFlag::ComputeShader, 0 );
 
-				renderBackend->SetUAVCS( 1, { m_TreeUAV, m_CountUAV }, { 0 } );
-				renderBackend->SetSRVsCS( 0, { geometry.GetPositionSRV(), geometry.GetIndexSRV() } );
+					VoxelObjectData objData;
+					objData.numTriangles = geometry.GetTriangleCount();
+					objData.worldMat = transform;
+					m_ObjectDataBuffer.Update( objData );
+					m_ObjectDataBuffer.Bind( ShaderFlag::ComputeShader, 1 );
 
-				uint32_t numTriangles = geometry.GetTriangleCount();
-				uint32_t groupSize = 128;
-				uint32_t numGroups = numTriangles / groupSize;
-				if( numTriangles & ( groupSize - 1 ) )
-					numGroups++;
+					renderBackend->SetUAVCS( 1, { m_TreeUAV, m_CountUAV }, { 0 } );
+					renderBackend->SetSRVsCS( 0, { geometry.GetPositionSRV(), geometry.GetIndexSRV() } );
 
-				renderBackend->Dispatch( numGroups, 1, 1 );
-				renderBackend->SetUAVCS( 1, { nullptr, nullptr }, { 0 } );
-			}
+					uint32_t numTriangles = geometry.GetTriangleCount();
+					uint32_t groupSize = 128;
+					uint32_t numGroups = numTriangles / groupSize;
+					if( numTriangles & ( groupSize - 1 ) )
+						numGroups++;
 
-			float time = Profiler::GlobalProfiler.EndProfile( L"Voxelize" );
+					renderBackend->Dispatch( numGroups, 1, 1 );
+					renderBackend->SetUAVCS( 1, { nullptr, nullptr }, { 0 } );
+				}
 
-			Game::GetLogger().Log( L"Voxelizer", L"Voxelization Time: " + std::to_wstring( time ) + L" ms" );
+				voxelizationTime = Profiler::GlobalProfiler.EndProfile( L"Voxelize" );
 
-			renderBackend->ReadBuffer( m_CountBuffer, sizeof( uint32_t ), &numBricks, sizeof( uint32_t ), 0 );
+				Game::GetLogger().Log( L"Voxelizer", L"Voxelization Time: " + std::to_wstring( voxelizationTime ) + L" ms" );
+
+				renderBackend->ReadBuffer( m_CountBuffer, sizeof( uint32_t ), &numBricks, sizeof( uint32_t ), 0 );
+			}
 
 			Game::GetLogger().Log( L"Voxelizer", L"Number of Bricks voxelized: " + std::to_wstring( numBricks ) );
-			if( numBricks == 0 )
+			totalBricks += numBricks;
+			numVoxelizedBricks = numBricks;
+			if( numBricks == 0 ) {
+				writePartMetrics( voxelPart, 0, partDebugData, voxelizationTime, 0 );
 				continue;
+			}
+
+			// dense parts get split into smaller ones until each fits the budget
+			if( numBricks > brickBudget && !storeVoxelization && maxLevel >= 3 ) {
+				SubdividePart( elements, elementBoxes, voxelPart, voxelPartSize, maxLevel, brickBudget, tempNodeBuffer, nodeList[voxelPart], debugData );
+				if( nodeList[voxelPart].Nodes.empty() || m_ResolutionMultiplier > 1 ) {
+					const PartTree& part = nodeList[voxelPart];
+					writePartMetrics( voxelPart, numVoxelizedBricks, partDebugData, voxelizationTime, part.Nodes.size() * sizeof( Node ) + part.Pointers.size() * sizeof( uint32_t ) );
+					continue;
+				}
+				isSubdivided = true;
+			}
+			else if( numBricks > m_NumTreeNodes ) {
+				Game::GetLogger().FatalError( L"Not enough space for voxelization" );
+			}
 		}
 		else {
-			numBricks = static_cast<uint32_t>( voxelizationParts[voxelPart].size() );
-			if( numBricks == 0 )
+			if( m_PartReader )
+				numBricks = m_PartReader->GetPartInfo( voxelPart ).NumBricks;
+			else
+				numBricks = static_cast<uint32_t>( voxelizationParts[voxelPart].size() );
+			numVoxelizedBricks = numBricks;
+			if( numBricks == 0 ) {
+				writePartMetrics( voxelPart, 0, partDebugData, voxelizationTime, 0 );
 				continue;
+			}
 		}
 
 #endif
@@ -300,7 +484,7 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 #endif	
 
 #ifndef PREVOXELIZE
-		if( !loadVoxelization ) {
+		if( !loadVoxelization && !isSubdivided && !cpuVoxelization ) {
 			renderBackend->CopyResource( tempNodeBuffer, m_TreeBuffer );
 		}
 #endif // !PREVOXELIZE
@@ -308,19 +492,26 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 		renderBackend->MapBuffer( tempPointerBuffer, reinterpret_cast<void**>( &pointer ), 0, MapType::Write );
 		renderBackend->MapBuffer( tempApproxBuffer, reinterpret_cast<void**>( &approx ), 0, MapType::Write );
 
+		if( cpuVoxelization && !isSubdivided )
+			std::copy( cpuBricks.begin(), cpuBricks.end(), nodes );
+
 		if( storeVoxelization ) {
 			SortAndOptimize( nodes, numBricks );
-			voxelizationParts[voxelPart].assign( nodes, nodes + numBricks );
+			float3 boxMin, boxMax;
+			ComputePartBounds( voxelPart, voxelPartSize, nodes, numBricks, boxMin, boxMax );
+			partWriter.WritePart( voxelPart, nodes, numBricks, boxMin, boxMax );
 			if( Game::GetConfig().GetBool( L"JustStoreVoxelization", false ) ) {
 				renderBackend->UnmapBuffer( tempNodeBuffer, 0 );
 				renderBackend->UnmapBuffer( tempPointerBuffer, 0 );
 				renderBackend->UnmapBuffer( tempApproxBuffer, 0 );
+				writePartMetrics( voxelPart, numVoxelizedBricks, partDebugData, voxelizationTime, numBricks * sizeof( Node ) );
 				continue;
 			}
 		}
 
 		if( loadVoxelization ) {
-			memcpy( nodes, voxelizationParts[voxelPart].data(), numBricks * sizeof( Node ) );
+			const Node* bricks = m_PartReader ? m_PartReader->GetPart( voxelPart ).Data : voxelizationParts[voxelPart].data();
+			memcpy( nodes, bricks, numBricks * sizeof( Node ) );
 		}
 
 #ifdef PREVOXELIZE
@@ -333,25 +524,39 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 			}
 		}
 		uint32_t numBricks = idx;
+		numVoxelizedBricks = numBricks;
 #endif
 
-		uint32_t maxLevel = static_cast<uint32_t>( ceil( log2( m_Width ) / 2.f ) ) - 1;
 		uint32_t nodesSize, pointersSize;
-		BuildTree( nodes, pointer, numBricks, maxLevel, nodesSize, pointersSize, debugData );
+		if( isSubdivided ) {
+			const PartTree& part = nodeList[voxelPart];
+			nodesSize = static_cast<uint32_t>( part.Nodes.size() );
+			pointersSize = static_cast<uint32_t>( part.Pointers.size() );
+			if( nodesSize > m_NumTreeNodes || pointersSize > m_NumTreeNodes )
+				Game::GetLogger().FatalError( L"Not enough space for the subdivided tree" );
+			std::copy( part.Nodes.begin(), part.Nodes.end(), nodes );
+			std::copy( part.Pointers.begin(), part.Pointers.end(), pointer );
+		}
+		else {
+			BuildTree( nodes, pointer, numBricks, maxLevel, nodesSize, pointersSize, debugData );
+		}
 		ComputeApproximation( nodes, nodesSize, pointer, approx );
 
 		if( m_ResolutionMultiplier > 1 ) {
-			nodeList[voxelPart].first.assign( nodes, nodes + nodesSize );
-			nodeList[voxelPart].second.assign( pointer, pointer + pointersSize );
+			nodeList[voxelPart].Nodes.assign( nodes, nodes + nodesSize );
+			nodeList[voxelPart].Pointers.assign( pointer, pointer + pointersSize );
 			renderBackend->UnmapBuffer( tempNodeBuffer, 0 );
 			renderBackend->UnmapBuffer( tempPointerBuffer, 0 );
 			renderBackend->UnmapBuffer( tempApproxBuffer, 0 );
 		}
 		else {
-			if( Game::GetConfig().GetBool( L"StoreTree", false ) ) {
+			if( !m_DynamicObjects.empty() )
+				StoreDynamicTree( nodes, nodesSize, pointer, pointersSize, approx, maxLevel );
+			if( useFiles && Game::GetConfig().GetBool( L"StoreTree", false ) ) {
 				std::wstring path = Game::GetConfig().GetString( L"TreeStorePath", L"TestTree.tr" );
-				Game::GetFileLoader().StoreTreeData( m_Width * m_ResolutionMultiplier, m_Position, m_Size, nodes, nodesSize, pointer, pointersSize, path );
+				Game::GetFileLoader().StoreTreeData( m_Width * m_ResolutionMultiplier, m_Position, m_Size, nodes, nodesSize, pointer, pointersSize, path, Game::GetConfig().GetBool( L"CompressTree", false ) );
 			}
+			UploadEmptyDistances( nodes, 0, nodesSize );
 			renderBackend->UnmapBuffer( tempNodeBuffer, 0 );
 			renderBackend->UnmapBuffer( tempPointerBuffer, 0 );
 			renderBackend->UnmapBuffer( tempApproxBuffer, 0 );
@@ -359,15 +564,31 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 			renderBackend->CopyResource( m_PointerBuffer, tempPointerBuffer );
 			renderBackend->CopyResource( m_ApproxBuffer, tempApproxBuffer );
 		}
+
+		writePartMetrics( voxelPart, numVoxelizedBricks, partDebugData, voxelizationTime, nodesSize * ( sizeof( Node ) + sizeof( approx[0] ) ) + pointersSize * sizeof( uint32_t ) );
 	}
 
 	tempNodeBuffer->Release();
 	tempPointerBuffer->Release();
 	tempApproxBuffer->Release();
 
-	if( storeVoxelization ) {
-		std::wstring path = Game::GetConfig().GetString( L"VoxelStorePath", L"TestVoxel.vx" );
-		Game::GetFileLoader().StoreVoxelData( m_Width, m_Position, m_Size, voxelizationParts, path );
+	if( storeVoxelization )
+		partWriter.Close();
+
+	if( loadVoxelization && m_PartReader ) {
+		// the file stays mapped for the region updates of the dynamic tree
+		if( m_DynamicTree ) {
+			for( DynamicObject& object : m_DynamicObjects ) {
+				object.IsStored = true;
+				object.StoredTransform = object.Transform;
+				object.StoredBoxMin = object.BoxMin;
+				object.StoredBoxMax = object.BoxMax;
+			}
+		}
+		else {
+			delete m_PartReader;
+			m_PartReader = nullptr;
+		}
 	}
 	
 	if( m_ResolutionMultiplier > 1 ) {
@@ -391,11 +612,414 @@ VoxelGrid * Voxelizer::Voxelize( const std::vector<std::pair<const Geometry*, Ma
 		UpdateGridData();
 	}
 
+	float endTime = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"Voxelizer", GetVoxelModeName( m_VoxelMode ) + L" voxelization: " + std::to_wstring( totalBricks ) + L" bricks, "
+						   + std::to_wstring( debugData.TreeBuildTime ) + L" ms tree build, " + std::to_wstring( ( endTime - startTime ) * 1000.f ) + L" ms total" );
+
 	StoreDebugData( debugData );
 	
 	return nullptr;
 }
 
+void Voxelizer::AddDynamicObject( GameObject& gameObject ) {
+	if( !Game::GetConfig().GetBool( L"DynamicVoxelization", false ) )
+		return;
+
+#ifdef SOFTSHADOW
+	// the solidified tree can't be updated locally
+	Game::GetLogger().Log( L"Voxelizer", L"Dynamic voxelization is not supported with SOFTSHADOW" );
+#else
+	DynamicObject object;
+	object.Object = &gameObject;
+	object.Geometry = gameObject.GetRenderable()->GetGeometry();
+	object.Transform = gameObject.GetTransform().GetWorldTransMat();
+	object.BoxMin = { 0.f, 0.f, 0.f };
+	object.BoxMax = { 0.f, 0.f, 0.f };
+	object.IsDirty = false;
+	object.IsStored = false;
+	m_DynamicObjects.push_back( object );
+
+	// index instead of pointer, the vector can still grow
+	size_t idx = m_DynamicObjects.size() - 1;
+	gameObject.GetTransform().AddOnInvalidateFunction( [this, idx]() {
+		m_DynamicObjects[idx].IsDirty = true;
+	} );
+#endif // SOFTSHADOW
+}
+
+void Voxelizer::UpdateDynamicObjects( TransformCache& transformCache ) {
+	if( !m_DynamicTree )
+		return;
+
+	for( DynamicObject& object : m_DynamicObjects ) {
+		if( !object.IsDirty )
+			continue;
+		object.IsDirty = false;
+
+		Matrix transform = object.Object->GetTransform().GetWorldTransMat();
+		if( memcmp( &transform, &object.Transform, sizeof( Matrix ) ) == 0 )
+			continue;
+
+		transformCache.Remove( *object.Geometry, object.Transform );
+		object.Transform = transform;
+
+		float3 boxMin, boxMax;
+		TransformBoundingBox( object.Geometry->GetBoxMin(), object.Geometry->GetBoxMax(), transform, boxMin, boxMax );
+
+		// the old and the new position have to be revoxelized
+		float3 regionMin = { Min( boxMin.x, object.BoxMin.x ), Min( boxMin.y, object.BoxMin.y ), Min( boxMin.z, object.BoxMin.z ) };
+		float3 regionMax = { Max( boxMax.x, object.BoxMax.x ), Max( boxMax.y, object.BoxMax.y ), Max( boxMax.z, object.BoxMax.z ) };
+		object.BoxMin = boxMin;
+		object.BoxMax = boxMax;
+
+		UpdateRegion( regionMin, regionMax, transformCache );
+
+		// a failed rebuild leaves no tree to update
+		if( !m_DynamicTree )
+			return;
+	}
+}
+
+bool Voxelizer::CreateDynamicBuffers() {
+	if( m_BrickBuffer )
+		return true;
+
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+	m_NumRegionBricks = static_cast<uint32_t>( Game::GetConfig().GetInt( L"DynamicBrickCapacity", 4 * 1024 * 1024 ) );
+
+	// bricks of the revoxelized region
+	BufferDesc bDesc;
+	bDesc.BindFlags = BindFlag::UnorderedAccess;
+	bDesc.MiscFlags = ResourceMiscFlag::BufferStructured;
+	bDesc.ByteWidth = m_NumRegionBricks * sizeof( Node );
+	bDesc.StructureByteStride = sizeof( Node );
+
+	m_BrickBuffer = renderBackend->CreateBuffer( nullptr, bDesc );
+
+	if( !m_BrickBuffer )
+		return false;
+
+	UAVDesc uavDesc;
+	uavDesc.Format = Format::Unknown;
+	uavDesc.ViewDimension = UAVDimension::Buffer;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = m_NumRegionBricks;
+	uavDesc.Buffer.Flags = UAVBufferFlag::Counter;
+
+	m_BrickUAV = renderBackend->CreateUAV( m_BrickBuffer, &uavDesc );
+
+	if( !m_BrickUAV )
+		return false;
+
+	BufferDesc desc;
+	desc.ByteWidth = m_NumRegionBricks * sizeof( Node );
+	desc.CPUAccessFlags = CPUAccessFlag::Read;
+	desc.Usage = Usage::Staging;
+
+	ID3D11Device* device = &Game::GetDevice();
+	HRESULT hr = device->CreateBuffer( reinterpret_cast<D3D11_BUFFER_DESC*>( &desc ), nullptr, &m_BrickStagingBuffer );
+	if( FAILED( hr ) )
+		return false;
+
+	return true;
+}
+
+void Voxelizer::StoreDynamicTree( const Node* nodes, uint32_t nodeSize, const uint32_t* pointers, uint32_t pointerSize, const void* approx, uint32_t maxLevel ) {
+	// subtrees need at least two levels below the updated cells
+	if( maxLevel < 3 ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Resolution too low for dynamic voxelization" );
+		return;
+	}
+	if( !CreateDynamicBuffers() ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Creation of dynamic voxelization buffers failed" );
+		return;
+	}
+
+	m_DynamicTree = new DynamicTree();
+	m_DynamicTree->Nodes.assign( nodes, nodes + nodeSize );
+	m_DynamicTree->Pointers.assign( pointers, pointers + pointerSize );
+#ifdef ANISOTROPIC
+	const uint32_t* approxValues = static_cast<const uint32_t*>( approx );
+#else
+	const float* approxValues = static_cast<const float*>( approx );
+#endif // ANISOTROPIC
+	m_DynamicTree->Approx.assign( approxValues, approxValues + nodeSize );
+	m_DynamicTree->MaxLevel = maxLevel;
+
+	for( DynamicObject& object : m_DynamicObjects ) {
+		object.Transform = object.Object->GetTransform().GetWorldTransMat();
+		TransformBoundingBox( object.Geometry->GetBoxMin(), object.Geometry->GetBoxMax(), object.Transform, object.BoxMin, object.BoxMax );
+		object.IsDirty = false;
+	}
+}
+
+void Voxelizer::UpdateRegion( const float3& regionMin, const float3& regionMax, TransformCache& transformCache ) {
+	DynamicTree& tree = *m_DynamicTree;
+	float startTime = Game::GetTime().GetRealTime();
+
+	int32_t numGridBricks = static_cast<int32_t>( m_Width / 4 );
+	float3 gridMin = m_Position - 0.5f * m_Size;
+	float3 brickSize = m_Size / static_cast<float>( numGridBricks );
+
+	// one additional brick on each side because of the conservative voxelization
+	float3 relMin = ( regionMin - gridMin ) / brickSize;
+	float3 relMax = ( regionMax - gridMin ) / brickSize;
+	int3 minPos = { static_cast<int32_t>( floorf( relMin.x ) ) - 1, static_cast<int32_t>( floorf( relMin.y ) ) - 1, static_cast<int32_t>( floorf( relMin.z ) ) - 1 };
+	int3 maxPos = { static_cast<int32_t>( floorf( relMax.x ) ) + 1, static_cast<int32_t>( floorf( relMax.y ) ) + 1, static_cast<int32_t>( floorf( relMax.z ) ) + 1 };
+
+	// completely outside of the grid
+	if( maxPos.x < 0 || maxPos.y < 0 || maxPos.z < 0 || minPos.x >= numGridBricks || minPos.y >= numGridBricks || minPos.z >= numGridBricks )
+		return;
+
+	uint3 brickMin = { static_cast<uint32_t>( Max( minPos.x, 0 ) ), static_cast<uint32_t>( Max( minPos.y, 0 ) ), static_cast<uint32_t>( Max( minPos.z, 0 ) ) };
+	uint3 brickMax = { static_cast<uint32_t>( Min( maxPos.x, numGridBricks - 1 ) ), static_cast<uint32_t>( Min( maxPos.y, numGridBricks - 1 ) ), static_cast<uint32_t>( Min( maxPos.z, numGridBricks - 1 ) ) };
+
+	// the loaded voxelization is still valid where no object moved away from its stored transform, the rest gets revoxelized
+	std::vector<Node> newBricks;
+	if( !LoadStoredRegion( brickMin, brickMax, newBricks ) && !RevoxelizeRegion( brickMin, brickMax, newBricks ) ) {
+		RebuildDynamicTree( transformCache );
+		return;
+	}
+
+	// deepest level whose cells still cover the region, so only a few subtrees have to be rebuilt
+	uint32_t extent = Max( brickMax.x - brickMin.x, Max( brickMax.y - brickMin.y, brickMax.z - brickMin.z ) ) + 1;
+	uint32_t maxLevel = tree.MaxLevel;
+	uint32_t depth = 1;
+	while( depth < maxLevel - 2 && ( 1u << ( 2 * ( maxLevel - depth - 1 ) ) ) >= extent )
+		++depth;
+	uint32_t levels = maxLevel - depth;
+	uint32_t cellShift = 2 * levels;
+
+	uint32_t firstNode = static_cast<uint32_t>( tree.Nodes.size() );
+	uint32_t firstPointer = static_cast<uint32_t>( tree.Pointers.size() );
+
+	uint3 cellMin = brickMin >> cellShift;
+	uint3 cellMax = brickMax >> cellShift;
+	for( uint32_t z = cellMin.z; z <= cellMax.z; z++ ) {
+		for( uint32_t y = cellMin.y; y <= cellMax.y; y++ ) {
+			for( uint32_t x = cellMin.x; x <= cellMax.x; x++ ) {
+				uint3 cell = { x, y, z };
+				uint3 cellOrigin = cell << cellShift;
+				uint32_t cellCode = MortonEncode( cell );
+
+				std::vector<uint32_t> path = GetCellPath( tree, cellCode, depth );
+				std::vector<Node> bricks;
+				if( path[depth] != -1 )
+					CollectBricks( tree, path[depth], levels, 0, bricks );
+
+				// bricks inside the region are replaced by the new voxelization
+				bricks.erase( std::remove_if( bricks.begin(), bricks.end(), [&]( const Node& brick ) {
+					uint3 pos = MortonDecode( brick.Pointer ) + cellOrigin;
+					return pos.x >= brickMin.x && pos.y >= brickMin.y && pos.z >= brickMin.z
+						&& pos.x <= brickMax.x && pos.y <= brickMax.y && pos.z <= brickMax.z;
+				} ), bricks.end() );
+
+				for( const Node& brick : newBricks ) {
+					uint3 pos = MortonDecode( brick.Pointer );
+					if( ( pos >> cellShift ) != cell )
+						continue;
+					uint3 relPos = { pos.x - cellOrigin.x, pos.y - cellOrigin.y, pos.z - cellOrigin.z };
+					bricks.push_back( { brick.Data, MortonEncode( relPos ) } );
+				}
+
+				std::vector<Node> nodes;
+				std::vector<uint32_t> pointers;
+				decltype( tree.Approx ) approx;
+				uint32_t nodeSize = 0;
+				uint32_t pointerSize = 0;
+				uint32_t numBricks = static_cast<uint32_t>( bricks.size() );
+				if( numBricks > 0 ) {
+					nodes.resize( numBricks * ( levels + 1 ) + 1 );
+					pointers.resize( nodes.size() );
+					approx.resize( nodes.size() );
+					std::copy( bricks.begin(), bricks.end(), nodes.begin() );
+
+					DebugData debugData( levels + 1 );
+					BuildTree( nodes.data(), pointers.data(), numBricks, levels, nodeSize, pointerSize, debugData );
+					ComputeApproximation( nodes.data(), nodeSize, pointers.data(), approx.data() );
+				}
+
+				SpliceSubtree( tree, cellCode, depth, nodes.data(), nodeSize, pointers.data(), pointerSize, approx.data() );
+			}
+		}
+	}
+
+	if( tree.Nodes.size() > m_NumTreeNodes || tree.Pointers.size() > m_NumTreeNodes ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Tree buffers full, rebuilding tree" );
+		RebuildDynamicTree( transformCache );
+		return;
+	}
+
+	UploadDynamicTree( firstNode, firstPointer );
+
+	float endTime = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"Voxelizer", L"Updated region with " + std::to_wstring( newBricks.size() ) + L" bricks in "
+						   + std::to_wstring( ( endTime - startTime ) * 1000.f ) + L" ms, tree grew by " + std::to_wstring( tree.Nodes.size() - firstNode ) + L" nodes" );
+}
+
+bool Voxelizer::RevoxelizeRegion( const uint3& brickMin, const uint3& brickMax, std::vector<Node>& bricks ) {
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+
+	uint3 numBricks = { brickMax.x - brickMin.x + 1, brickMax.y - brickMin.y + 1, brickMax.z - brickMin.z + 1 };
+
+	VoxelizeData data;
+	data.gridSize = numBricks << 2;
+	data.numBits = { 4, 4, 4 };
+	data.voxelMode = m_VoxelMode;
+	data.numTexels = numBricks;
+	data.deltaGrid = { m_Size.x / static_cast<float>( m_Width ), m_Size.y / static_cast<float>( m_Height ), m_Size.z / static_cast<float>( m_Depth ) };
+	data.invDeltaGrid = { 1.0f / data.deltaGrid.x, 1.0f / data.deltaGrid.y, 1.0f / data.deltaGrid.z };
+	float3 regionMin = m_Position - 0.5f * m_Size + make_float3( brickMin << 2 ) * data.deltaGrid;
+	float3 regionSize = make_float3( data.gridSize ) * data.deltaGrid;
+	float3 regionMax = regionMin + regionSize;
+	data.minBoxPos = make_float3a( regionMin );
+	data.boxSize = make_float3a( regionSize );
+
+	m_VoxelizeDataBuffer.Update( data );
+
+	uint32_t clearVal[4] = { 0,0,0,0 };
+	renderBackend->ClearUAV( m_CountUAV, clearVal );
+
+	for( const DynamicObject& object : m_DynamicObjects ) {
+		// only objects overlapping the region contribute
+		if( object.BoxMax.x < regionMin.x || object.BoxMax.y < regionMin.y || object.BoxMax.z < regionMin.z
+			|| object.BoxMin.x > regionMax.x || object.BoxMin.y > regionMax.y || object.BoxMin.z > regionMax.z )
+			continue;
+
+		DispatchVoxelization( *object.Geometry, object.Transform, m_BrickUAV );
+	}
+
+	uint32_t numRegionBricks;
+	renderBackend->ReadBuffer( m_CountBuffer, sizeof( uint32_t ), &numRegionBricks, sizeof( uint32_t ), 0 );
+
+	if( numRegionBricks > m_NumRegionBricks ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Region too big for dynamic brick buffer" );
+		return false;
+	}
+
+	bricks.clear();
+	if( numRegionBricks == 0 )
+		return true;
+
+	Node* regionBricks;
+	renderBackend->CopyResource( m_BrickStagingBuffer, m_BrickBuffer );
+	renderBackend->MapBuffer( m_BrickStagingBuffer, reinterpret_cast<void**>( &regionBricks ), 0, MapType::Read );
+
+	// positions are relative to the region, convert them to the whole grid
+	bricks.resize( numRegionBricks );
+	for( uint32_t i = 0; i < numRegionBricks; i++ ) {
+		uint3 pos = MortonDecode( regionBricks[i].Pointer ) + brickMin;
+		bricks[i] = { regionBricks[i].Data, MortonEncode( pos ) };
+	}
+
+	renderBackend->UnmapBuffer( m_BrickStagingBuffer, 0 );
+
+	// bricks hit by several triangles get merged
+	uint32_t numUniqueBricks = numRegionBricks;
+	SortAndOptimize( bricks.data(), numUniqueBricks );
+	bricks.resize( numUniqueBricks );
+
+	return true;
+}
+
+bool Voxelizer::LoadStoredRegion( const uint3& brickMin, const uint3& brickMax, std::vector<Node>& bricks ) {
+	if( !m_PartReader )
+		return false;
+
+	uint32_t numPartBricks = m_Width / 4;
+	float3 gridMin = m_Position - 0.5f * m_Size;
+	float3 brickSize = m_Size / static_cast<float>( numPartBricks * m_ResolutionMultiplier );
+	float3 regionMin = gridMin + make_float3( brickMin ) * brickSize;
+	float3 regionMax = gridMin + ( make_float3( brickMax ) + 1.f ) * brickSize;
+
+	for( const DynamicObject& object : m_DynamicObjects ) {
+		bool overlaps = !( object.BoxMax.x < regionMin.x || object.BoxMax.y < regionMin.y || object.BoxMax.z < regionMin.z
+						   || object.BoxMin.x > regionMax.x || object.BoxMin.y > regionMax.y || object.BoxMin.z > regionMax.z );
+		bool overlapsStored = object.IsStored && !( object.StoredBoxMax.x < regionMin.x || object.StoredBoxMax.y < regionMin.y || object.StoredBoxMax.z < regionMin.z
+													|| object.StoredBoxMin.x > regionMax.x || object.StoredBoxMin.y > regionMax.y || object.StoredBoxMin.z > regionMax.z );
+		if( !overlaps && !overlapsStored )
+			continue;
+		// objects that aren't in the file or were moved would be missing or show up at the old place
+		if( !object.IsStored || memcmp( &object.Transform, &object.StoredTransform, sizeof( Matrix ) ) != 0 )
+			return false;
+	}
+
+	std::vector<uint32_t> parts = m_PartReader->FindParts( regionMin, regionMax );
+	std::vector<std::vector<Node>> voxelParts;
+	m_PartReader->LoadParts( parts, voxelParts );
+
+	// positions are relative to the part, only the ones inside the region are taken
+	bricks.clear();
+	for( uint32_t part : parts ) {
+		uint3 partPos = MortonDecode( part );
+		uint3 partOffset = { partPos.x * numPartBricks, partPos.y * numPartBricks, partPos.z * numPartBricks };
+		for( const Node& brick : voxelParts[part] ) {
+			uint3 pos = MortonDecode( brick.Pointer ) + partOffset;
+			if( pos.x < brickMin.x || pos.y < brickMin.y || pos.z < brickMin.z || pos.x > brickMax.x || pos.y > brickMax.y || pos.z > brickMax.z )
+				continue;
+			bricks.push_back( { brick.Data, MortonEncode( pos ) } );
+		}
+	}
+
+	Game::GetLogger().Log( L"Voxelizer", L"Region loaded from " + std::to_wstring( parts.size() ) + L" stored parts" );
+	return true;
+}
+
+void Voxelizer::UploadDynamicTree( uint32_t firstNode, uint32_t firstPointer ) {
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+	DynamicTree& tree = *m_DynamicTree;
+
+	uint32_t approxSize = sizeof( tree.Approx[0] );
+	uint32_t numNodes = static_cast<uint32_t>( tree.Nodes.size() );
+	uint32_t numPointers = static_cast<uint32_t>( tree.Pointers.size() );
+
+	// the root is changed in place, everything else was appended
+	Box box = { 0, 0, 0, sizeof( Node ), 1, 1 };
+	renderBackend->UpdateSubresource( m_TreeBuffer, 0, &box, &tree.Nodes[0], 0, 0 );
+	box.right = approxSize;
+	renderBackend->UpdateSubresource( m_ApproxBuffer, 0, &box, &tree.Approx[0], 0, 0 );
+
+	if( numNodes > firstNode ) {
+		box.left = firstNode * sizeof( Node );
+		box.right = numNodes * sizeof( Node );
+		renderBackend->UpdateSubresource( m_TreeBuffer, 0, &box, &tree.Nodes[firstNode], 0, 0 );
+		box.left = firstNode * approxSize;
+		box.right = numNodes * approxSize;
+		renderBackend->UpdateSubresource( m_ApproxBuffer, 0, &box, &tree.Approx[firstNode], 0, 0 );
+	}
+	UploadEmptyDistances( tree.Nodes.data(), 0, 1 );
+	UploadEmptyDistances( tree.Nodes.data(), firstNode, numNodes );
+	if( numPointers > firstPointer ) {
+		box.left = firstPointer * sizeof( uint32_t );
+		box.right = numPointers * sizeof( uint32_t );
+		renderBackend->UpdateSubresource( m_PointerBuffer, 0, &box, &tree.Pointers[firstPointer], 0, 0 );
+	}
+}
+
+void Voxelizer::UploadEmptyDistances( const Node* nodes, uint32_t firstNode, uint32_t numNodes ) {
+#ifdef EMPTY_DISTANCE
+	if( numNodes <= firstNode )
+		return;
+
+	std::vector<uint4> distances( numNodes - firstNode );
+	ComputeEmptyDistances( nodes + firstNode, numNodes - firstNode, distances.data() );
+
+	Box box = { 0, 0, 0, 0, 1, 1 };
+	box.left = firstNode * sizeof( uint4 );
+	box.right = numNodes * sizeof( uint4 );
+	Game::GetRenderBackend().UpdateSubresource( m_EmptyDistanceBuffer, 0, &box, distances.data(), 0, 0 );
+#endif // EMPTY_DISTANCE
+}
+
+void Voxelizer::RebuildDynamicTree( TransformCache& transformCache ) {
+	std::vector<std::pair<const Geometry*, Matrix>> elements;
+	for( const DynamicObject& object : m_DynamicObjects )
+		elements.push_back( { object.Geometry, object.Object->GetTransform().GetWorldTransMat() } );
+
+	// the loaded tree would not contain the moved objects and the stored one should stay the original scene
+	VoxelizeElements( elements, transformCache, false );
+}
+
 void Voxelizer::TestRender( Camera & camera ) {
 	RenderBackend* renderBackend = &Game::GetRenderBackend();
 
@@ -442,6 +1066,15 @@ void Voxelizer::BindSRVs() {
 	Game::GetRenderer().SetLight( GetLightDir(), { 1.f,1.f,1.f,1.f } );
 
 	Game::GetRenderBackend().SetSRVsPS( 2, { m_TreeSRV, m_PointerSRV, m_ApproxSRV } );
+#ifdef EMPTY_DISTANCE
+	Game::GetRenderBackend().SetSRVsPS( 6, { m_EmptyDistanceSRV } );
+#endif // EMPTY_DISTANCE
+#ifdef BEAM_TRAVERSE
+	Game::GetRenderBackend().SetSRVsPS( 7, { m_BeamSRV } );
+#endif // BEAM_TRAVERSE
+#ifdef SAMPLE_TABLE
+	Game::GetRenderBackend().SetSRVsPS( 8, { m_SampleTableSRV } );
+#endif // SAMPLE_TABLE
 
 	m_UseShadowTexOne = !m_UseShadowTexOne;
 
@@ -518,6 +1151,77 @@ void Voxelizer::BindSRVs() {
 	lastFrameMat = Game::GetRenderer().GetActiveCamera()->GetViewProjMat();
 }
 
+void Voxelizer::BuildBeams( ShaderResourceView* depthSRV, ShaderResourceView* normalSRV ) {
+#ifdef BEAM_TRAVERSE
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+
+	uint2 screenSize = { Game::GetWindow().GetWidth(), Game::GetWindow().GetHeight() };
+	uint32_t numTilesX = ( screenSize.x + BEAM_TILE_SIZE - 1 ) / BEAM_TILE_SIZE;
+	uint32_t numTilesY = ( screenSize.y + BEAM_TILE_SIZE - 1 ) / BEAM_TILE_SIZE;
+
+	// grows with the window
+	if( numTilesX * numTilesY > m_NumBeamTiles ) {
+		SRelease( m_BeamSRV );
+		SRelease( m_BeamUAV );
+		SRelease( m_BeamBuffer );
+		m_NumBeamTiles = 0;
+
+		BufferDesc bDesc;
+		bDesc.BindFlags = BindFlag::ShaderResource | BindFlag::UnorderedAccess;
+		bDesc.MiscFlags = ResourceMiscFlag::BufferStructured;
+		bDesc.ByteWidth = numTilesX * numTilesY * BEAM_SIZE * 3 * sizeof( uint32_t );
+		bDesc.StructureByteStride = 3 * sizeof( uint32_t );
+
+		m_BeamBuffer = renderBackend->CreateBuffer( nullptr, bDesc );
+		if( !m_BeamBuffer )
+			return;
+
+		UAVDesc uavDesc;
+		uavDesc.Format = Format::Unknown;
+		uavDesc.ViewDimension = UAVDimension::Buffer;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = numTilesX * numTilesY * BEAM_SIZE;
+		uavDesc.Buffer.Flags = UAVBufferFlag::None;
+
+		m_BeamUAV = renderBackend->CreateUAV( m_BeamBuffer, &uavDesc );
+		if( !m_BeamUAV )
+			return;
+
+		SRVDesc srvDesc;
+		srvDesc.Format = Format::Unknown;
+		srvDesc.ViewDimension = SRVDimension::Buffer;
+		srvDesc.Buffer.ElementOffset = 0;
+		srvDesc.Buffer.NumElements = numTilesX * numTilesY * BEAM_SIZE;
+
+		m_BeamSRV = renderBackend->CreateSRV( m_BeamBuffer, &srvDesc );
+		if( !m_BeamSRV )
+			return;
+		m_NumBeamTiles = numTilesX * numTilesY;
+	}
+
+	BeamData beamData;
+	beamData.InvViewProjMatrix = Game::GetRenderer().GetActiveCamera()->GetInvViewProjMat();
+	beamData.InvLightDir = Normalize( GetLightDir() );
+	beamData.JitterRad = tan( Deg2Rad( m_LightAngleSize ) );
+	beamData.ScreenSize = screenSize;
+	beamData.NumTilesX = numTilesX;
+	m_BeamDataBuffer.Update( beamData );
+
+	m_BeamShader->SetShader();
+	m_BeamDataBuffer.Bind( ShaderFlag::ComputeShader, 0 );
+	m_GridDataBuffer.Bind( ShaderFlag::ComputeShader, 4 );
+
+	renderBackend->SetSRVsPS( 7, { nullptr } );
+	renderBackend->SetUAVCS( 0, { m_BeamUAV }, { 0 } );
+	renderBackend->SetSRVsCS( 0, { depthSRV, normalSRV, m_TreeSRV, m_PointerSRV } );
+
+	renderBackend->Dispatch( numTilesX, numTilesY, 1 );
+
+	renderBackend->SetUAVCS( 0, { nullptr }, { 0 } );
+	renderBackend->SetSRVsCS( 0, { nullptr, nullptr, nullptr, nullptr } );
+#endif // BEAM_TRAVERSE
+}
+
 void Voxelizer::SetLightSizeAngle( float angle ) {
 	m_LightAngleSize = angle;
 }
@@ -562,6 +1266,13 @@ Texture * Voxelizer::GetCurrentShadowTex() {
 		return m_ShadowTexture2;
 }
 
+Texture * Voxelizer::GetLastShadowTex() {
+	if( m_UseShadowTexOne )
+		return m_ShadowTexture2;
+	else
+		return m_ShadowTexture1;
+}
+
 bool Voxelizer::CreateBuffers() {
 	RenderBackend* renderBackend = &Game::GetRenderBackend();
 
@@ -659,6 +1370,37 @@ bool Voxelizer::CreateBuffers() {
 	if( !m_ApproxSRV )
 		return false;
 
+#ifdef EMPTY_DISTANCE
+	bDesc.ByteWidth = sizeof( uint4 ) * m_NumTreeNodes;
+
+	m_EmptyDistanceBuffer = renderBackend->CreateBuffer( nullptr, bDesc );
+	if( !m_EmptyDistanceBuffer )
+		return false;
+
+	srvDesc.Format = Format::R32G32B32A32_UInt;
+
+	m_EmptyDistanceSRV = renderBackend->CreateSRV( m_EmptyDistanceBuffer, &srvDesc );
+	if( !m_EmptyDistanceSRV )
+		return false;
+#endif // EMPTY_DISTANCE
+
+#ifdef SAMPLE_TABLE
+	std::vector<float2> sampleTable( SAMPLE_TABLE_SETS * SAMPLE_TABLE_SIZE );
+	ComputeSampleTable( sampleTable.data() );
+	bDesc.ByteWidth = static_cast<UINT>( sizeof( float2 ) * sampleTable.size() );
+
+	m_SampleTableBuffer = renderBackend->CreateBuffer( sampleTable.data(), bDesc );
+	if( !m_SampleTableBuffer )
+		return false;
+
+	srvDesc.Format = Format::R32G32_Float;
+	srvDesc.Buffer.NumElements = static_cast<UINT>( sampleTable.size() );
+
+	m_SampleTableSRV = renderBackend->CreateSRV( m_SampleTableBuffer, &srvDesc );
+	if( !m_SampleTableSRV )
+		return false;
+#endif // SAMPLE_TABLE
+
 	TextureDesc tDesc;
 	tDesc.UniqueName = L"ShadowTexture1";
 	tDesc.TextureType = TextureType::Texture2D;
@@ -688,6 +1430,9 @@ bool Voxelizer::CreateRenderPass() {
 	m_VoxelShader = Shader::Get( L"csVoxel" );
 	m_SparselizeShader = Shader::Get( L"csSparselize" );
 	m_MipMapShader = Shader::Get( L"csMipMap" );
+#ifdef BEAM_TRAVERSE
+	m_BeamShader = Shader::Get( L"csBeam" );
+#endif // BEAM_TRAVERSE
 
 	RenderPassInit rInit;
 	rInit.Name = L"VoxelLinkedFragmentPass";
@@ -737,26 +1482,7 @@ bool Voxelizer::CreateCamera() {
 	return true;
 }
 
-void Voxelizer::StitchTree( const std::vector<std::pair<std::vector<Node>, std::vector<uint32_t>>>& treeParts ) {
-	// Construct root node
-	Node rootNode;
-	rootNode.Data.x = 0;
-	rootNode.Data.y = 0;
-	rootNode.Pointer = 1;
-
-	uint32_t pointerIdx = 1;
-	uint32_t nodeIdx = 1;
-
-	for( size_t i = 0; i < treeParts.size(); ++i ) {
-		if( !treeParts[i].first.empty() ) {
-			if( i < 32 )
-				rootNode.Data.x |= 1 << i;
-			else
-				rootNode.Data.y |= 1 << ( i - 32 );
-			++pointerIdx;
-		}
-	}
-
+void Voxelizer::StitchTree( const std::vector<PartTree>& treeParts ) {
 	ID3D11DeviceContext *context = &Game::GetContext();
 	ID3D11Device* device = &Game::GetDevice();
 
@@ -788,28 +1514,14 @@ void Voxelizer::StitchTree( const std::vector<std::pair<std::vector<Node>, std::
 	renderBackend->MapBuffer( tempNodeBuffer, reinterpret_cast<void**>( &nodes ), 0, MapType::ReadWrite );
 	renderBackend->MapBuffer( tempPointerBuffer, reinterpret_cast<void**>( &pointer ), 0, MapType::ReadWrite );
 
-	nodes[0] = rootNode;
-	pointer[0] = 0;
-	uint32_t rootIdx = 1;
-	for( size_t i = 0; i < treeParts.size(); ++i ) {
-		if( !treeParts[i].first.empty() ) {
-			pointer[rootIdx++] = nodeIdx;
-			uint32_t oldNodeIdx = nodeIdx;
-			for( const Node& node : treeParts[i].first ) {
-				nodes[nodeIdx] = node;
-				nodes[nodeIdx].Pointer += pointerIdx;
-				++nodeIdx;
-			}
-			for( uint32_t ptr : treeParts[i].second ) {
-				pointer[pointerIdx++] = ptr + oldNodeIdx;
-			}
-		}
-	}
+	uint32_t nodeIdx, pointerIdx;
+	StitchTreeParts( treeParts, nodes, pointer, nodeIdx, pointerIdx );
 
 	if( Game::GetConfig().GetBool( L"StoreTree", false ) ) {
 		std::wstring path = Game::GetConfig().GetString( L"TreeStorePath", L"TestTree.tr" );
-		Game::GetFileLoader().StoreTreeData( m_Width * m_ResolutionMultiplier, m_Position, m_Size, nodes, nodeIdx, pointer, pointerIdx, path );
+		Game::GetFileLoader().StoreTreeData( m_Width * m_ResolutionMultiplier, m_Position, m_Size, nodes, nodeIdx, pointer, pointerIdx, path, Game::GetConfig().GetBool( L"CompressTree", false ) );
 	}
+	UploadEmptyDistances( nodes, 0, nodeIdx );
 
 	renderBackend->UnmapBuffer( tempNodeBuffer, 0 );
 	renderBackend->UnmapBuffer( tempPointerBuffer, 0 );
@@ -826,6 +1538,7 @@ void Voxelizer::UpdateVoxelizeData( uint32_t voxelPart, const float3& partSize )
 
 	data.gridSize = { m_Width, m_Height, m_Depth };
 	data.numBits = { 4, 4, 4 };
+	data.voxelMode = m_VoxelMode;
 	data.numTexels = { m_Width / data.numBits.x, m_Height / data.numBits.y, m_Depth / data.numBits.z };
 	data.deltaGrid = { partSize.x / static_cast<float>( m_Width ), partSize.y / static_cast<float>( m_Height ), partSize.z / static_cast<float>( m_Depth ) };
 	data.invDeltaGrid = { 1.0f / data.deltaGrid.x, 1.0f / data.deltaGrid.y, 1.0f / data.deltaGrid.z };
@@ -835,7 +1548,245 @@ void Voxelizer::UpdateVoxelizeData( uint32_t voxelPart, const float3& partSize )
 	m_VoxelizeDataBuffer.Update( data );
 }
 
+uint32_t Voxelizer::VoxelizePartOnCpu( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes, TransformCache& transformCache,
+									   uint32_t voxelPart, const float3& partSize, std::vector<Node>& bricks ) {
+	CpuVoxelizeData data;
+	data.GridSize = m_Width;
+	data.VoxelMode = m_VoxelMode;
+	data.MinBoxPos = make_float3( MortonDecode( voxelPart ) ) * partSize + m_Position - 0.5f * m_Size;
+	data.BoxSize = partSize;
+	float3 partMax = data.MinBoxPos + partSize;
+
+	bricks.clear();
+	for( size_t i = 0; i < elements.size(); i++ ) {
+		const float3& boxMin = boxes[i].first;
+		const float3& boxMax = boxes[i].second;
+		if( boxMax.x < data.MinBoxPos.x || boxMax.y < data.MinBoxPos.y || boxMax.z < data.MinBoxPos.z || boxMin.x > partMax.x || boxMin.y > partMax.y || boxMin.z > partMax.z )
+			continue;
+		const std::vector<float4a>& positions = transformCache.GetWorldPositions( *elements[i].first, elements[i].second );
+		const std::vector<uint3>& indices = elements[i].first->GetTriangleIndices();
+		VoxelizeTriangles( data, positions.data(), reinterpret_cast<const uint32_t*>( indices.data() ), static_cast<uint32_t>( indices.size() ), bricks );
+	}
+	return static_cast<uint32_t>( bricks.size() );
+}
+
+void Voxelizer::ComputePartBounds( uint32_t voxelPart, const float3& partSize, const Node* bricks, uint32_t numBricks, float3& boxMin, float3& boxMax ) {
+	uint3 brickMin = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+	uint3 brickMax = { 0, 0, 0 };
+	for( uint32_t i = 0; i < numBricks; i++ ) {
+		uint3 pos = MortonDecode( bricks[i].Pointer );
+		brickMin = { Min( brickMin.x, pos.x ), Min( brickMin.y, pos.y ), Min( brickMin.z, pos.z ) };
+		brickMax = { Max( brickMax.x, pos.x ), Max( brickMax.y, pos.y ), Max( brickMax.z, pos.z ) };
+	}
+	if( numBricks == 0 ) {
+		boxMin = boxMax = { 0.f, 0.f, 0.f };
+		return;
+	}
+
+	// bricks are 4 voxels wide
+	float3 brickSize = partSize / static_cast<float>( m_Width / 4 );
+	float3 partMin = make_float3( MortonDecode( voxelPart ) ) * partSize + m_Position - 0.5f * m_Size;
+	boxMin = partMin + make_float3( brickMin ) * brickSize;
+	boxMax = partMin + make_float3( brickMax + 1 ) * brickSize;
+}
+
+void Voxelizer::DispatchVoxelization( const Geometry& geometry, const Matrix& transform, UnorderedAccessView* brickUAV ) {
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+
+	m_VoxelShader->SetShader();
+	m_VoxelizeDataBuffer.Bind( ShaderFlag::ComputeShader, 0 );
+
+	VoxelObjectData objData;
+	objData.numTriangles = geometry.GetTriangleCount();
+	objData.worldMat = transform;
+	m_ObjectDataBuffer.Update( objData );
+	m_ObjectDataBuffer.Bind( ShaderFlag::ComputeShader, 1 );
+
+	renderBackend->SetUAVCS( 1, { brickUAV, m_CountUAV }, { 0 } );
+	renderBackend->SetSRVsCS( 0, { geometry.GetPositionSRV(), geometry.GetIndexSRV() } );
+
+	uint32_t numTriangles = geometry.GetTriangleCount();
+	uint32_t groupSize = 128;
+	uint32_t numGroups = numTriangles / groupSize;
+	if( numTriangles & ( groupSize - 1 ) )
+		numGroups++;
+
+	renderBackend->Dispatch( numGroups, 1, 1 );
+	renderBackend->SetUAVCS( 1, { nullptr, nullptr }, { 0 } );
+}
+
+uint32_t Voxelizer::VoxelizeRegion( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes,
+									const float3& regionMin, const uint3& numBricks, const float3& deltaGrid ) {
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+
+	VoxelizeData data;
+	data.gridSize = numBricks << 2;
+	data.numBits = { 4, 4, 4 };
+	data.voxelMode = m_VoxelMode;
+	data.numTexels = numBricks;
+	data.deltaGrid = make_float3a( deltaGrid );
+	data.invDeltaGrid = { 1.0f / deltaGrid.x, 1.0f / deltaGrid.y, 1.0f / deltaGrid.z };
+	float3 regionSize = make_float3( data.gridSize ) * deltaGrid;
+	float3 regionMax = regionMin + regionSize;
+	data.minBoxPos = make_float3a( regionMin );
+	data.boxSize = make_float3a( regionSize );
+
+	m_VoxelizeDataBuffer.Update( data );
+
+	uint32_t clearVal[4] = { 0,0,0,0 };
+	renderBackend->ClearUAV( m_CountUAV, clearVal );
+
+	for( size_t i = 0; i < elements.size(); i++ ) {
+		const float3& boxMin = boxes[i].first;
+		const float3& boxMax = boxes[i].second;
+		if( boxMax.x < regionMin.x || boxMax.y < regionMin.y || boxMax.z < regionMin.z
+			|| boxMin.x > regionMax.x || boxMin.y > regionMax.y || boxMin.z > regionMax.z )
+			continue;
+
+		DispatchVoxelization( *elements[i].first, elements[i].second, m_TreeUAV );
+	}
+
+	uint32_t count;
+	renderBackend->ReadBuffer( m_CountBuffer, sizeof( uint32_t ), &count, sizeof( uint32_t ), 0 );
+	return count;
+}
+
+void Voxelizer::SubdividePart( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes, uint32_t voxelPart, const float3& partSize,
+							   uint32_t maxLevel, uint32_t brickBudget, Buffer* stagingBuffer, PartTree& part, DebugData& debugData ) {
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+	float start = Game::GetTime().GetRealTime();
+
+	float3 partMin = make_float3( MortonDecode( voxelPart ) ) * partSize + m_Position - 0.5f * m_Size;
+	float3 deltaGrid = { partSize.x / static_cast<float>( m_Width ), partSize.y / static_cast<float>( m_Height ), partSize.z / static_cast<float>( m_Depth ) };
+	uint32_t gridBricks = m_Width / 4;
+
+	struct SubPart {
+		PartTree* Tree;
+		uint3 Origin;
+		uint32_t Depth;
+	};
+
+	// the sub parts are cells of the part tree, so their trees can be stitched together afterwards
+	std::vector<SubPart> stack;
+	stack.push_back( { &part, { 0, 0, 0 }, 0 } );
+
+	std::mutex debugMutex;
+	concurrency::task_group tasks;
+	uint32_t numLeafParts = 0;
+	uint32_t maxBricks = 0;
+
+	while( !stack.empty() ) {
+		SubPart subPart = stack.back();
+		stack.pop_back();
+
+		uint32_t levels = maxLevel - subPart.Depth;
+		uint32_t numBricks = 0;
+		// the part itself was already voxelized
+		if( subPart.Depth == 0 ) {
+			numBricks = brickBudget + 1;
+		}
+		else {
+			uint32_t cellBricks = 1 << ( 2 * levels );
+			uint3 regionBricks = { Min( cellBricks, gridBricks - subPart.Origin.x ), Min( cellBricks, gridBricks - subPart.Origin.y ), Min( cellBricks, gridBricks - subPart.Origin.z ) };
+			numBricks = VoxelizeRegion( elements, boxes, partMin + make_float3( subPart.Origin << 2 ) * deltaGrid, regionBricks, deltaGrid );
+		}
+
+		if( numBricks == 0 )
+			continue;
+
+		// bricks beyond the tree buffer were not written by the voxelizer, so those sub parts always get split
+		if( ( numBricks > brickBudget || numBricks > m_NumTreeNodes ) && levels > 2 ) {
+			subPart.Tree->Children.resize( 64 );
+			uint32_t childShift = 2 * ( levels - 1 );
+			for( uint32_t i = 0; i < 64; i++ ) {
+				uint3 origin = subPart.Origin + ( MortonDecode( i ) << childShift );
+				// cells outside of the grid stay empty
+				if( origin.x >= gridBricks || origin.y >= gridBricks || origin.z >= gridBricks )
+					continue;
+				stack.push_back( { &subPart.Tree->Children[i], origin, subPart.Depth + 1 } );
+			}
+			continue;
+		}
+
+		if( numBricks > m_NumTreeNodes )
+			Game::GetLogger().FatalError( L"Not enough space for the voxelization of sub part" );
+
+		// the smallest sub parts may still exceed the budget, their trees are built on the cpu with enough space for every level
+
+		// only the voxelized bricks have to be read back
+		Node* bricks = nullptr;
+		renderBackend->CopyBufferRegion( stagingBuffer, m_TreeBuffer, 0, numBricks * sizeof( Node ) );
+		renderBackend->MapBuffer( stagingBuffer, reinterpret_cast<void**>( &bricks ), 0, MapType::Read );
+
+		PartTree* tree = subPart.Tree;
+		tree->Nodes.resize( numBricks * ( levels + 1 ) + 1 );
+		tree->Pointers.resize( tree->Nodes.size() );
+		std::copy( bricks, bricks + numBricks, tree->Nodes.begin() );
+
+		renderBackend->UnmapBuffer( stagingBuffer, 0 );
+
+		++numLeafParts;
+		maxBricks = Max( maxBricks, numBricks );
+
+		// the trees get built on worker threads while the gpu voxelizes the next sub part
+		uint32_t depth = subPart.Depth;
+		tasks.run( [tree, numBricks, levels, depth, &debugData, &debugMutex]() {
+			uint32_t numTreeBricks = numBricks;
+			uint32_t nodeSize, pointerSize;
+			DebugData subDebugData( levels + 1 );
+			BuildTree( tree->Nodes.data(), tree->Pointers.data(), numTreeBricks, levels, nodeSize, pointerSize, subDebugData );
+			tree->Nodes.resize( nodeSize );
+			tree->Pointers.resize( pointerSize );
+
+			std::lock_guard<std::mutex> lock( debugMutex );
+			AddDebugData( debugData, subDebugData, depth );
+		} );
+	}
+
+	tasks.wait();
+	MergePartTree( part );
+
+	float end = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"Voxelizer", L"Subdivided part " + std::to_wstring( voxelPart ) + L" into " + std::to_wstring( numLeafParts ) + L" sub parts with at most "
+						   + std::to_wstring( maxBricks ) + L" bricks in " + std::to_wstring( ( end - start ) * 1000.f ) + L" ms" );
+}
+
+void Voxelizer::PrefetchTree( const std::wstring & fileName ) {
+	delete m_PreparedTree;
+	m_PreparedTree = new PreparedTree();
+	m_PreparedTree->FileName = fileName;
+
+	PreparedTree* prepared = m_PreparedTree;
+	prepared->Tasks.run( [prepared]() {
+		float start = Game::GetTime().GetRealTime();
+		if( !Game::GetFileLoader().MapTreeData( prepared->FileName, prepared->File, prepared->Tree ) )
+			return;
+		// built for every tree like after a voxelization, SOFTSHADOW is only defined for the shaders
+		prepared->Approx.resize( prepared->Tree.Nodes.Size );
+		ComputeApproximation( prepared->Tree.Nodes.Data, static_cast<uint32_t>( prepared->Tree.Nodes.Size ), prepared->Tree.Pointers.Data, prepared->Approx.data() );
+		prepared->LoadTime = Game::GetTime().GetRealTime() - start;
+		prepared->IsLoaded = true;
+	} );
+}
+
 bool Voxelizer::LoadTree( const std::wstring & fileName ) {
+	if( !m_PreparedTree || m_PreparedTree->FileName != fileName )
+		PrefetchTree( fileName );
+	m_PreparedTree->Tasks.wait();
+
+	std::unique_ptr<PreparedTree> prepared( m_PreparedTree );
+	m_PreparedTree = nullptr;
+	if( !prepared->IsLoaded )
+		return false;
+	const TreeView& tree = prepared->Tree;
+
+	uint32_t numNodes = static_cast<uint32_t>( tree.Nodes.Size );
+	uint32_t numPointers = static_cast<uint32_t>( tree.Pointers.Size );
+	if( numNodes > m_NumTreeNodes || numPointers > m_NumTreeNodes ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Voxel file with " + std::to_wstring( numNodes ) + L" nodes doesn't fit into the tree buffer. Revoxelizing." );
+		return false;
+	}
+
 	Node* nodePtr = nullptr;
 	uint32_t* pointerPtr = nullptr;
 #ifdef ANISOTROPIC
@@ -872,12 +1823,13 @@ bool Voxelizer::LoadTree( const std::wstring & fileName ) {
 	renderBackend->MapBuffer( tempPointerBuffer, reinterpret_cast<void**>( &pointerPtr ), 0, MapType::Write );
 	renderBackend->MapBuffer( tempApproxBuffer, reinterpret_cast<void**>( &approx ), 0, MapType::Write );
 
-	uint32_t numNodes = 0, numPointers = 0;
-	if( !Game::GetFileLoader().LoadTreeData( fileName, nodePtr, numNodes, pointerPtr, numPointers, m_Width, m_Position, m_Size ) )
-		return false;
-#ifdef SOFTSHADOW
-	ComputeApproximation( nodePtr, numNodes, pointerPtr, approx );
-#endif // SOFTSHADOW
+	memcpy( nodePtr, tree.Nodes.Data, numNodes * sizeof( Node ) );
+	memcpy( pointerPtr, tree.Pointers.Data, numPointers * sizeof( uint32_t ) );
+	UploadEmptyDistances( tree.Nodes.Data, 0, numNodes );
+	m_Width = tree.Resolution;
+	m_Position = tree.Position;
+	m_Size = tree.Size;
+	memcpy( approx, prepared->Approx.data(), numNodes * sizeof( approx[0] ) );
 
 	m_Height = m_Depth = m_Width;
 
@@ -889,18 +1841,128 @@ bool Voxelizer::LoadTree( const std::wstring & fileName ) {
 
 	renderBackend->CopyResource( m_TreeBuffer, tempNodeBuffer );
 	renderBackend->CopyResource( m_PointerBuffer, tempPointerBuffer );
+	renderBackend->CopyResource( m_ApproxBuffer, tempApproxBuffer );
 
 	tempNodeBuffer->Release();
 	tempPointerBuffer->Release();
 	tempApproxBuffer->Release();
 
 	Game::GetLogger().Log( L"Voxelizer", L"Voxel file loaded with " + std::to_wstring( numNodes ) + L" nodes and " + std::to_wstring( numPointers ) + L" pointers loaded." );
+	Game::GetLogger().Log( L"Voxelizer", L"Loading and preparing the tree took " + std::to_wstring( prepared->LoadTime * 1000.f ) + L" ms" );
 
 	UpdateGridData();
 	
 	return true;
 }
 
+void Voxelizer::RecordTraversalVectors( const std::wstring & fileName, const std::wstring & treeFile ) {
+	TraversalVectors vectors;
+	vectors.TreeFile = treeFile;
+#ifdef SHORT_STACK_TRAVERSE
+	vectors.ShortStack = true;
+#endif // SHORT_STACK_TRAVERSE
+#ifdef EMPTY_DISTANCE
+	vectors.EmptyDistance = true;
+#endif // EMPTY_DISTANCE
+	uint32_t numRays = static_cast<uint32_t>( Max( Game::GetConfig().GetInt( L"TraversalVectorRays", 2048 ), 0 ) );
+	if( numRays == 0 )
+		return;
+	CreateTraversalRays( numRays, 1, vectors.Vectors );
+
+	ID3D11Device* device = &Game::GetDevice();
+	IDXGIDevice* dxgiDevice = nullptr;
+	IDXGIAdapter* adapter = nullptr;
+	DXGI_ADAPTER_DESC adapterDesc;
+	if( SUCCEEDED( device->QueryInterface( __uuidof( IDXGIDevice ), reinterpret_cast<void**>( &dxgiDevice ) ) ) && SUCCEEDED( dxgiDevice->GetAdapter( &adapter ) )
+		&& SUCCEEDED( adapter->GetDesc( &adapterDesc ) ) )
+		vectors.Source = adapterDesc.Description;
+	SRelease( adapter );
+	SRelease( dxgiDevice );
+
+	std::vector<float3> rays( 2 * numRays );
+	for( uint32_t i = 0; i < numRays; i++ ) {
+		rays[2 * i] = vectors.Vectors[i].Pos;
+		rays[2 * i + 1] = vectors.Vectors[i].Dir;
+	}
+
+	BufferDesc desc;
+	desc.BindFlags = BindFlag::ShaderResource;
+	desc.MiscFlags = ResourceMiscFlag::BufferStructured;
+	desc.ByteWidth = numRays * 2 * sizeof( float3 );
+	desc.StructureByteStride = 2 * sizeof( float3 );
+	desc.Usage = Usage::Immutable;
+	D3D11_SUBRESOURCE_DATA rayData = {};
+	rayData.pSysMem = rays.data();
+
+	Buffer* rayBuffer = nullptr, *resultBuffer = nullptr;
+	HRESULT hr = device->CreateBuffer( reinterpret_cast<D3D11_BUFFER_DESC*>( &desc ), &rayData, &rayBuffer );
+	desc.BindFlags = BindFlag::UnorderedAccess;
+	desc.ByteWidth = numRays * sizeof( uint2 );
+	desc.StructureByteStride = sizeof( uint2 );
+	desc.Usage = Usage::Default;
+	if( SUCCEEDED( hr ) )
+		hr = device->CreateBuffer( reinterpret_cast<D3D11_BUFFER_DESC*>( &desc ), nullptr, &resultBuffer );
+	if( FAILED( hr ) ) {
+		Game::GetLogger().Log( L"Voxelizer", L"Creating the buffers for the traversal vectors failed" );
+		SRelease( rayBuffer );
+		return;
+	}
+
+	RenderBackend* renderBackend = &Game::GetRenderBackend();
+	SRVDesc srvDesc;
+	srvDesc.Format = Format::Unknown;
+	srvDesc.ViewDimension = SRVDimension::Buffer;
+	srvDesc.Buffer.ElementOffset = 0;
+	srvDesc.Buffer.NumElements = numRays;
+	ShaderResourceView* raySRV = renderBackend->CreateSRV( rayBuffer, &srvDesc );
+
+	UAVDesc uavDesc;
+	uavDesc.Format = Format::Unknown;
+	uavDesc.ViewDimension = UAVDimension::Buffer;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = numRays;
+	uavDesc.Buffer.Flags = UAVBufferFlag::None;
+	UnorderedAccessView* resultUAV = renderBackend->CreateUAV( resultBuffer, &uavDesc );
+
+	Shader* shader = Shader::Get( L"csTraversalVectors" );
+	if( raySRV && resultUAV && shader ) {
+		UpdateGridData();
+		shader->SetShader();
+		m_GridDataBuffer.Bind( ShaderFlag::ComputeShader, 4 );
+		renderBackend->SetUAVCS( 0, { resultUAV }, { 0 } );
+		renderBackend->SetSRVsCS( 0, { raySRV, nullptr, m_TreeSRV, m_PointerSRV } );
+#ifdef EMPTY_DISTANCE
+		renderBackend->SetSRVsCS( 6, { m_EmptyDistanceSRV } );
+#endif // EMPTY_DISTANCE
+
+		renderBackend->Dispatch( ( numRays + 63 ) / 64, 1, 1 );
+
+		renderBackend->SetUAVCS( 0, { nullptr }, { 0 } );
+		renderBackend->SetSRVsCS( 0, { nullptr, nullptr, nullptr, nullptr } );
+#ifdef EMPTY_DISTANCE
+		renderBackend->SetSRVsCS( 6, { nullptr } );
+#endif // EMPTY_DISTANCE
+
+		std::vector<uint2> results( numRays );
+		renderBackend->ReadBuffer( resultBuffer, desc.ByteWidth, results.data(), desc.ByteWidth, 0 );
+		uint32_t numHits = 0;
+		for( uint32_t i = 0; i < numRays; i++ ) {
+			vectors.Vectors[i].Hit = results[i].x != 0;
+			vectors.Vectors[i].Steps = results[i].y;
+			numHits += results[i].x != 0;
+		}
+		if( StoreTraversalVectors( fileName, vectors ) )
+			Game::GetLogger().Log( L"Voxelizer", L"Stored " + std::to_wstring( numRays ) + L" traversal vectors with " + std::to_wstring( numHits ) + L" hits in \"" + fileName + L"\"" );
+	}
+	else
+		Game::GetLogger().Log( L"Voxelizer", L"Recording the traversal vectors failed" );
+
+	SRelease( raySRV );
+	SRelease( resultUAV );
+	SRelease( rayBuffer );
+	SRelease( resultBuffer );
+}
+
 void Voxelizer::StoreDebugData( const DebugData & debugData ) {
 	nlohmann::json j;
 
@@ -932,6 +1994,7 @@ void Voxelizer::StoreDebugData( const DebugData & debugData ) {
 	j["DoubleNodeRemovelTime"] = debugData.DoubleNodeRemovelTime;
 
 	j["VoxelResolution"] = m_Width * m_ResolutionMultiplier;
+	j["VoxelizationMode"] = ws2s( GetVoxelModeName( m_VoxelMode ) );
 	std::string comparison;
 	switch( Game::GetConfig().GetInt( L"SimilarityTest" ) ) {
 		case 0:
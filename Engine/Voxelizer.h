@@ -4,6 +4,7 @@
 
 #include "Math.h"
 #include "ConstantBuffer.h"
+#include "TreeNode.h"
 
 class Geometry;
 class RenderPass;
@@ -12,7 +13,11 @@ class Texture;
 class Shader;
 class Slider;
 class GameObject;
+class TransformCache;
 struct DebugData;
+struct DynamicTree;
+struct PreparedTree;
+class VoxelPartReader;
 
 struct VoxelGrid {
 
@@ -21,6 +26,7 @@ struct VoxelGrid {
 __declspec( align( 16 ) )
 struct VoxelizeData {
 	uint3 gridSize;
+	uint32_t voxelMode;
 	__declspec( align( 16 ) )
 		uint3 numTexels;
 	float3a deltaGrid;
@@ -70,9 +76,27 @@ struct FilterData {
 	float DepthThresh;
 };
 
-struct Node {
-	uint2 Data;
-	uint32_t Pointer;
+__declspec( align( 16 ) )
+struct BeamData {
+	Matrix InvViewProjMatrix;
+	float3 InvLightDir;
+	float JitterRad;
+	uint2 ScreenSize;
+	uint32_t NumTilesX;
+};
+
+struct DynamicObject {
+	GameObject* Object;
+	const Geometry* Geometry;
+	Matrix Transform;
+	float3 BoxMin;
+	float3 BoxMax;
+	bool IsDirty;
+	// placement inside the loaded voxelization file
+	bool IsStored;
+	Matrix StoredTransform;
+	float3 StoredBoxMin;
+	float3 StoredBoxMax;
 };
 
 class Voxelizer {
@@ -81,9 +105,15 @@ public:
 	virtual ~Voxelizer();
 
 	void VoxelizeObject( GameObject& gameObject );
-	VoxelGrid* Voxelize( const std::vector<std::pair<const Geometry*, Matrix>>& elements );
+	VoxelGrid* Voxelize( const std::vector<std::pair<const Geometry*, Matrix>>& elements, TransformCache& transformCache );
+	// loads the tree file and computes its approximation on a worker thread, LoadTree waits for it
+	void PrefetchTree( const std::wstring& fileName );
+	void AddDynamicObject( GameObject& gameObject );
+	void UpdateDynamicObjects( TransformCache& transformCache );
 	void TestRender( Camera& camera );
 	void BindSRVs();
+	// beams of the shadow rays of all tiles for TraverseTree from the depth and normals of the shadow pass, does nothing without BEAM_TRAVERSE
+	void BuildBeams( ShaderResourceView* depthSRV, ShaderResourceView* normalSRV );
 
 	void SetLightSizeAngle( float angle );
 	void SetLightSamples( uint32_t samples );
@@ -93,18 +123,46 @@ public:
 
 	void SetSliderVisibility( bool visible );
 	Texture* GetCurrentShadowTex();
+	// the one written in the frame before the current one
+	Texture* GetLastShadowTex();
 private:
 	bool CreateBuffers();
 	bool CreateRenderPass();
 	bool CreateCamera();
-	void StitchTree( const std::vector<std::pair<std::vector<Node>, std::vector<uint32_t>>>& treeParts );
+	void StitchTree( const std::vector<PartTree>& treeParts );
 	void UpdateVoxelizeData( uint32_t voxelPart, const float3& numVoxelParts );
+	// bricks of the part from the world space positions of the elements overlapping it
+	uint32_t VoxelizePartOnCpu( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes, TransformCache& transformCache,
+								uint32_t voxelPart, const float3& partSize, std::vector<Node>& bricks );
+	void ComputePartBounds( uint32_t voxelPart, const float3& partSize, const Node* bricks, uint32_t numBricks, float3& boxMin, float3& boxMax );
+	void DispatchVoxelization( const Geometry& geometry, const Matrix& transform, UnorderedAccessView* brickUAV );
+	uint32_t VoxelizeRegion( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes,
+							 const float3& regionMin, const uint3& numBricks, const float3& deltaGrid );
+	// boxes are the world space bounds of the elements, sub parts only voxelize the elements overlapping them
+	void SubdividePart( const std::vector<std::pair<const Geometry*, Matrix>>& elements, const std::vector<std::pair<float3, float3>>& boxes, uint32_t voxelPart, const float3& partSize,
+						uint32_t maxLevel, uint32_t brickBudget, Buffer* stagingBuffer, PartTree& part, DebugData& debugData );
 	bool LoadTree( const std::wstring& fileName );
+	// traces the rays of CreateTraversalRays through the loaded tree with TraverseTree and stores them with the results for TreeInspector -v
+	void RecordTraversalVectors( const std::wstring& fileName, const std::wstring& treeFile );
 	void StoreDebugData( const DebugData& debugData );
 	
 	void UpdateGridData();
 
+	bool CreateDynamicBuffers();
+	void StoreDynamicTree( const Node* nodes, uint32_t nodeSize, const uint32_t* pointers, uint32_t pointerSize, const void* approx, uint32_t maxLevel );
+	void UpdateRegion( const float3& regionMin, const float3& regionMax, TransformCache& transformCache );
+	bool RevoxelizeRegion( const uint3& brickMin, const uint3& brickMax, std::vector<Node>& bricks );
+	// bricks of the region from the parts of the loaded voxelization file, only possible while every object in it is at its stored transform
+	bool LoadStoredRegion( const uint3& brickMin, const uint3& brickMax, std::vector<Node>& bricks );
+	void UploadDynamicTree( uint32_t firstNode, uint32_t firstPointer );
+	// computes the empty distances of the nodes [firstNode, numNodes) and copies them into the buffer, does nothing without EMPTY_DISTANCE
+	void UploadEmptyDistances( const Node* nodes, uint32_t firstNode, uint32_t numNodes );
+	void RebuildDynamicTree( TransformCache& transformCache );
+	// builds the tree of the elements, without useFiles the load and store settings are ignored
+	VoxelGrid* VoxelizeElements( const std::vector<std::pair<const Geometry*, Matrix>>& elements, TransformCache& transformCache, bool useFiles );
+
 	uint32_t m_ResolutionMultiplier = 1;
+	uint32_t m_VoxelMode = 0;
 	uint32_t m_Width = 256;
 	uint32_t m_Height = 256;
 	uint32_t m_Depth = 256;
@@ -119,9 +177,11 @@ private:
 	Buffer* m_TreeBuffer;
 	UnorderedAccessView* m_TreeUAV;
 	ShaderResourceView* m_TreeSRV;
-	Buffer* m_BrickBuffer;
-	UnorderedAccessView* m_BrickUAV;
-	ShaderResourceView* m_BrickSRV;
+	Buffer* m_BrickBuffer = nullptr;
+	UnorderedAccessView* m_BrickUAV = nullptr;
+	ShaderResourceView* m_BrickSRV = nullptr;
+	Buffer* m_BrickStagingBuffer = nullptr;
+	uint32_t m_NumRegionBricks = 0;
 
 	Buffer* m_CountBuffer;
 	UnorderedAccessView* m_CountUAV;
@@ -133,9 +193,24 @@ private:
 	Buffer* m_ApproxBuffer;
 	ShaderResourceView* m_ApproxSRV;
 
+	// only created with EMPTY_DISTANCE
+	Buffer* m_EmptyDistanceBuffer = nullptr;
+	ShaderResourceView* m_EmptyDistanceSRV = nullptr;
+
+	// only created with BEAM_TRAVERSE, BEAM_SIZE entries per tile of the screen
+	Buffer* m_BeamBuffer = nullptr;
+	UnorderedAccessView* m_BeamUAV = nullptr;
+	ShaderResourceView* m_BeamSRV = nullptr;
+	uint32_t m_NumBeamTiles = 0;
+
+	// only created with SAMPLE_TABLE, the points of ComputeSampleTable
+	Buffer* m_SampleTableBuffer = nullptr;
+	ShaderResourceView* m_SampleTableSRV = nullptr;
+
 	Shader* m_VoxelShader;
 	Shader* m_SparselizeShader;
 	Shader* m_MipMapShader;
+	Shader* m_BeamShader = nullptr;
 
 	RenderPass* m_VoxelizePass;
 	RenderPass* m_TestPass;
@@ -145,6 +220,7 @@ private:
 	ConstantBuffer<VoxelTestData> m_TestDataBuffer;
 	ConstantBuffer<GridData> m_GridDataBuffer;
 	ConstantBuffer<FilterData> m_FilterDataBuffer;
+	ConstantBuffer<BeamData> m_BeamDataBuffer;
 
 	Texture* m_ShadowTexture1;
 	Texture* m_ShadowTexture2;
@@ -156,6 +232,11 @@ private:
 
 	std::unordered_map<const GameObject*, std::vector<Node>> m_VoxelizedObjects;
 
+	std::vector<DynamicObject> m_DynamicObjects;
+	DynamicTree* m_DynamicTree = nullptr;
+	VoxelPartReader* m_PartReader = nullptr;
+	PreparedTree* m_PreparedTree = nullptr;
+
 	int m_NumLightSamples = 1;
 	float m_LightAngleSize = 0.f;
 	float m_VerticalLightAngle = Deg2Rad( 45.f );
@@ -101,7 +101,7 @@ Flow will be stored
 
 ******************************************************************************/
 
-feature_t Decode( uint32_t code ) {
+static feature_t Decode( uint32_t code ) {
 	feature_t pos;
 	pos.x = code;
 	pos.y = code >> 1;
@@ -0,0 +1,98 @@
+#include "MeshEncoder.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+void ComputeBounds( const ObjFloat3* positions, const uint32_t* indices, size_t numIndices, ObjFloat3& boxMin, ObjFloat3& boxMax ) {
+	boxMin = { INFINITY, INFINITY, INFINITY };
+	boxMax = { -INFINITY, -INFINITY, -INFINITY };
+	for( size_t i = 0; i < numIndices; i++ ) {
+		const ObjFloat3& pos = positions[indices ? indices[i] : i];
+		boxMin = { std::min( boxMin.x, pos.x ), std::min( boxMin.y, pos.y ), std::min( boxMin.z, pos.z ) };
+		boxMax = { std::max( boxMax.x, pos.x ), std::max( boxMax.y, pos.y ), std::max( boxMax.z, pos.z ) };
+	}
+	if( numIndices == 0 )
+		boxMin = boxMax = { 0.f, 0.f, 0.f };
+}
+
+uint16_t Quantize( float value, float min, float max ) {
+	if( max <= min )
+		return 0;
+	float normalized = std::min( std::max( ( value - min ) / ( max - min ), 0.f ), 1.f );
+	return static_cast<uint16_t>( normalized * 65535.f + 0.5f );
+}
+
+int16_t ToSnorm( float value ) {
+	return static_cast<int16_t>( std::round( std::min( std::max( value, -1.f ), 1.f ) * 32767.f ) );
+}
+
+float SignNotZero( float value ) {
+	return value < 0.f ? -1.f : 1.f;
+}
+}
+
+void EncodeMesh( const WeldedMesh & mesh, const std::vector<uint32_t>& subMeshes, bool buildMeshlets, EncodedMesh & encoded ) {
+	size_t numVertices = mesh.Positions.size();
+	ComputeBounds( mesh.Positions.data(), nullptr, numVertices, encoded.BoxMin, encoded.BoxMax );
+
+	// with a single shape the bounds of the mesh are already the tightest ones
+	encoded.SubMeshes.clear();
+	if( subMeshes.size() > 1 ) {
+		uint32_t firstVertex = 0;
+		for( uint32_t numSubVertices : subMeshes ) {
+			SubMeshRange subMesh;
+			subMesh.FirstVertex = firstVertex;
+			subMesh.NumVertices = numSubVertices;
+			ComputeBounds( mesh.Positions.data() + firstVertex, nullptr, numSubVertices, subMesh.BoxMin, subMesh.BoxMax );
+			encoded.SubMeshes.push_back( subMesh );
+			firstVertex += numSubVertices;
+		}
+	}
+
+	std::vector<SubMeshRange> ranges = encoded.SubMeshes;
+	if( ranges.empty() )
+		ranges.push_back( { 0, static_cast<uint32_t>( numVertices ), encoded.BoxMin, encoded.BoxMax } );
+
+	encoded.Positions.resize( numVertices * 3 );
+	for( const SubMeshRange& range : ranges ) {
+		for( size_t i = range.FirstVertex; i < range.FirstVertex + range.NumVertices; i++ ) {
+			const ObjFloat3& pos = mesh.Positions[i];
+			encoded.Positions[i * 3] = Quantize( pos.x, range.BoxMin.x, range.BoxMax.x );
+			encoded.Positions[i * 3 + 1] = Quantize( pos.y, range.BoxMin.y, range.BoxMax.y );
+			encoded.Positions[i * 3 + 2] = Quantize( pos.z, range.BoxMin.z, range.BoxMax.z );
+		}
+	}
+
+	encoded.Normals.resize( numVertices * 2 );
+	for( size_t i = 0; i < numVertices; i++ ) {
+		// project onto the octahedron and fold the lower half over the upper one
+		const ObjFloat3& normal = mesh.Normals[i];
+		float length = std::abs( normal.x ) + std::abs( normal.y ) + std::abs( normal.z );
+		float x = length > 0.f ? normal.x / length : 0.f;
+		float y = length > 0.f ? normal.y / length : 0.f;
+		if( normal.z < 0.f ) {
+			float foldedX = ( 1.f - std::abs( y ) ) * SignNotZero( x );
+			y = ( 1.f - std::abs( x ) ) * SignNotZero( y );
+			x = foldedX;
+		}
+		encoded.Normals[i * 2] = ToSnorm( x );
+		encoded.Normals[i * 2 + 1] = ToSnorm( y );
+	}
+
+	encoded.ShortIndices.clear();
+	if( numVertices <= 65536 )
+		encoded.ShortIndices.assign( mesh.Indices.begin(), mesh.Indices.end() );
+
+	encoded.Meshlets.clear();
+	if( buildMeshlets ) {
+		uint32_t numTriangles = static_cast<uint32_t>( mesh.Indices.size() / 3 );
+		for( uint32_t first = 0; first < numTriangles; first += MeshletSize ) {
+			MeshletRange meshlet;
+			meshlet.FirstTriangle = first;
+			meshlet.NumTriangles = std::min( MeshletSize, numTriangles - first );
+			ComputeBounds( mesh.Positions.data(), mesh.Indices.data() + first * 3, meshlet.NumTriangles * 3, meshlet.BoxMin, meshlet.BoxMax );
+			encoded.Meshlets.push_back( meshlet );
+		}
+	}
+}
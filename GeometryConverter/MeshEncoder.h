@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "MeshOptimizer.h"
+
+struct MeshletRange {
+	uint32_t FirstTriangle;
+	uint32_t NumTriangles;
+	ObjFloat3 BoxMin;
+	ObjFloat3 BoxMax;
+};
+
+struct SubMeshRange {
+	uint32_t FirstVertex;
+	uint32_t NumVertices;
+	ObjFloat3 BoxMin;
+	ObjFloat3 BoxMax;
+};
+
+struct EncodedMesh {
+	// bounds of all sub meshes
+	ObjFloat3 BoxMin;
+	ObjFloat3 BoxMax;
+	// 3 values per vertex
+	std::vector<uint16_t> Positions;
+	// 2 values per vertex
+	std::vector<int16_t> Normals;
+	// empty if the mesh has more than 65536 vertices
+	std::vector<uint16_t> ShortIndices;
+	std::vector<MeshletRange> Meshlets;
+	// empty if the whole mesh is quantized relative to BoxMin and BoxMax
+	std::vector<SubMeshRange> SubMeshes;
+};
+
+const uint32_t MeshletSize = 64;
+
+// quantizes the mesh for the version 2 format, the meshlets follow the triangle order of the mesh.
+// subMeshes are the vertex counts of consecutive shapes that get quantized relative to their own bounds
+void EncodeMesh( const WeldedMesh& mesh, const std::vector<uint32_t>& subMeshes, bool buildMeshlets, EncodedMesh& encoded );
@@ -0,0 +1,216 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+struct VertexKey {
+	ObjFloat3 Position;
+	ObjFloat3 Normal;
+};
+
+uint32_t HashVertex( const VertexKey& key ) {
+	uint32_t words[6];
+	memcpy( words, &key, sizeof( words ) );
+	uint32_t hash = 2166136261u;
+	for( uint32_t word : words ) {
+		hash ^= word;
+		hash *= 16777619u;
+	}
+	return hash ^ ( hash >> 15 );
+}
+
+// -0 and 0 compare equal but have different bits, the hash and Equal only see +0
+ObjFloat3 PositiveZero( const ObjFloat3& v ) {
+	return { v.x == 0.f ? 0.f : v.x, v.y == 0.f ? 0.f : v.y, v.z == 0.f ? 0.f : v.z };
+}
+
+bool Equal( const ObjFloat3& a, const ObjFloat3& b ) {
+	return memcmp( &a, &b, sizeof( ObjFloat3 ) ) == 0;
+}
+
+ObjFloat3 FaceNormal( const ObjFloat3& a, const ObjFloat3& b, const ObjFloat3& c ) {
+	ObjFloat3 u = { b.x - a.x, b.y - a.y, b.z - a.z };
+	ObjFloat3 v = { c.x - a.x, c.y - a.y, c.z - a.z };
+	ObjFloat3 n = { u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x };
+	float length = std::sqrt( n.x * n.x + n.y * n.y + n.z * n.z );
+	if( length > 0.f ) {
+		n.x /= length;
+		n.y /= length;
+		n.z /= length;
+	}
+	return n;
+}
+
+// triangles that use a vertex
+struct VertexAdjacency {
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Triangles;
+};
+
+void BuildAdjacency( const std::vector<uint32_t>& indices, uint32_t numVertices, VertexAdjacency& adjacency ) {
+	adjacency.Offsets.assign( numVertices + 1, 0 );
+	for( uint32_t index : indices )
+		adjacency.Offsets[index + 1]++;
+	for( uint32_t v = 0; v < numVertices; v++ )
+		adjacency.Offsets[v + 1] += adjacency.Offsets[v];
+
+	std::vector<uint32_t> fill( adjacency.Offsets.begin(), adjacency.Offsets.end() - 1 );
+	adjacency.Triangles.resize( indices.size() );
+	for( uint32_t i = 0; i < indices.size(); i++ )
+		adjacency.Triangles[fill[indices[i]]++] = i / 3;
+}
+}
+
+void WeldVertices( const ObjData & obj, const std::vector<const ObjShape*>& shapes, WeldedMesh & mesh ) {
+	size_t numCorners = 0;
+	for( const ObjShape* shape : shapes )
+		numCorners += shape->PositionIndices.size();
+
+	// open addressing with the vertex index as entry, at most half full
+	size_t tableSize = 1;
+	while( tableSize < numCorners * 2 )
+		tableSize <<= 1;
+	std::vector<uint32_t> table( tableSize, -1 );
+
+	mesh.Positions.clear();
+	mesh.Normals.clear();
+	mesh.Indices.clear();
+	mesh.Indices.reserve( numCorners );
+
+	for( const ObjShape* shape : shapes ) {
+		for( size_t corner = 0; corner < shape->PositionIndices.size(); corner++ ) {
+			VertexKey key;
+			key.Position = obj.Positions[shape->PositionIndices[corner]];
+			if( shape->NormalIndices[corner] != -1 ) {
+				key.Normal = obj.Normals[shape->NormalIndices[corner]];
+			}
+			else {
+				size_t first = corner - corner % 3;
+				key.Normal = FaceNormal( obj.Positions[shape->PositionIndices[first]], obj.Positions[shape->PositionIndices[first + 1]], obj.Positions[shape->PositionIndices[first + 2]] );
+			}
+			key.Position = PositiveZero( key.Position );
+			key.Normal = PositiveZero( key.Normal );
+
+			size_t slot = HashVertex( key ) & ( tableSize - 1 );
+			while( table[slot] != -1 && !( Equal( mesh.Positions[table[slot]], key.Position ) && Equal( mesh.Normals[table[slot]], key.Normal ) ) )
+				slot = ( slot + 1 ) & ( tableSize - 1 );
+
+			if( table[slot] == -1 ) {
+				table[slot] = static_cast<uint32_t>( mesh.Positions.size() );
+				mesh.Positions.push_back( key.Position );
+				mesh.Normals.push_back( key.Normal );
+			}
+			mesh.Indices.push_back( table[slot] );
+		}
+	}
+}
+
+void OptimizeVertexCache( std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize ) {
+	uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+	if( numTriangles == 0 )
+		return;
+
+	VertexAdjacency adjacency;
+	BuildAdjacency( indices, numVertices, adjacency );
+
+	std::vector<uint32_t> liveTriangles( numVertices );
+	for( uint32_t v = 0; v < numVertices; v++ )
+		liveTriangles[v] = adjacency.Offsets[v + 1] - adjacency.Offsets[v];
+
+	std::vector<uint32_t> cacheTime( numVertices, 0 );
+	std::vector<bool> emitted( numTriangles, false );
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve( indices.size() );
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	int64_t fanning = indices[0];
+	while( fanning >= 0 ) {
+		candidates.clear();
+		uint32_t vertex = static_cast<uint32_t>( fanning );
+		for( uint32_t a = adjacency.Offsets[vertex]; a < adjacency.Offsets[vertex + 1]; a++ ) {
+			uint32_t triangle = adjacency.Triangles[a];
+			if( emitted[triangle] )
+				continue;
+			emitted[triangle] = true;
+			for( uint32_t k = 0; k < 3; k++ ) {
+				uint32_t v = indices[triangle * 3 + k];
+				result.push_back( v );
+				deadEnd.push_back( v );
+				candidates.push_back( v );
+				--liveTriangles[v];
+				if( time - cacheTime[v] > cacheSize )
+					cacheTime[v] = time++;
+			}
+		}
+
+		// the candidate that is still in the cache after its remaining triangles are emitted
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for( uint32_t v : candidates ) {
+			if( liveTriangles[v] == 0 )
+				continue;
+			int64_t priority = 0;
+			if( time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize )
+				priority = time - cacheTime[v];
+			if( priority > bestPriority ) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		if( fanning < 0 ) {
+			while( !deadEnd.empty() && fanning < 0 ) {
+				uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if( liveTriangles[v] > 0 )
+					fanning = v;
+			}
+			while( cursor < numVertices && fanning < 0 ) {
+				if( liveTriangles[cursor] > 0 )
+					fanning = cursor;
+				++cursor;
+			}
+		}
+	}
+
+	indices.swap( result );
+}
+
+void OptimizeVertexFetch( WeldedMesh & mesh ) {
+	std::vector<uint32_t> remap( mesh.Positions.size(), -1 );
+	std::vector<ObjFloat3> positions, normals;
+	positions.reserve( mesh.Positions.size() );
+	normals.reserve( mesh.Normals.size() );
+
+	for( uint32_t& index : mesh.Indices ) {
+		if( remap[index] == -1 ) {
+			remap[index] = static_cast<uint32_t>( positions.size() );
+			positions.push_back( mesh.Positions[index] );
+			normals.push_back( mesh.Normals[index] );
+		}
+		index = remap[index];
+	}
+
+	mesh.Positions.swap( positions );
+	mesh.Normals.swap( normals );
+}
+
+float ComputeACMR( const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize ) {
+	if( indices.empty() )
+		return 0.f;
+
+	// fifo cache, a vertex is in the cache if it was loaded less than cacheSize misses ago
+	std::vector<uint32_t> loadTime( numVertices, 0 );
+	uint32_t misses = 0;
+	for( uint32_t index : indices ) {
+		if( loadTime[index] == 0 || misses + 1 - loadTime[index] > cacheSize ) {
+			++misses;
+			loadTime[index] = misses;
+		}
+	}
+	return static_cast<float>( misses ) / ( indices.size() / 3 );
+}
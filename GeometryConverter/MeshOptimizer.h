@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+
+#include "ObjParser.h"
+
+struct WeldedMesh {
+	std::vector<ObjFloat3> Positions;
+	std::vector<ObjFloat3> Normals;
+	std::vector<uint32_t> Indices;
+};
+
+// merges all corners of the shapes with the same position and normal into one vertex.
+// corners without normal get the normal of their triangle
+void WeldVertices( const ObjData& obj, const std::vector<const ObjShape*>& shapes, WeldedMesh& mesh );
+
+// reorders the triangles for the post transform vertex cache (tipsify, Sander et al. 2007)
+void OptimizeVertexCache( std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize = 16 );
+// reorders the vertices in the order they are first used
+void OptimizeVertexFetch( WeldedMesh& mesh );
+
+// average number of vertex shader invocations per triangle with a fifo cache
+float ComputeACMR( const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize = 16 );
@@ -0,0 +1,283 @@
+#include "ObjParser.h"
+
+#include <ppl.h>
+#include <thread>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+// face indices can be relative to the vertices read so far, those get resolved once the offsets of all chunks are known
+struct ObjIndex {
+	int64_t Value;
+	bool Relative;
+};
+
+struct ObjShapeStart {
+	size_t Corner;
+	std::string Name;
+};
+
+struct ObjChunk {
+	std::vector<ObjFloat3> Positions;
+	std::vector<ObjFloat3> Normals;
+	std::vector<ObjIndex> PositionIndices;
+	std::vector<ObjIndex> NormalIndices;
+	std::vector<ObjShapeStart> ShapeStarts;
+	bool Valid = true;
+};
+
+const size_t MaterialFlag = size_t( 1 ) << ( sizeof( size_t ) * 8 - 1 );
+
+const double PowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+inline bool IsSpace( char c ) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipSpaces( const char* ptr, const char* end ) {
+	while( ptr < end && IsSpace( *ptr ) )
+		++ptr;
+	return ptr;
+}
+
+inline bool IsDigit( char c ) {
+	return c >= '0' && c <= '9';
+}
+
+const char* ParseFloat( const char* ptr, const char* end, float& value ) {
+	ptr = SkipSpaces( ptr, end );
+	bool negative = false;
+	if( ptr < end && ( *ptr == '-' || *ptr == '+' ) )
+		negative = *ptr++ == '-';
+
+	uint64_t mantissa = 0;
+	int32_t exponent = 0;
+	uint32_t digits = 0;
+	for( ; ptr < end && IsDigit( *ptr ); ++ptr, ++digits ) {
+		// further digits don't change a float
+		if( digits < 19 )
+			mantissa = mantissa * 10 + ( *ptr - '0' );
+		else
+			++exponent;
+	}
+	if( ptr < end && *ptr == '.' ) {
+		for( ++ptr; ptr < end && IsDigit( *ptr ); ++ptr, ++digits ) {
+			if( digits < 19 ) {
+				mantissa = mantissa * 10 + ( *ptr - '0' );
+				--exponent;
+			}
+		}
+	}
+	if( ptr < end && ( *ptr == 'e' || *ptr == 'E' ) ) {
+		++ptr;
+		bool negativeExp = false;
+		if( ptr < end && ( *ptr == '-' || *ptr == '+' ) )
+			negativeExp = *ptr++ == '-';
+		int32_t exp = 0;
+		for( ; ptr < end && IsDigit( *ptr ); ++ptr )
+			exp = exp < 10000 ? exp * 10 + ( *ptr - '0' ) : exp;
+		exponent += negativeExp ? -exp : exp;
+	}
+
+	double result = static_cast<double>( mantissa );
+	while( exponent > 22 ) {
+		result *= 1e22;
+		exponent -= 22;
+	}
+	while( exponent < -22 ) {
+		result /= 1e22;
+		exponent += 22;
+	}
+	result = exponent < 0 ? result / PowersOfTen[-exponent] : result * PowersOfTen[exponent];
+	value = static_cast<float>( negative ? -result : result );
+	return ptr;
+}
+
+const char* ParseIndex( const char* ptr, const char* end, int64_t& value, bool& valid ) {
+	bool negative = false;
+	if( ptr < end && ( *ptr == '-' || *ptr == '+' ) )
+		negative = *ptr++ == '-';
+	valid = ptr < end && IsDigit( *ptr );
+	value = 0;
+	for( ; ptr < end && IsDigit( *ptr ); ++ptr )
+		value = value * 10 + ( *ptr - '0' );
+	if( negative )
+		value = -value;
+	return ptr;
+}
+
+// converts an index of the file into a 0 based one, negative indices count back from the last vertex of the chunk
+ObjIndex MakeIndex( int64_t index, size_t numLocal ) {
+	if( index < 0 )
+		return { static_cast<int64_t>( numLocal ) + index, true };
+	return { index - 1, false };
+}
+
+void ParseChunk( const char* ptr, const char* end, ObjChunk& chunk ) {
+	std::vector<ObjIndex> facePositions, faceNormals;
+	while( ptr < end ) {
+		const char* lineEnd = static_cast<const char*>( memchr( ptr, '\n', end - ptr ) );
+		if( !lineEnd )
+			lineEnd = end;
+
+		const char* token = SkipSpaces( ptr, lineEnd );
+		size_t length = lineEnd - token;
+		if( length > 2 && token[0] == 'v' && IsSpace( token[1] ) ) {
+			ObjFloat3 pos;
+			token = ParseFloat( token + 2, lineEnd, pos.x );
+			token = ParseFloat( token, lineEnd, pos.y );
+			ParseFloat( token, lineEnd, pos.z );
+			chunk.Positions.push_back( pos );
+		}
+		else if( length > 3 && token[0] == 'v' && token[1] == 'n' && IsSpace( token[2] ) ) {
+			ObjFloat3 normal;
+			token = ParseFloat( token + 3, lineEnd, normal.x );
+			token = ParseFloat( token, lineEnd, normal.y );
+			ParseFloat( token, lineEnd, normal.z );
+			chunk.Normals.push_back( normal );
+		}
+		else if( length > 2 && token[0] == 'f' && IsSpace( token[1] ) ) {
+			facePositions.clear();
+			faceNormals.clear();
+			token = SkipSpaces( token + 2, lineEnd );
+			while( token < lineEnd ) {
+				int64_t index;
+				bool valid;
+				token = ParseIndex( token, lineEnd, index, valid );
+				if( !valid ) {
+					chunk.Valid = false;
+					return;
+				}
+				facePositions.push_back( MakeIndex( index, chunk.Positions.size() ) );
+
+				ObjIndex normal = { -1, false };
+				if( token < lineEnd && *token == '/' ) {
+					++token;
+					// texture coordinate
+					if( token < lineEnd && *token != '/' )
+						token = ParseIndex( token, lineEnd, index, valid );
+					if( token < lineEnd && *token == '/' ) {
+						token = ParseIndex( token + 1, lineEnd, index, valid );
+						if( valid )
+							normal = MakeIndex( index, chunk.Normals.size() );
+					}
+				}
+				faceNormals.push_back( normal );
+				// skip anything that isn't part of an index
+				while( token < lineEnd && !IsSpace( *token ) )
+					++token;
+				token = SkipSpaces( token, lineEnd );
+			}
+
+			for( size_t i = 1; i + 1 < facePositions.size(); i++ ) {
+				chunk.PositionIndices.insert( chunk.PositionIndices.end(), { facePositions[0], facePositions[i], facePositions[i + 1] } );
+				chunk.NormalIndices.insert( chunk.NormalIndices.end(), { faceNormals[0], faceNormals[i], faceNormals[i + 1] } );
+			}
+		}
+		else if( ( length > 1 && ( token[0] == 'g' || token[0] == 'o' ) && IsSpace( token[1] ) ) || ( length > 6 && strncmp( token, "usemtl", 6 ) == 0 && IsSpace( token[6] ) ) ) {
+			ObjShapeStart start;
+			start.Corner = chunk.PositionIndices.size();
+			if( token[0] != 'u' ) {
+				const char* nameStart = SkipSpaces( token + 2, lineEnd );
+				const char* nameEnd = lineEnd;
+				while( nameEnd > nameStart && IsSpace( nameEnd[-1] ) )
+					--nameEnd;
+				start.Name.assign( nameStart, nameEnd );
+			}
+			else {
+				// materials only start a new shape, it keeps the name of the group
+				start.Corner |= MaterialFlag;
+			}
+			chunk.ShapeStarts.push_back( start );
+		}
+
+		ptr = lineEnd + 1;
+	}
+}
+
+bool ResolveIndex( const ObjIndex& index, size_t base, size_t count, uint32_t& out ) {
+	int64_t value = index.Relative ? static_cast<int64_t>( base ) + index.Value : index.Value;
+	if( value < 0 || value >= static_cast<int64_t>( count ) )
+		return false;
+	out = static_cast<uint32_t>( value );
+	return true;
+}
+}
+
+bool ParseObjFile( const std::string & fileName, ObjData & data, size_t& fileSize ) {
+	std::ifstream file( fileName, std::ios::in | std::ios::binary | std::ios::ate );
+	if( !file.is_open() )
+		return false;
+	fileSize = static_cast<size_t>( file.tellg() );
+	std::vector<char> text( fileSize );
+	file.seekg( 0 );
+	file.read( text.data(), fileSize );
+	if( file.bad() )
+		return false;
+
+	// chunks end at line breaks
+	size_t numChunks = std::max( size_t( 1 ), std::min( fileSize / ( 1 << 20 ) + 1, static_cast<size_t>( std::thread::hardware_concurrency() ) * 4 ) );
+	std::vector<size_t> chunkStarts( numChunks + 1, fileSize );
+	chunkStarts[0] = 0;
+	for( size_t i = 1; i < numChunks; i++ ) {
+		size_t pos = std::max( chunkStarts[i - 1], fileSize * i / numChunks );
+		const char* lineEnd = static_cast<const char*>( memchr( text.data() + pos, '\n', fileSize - pos ) );
+		chunkStarts[i] = lineEnd ? lineEnd - text.data() + 1 : fileSize;
+	}
+
+	std::vector<ObjChunk> chunks( numChunks );
+	concurrency::parallel_for( size_t( 0 ), numChunks, [&]( size_t i ) {
+		ParseChunk( text.data() + chunkStarts[i], text.data() + chunkStarts[i + 1], chunks[i] );
+	} );
+
+	std::vector<size_t> positionBase( numChunks + 1, 0 ), normalBase( numChunks + 1, 0 );
+	for( size_t i = 0; i < numChunks; i++ ) {
+		if( !chunks[i].Valid )
+			return false;
+		positionBase[i + 1] = positionBase[i] + chunks[i].Positions.size();
+		normalBase[i + 1] = normalBase[i] + chunks[i].Normals.size();
+	}
+
+	data.Positions.resize( positionBase[numChunks] );
+	data.Normals.resize( normalBase[numChunks] );
+	concurrency::parallel_for( size_t( 0 ), numChunks, [&]( size_t i ) {
+		std::copy( chunks[i].Positions.begin(), chunks[i].Positions.end(), data.Positions.begin() + positionBase[i] );
+		std::copy( chunks[i].Normals.begin(), chunks[i].Normals.end(), data.Normals.begin() + normalBase[i] );
+	} );
+
+	data.Shapes.clear();
+	data.Shapes.push_back( ObjShape() );
+	std::string groupName;
+	for( size_t i = 0; i < numChunks; i++ ) {
+		const ObjChunk& chunk = chunks[i];
+		size_t nextStart = 0;
+		for( size_t corner = 0; corner <= chunk.PositionIndices.size(); corner++ ) {
+			// a chunk can start several shapes before its next face
+			while( nextStart < chunk.ShapeStarts.size() && ( chunk.ShapeStarts[nextStart].Corner & ~MaterialFlag ) == corner ) {
+				const ObjShapeStart& start = chunk.ShapeStarts[nextStart++];
+				if( !( start.Corner & MaterialFlag ) )
+					groupName = start.Name;
+				if( !data.Shapes.back().PositionIndices.empty() )
+					data.Shapes.push_back( ObjShape() );
+				data.Shapes.back().Name = groupName;
+			}
+			if( corner == chunk.PositionIndices.size() )
+				break;
+
+			ObjShape& shape = data.Shapes.back();
+			uint32_t position, normal = -1;
+			if( !ResolveIndex( chunk.PositionIndices[corner], positionBase[i], data.Positions.size(), position ) )
+				return false;
+			// like tinyobj a missing normal is not an error, the face gets its own normal then
+			if( !ResolveIndex( chunk.NormalIndices[corner], normalBase[i], data.Normals.size(), normal ) )
+				normal = -1;
+			shape.PositionIndices.push_back( position );
+			shape.NormalIndices.push_back( normal );
+		}
+	}
+	if( data.Shapes.back().PositionIndices.empty() )
+		data.Shapes.pop_back();
+
+	return true;
+}
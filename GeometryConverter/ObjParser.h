@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ObjFloat3 {
+	float x, y, z;
+};
+
+struct ObjShape {
+	std::string Name;
+	// indices per triangle corner, the normal index is -1 if the corner has no valid normal
+	std::vector<uint32_t> PositionIndices;
+	std::vector<uint32_t> NormalIndices;
+};
+
+struct ObjData {
+	std::vector<ObjFloat3> Positions;
+	std::vector<ObjFloat3> Normals;
+	std::vector<ObjShape> Shapes;
+};
+
+// parses the file in chunks on all cores, faces get triangulated as fans.
+// a new shape starts at every group, object and material, texture coordinates and materials are skipped
+bool ParseObjFile( const std::string& fileName, ObjData& data, size_t& fileSize );
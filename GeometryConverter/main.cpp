@@ -1,5 +1,7 @@
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "ObjParser.h"
+#include "MeshOptimizer.h"
+#include "MeshEncoder.h"
+#include "json.hpp"
 
 #include "Mesh_generated.h"
 
@@ -7,16 +9,28 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <mutex>
+#include <iomanip>
+#include <cstdio>
+#include <sys/stat.h>
+#include <ppl.h>
+#include <concrt.h>
 
 static const std::string fileType = "mesh";
 
 struct Parameters {
 	std::string input = "", output = "";
 	bool combineMesh = true;
+	uint32_t version = 2;
+	bool meshlets = false;
 };
 
 void PrintHelp( const std::string& name ) {
-	std::cout << "Usage: " << name << " inputfile [-o outputfile] [-c <combineMeshes=true>]" << std::endl;
+	std::cout << "Usage: " << name << " inputfile [-o outputfile] [-c <combineMeshes=true>] [-v <version=2>] [-m <meshlets=false>]" << std::endl;
+	std::cout << "       " << name << " -b manifest.json" << std::endl;
 }
 
 bool ChangeType( std::string& path, const std::string& targetType ) {
@@ -33,6 +47,18 @@ bool ChangeType( std::string& path, const std::string& targetType ) {
 	return changed;
 }
 
+bool ParseBool( const std::string& value, bool& result ) {
+	if( value == "1" || value == "true" || value == "TRUE" || value == "True" ) {
+		result = true;
+		return true;
+	}
+	if( value == "0" || value == "false" || value == "FALSE" || value == "False" ) {
+		result = false;
+		return true;
+	}
+	return false;
+}
+
 bool ReadParameters( int argc, char * argv[], Parameters& params ) {
 	if( argc < 2 || std::string( argv[1] ) == "-h" || std::string( argv[1] ) == "--help" ) {
 		PrintHelp( argv[0] );
@@ -49,13 +75,17 @@ bool ReadParameters( int argc, char * argv[], Parameters& params ) {
 				i++;
 			}
 			else if( arg == "-c" ) {
-				std::string comb = argv[i + 1];
-				if( comb == "1" || comb == "true" || comb == "TRUE" || comb == "True" ) {
-					params.combineMesh = true;
+				if( ParseBool( argv[i + 1], params.combineMesh ) )
 					i++;
-				}
-				else if( comb == "0" || comb == "false" || comb == "FALSE" || comb == "False" ) {
-					params.combineMesh = false;
+			}
+			else if( arg == "-m" ) {
+				if( ParseBool( argv[i + 1], params.meshlets ) )
+					i++;
+			}
+			else if( arg == "-v" ) {
+				std::string version = argv[i + 1];
+				if( version == "1" || version == "2" ) {
+					params.version = std::stoul( version );
 					i++;
 				}
 			}
@@ -70,107 +100,454 @@ bool ReadParameters( int argc, char * argv[], Parameters& params ) {
 	return true;
 }
 
-bool ConvertMesh(const std::string& loadPath, bool combineMesh, flatbuffers::FlatBufferBuilder& builder ) {
+flatbuffers::Offset<Loader::Mesh::Mesh> CreateMeshV1( flatbuffers::FlatBufferBuilder& builder, WeldedMesh& mesh ) {
 	using namespace Loader::Mesh;
 
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
+	std::vector<Vec3>* positions = reinterpret_cast<std::vector<Vec3>*>( &mesh.Positions );
+	std::vector<Vec3>* normals = reinterpret_cast<std::vector<Vec3>*>( &mesh.Normals );
+	auto posVec = builder.CreateVectorOfStructs( *positions );
+	auto normalVec = builder.CreateVectorOfStructs( *normals );
+	auto indicesVec = builder.CreateVector( mesh.Indices );
+	return CreateMesh( builder, posVec, normalVec, indicesVec );
+}
 
-	std::string err;
+flatbuffers::Offset<Loader::Mesh::Mesh> CreateMeshV2( flatbuffers::FlatBufferBuilder& builder, const WeldedMesh& mesh, const std::vector<uint32_t>& subMeshes, bool meshlets ) {
+	using namespace Loader::Mesh;
 
-	std::cout << "Loading '" << loadPath << "'... ";
+	EncodedMesh encoded;
+	EncodeMesh( mesh, subMeshes, meshlets, encoded );
+
+	auto posVec = builder.CreateVector( encoded.Positions );
+	auto normalVec = builder.CreateVector( encoded.Normals );
+	flatbuffers::Offset<flatbuffers::Vector<uint32_t>> indicesVec = 0;
+	flatbuffers::Offset<flatbuffers::Vector<uint16_t>> shortIndicesVec = 0;
+	if( encoded.ShortIndices.empty() )
+		indicesVec = builder.CreateVector( mesh.Indices );
+	else
+		shortIndicesVec = builder.CreateVector( encoded.ShortIndices );
+
+	flatbuffers::Offset<flatbuffers::Vector<const Meshlet*>> meshletVec = 0;
+	if( meshlets ) {
+		std::vector<Meshlet> fbMeshlets;
+		for( const MeshletRange& range : encoded.Meshlets ) {
+			Box bounds( reinterpret_cast<const Vec3&>( range.BoxMin ), reinterpret_cast<const Vec3&>( range.BoxMax ) );
+			fbMeshlets.push_back( Meshlet( range.FirstTriangle, range.NumTriangles, bounds ) );
+		}
+		meshletVec = builder.CreateVectorOfStructs( fbMeshlets );
+	}
 
-	bool ret = tinyobj::LoadObj( shapes, materials, err, loadPath.c_str() );
-	if( !ret ) {
-		std::cout << "failed" << std::endl;
-		return false;
+	flatbuffers::Offset<flatbuffers::Vector<const SubMesh*>> subMeshVec = 0;
+	if( !encoded.SubMeshes.empty() ) {
+		std::vector<SubMesh> fbSubMeshes;
+		for( const SubMeshRange& range : encoded.SubMeshes ) {
+			Box bounds( reinterpret_cast<const Vec3&>( range.BoxMin ), reinterpret_cast<const Vec3&>( range.BoxMax ) );
+			fbSubMeshes.push_back( SubMesh( range.FirstVertex, range.NumVertices, bounds ) );
+		}
+		subMeshVec = builder.CreateVectorOfStructs( fbSubMeshes );
 	}
 
-	std::cout << "complete" << std::endl;
+	Box bounds( reinterpret_cast<const Vec3&>( encoded.BoxMin ), reinterpret_cast<const Vec3&>( encoded.BoxMax ) );
+	return CreateMesh( builder, 0, 0, indicesVec, &bounds, posVec, normalVec, shortIndicesVec, meshletVec, subMeshVec );
+}
 
-	std::vector<flatbuffers::Offset<Mesh>> meshes;
+bool ConvertMesh( const std::string& loadPath, const Parameters& params, flatbuffers::FlatBufferBuilder& builder, std::ostream& out ) {
+	using namespace Loader::Mesh;
 
-	std::cout << "Converting... ";
-
-	if( combineMesh ) {
-		std::vector<Vec3> allPositions;
-		std::vector<Vec3> allNormals;
-		std::vector<uint32_t> allIndices;
-		for( size_t i = 0; i < shapes.size(); ++i ) {
-			std::vector<Vec3>* positions = reinterpret_cast<std::vector<Vec3>*>( &shapes[i].mesh.positions );
-			std::vector<Vec3>* normals = reinterpret_cast<std::vector<Vec3>*>( &shapes[i].mesh.normals );
-			std::vector<uint32_t>* indices = &shapes[i].mesh.indices;
-			if( allPositions.size() > 0 ) {
-				for( uint32_t& val : *indices ) {
-					val += static_cast<uint32_t>( allPositions.size() );
-				}
-			}
-			allPositions.insert( allPositions.end(), positions->begin(), positions->end() );
-			allNormals.insert( allNormals.end(), normals->begin(), normals->end() );
-			allIndices.insert( allIndices.end(), indices->begin(), indices->end() );
+	ObjData obj;
+	size_t fileSize = 0;
+
+	out << "Loading '" << loadPath << "'... ";
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	if( !ParseObjFile( loadPath, obj, fileSize ) ) {
+		out << "failed" << std::endl;
+		return false;
+	}
+	double loadSeconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - loadStart ).count();
+
+	out << "complete (" << fileSize / ( 1024.0 * 1024.0 ) / std::max( loadSeconds, 1e-6 ) << " MB/s)" << std::endl;
+
+	out << "Converting... ";
+
+	// every shape is welded and optimized on its own, a combined mesh appends them so each
+	// shape keeps a vertex range that is quantized relative to its own bounds
+	auto convertStart = std::chrono::high_resolution_clock::now();
+	std::vector<WeldedMesh> shapes( obj.Shapes.size() );
+	std::vector<float> acmrBefore( shapes.size() ), acmrAfter( shapes.size() );
+	concurrency::parallel_for( size_t( 0 ), shapes.size(), [&]( size_t i ) {
+		WeldedMesh& mesh = shapes[i];
+		WeldVertices( obj, { &obj.Shapes[i] }, mesh );
+		uint32_t numVertices = static_cast<uint32_t>( mesh.Positions.size() );
+		acmrBefore[i] = ComputeACMR( mesh.Indices, numVertices );
+		OptimizeVertexCache( mesh.Indices, numVertices );
+		OptimizeVertexFetch( mesh );
+		acmrAfter[i] = ComputeACMR( mesh.Indices, numVertices );
+	} );
+
+	size_t numCorners = 0, numVertices = 0;
+	double sumBefore = 0.0, sumAfter = 0.0;
+	for( size_t i = 0; i < shapes.size(); ++i ) {
+		size_t numTriangles = shapes[i].Indices.size() / 3;
+		numCorners += shapes[i].Indices.size();
+		numVertices += shapes[i].Positions.size();
+		sumBefore += acmrBefore[i] * numTriangles;
+		sumAfter += acmrAfter[i] * numTriangles;
+	}
+
+	std::vector<WeldedMesh> welded;
+	std::vector<std::vector<uint32_t>> subMeshes;
+	if( params.combineMesh ) {
+		welded.emplace_back();
+		subMeshes.emplace_back();
+		WeldedMesh& combined = welded.back();
+		for( WeldedMesh& shape : shapes ) {
+			if( shape.Positions.empty() )
+				continue;
+			uint32_t firstVertex = static_cast<uint32_t>( combined.Positions.size() );
+			combined.Positions.insert( combined.Positions.end(), shape.Positions.begin(), shape.Positions.end() );
+			combined.Normals.insert( combined.Normals.end(), shape.Normals.begin(), shape.Normals.end() );
+			for( uint32_t index : shape.Indices )
+				combined.Indices.push_back( firstVertex + index );
+			subMeshes.back().push_back( static_cast<uint32_t>( shape.Positions.size() ) );
+			shape = WeldedMesh();
 		}
-		auto posVec = builder.CreateVectorOfStructs( allPositions );
-		auto normalVec = builder.CreateVectorOfStructs( allNormals );
-		auto indicesVec = builder.CreateVector( allIndices );
-		auto mesh = CreateMesh( builder, posVec, normalVec, indicesVec );
-		meshes.push_back( mesh );
 	}
 	else {
-		for( size_t i = 0; i < shapes.size(); ++i ) {
-			std::vector<Vec3>* positions = reinterpret_cast<std::vector<Vec3>*>( &shapes[i].mesh.positions );
-			std::vector<Vec3>* normals = reinterpret_cast<std::vector<Vec3>*>( &shapes[i].mesh.normals );
-			auto posVec = builder.CreateVectorOfStructs( *positions );
-			auto normalVec = builder.CreateVectorOfStructs( *normals );
-			auto indicesVec = builder.CreateVector( shapes[i].mesh.indices );
-			auto mesh = CreateMesh( builder, posVec, normalVec, indicesVec );
-			meshes.push_back( mesh );
-		}
+		welded = std::move( shapes );
+		subMeshes.resize( welded.size() );
+	}
+	double convertSeconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - convertStart ).count();
+
+	std::vector<flatbuffers::Offset<Mesh>> meshes;
+	for( size_t i = 0; i < welded.size(); ++i ) {
+		if( params.version == 1 )
+			meshes.push_back( CreateMeshV1( builder, welded[i] ) );
+		else
+			meshes.push_back( CreateMeshV2( builder, welded[i], subMeshes[i], params.meshlets ) );
 	}
 
 	auto meshesVec = builder.CreateVector( meshes );
-	auto geometries = CreateMeshes( builder, meshesVec );
+	auto geometries = CreateMeshes( builder, meshesVec, params.version );
 
 	Loader::Mesh::FinishMeshesBuffer( builder, geometries );
 
-	std::cout << "complete" << std::endl;
+	out << "complete (" << convertSeconds * 1000.0 << " ms)" << std::endl;
+
+	size_t numTriangles = std::max( numCorners / 3, size_t( 1 ) );
+	out << "Vertices: " << numCorners << " -> " << numVertices << " in " << meshes.size() << " meshes" << std::endl;
+	out << "ACMR: " << sumBefore / numTriangles << " -> " << sumAfter / numTriangles << std::endl;
 
 	return true;
 }
 
-bool SaveMesh( std::string savePath, flatbuffers::FlatBufferBuilder& builder ) {
-	size_t dotPos = savePath.rfind( '.' );
-
+bool SaveMesh( std::string savePath, flatbuffers::FlatBufferBuilder& builder, std::ostream& out ) {
 	if( ChangeType( savePath, fileType ) )
-		std::cout << "Changed output type to '." << fileType << "'" << std::endl;
+		out << "Changed output type to '." << fileType << "'" << std::endl;
 	
-	std::cout << "Saving to '" << savePath << "'... ";
+	out << "Saving to '" << savePath << "'... ";
 
 	std::ofstream file( savePath, std::ios::out | std::ios::trunc | std::ios::binary );
 	if( !file.is_open() ) {
-		std::cout << "failed" << std::endl;
+		out << "failed" << std::endl;
 		return false;
 	}
 
 	file.write( reinterpret_cast<char*>( builder.GetBufferPointer() ), builder.GetSize() );
 
 	if( file.bad() ) {
-		std::cout << "failed" << std::endl;
+		out << "failed" << std::endl;
 		return false;
 	}
 	
-	std::cout << "complete" << std::endl;
+	out << "complete (" << builder.GetSize() / ( 1024.0 * 1024.0 ) << " MB)" << std::endl;
 
 	return true;
 }
 
-void main( int argc, char *argv[] ) {
+// size, write time and content hash of an input, stored next to the output as <output>.stamp.
+// the size and write time of the output it produced are kept too, so a replaced or truncated output gets converted again
+struct InputStamp {
+	uint64_t Size = 0;
+	uint64_t WriteTime = 0;
+	uint64_t Hash = 0;
+	bool CombineMesh = true;
+	uint32_t Version = 2;
+	bool Meshlets = false;
+	uint64_t OutputSize = 0;
+	uint64_t OutputWriteTime = 0;
+};
+
+enum class JobResult {
+	Converted,
+	Skipped,
+	Failed
+};
+
+const char* GetResultName( JobResult result ) {
+	const char* names[] = { "converted", "skipped", "failed" };
+	return names[static_cast<int>( result )];
+}
+
+struct BatchJob {
+	Parameters Params;
+	JobResult Result = JobResult::Failed;
+	double Seconds = 0.0;
+	uint64_t InputSize = 0;
+	uint64_t OutputSize = 0;
+};
+
+bool GetFileInfo( const std::string& path, uint64_t& size, uint64_t& writeTime ) {
+	struct _stat64 info;
+	if( _stat64( path.c_str(), &info ) != 0 )
+		return false;
+	size = static_cast<uint64_t>( info.st_size );
+	writeTime = static_cast<uint64_t>( info.st_mtime );
+	return true;
+}
+
+bool HashFile( const std::string& path, uint64_t& hash ) {
+	std::ifstream file( path, std::ios::in | std::ios::binary );
+	if( !file.is_open() )
+		return false;
+
+	// 64 bit fnv-1a, only has to detect changes of the input
+	hash = 14695981039346656037ull;
+	std::vector<char> buffer( 1 << 20 );
+	while( file ) {
+		file.read( buffer.data(), buffer.size() );
+		std::streamsize read = file.gcount();
+		for( std::streamsize i = 0; i < read; i++ )
+			hash = ( hash ^ static_cast<uint8_t>( buffer[i] ) ) * 1099511628211ull;
+	}
+	return !file.bad();
+}
+
+bool ReadStamp( const std::string& path, InputStamp& stamp ) {
+	std::ifstream file( path );
+	return static_cast<bool>( file >> stamp.Size >> stamp.WriteTime >> stamp.Hash >> stamp.CombineMesh >> stamp.Version >> stamp.Meshlets >> stamp.OutputSize >> stamp.OutputWriteTime );
+}
+
+bool WriteStamp( const std::string& path, const InputStamp& stamp ) {
+	std::ofstream file( path, std::ios::out | std::ios::trunc );
+	file << stamp.Size << " " << stamp.WriteTime << " " << stamp.Hash << " " << stamp.CombineMesh << " " << stamp.Version << " " << stamp.Meshlets << " "
+		<< stamp.OutputSize << " " << stamp.OutputWriteTime << std::endl;
+	return !file.bad();
+}
+
+// an input is unchanged if it has the stamped size and write time or, if only the write time differs, the same hash.
+// the output has to be the one that was stamped
+bool IsUpToDate( const Parameters& params, InputStamp& stamp ) {
+	uint64_t outputSize, outputTime;
+	InputStamp stored;
+	bool hasOutput = GetFileInfo( params.output, outputSize, outputTime ) && ReadStamp( params.output + ".stamp", stored )
+		&& stored.OutputSize == outputSize && stored.OutputWriteTime == outputTime;
+
+	stamp.CombineMesh = params.combineMesh;
+	stamp.Version = params.version;
+	stamp.Meshlets = params.meshlets;
+	if( !GetFileInfo( params.input, stamp.Size, stamp.WriteTime ) )
+		return false;
+	if( hasOutput && stored.Size == stamp.Size && stored.WriteTime == stamp.WriteTime && stored.CombineMesh == stamp.CombineMesh
+		&& stored.Version == stamp.Version && stored.Meshlets == stamp.Meshlets ) {
+		stamp.Hash = stored.Hash;
+		return true;
+	}
+	if( !HashFile( params.input, stamp.Hash ) )
+		return false;
+	return hasOutput && stored.Size == stamp.Size && stored.Hash == stamp.Hash && stored.CombineMesh == stamp.CombineMesh
+		&& stored.Version == stamp.Version && stored.Meshlets == stamp.Meshlets;
+}
+
+std::string GetDirectory( const std::string& path ) {
+	size_t slashPos = path.find_last_of( "/\\" );
+	return slashPos == std::string::npos ? "" : path.substr( 0, slashPos + 1 );
+}
+
+bool IsAbsolute( const std::string& path ) {
+	return ( !path.empty() && ( path[0] == '/' || path[0] == '\\' ) ) || path.find( ':' ) != std::string::npos;
+}
+
+bool ReadManifest( const std::string& manifestPath, std::vector<BatchJob>& jobs, uint32_t& numThreads, std::string& reportPath ) {
+	std::ifstream file( manifestPath, std::ios::in | std::ios::binary );
+	if( !file.is_open() ) {
+		std::cout << "Couldn't open manifest '" << manifestPath << "'" << std::endl;
+		return false;
+	}
+	std::string text( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+
+	nlohmann::json root;
+	try {
+		root = nlohmann::json::parse( text );
+	}
+	catch( const std::invalid_argument& error ) {
+		std::cout << "Manifest '" << manifestPath << "' is invalid: " << error.what() << std::endl;
+		return false;
+	}
+
+	// either a list of jobs or an object with the jobs and the batch settings
+	const nlohmann::json* jobList = &root;
+	if( root.is_object() ) {
+		auto jobsIt = root.find( "jobs" );
+		jobList = jobsIt != root.end() ? &*jobsIt : nullptr;
+		auto threads = root.find( "threads" );
+		if( threads != root.end() && threads->is_number() && threads->get<double>() >= 1.0 )
+			numThreads = threads->get<uint32_t>();
+		auto report = root.find( "report" );
+		if( report != root.end() && report->is_string() )
+			reportPath = report->get<std::string>();
+	}
+	if( !jobList || !jobList->is_array() ) {
+		std::cout << "Manifest '" << manifestPath << "' has no list of jobs" << std::endl;
+		return false;
+	}
+
+	// relative paths start at the manifest
+	std::string baseDir = GetDirectory( manifestPath );
+	auto resolve = [&]( const std::string& path ) {
+		return IsAbsolute( path ) ? path : baseDir + path;
+	};
+	if( !reportPath.empty() )
+		reportPath = resolve( reportPath );
+
+	for( size_t i = 0; i < jobList->size(); i++ ) {
+		const nlohmann::json& entry = ( *jobList )[i];
+		auto input = entry.find( "input" );
+		if( input == entry.end() || !input->is_string() ) {
+			std::cout << "Job " << i << " of the manifest has no input" << std::endl;
+			return false;
+		}
+
+		BatchJob job;
+		job.Params.input = resolve( input->get<std::string>() );
+		auto output = entry.find( "output" );
+		job.Params.output = output != entry.end() && output->is_string() ? resolve( output->get<std::string>() ) : job.Params.input;
+		ChangeType( job.Params.output, fileType );
+
+		auto combine = entry.find( "combine" );
+		if( combine != entry.end() && combine->is_boolean() )
+			job.Params.combineMesh = combine->get<bool>();
+		auto meshlets = entry.find( "meshlets" );
+		if( meshlets != entry.end() && meshlets->is_boolean() )
+			job.Params.meshlets = meshlets->get<bool>();
+		auto version = entry.find( "version" );
+		if( version != entry.end() && version->is_number() && ( version->get<double>() == 1.0 || version->get<double>() == 2.0 ) )
+			job.Params.version = version->get<uint32_t>();
+
+		jobs.push_back( job );
+	}
+	return true;
+}
+
+void WriteReport( const std::string& reportPath, const std::vector<BatchJob>& jobs ) {
+	std::ofstream file( reportPath, std::ios::out | std::ios::trunc );
+	if( !file.is_open() ) {
+		std::cout << "Couldn't write report '" << reportPath << "'" << std::endl;
+		return;
+	}
+
+	nlohmann::json report = nlohmann::json::array();
+	for( const BatchJob& job : jobs ) {
+		nlohmann::json entry;
+		entry["input"] = job.Params.input;
+		entry["output"] = job.Params.output;
+		entry["result"] = GetResultName( job.Result );
+		entry["seconds"] = job.Seconds;
+		entry["inputBytes"] = job.InputSize;
+		entry["outputBytes"] = job.OutputSize;
+		report.push_back( entry );
+	}
+	file << report.dump( 4 ) << std::endl;
+}
+
+bool RunBatch( const std::string& manifestPath ) {
+	std::vector<BatchJob> jobs;
+	uint32_t numThreads = 0;
+	std::string reportPath;
+	if( !ReadManifest( manifestPath, jobs, numThreads, reportPath ) )
+		return false;
+
+	// by default the scheduler uses all cores
+	if( numThreads > 0 )
+		concurrency::CurrentScheduler::Create( concurrency::SchedulerPolicy( 2, concurrency::MinConcurrency, 1, concurrency::MaxConcurrency, numThreads ) );
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::mutex outputMutex;
+	size_t numFinished = 0;
+	concurrency::parallel_for( size_t( 0 ), jobs.size(), [&]( size_t i ) {
+		BatchJob& job = jobs[i];
+		auto jobStart = std::chrono::high_resolution_clock::now();
+		// every job writes into its own log, which gets printed as a whole once the job is done
+		std::ostringstream log;
+
+		InputStamp stamp;
+		uint64_t outputTime;
+		if( IsUpToDate( job.Params, stamp ) ) {
+			job.Result = JobResult::Skipped;
+			GetFileInfo( job.Params.output, job.OutputSize, outputTime );
+			log << "Skipping unchanged '" << job.Params.input << "'" << std::endl;
+		}
+		else {
+			// a conversion that fails or gets interrupted must not leave the old stamp next to a new or partial output
+			std::string stampPath = job.Params.output + ".stamp";
+			std::remove( stampPath.c_str() );
+
+			flatbuffers::FlatBufferBuilder builder;
+			if( ConvertMesh( job.Params.input, job.Params, builder, log ) && SaveMesh( job.Params.output, builder, log ) ) {
+				job.Result = JobResult::Converted;
+				job.OutputSize = builder.GetSize();
+				if( GetFileInfo( job.Params.output, stamp.OutputSize, stamp.OutputWriteTime ) )
+					WriteStamp( stampPath, stamp );
+			}
+		}
+		job.InputSize = stamp.Size;
+		job.Seconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - jobStart ).count();
+
+		std::lock_guard<std::mutex> lock( outputMutex );
+		std::cout << "[" << ++numFinished << "/" << jobs.size() << "] " << log.str();
+	} );
+	double seconds = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count();
+
+	if( numThreads > 0 )
+		concurrency::CurrentScheduler::Detach();
+
+	size_t counts[3] = {};
+	uint64_t inputSize = 0, outputSize = 0;
+	std::cout << std::endl << std::left << std::setw( 10 ) << "Result" << std::right << std::setw( 10 ) << "Time (s)" << std::setw( 12 ) << "Input (MB)"
+		<< std::setw( 12 ) << "Output (MB)" << "  Asset" << std::endl;
+	std::cout << std::fixed << std::setprecision( 3 );
+	for( const BatchJob& job : jobs ) {
+		counts[static_cast<int>( job.Result )]++;
+		inputSize += job.InputSize;
+		outputSize += job.OutputSize;
+		std::cout << std::left << std::setw( 10 ) << GetResultName( job.Result ) << std::right << std::setw( 10 ) << job.Seconds
+			<< std::setw( 12 ) << job.InputSize / ( 1024.0 * 1024.0 ) << std::setw( 12 ) << job.OutputSize / ( 1024.0 * 1024.0 ) << "  " << job.Params.input << std::endl;
+	}
+	std::cout << counts[0] << " converted, " << counts[1] << " skipped, " << counts[2] << " failed in " << seconds << " s, "
+		<< inputSize / ( 1024.0 * 1024.0 ) << " MB -> " << outputSize / ( 1024.0 * 1024.0 ) << " MB" << std::endl;
+
+	if( !reportPath.empty() )
+		WriteReport( reportPath, jobs );
+
+	return counts[2] == 0;
+}
+
+int main( int argc, char *argv[] ) {
+	if( argc == 3 && std::string( argv[1] ) == "-b" )
+		return RunBatch( argv[2] ) ? 0 : 1;
+
 	Parameters params;
 	if( !ReadParameters( argc, argv, params ) )
-		return;
+		return 1;
+
+	auto start = std::chrono::high_resolution_clock::now();
 
 	flatbuffers::FlatBufferBuilder builder;
-	if( !ConvertMesh( params.input, params.combineMesh, builder ) ) 
-		return;
+	if( !ConvertMesh( params.input, params, builder, std::cout ) ) 
+		return 1;
+
+	if( !SaveMesh( params.output, builder, std::cout ) )
+		return 1;
 
-	SaveMesh( params.output, builder );
+	std::cout << "Total: " << std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - start ).count() << " s" << std::endl;
+	return 0;
 }
@@ -0,0 +1,272 @@
+// builds .tr files from .mesh files on the CPU, without a D3D device or window.
+// besides the solution it also builds with gcc or clang, Platform.h and Types.h replace PPL, the intrinsics and DirectXMath there:
+// g++ -O2 -std=c++14 -pthread -IEngine -IConvert TreeBuilder/main.cpp Engine/{Approximation,ConfigManager,CpuVoxelizer,Distance,emd,Game,Logger,Makros,MappedFile,Math,MeshFile,Time,TreeCompression,TreeFile}.cpp -o TreeBuilder
+#include "Game.h"
+#include "Logger.h"
+#include "Time.h"
+#include "ConfigManager.h"
+#include "MeshFile.h"
+#include "CpuVoxelizer.h"
+#include "TreeFile.h"
+#include "TreeBuild_Impl.h"
+#include "Morton.h"
+#include "Shader/VoxelDefines.hlsli"
+
+#include <string>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+
+struct Parameters {
+	std::wstring output = L"";
+	std::vector<std::wstring> meshes;
+	uint32_t resolution = 2048;
+	int similarityTest = 0;
+	float similarity = 2.f;
+	uint32_t voxelMode = VOXEL_MODE_CONSERVATIVE;
+	bool compress = false;
+	// the grid is the bounding cube of all meshes, if it isn't given
+	bool hasPosition = false, hasSize = false;
+	float3 position = { 0.f, 0.f, 0.f };
+	float3 size = { 0.f, 0.f, 0.f };
+};
+
+void PrintHelp( const std::wstring& name ) {
+	Game::GetLogger().PrintLine( L"Usage: " + name + L" outputfile.tr meshfile [meshfile ...] [-r <resolution=2048>] [-t <SimilarityTest=0>] [-s <Similarity=2>]" );
+	Game::GetLogger().PrintLine( L"       [-m <VoxelizationMode=0>] [-c <compress=false>] [-p <x y z>] [-e <x y z>]" );
+	Game::GetLogger().PrintLine( L"Similarity Test 0: PureSimilarity, 1: NeigborhoodSimilarity, 2: EMD, 3: DistanceField" );
+	Game::GetLogger().PrintLine( L"Voxelization Mode 0: Conservative, 1: 26-Separating, 2: 6-Separating" );
+	Game::GetLogger().PrintLine( L"-p and -e are the center and size of the voxel grid, like VoxelPos and VoxelSize of the config" );
+}
+
+bool ParseBool( const std::wstring& value, bool& result ) {
+	if( value == L"1" || value == L"true" || value == L"TRUE" || value == L"True" ) {
+		result = true;
+		return true;
+	}
+	if( value == L"0" || value == L"false" || value == L"FALSE" || value == L"False" ) {
+		result = false;
+		return true;
+	}
+	return false;
+}
+
+bool ParseFloat3( wchar_t* argv[], float3& result ) {
+	return StringToFloat( argv[0], result.x ) && StringToFloat( argv[1], result.y ) && StringToFloat( argv[2], result.z );
+}
+
+bool ReadParameters( int argc, wchar_t * argv[], Parameters& params ) {
+	if( argc < 3 || std::wstring( argv[1] ) == L"-h" || std::wstring( argv[1] ) == L"--help" ) {
+		PrintHelp( argv[0] );
+		return false;
+	}
+
+	params.output = argv[1];
+
+	for( int i = 2; i < argc; i++ ) {
+		std::wstring arg = argv[i];
+		if( arg.empty() || arg[0] != L'-' ) {
+			params.meshes.push_back( arg );
+			continue;
+		}
+
+		int value;
+		bool valid = false;
+		if( arg == L"-p" && i + 3 < argc ) {
+			valid = params.hasPosition = ParseFloat3( &argv[i + 1], params.position );
+			i += 3;
+		}
+		else if( arg == L"-e" && i + 3 < argc ) {
+			valid = params.hasSize = ParseFloat3( &argv[i + 1], params.size );
+			i += 3;
+		}
+		else if( i + 1 < argc ) {
+			std::wstring next = argv[++i];
+			if( arg == L"-r" ) {
+				valid = StringToInt( next, value ) && value >= 16;
+				params.resolution = value;
+			}
+			else if( arg == L"-t" ) {
+				valid = StringToInt( next, params.similarityTest );
+			}
+			else if( arg == L"-s" ) {
+				valid = StringToFloat( next, params.similarity );
+			}
+			else if( arg == L"-m" ) {
+				valid = StringToInt( next, value ) && value >= VOXEL_MODE_CONSERVATIVE && value <= VOXEL_MODE_6_SEPARATING;
+				params.voxelMode = value;
+			}
+			else if( arg == L"-c" ) {
+				valid = ParseBool( next, params.compress );
+			}
+		}
+
+		if( !valid ) {
+			Game::GetLogger().PrintLine( L"Invalid argument \"" + arg + L"\"." );
+			PrintHelp( argv[0] );
+			return false;
+		}
+	}
+
+	// the bricks of a part are addressed with 10 bits per axis
+	uint32_t partResolution = params.resolution > 4096 ? 4096 : params.resolution;
+	if( params.meshes.empty() || ( params.resolution & ( params.resolution - 1 ) ) != 0 || params.resolution % partResolution != 0 ) {
+		PrintHelp( argv[0] );
+		return false;
+	}
+	return true;
+}
+
+int wmain( int argc, wchar_t *argv[] ) {
+	Logger& logger = Logger::InitMainLogger();
+	logger.SetShowMessageBox( false );
+	Time::Init();
+	ConfigManager::Init( L"" );
+
+	Parameters params;
+	if( !ReadParameters( argc, argv, params ) )
+		return 1;
+
+	// builds running side by side would truncate each others log files in ./Log/
+	logger.SetLogDir( params.output + L".log/" );
+
+	// the tree build reads the similarity settings from the config
+	Game::GetConfig().SetInt( L"SimilarityTest", params.similarityTest );
+	Game::GetConfig().SetFloat( L"Similarity", params.similarity );
+
+	float startTime = Game::GetTime().GetRealTime();
+
+	// all meshes get voxelized at once, so their positions and indices are put together
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	float3 boxMin( FLT_MAX, FLT_MAX, FLT_MAX );
+	float3 boxMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	for( const std::wstring& meshFile : params.meshes ) {
+		std::vector<DecodedMesh> meshes;
+		if( !ReadMeshFile( meshFile, meshes ) )
+			return 1;
+		for( const DecodedMesh& mesh : meshes ) {
+			uint32_t offset = static_cast<uint32_t>( positions.size() );
+			// empty meshes are stored with a box at the origin
+			if( !mesh.Positions.empty() ) {
+				boxMin = float3( Min( boxMin.x, mesh.Bounds.first.x ), Min( boxMin.y, mesh.Bounds.first.y ), Min( boxMin.z, mesh.Bounds.first.z ) );
+				boxMax = float3( Max( boxMax.x, mesh.Bounds.second.x ), Max( boxMax.y, mesh.Bounds.second.y ), Max( boxMax.z, mesh.Bounds.second.z ) );
+			}
+			positions.insert( positions.end(), mesh.Positions.begin(), mesh.Positions.end() );
+			for( uint32_t index : mesh.Indices )
+				indices.push_back( index + offset );
+		}
+	}
+	uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+	if( numTriangles == 0 ) {
+		Game::GetLogger().Log( L"TreeBuilder", L"The meshes contain no triangles." );
+		return 1;
+	}
+
+	if( !params.hasPosition )
+		params.position = 0.5f * ( boxMin + boxMax );
+	if( !params.hasSize ) {
+		float3 extent = boxMax - boxMin;
+		float size = Max( extent.x, Max( extent.y, extent.z ) );
+		params.size = float3( size, size, size );
+	}
+
+	float readTime = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"TreeBuilder", L"Read " + std::to_wstring( positions.size() ) + L" vertices and " + std::to_wstring( numTriangles ) + L" triangles in "
+						   + std::to_wstring( ( readTime - startTime ) * 1000.f ) + L" ms" );
+	Game::GetLogger().Log( L"TreeBuilder", L"Voxel grid at " + std::to_wstring( params.position ) + L" with size " + std::to_wstring( params.size ) + L" and resolution "
+						   + std::to_wstring( params.resolution ) );
+
+	// same split into parts as the voxelizer
+	uint32_t resolutionMultiplier = params.resolution > 4096 ? params.resolution / 4096 : 1;
+	uint32_t width = params.resolution / resolutionMultiplier;
+	uint32_t maxLevel = static_cast<uint32_t>( ceil( log2( width ) / 2.f ) ) - 1;
+	uint32_t numParts = resolutionMultiplier * resolutionMultiplier * resolutionMultiplier;
+	float3 partSize = params.size / static_cast<float>( resolutionMultiplier );
+
+	std::vector<PartTree> partTrees( numParts );
+	size_t totalBricks = 0;
+	float voxelizationTime = 0.f, treeBuildTime = 0.f;
+	for( uint32_t part = 0; part < numParts; part++ ) {
+		float partStart = Game::GetTime().GetRealTime();
+
+		CpuVoxelizeData data;
+		data.GridSize = width;
+		data.VoxelMode = params.voxelMode;
+		data.MinBoxPos = make_float3( MortonDecode( part ) ) * partSize + params.position - 0.5f * params.size;
+		data.BoxSize = partSize;
+
+		std::vector<Node> bricks;
+		VoxelizeTriangles( data, positions.data(), indices.data(), numTriangles, bricks );
+
+		float voxelized = Game::GetTime().GetRealTime();
+		voxelizationTime += voxelized - partStart;
+		Game::GetLogger().Log( L"TreeBuilder", L"Part " + std::to_wstring( part + 1 ) + L"/" + std::to_wstring( numParts ) + L": " + std::to_wstring( bricks.size() )
+							   + L" bricks voxelized in " + std::to_wstring( ( voxelized - partStart ) * 1000.f ) + L" ms" );
+		if( bricks.empty() )
+			continue;
+
+		uint32_t numBricks = static_cast<uint32_t>( bricks.size() );
+		totalBricks += numBricks;
+
+		PartTree& tree = partTrees[part];
+		tree.Nodes.resize( numBricks * ( maxLevel + 1 ) + 1 );
+		tree.Pointers.resize( tree.Nodes.size() );
+		std::copy( bricks.begin(), bricks.end(), tree.Nodes.begin() );
+		bricks = std::vector<Node>();
+
+		uint32_t nodeSize, pointerSize;
+		DebugData debugData( maxLevel + 1 );
+		BuildTree( tree.Nodes.data(), tree.Pointers.data(), numBricks, maxLevel, nodeSize, pointerSize, debugData );
+		tree.Nodes.resize( nodeSize );
+		tree.Pointers.resize( pointerSize );
+
+		treeBuildTime += Game::GetTime().GetRealTime() - voxelized;
+	}
+
+	if( totalBricks == 0 ) {
+		Game::GetLogger().Log( L"TreeBuilder", L"No voxels inside the grid." );
+		return 1;
+	}
+
+	bool stored;
+	if( resolutionMultiplier > 1 ) {
+		size_t nodeSize = 1;
+		size_t pointerSize = 1;
+		for( const PartTree& tree : partTrees ) {
+			if( !tree.Nodes.empty() ) {
+				nodeSize += tree.Nodes.size();
+				pointerSize += tree.Pointers.size() + 1;
+			}
+		}
+		std::vector<Node> nodes( nodeSize );
+		std::vector<uint32_t> pointers( pointerSize );
+		uint32_t numNodes, numPointers;
+		StitchTreeParts( partTrees, nodes.data(), pointers.data(), numNodes, numPointers );
+		stored = StoreTreeFile( params.resolution, params.position, params.size, nodes.data(), numNodes, pointers.data(), numPointers, params.output, params.compress );
+	}
+	else {
+		const PartTree& tree = partTrees[0];
+		stored = StoreTreeFile( params.resolution, params.position, params.size, tree.Nodes.data(), static_cast<uint32_t>( tree.Nodes.size() ),
+								tree.Pointers.data(), static_cast<uint32_t>( tree.Pointers.size() ), params.output, params.compress );
+	}
+
+	float endTime = Game::GetTime().GetRealTime();
+	Game::GetLogger().Log( L"TreeBuilder", std::to_wstring( totalBricks ) + L" bricks, " + std::to_wstring( voxelizationTime * 1000.f ) + L" ms voxelization, "
+						   + std::to_wstring( treeBuildTime * 1000.f ) + L" ms tree build, " + std::to_wstring( ( endTime - startTime ) * 1000.f ) + L" ms total" );
+
+	return stored ? 0 : 1;
+}
+
+#ifndef _WIN32
+// gcc and clang have no wmain, the arguments are utf-8 there
+int main( int argc, char *argv[] ) {
+	std::vector<std::wstring> arguments;
+	for( int i = 0; i < argc; i++ )
+		arguments.push_back( s2ws( argv[i] ) );
+	std::vector<wchar_t*> wideArgv;
+	for( std::wstring& argument : arguments )
+		wideArgv.push_back( &argument[0] );
+	return wmain( argc, wideArgv.data() );
+}
+#endif
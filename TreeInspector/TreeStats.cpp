@@ -0,0 +1,165 @@
+#include "TreeStats.h"
+
+#include <ppl.h>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <intrin.h>
+
+#include "Makros.h"
+#include "TreeFile.h"
+#include "Voxelizer.h"
+
+namespace {
+const size_t CacheLineSize = 64;
+// nodes of the current level per parallel work item
+const size_t NodesPerTask = 4096;
+
+struct ThreadStats {
+	LevelStats Level;
+	// references, full children and pointer lines are found while visiting the parents
+	LevelStats NextLevel;
+	std::array<uint64_t, NumDistanceBuckets> ChildDistances = {};
+	uint64_t InvalidPointers = 0;
+	// nodes of the next level that were reached first by this thread
+	std::vector<uint32_t> Children;
+};
+
+// every entry keeps the level + 1 of its first visit, so it gets counted only once
+class VisitMarks {
+public:
+	explicit VisitMarks( size_t size )
+		: m_Marks( new std::atomic<uint8_t>[size] ) {
+		for( size_t i = 0; i < size; i++ )
+			m_Marks[i].store( 0, std::memory_order_relaxed );
+	}
+
+	bool Visit( size_t idx, uint32_t level ) {
+		uint8_t expected = 0;
+		return m_Marks[idx].compare_exchange_strong( expected, static_cast<uint8_t>( level + 1 ), std::memory_order_relaxed );
+	}
+private:
+	std::unique_ptr<std::atomic<uint8_t>[]> m_Marks;
+};
+
+uint32_t GetDistanceBucket( uint64_t distance ) {
+	uint32_t bucket = 0;
+	while( distance > 0 && bucket < NumDistanceBuckets - 1 ) {
+		distance >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void AddLevelStats( LevelStats& target, const LevelStats& source ) {
+	target.Nodes += source.Nodes;
+	target.References += source.References;
+	target.FullChildren += source.FullChildren;
+	target.SolidNodes += source.SolidNodes;
+	for( size_t i = 0; i < target.BitCounts.size(); i++ )
+		target.BitCounts[i] += source.BitCounts[i];
+	target.NodeLines += source.NodeLines;
+	target.PointerLines += source.PointerLines;
+}
+
+uint32_t VisitLines( VisitMarks& marks, size_t firstByte, size_t lastByte, uint32_t level ) {
+	uint32_t newLines = 0;
+	for( size_t line = firstByte / CacheLineSize; line <= lastByte / CacheLineSize; line++ ) {
+		if( marks.Visit( line, level ) )
+			newLines++;
+	}
+	return newLines;
+}
+}
+
+void ComputeTreeStats( const TreeView & tree, TreeStats & stats ) {
+	stats = TreeStats();
+	if( tree.Nodes.Size == 0 || tree.Pointers.Size == 0 || tree.Pointers[0] >= tree.Nodes.Size ) {
+		stats.InvalidPointers = 1;
+		return;
+	}
+
+	// same depth as the traversal in TreeTraverse.hlsli, the nodes at the leaf level are bricks
+	stats.LeafLevel = tree.Resolution > 4 ? static_cast<uint32_t>( ceil( log2( tree.Resolution ) / 2.f ) - 1 ) : 0;
+	stats.Levels.resize( stats.LeafLevel + 1 );
+
+	size_t numNodes = tree.Nodes.Size;
+	size_t numPointers = tree.Pointers.Size;
+	VisitMarks nodeMarks( numNodes );
+	VisitMarks nodeLineMarks( ( numNodes * sizeof( Node ) + CacheLineSize - 1 ) / CacheLineSize );
+	VisitMarks pointerLineMarks( ( numPointers * sizeof( uint32_t ) + CacheLineSize - 1 ) / CacheLineSize );
+
+	// the root is reached through the first pointer
+	std::vector<uint32_t> frontier( 1, tree.Pointers[0] );
+	nodeMarks.Visit( frontier[0], 0 );
+	stats.Levels[0].References = 1;
+	pointerLineMarks.Visit( 0, 0 );
+	stats.Levels[0].PointerLines = 1;
+
+	uint64_t reachedNodes = 0;
+	for( uint32_t level = 0; level <= stats.LeafLevel && !frontier.empty(); level++ ) {
+		bool isLeaf = level == stats.LeafLevel;
+		LevelStats& levelStats = stats.Levels[level];
+		levelStats.Nodes = frontier.size();
+		reachedNodes += frontier.size();
+
+		concurrency::combinable<ThreadStats> threadStats;
+		size_t numTasks = ( frontier.size() + NodesPerTask - 1 ) / NodesPerTask;
+		concurrency::parallel_for( size_t( 0 ), numTasks, [&]( size_t task ) {
+			ThreadStats& local = threadStats.local();
+			size_t end = Min( ( task + 1 ) * NodesPerTask, frontier.size() );
+			for( size_t i = task * NodesPerTask; i < end; i++ ) {
+				uint32_t nodeIdx = frontier[i];
+				const Node& node = tree.Nodes[nodeIdx];
+				local.Level.NodeLines += VisitLines( nodeLineMarks, nodeIdx * sizeof( Node ), nodeIdx * sizeof( Node ) + sizeof( Node ) - 1, level );
+
+				uint32_t numBits = __popcnt( node.Data.x ) + __popcnt( node.Data.y );
+				local.Level.BitCounts[numBits]++;
+				if( numBits == 64 )
+					local.Level.SolidNodes++;
+				if( isLeaf || numBits == 0 )
+					continue;
+
+				if( static_cast<size_t>( node.Pointer ) + numBits > numPointers ) {
+					local.InvalidPointers++;
+					continue;
+				}
+				// the pointers to the children of a node are stored next to each other
+				local.NextLevel.PointerLines += VisitLines( pointerLineMarks, node.Pointer * sizeof( uint32_t ), ( node.Pointer + numBits ) * sizeof( uint32_t ) - 1, level + 1 );
+
+				for( uint32_t child = 0; child < numBits; child++ ) {
+					uint32_t childIdx = tree.Pointers[node.Pointer + child];
+					if( childIdx == 0xFFFFFFFF ) {
+						local.NextLevel.FullChildren++;
+						continue;
+					}
+					if( childIdx >= numNodes ) {
+						local.InvalidPointers++;
+						continue;
+					}
+					local.NextLevel.References++;
+					uint64_t distance = ( childIdx > nodeIdx ? childIdx - nodeIdx : nodeIdx - childIdx ) * sizeof( Node );
+					local.ChildDistances[GetDistanceBucket( distance )]++;
+					if( nodeMarks.Visit( childIdx, level + 1 ) )
+						local.Children.push_back( childIdx );
+				}
+			}
+		} );
+
+		std::vector<uint32_t> nextFrontier;
+		threadStats.combine_each( [&]( const ThreadStats& local ) {
+			AddLevelStats( levelStats, local.Level );
+			if( !isLeaf )
+				AddLevelStats( stats.Levels[level + 1], local.NextLevel );
+			for( size_t i = 0; i < local.ChildDistances.size(); i++ )
+				stats.ChildDistances[i] += local.ChildDistances[i];
+			stats.InvalidPointers += local.InvalidPointers;
+			nextFrontier.insert( nextFrontier.end(), local.Children.begin(), local.Children.end() );
+		} );
+		// visiting the next level in memory order keeps the walk itself cache friendly
+		concurrency::parallel_sort( nextFrontier.begin(), nextFrontier.end() );
+		frontier.swap( nextFrontier );
+	}
+
+	stats.UnreachableNodes = numNodes - reachedNodes;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <array>
+
+#include "Types.h"
+
+struct TreeView;
+
+const uint32_t NumDistanceBuckets = 40;
+
+struct LevelStats {
+	// distinct nodes of the level and how often they are referenced by the level above
+	uint64_t Nodes = 0;
+	uint64_t References = 0;
+	// children stored as -1, so completely filled without a node
+	uint64_t FullChildren = 0;
+	// nodes with all 64 bits set, they could have been stored as full children
+	uint64_t SolidNodes = 0;
+	// set bits per node, children for inner nodes and voxels for the bricks
+	std::array<uint64_t, 65> BitCounts = {};
+	// 64 byte lines first touched by a traversal at this level
+	uint64_t NodeLines = 0;
+	uint64_t PointerLines = 0;
+};
+
+struct TreeStats {
+	uint32_t LeafLevel = 0;
+	std::vector<LevelStats> Levels;
+	// log2 of the byte distance between a node and its children in the node array, bucket 0 is a distance of 0
+	std::array<uint64_t, NumDistanceBuckets> ChildDistances = {};
+	uint64_t InvalidPointers = 0;
+	uint64_t UnreachableNodes = 0;
+};
+
+// walks the tree level by level from the root and collects the statistics, each level is processed in parallel
+void ComputeTreeStats( const TreeView& tree, TreeStats& stats );
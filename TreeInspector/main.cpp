@@ -0,0 +1,633 @@
+#include "Game.h"
+#include "Logger.h"
+#include "Time.h"
+#include "Makros.h"
+#include "Math.h"
+#include "TreeFile.h"
+#include "Voxelizer.h"
+#include "TreeStats.h"
+#include "OcclusionQuery.h"
+#include "EmptyDistance.h"
+#include "Approximation.h"
+#include "ImageDiff.h"
+#include "SampleTable.h"
+#include "TraversalVectors.h"
+#include "Shader\VoxelDefines.hlsli"
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+// typical sizes of a per core L1 and L2 and a shared L3
+const size_t CacheSizes[] = { 32 * 1024, 256 * 1024, 1024 * 1024, 8 * 1024 * 1024, 32 * 1024 * 1024 };
+const size_t LineSize = 64;
+// the benchmark takes the fastest of a few runs
+const uint32_t BenchmarkRuns = 3;
+// size of the light for the soft shadow rays, relative to its distance
+const float LightRadius = 0.2f;
+// stratified rays per axis of the light for the soft shadow reference, 10x10 like JITTER in psShadow.hlsl
+const uint32_t ReferenceSamples = 10;
+// light directions per axis of the jittered soft shadows the cone traces are compared to
+const uint32_t JitterSamples[] = { 2, 4 };
+// the per pixel shuffle and the table of SAMPLE_TABLE are compared to a reference with more rays
+const uint32_t PatternReferenceSamples = 32;
+const uint32_t PatternSamples[] = { 2, 4, 6, 8, 10 };
+// mismatching traversal vectors that get printed
+const uint32_t PrintedMismatches = 10;
+// of the orthographic view rays and the directional light
+const float3 ViewDir = Normalize( float3( 0.3f, -1.f, 0.2f ) );
+const float3 LightDir = Normalize( float3( -0.4f, 1.f, -0.6f ) );
+
+void PrintHelp( const std::wstring& name ) {
+	Game::GetLogger().PrintLine( L"Usage: " + name + L" [-b <numRays>] [-s <numPoints>] [-a <LightAngle=5>] [-v <vectorfile>] treefile.tr [treefile.tr ...]" );
+	Game::GetLogger().PrintLine( L"-b traces primary, shadow and soft shadow rays with OcclusionQuery instead of printing the statistics" );
+	Game::GetLogger().PrintLine( L"-s compares the soft shadows of SmoothTraverse1 and SmoothTraverse2 to 100 jittered rays per point, -a is the light size in degrees" );
+	Game::GetLogger().PrintLine( L"   and the convergence of the per pixel sample shuffle of psShadow.hlsl to the table of SAMPLE_TABLE" );
+	Game::GetLogger().PrintLine( L"-v traces the rays of a file recorded by the engine (TraversalVectorPath) with OcclusionQuery, hits and steps have to match the shader" );
+}
+
+double Percent( uint64_t value, uint64_t total ) {
+	return total > 0 ? 100.0 * value / total : 0.0;
+}
+
+// histogram of the set bits per node in groups of 8, 0 and 64 get their own group
+void PrintBitCounts( const std::wstring& title, const std::array<uint64_t, 65>& counts ) {
+	uint64_t total = 0;
+	for( uint64_t count : counts )
+		total += count;
+	if( total == 0 )
+		return;
+
+	std::wcout << title << std::endl;
+	std::wcout << L"  " << std::setw( 7 ) << L"0" << std::setw( 10 ) << counts[0] << std::setw( 8 ) << Percent( counts[0], total ) << L" %" << std::endl;
+	for( uint32_t first = 1; first < 64; first += 8 ) {
+		uint64_t count = 0;
+		for( uint32_t i = first; i < first + 8 && i < 64; i++ )
+			count += counts[i];
+		std::wstring range = std::to_wstring( first ) + L"-" + std::to_wstring( Min( first + 7, 63u ) );
+		std::wcout << L"  " << std::setw( 7 ) << range << std::setw( 10 ) << count << std::setw( 8 ) << Percent( count, total ) << L" %" << std::endl;
+	}
+	std::wcout << L"  " << std::setw( 7 ) << L"64" << std::setw( 10 ) << counts[64] << std::setw( 8 ) << Percent( counts[64], total ) << L" %" << std::endl;
+}
+
+void PrintStats( const TreeView& tree, const TreeStats& stats ) {
+	std::wcout << std::fixed << std::setprecision( 2 );
+	std::wcout << std::endl << std::setw( 5 ) << L"Level" << std::setw( 12 ) << L"Nodes" << std::setw( 12 ) << L"References" << std::setw( 9 ) << L"Sharing"
+		<< std::setw( 12 ) << L"Full" << std::setw( 12 ) << L"Solid" << std::setw( 10 ) << L"Avg bits" << std::setw( 13 ) << L"Lines (KB)" << std::setw( 13 ) << L"Total (KB)" << std::endl;
+
+	uint64_t totalNodes = 0, totalReferences = 0, totalLines = 0;
+	std::array<uint64_t, 65> innerBits = {};
+	std::vector<uint64_t> cumulativeLines;
+	for( size_t level = 0; level < stats.Levels.size(); level++ ) {
+		const LevelStats& levelStats = stats.Levels[level];
+		uint64_t bits = 0;
+		for( size_t i = 0; i < levelStats.BitCounts.size(); i++ ) {
+			bits += i * levelStats.BitCounts[i];
+			if( level < stats.LeafLevel )
+				innerBits[i] += levelStats.BitCounts[i];
+		}
+		uint64_t lines = levelStats.NodeLines + levelStats.PointerLines;
+		totalNodes += levelStats.Nodes;
+		totalReferences += levelStats.References;
+		totalLines += lines;
+		cumulativeLines.push_back( totalLines );
+
+		std::wcout << std::setw( 5 ) << level << std::setw( 12 ) << levelStats.Nodes << std::setw( 12 ) << levelStats.References
+			<< std::setw( 9 ) << ( levelStats.Nodes > 0 ? static_cast<double>( levelStats.References ) / levelStats.Nodes : 0.0 )
+			<< std::setw( 12 ) << levelStats.FullChildren << std::setw( 12 ) << levelStats.SolidNodes
+			<< std::setw( 10 ) << ( levelStats.Nodes > 0 ? static_cast<double>( bits ) / levelStats.Nodes : 0.0 )
+			<< std::setw( 13 ) << lines * LineSize / 1024.0 << std::setw( 13 ) << totalLines * LineSize / 1024.0 << std::endl;
+	}
+	std::wcout << L"Sharing factor " << ( totalNodes > 0 ? static_cast<double>( totalReferences ) / totalNodes : 0.0 ) << L" (references per node), "
+		<< stats.UnreachableNodes << L" unreachable nodes, " << stats.InvalidPointers << L" invalid pointers" << std::endl;
+
+	uint64_t solidNodes = 0, fullChildren = 0;
+	for( const LevelStats& levelStats : stats.Levels ) {
+		solidNodes += levelStats.SolidNodes;
+		fullChildren += levelStats.FullChildren;
+	}
+	std::wcout << L"Solid: " << solidNodes << L" nodes (" << Percent( solidNodes, totalNodes ) << L" %) are completely filled, "
+		<< fullChildren << L" children (" << Percent( fullChildren, fullChildren + totalReferences ) << L" % of all children) are stored as full pointers" << std::endl;
+
+	std::wcout << std::endl;
+	PrintBitCounts( L"Children per inner node:", innerBits );
+	if( stats.LeafLevel < stats.Levels.size() )
+		PrintBitCounts( L"Voxels per brick:", stats.Levels[stats.LeafLevel].BitCounts );
+
+	uint64_t numDistances = 0;
+	for( uint64_t count : stats.ChildDistances )
+		numDistances += count;
+	std::wcout << std::endl << L"Distance from node to child in the node array:" << std::endl;
+	uint64_t closer = 0;
+	for( uint32_t bucket = 0; bucket < NumDistanceBuckets; bucket++ ) {
+		closer += stats.ChildDistances[bucket];
+		if( stats.ChildDistances[bucket] == 0 )
+			continue;
+		uint64_t maxDistance = bucket == 0 ? 0 : ( 1ull << bucket ) - 1;
+		std::wcout << L"  <= " << std::setw( 14 ) << maxDistance << L" B" << std::setw( 12 ) << stats.ChildDistances[bucket]
+			<< std::setw( 8 ) << Percent( stats.ChildDistances[bucket], numDistances ) << L" %" << std::setw( 8 ) << Percent( closer, numDistances ) << L" %" << std::endl;
+	}
+
+	std::wcout << std::endl << L"Traversal footprint, deepest level whose nodes and pointers up to the root fit into a cache:" << std::endl;
+	for( size_t cacheSize : CacheSizes ) {
+		int fittingLevel = -1;
+		for( size_t level = 0; level < cumulativeLines.size(); level++ ) {
+			if( cumulativeLines[level] * LineSize <= cacheSize )
+				fittingLevel = static_cast<int>( level );
+		}
+		std::wcout << std::setw( 8 ) << cacheSize / 1024 << L" KB: ";
+		if( fittingLevel < 0 )
+			std::wcout << L"none" << std::endl;
+		else
+			std::wcout << L"level " << fittingLevel << std::endl;
+	}
+	std::wcout << L"  whole tree: " << ( tree.Nodes.Size * sizeof( Node ) + tree.Pointers.Size * sizeof( uint32_t ) ) / ( 1024.0 * 1024.0 ) << L" MB, touched: "
+		<< totalLines * LineSize / ( 1024.0 * 1024.0 ) << L" MB" << std::endl;
+}
+
+// seconds of the fastest run
+float TimeBatch( const OcclusionQuery& query, const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits, bool usePackets, bool sortRays ) {
+	float best = FLT_MAX;
+	for( uint32_t run = 0; run < BenchmarkRuns; run++ ) {
+		float start = Game::GetTime().GetRealTime();
+		if( sortRays )
+			query.TraceSorted( rays, hits, usePackets );
+		else
+			query.TraceBatch( rays, hits, usePackets );
+		best = Min( best, Game::GetTime().GetRealTime() - start );
+	}
+	return best;
+}
+
+void PrintBenchmark( const std::wstring& title, const OcclusionQuery& query, Span<uint4> emptyDistances, const std::vector<OcclusionRay>& rays, std::vector<OcclusionHit>& hits ) {
+	std::vector<OcclusionHit> packetHits, sortedHits, sortedPacketHits;
+	float singleTime = TimeBatch( query, rays, hits, false, false );
+	float packetTime = TimeBatch( query, rays, packetHits, true, false );
+	// the sorted times include the sort
+	float sortedTime = TimeBatch( query, rays, sortedHits, false, true );
+	float sortedPacketTime = TimeBatch( query, rays, sortedPacketHits, true, true );
+
+	size_t numHits = 0, differences = 0;
+	for( size_t i = 0; i < rays.size(); i++ ) {
+		numHits += hits[i].Hit ? 1 : 0;
+		differences += hits[i].Hit != packetHits[i].Hit || hits[i].Hit != sortedHits[i].Hit || hits[i].Hit != sortedPacketHits[i].Hit ? 1 : 0;
+	}
+	double numRays = static_cast<double>( rays.size() );
+	std::wcout << title << std::setw( 10 ) << rays.size() << L" rays, " << std::setw( 6 ) << Percent( numHits, rays.size() ) << L" % hits, Mrays/s: single "
+		<< std::setw( 7 ) << numRays / singleTime / 1e6 << L", packets " << std::setw( 7 ) << numRays / packetTime / 1e6
+		<< L", sorted " << std::setw( 7 ) << numRays / sortedTime / 1e6 << L", sorted packets " << std::setw( 7 ) << numRays / sortedPacketTime / 1e6
+		<< L", " << differences << L" different results" << std::endl;
+
+	// the single rays above use the short stack
+	OcclusionQuery restartQuery = query;
+	restartQuery.SetShortStack( false );
+	std::vector<OcclusionHit> restartHits;
+	float restartTime = TimeBatch( restartQuery, rays, restartHits, false, false );
+	uint64_t nodes = 0, restartNodes = 0;
+	for( size_t i = 0; i < rays.size(); i++ ) {
+		nodes += hits[i].Nodes;
+		restartNodes += restartHits[i].Nodes;
+	}
+	std::wcout << L"          nodes per ray: restart at the root " << std::setw( 7 ) << restartNodes / numRays << L" (" << numRays / restartTime / 1e6
+		<< L" Mrays/s), short stack " << std::setw( 7 ) << nodes / numRays << L" (" << numRays / singleTime / 1e6 << L" Mrays/s)";
+
+	// the nodes of the beams are shared by their rays
+	std::vector<OcclusionHit> beamHits;
+	float beamTime = FLT_MAX;
+	uint64_t beamNodes = 0;
+	for( uint32_t run = 0; run < BenchmarkRuns; run++ ) {
+		float start = Game::GetTime().GetRealTime();
+		beamNodes = restartQuery.TraceBeamBatch( rays, beamHits );
+		beamTime = Min( beamTime, Game::GetTime().GetRealTime() - start );
+	}
+	differences = 0;
+	uint64_t beamMisses = 0;
+	for( size_t i = 0; i < rays.size(); i++ ) {
+		beamNodes += beamHits[i].Nodes;
+		beamMisses += beamHits[i].BeamMisses;
+		differences += hits[i].Hit != beamHits[i].Hit ? 1 : 0;
+	}
+	// lookups outside of the beams should only come from rounding at the border of a beam
+	std::wcout << L", beams " << std::setw( 7 ) << beamNodes / numRays << L" (" << numRays / beamTime / 1e6 << L" Mrays/s), "
+		<< differences << L" different results, " << beamMisses << L" lookups outside of the beams" << std::endl;
+
+	OcclusionQuery distanceQuery = query;
+	distanceQuery.SetEmptyDistances( emptyDistances );
+	std::vector<OcclusionHit> distanceHits;
+	float distanceTime = TimeBatch( distanceQuery, rays, distanceHits, false, false );
+	uint64_t steps = 0, distanceSteps = 0;
+	differences = 0;
+	for( size_t i = 0; i < rays.size(); i++ ) {
+		steps += hits[i].Steps;
+		distanceSteps += distanceHits[i].Steps;
+		differences += hits[i].Hit != distanceHits[i].Hit ? 1 : 0;
+	}
+	std::wcout << L"          steps per ray: cell by cell " << std::setw( 7 ) << steps / numRays << L" (" << numRays / singleTime / 1e6
+		<< L" Mrays/s), empty distances " << std::setw( 7 ) << distanceSteps / numRays << L" (" << numRays / distanceTime / 1e6 << L" Mrays/s), "
+		<< differences << L" different results" << std::endl;
+}
+
+// orthographic view rays from above in tiles of 8x8 pixels made of packets of 4x2 pixels, so consecutive rays form a packet and a beam
+void GetViewRays( const TreeView& tree, uint32_t numRays, std::vector<OcclusionRay>& viewRays ) {
+	uint32_t width = Max( 8u, static_cast<uint32_t>( sqrt( static_cast<double>( numRays ) ) ) / 8 * 8 );
+	uint32_t height = Max( 8u, numRays / width / 8 * 8 );
+	float3 minPos = tree.Position - 0.5f * tree.Size;
+	viewRays.clear();
+	viewRays.reserve( width * height );
+	for( uint32_t tileY = 0; tileY < height; tileY += 8 ) {
+		for( uint32_t tileX = 0; tileX < width; tileX += 8 ) {
+			for( uint32_t i = 0; i < OcclusionBeamSize; i++ ) {
+				uint32_t packet = i / OcclusionPacketSize;
+				uint32_t x = ( packet % 2 ) * 4 + i % 4;
+				uint32_t y = ( packet / 2 ) * 2 + ( i / 4 ) % 2;
+				float u = ( tileX + x + 0.5f ) / width;
+				float v = ( tileY + y + 0.5f ) / height;
+				OcclusionRay ray;
+				ray.Origin = minPos + float3( u * tree.Size.x, tree.Size.y, v * tree.Size.z ) - ViewDir * tree.Size.y * 0.5f;
+				ray.Direction = ViewDir;
+				viewRays.push_back( ray );
+			}
+		}
+	}
+}
+
+// view rays from GetViewRays and shadow rays from their hits to a directional light.
+// the soft shadow rays are jittered over the light like the samples of psShadow.hlsl, the last run shuffles them like the rays of a path tracer
+void RunBenchmark( const TreeView& tree, uint32_t numRays ) {
+	OcclusionQuery query( tree );
+	float distanceStart = Game::GetTime().GetRealTime();
+	std::vector<uint4> distances( tree.Nodes.Size );
+	ComputeEmptyDistances( tree.Nodes.Data, static_cast<uint32_t>( tree.Nodes.Size ), distances.data() );
+	Span<uint4> emptyDistances;
+	emptyDistances.Data = distances.data();
+	emptyDistances.Size = distances.size();
+	float distanceTime = Game::GetTime().GetRealTime() - distanceStart;
+	// moves the shadow origins out of the hit voxel
+	float shadowOffset = 2.f * Max( tree.Size.x, Max( tree.Size.y, tree.Size.z ) ) / tree.Resolution;
+
+	std::vector<OcclusionRay> viewRays;
+	GetViewRays( tree, numRays, viewRays );
+
+	std::vector<OcclusionHit> viewHits;
+	std::wcout << std::fixed << std::setprecision( 2 ) << L"Packets " << ( OcclusionQuery::HasPacketSupport() ? L"use avx2" : L"are traced as single rays, no avx2" ) << std::endl;
+	std::wcout << L"Empty distances: " << distances.size() * sizeof( uint4 ) / ( 1024.0 * 1024.0 ) << L" MB computed in " << distanceTime * 1000.f << L" ms" << std::endl;
+	PrintBenchmark( L"Primary:", query, emptyDistances, viewRays, viewHits );
+
+	std::vector<OcclusionRay> shadowRays;
+	for( size_t i = 0; i < viewRays.size(); i++ ) {
+		if( !viewHits[i].Hit )
+			continue;
+		OcclusionRay ray;
+		ray.Origin = viewRays[i].Origin + viewRays[i].Direction * viewHits[i].Distance + LightDir * shadowOffset;
+		ray.Direction = LightDir;
+		shadowRays.push_back( ray );
+	}
+	std::vector<OcclusionHit> shadowHits;
+	if( shadowRays.empty() )
+		return;
+	PrintBenchmark( L"Shadow: ", query, emptyDistances, shadowRays, shadowHits );
+
+	float3 lightSide = Normalize( Cross( LightDir, float3( 1.f, 0.f, 0.f ) ) );
+	float3 lightUp = Normalize( Cross( LightDir, lightSide ) );
+	std::default_random_engine engine;
+	std::uniform_real_distribution<float> distr( -LightRadius, LightRadius );
+	for( OcclusionRay& ray : shadowRays )
+		ray.Direction = Normalize( LightDir + distr( engine ) * lightSide + distr( engine ) * lightUp );
+	PrintBenchmark( L"Soft:   ", query, emptyDistances, shadowRays, shadowHits );
+	std::shuffle( shadowRays.begin(), shadowRays.end(), engine );
+	PrintBenchmark( L"Random: ", query, emptyDistances, shadowRays, shadowHits );
+}
+
+// samplesPerAxis x samplesPerAxis stratified rays per point with directions in the square of jitterRadius around the light like JITTER in psShadow.hlsl
+void GetJitteredRays( const std::vector<OcclusionRay>& points, uint32_t samplesPerAxis, float jitterRadius, std::default_random_engine& engine, std::vector<OcclusionRay>& rays ) {
+	float3 lightSide = Normalize( Cross( LightDir, float3( 1.f, 0.f, 0.f ) ) );
+	float3 lightUp = Normalize( Cross( LightDir, lightSide ) );
+	std::uniform_real_distribution<float> distr( 0.f, 1.f );
+	rays.clear();
+	rays.reserve( points.size() * samplesPerAxis * samplesPerAxis );
+	for( const OcclusionRay& point : points ) {
+		for( uint32_t y = 0; y < samplesPerAxis; y++ ) {
+			for( uint32_t x = 0; x < samplesPerAxis; x++ ) {
+				float randX = ( 2.f * ( x + distr( engine ) ) / samplesPerAxis - 1.f ) * jitterRadius;
+				float randY = ( 2.f * ( y + distr( engine ) ) / samplesPerAxis - 1.f ) * jitterRadius;
+				OcclusionRay ray = point;
+				ray.Direction = Normalize( LightDir + randX * lightSide + randY * lightUp );
+				rays.push_back( ray );
+			}
+		}
+	}
+}
+
+// fraction of the rays of each point that hit, with their time per point
+float TraceJittered( const OcclusionQuery& query, const std::vector<OcclusionRay>& points, uint32_t samplesPerAxis, float jitterRadius, std::vector<float>& occlusion ) {
+	std::default_random_engine engine( samplesPerAxis );
+	std::vector<OcclusionRay> rays;
+	GetJitteredRays( points, samplesPerAxis, jitterRadius, engine, rays );
+	std::vector<OcclusionHit> hits;
+	float time = TimeBatch( query, rays, hits, true, false );
+
+	uint32_t samples = samplesPerAxis * samplesPerAxis;
+	occlusion.assign( points.size(), 0.f );
+	for( size_t i = 0; i < hits.size(); i++ )
+		occlusion[i / samples] += hits[i].Hit ? 1.f / samples : 0.f;
+	return time;
+}
+
+// the multi-jittered points of JITTER in psShadow.hlsl, shuffled per pixel
+void GetShuffledSamples( uint32_t samplesPerAxis, std::default_random_engine& engine, float2* p ) {
+	std::uniform_real_distribution<float> distr( 0.f, 1.f );
+	int iN = static_cast<int>( samplesPerAxis );
+	float fN = static_cast<float>( samplesPerAxis );
+	for( int j = 0; j < iN; ++j ) {
+		for( int i = 0; i < iN; ++i ) {
+			p[j * iN + i].x = ( i + ( j + distr( engine ) ) / fN ) / fN;
+			p[j * iN + i].y = ( j + ( i + distr( engine ) ) / fN ) / fN;
+		}
+	}
+	for( int j = 0; j < iN; ++j ) {
+		int k = Min( static_cast<int>( j + distr( engine ) * ( iN - j ) ), iN - 1 );
+		for( int i = 0; i < iN; ++i )
+			std::swap( p[j * iN + i].x, p[k * iN + i].x );
+	}
+	for( int i = 0; i < iN; ++i ) {
+		int k = Min( static_cast<int>( i + distr( engine ) * ( iN - i ) ), iN - 1 );
+		for( int j = 0; j < iN; ++j )
+			std::swap( p[j * iN + i].y, p[j * iN + k].y );
+	}
+}
+
+// like TraceJittered with the points of GetShuffledSamples or, with a table, the set of the point like the pixels of SAMPLE_TABLE
+void TracePattern( const OcclusionQuery& query, const std::vector<OcclusionRay>& points, uint32_t samplesPerAxis, float jitterRadius, const float2* table, std::vector<float>& occlusion ) {
+	float3 lightSide = Normalize( Cross( LightDir, float3( 1.f, 0.f, 0.f ) ) );
+	float3 lightUp = Normalize( Cross( LightDir, lightSide ) );
+	std::default_random_engine engine( samplesPerAxis );
+	uint32_t samples = samplesPerAxis * samplesPerAxis;
+	std::vector<float2> shuffled( samples );
+	std::vector<OcclusionRay> rays;
+	rays.reserve( points.size() * samples );
+	for( size_t i = 0; i < points.size(); i++ ) {
+		const float2* p = table ? table + ( i % SAMPLE_TABLE_SETS ) * SAMPLE_TABLE_SIZE + GetSampleTableOffset( samplesPerAxis ) : shuffled.data();
+		if( !table )
+			GetShuffledSamples( samplesPerAxis, engine, shuffled.data() );
+		for( uint32_t k = 0; k < samples; k++ ) {
+			OcclusionRay ray = points[i];
+			ray.Direction = Normalize( LightDir + ( p[k].x * 2.f - 1.f ) * jitterRadius * lightSide + ( p[k].y * 2.f - 1.f ) * jitterRadius * lightUp );
+			rays.push_back( ray );
+		}
+	}
+	std::vector<OcclusionHit> hits;
+	query.TraceBatch( rays, hits );
+
+	occlusion.assign( points.size(), 0.f );
+	for( size_t i = 0; i < hits.size(); i++ )
+		occlusion[i / samples] += hits[i].Hit ? 1.f / samples : 0.f;
+}
+
+// error of both sample patterns against the reference for each number of rays, SAMPLE_TABLE should converge as fast as the shuffle
+void RunPatternTest( const OcclusionQuery& query, const std::vector<OcclusionRay>& points, float jitterRadius ) {
+	std::vector<float> reference;
+	TraceJittered( query, points, PatternReferenceSamples, jitterRadius, reference );
+	std::vector<float2> table( SAMPLE_TABLE_SETS * SAMPLE_TABLE_SIZE );
+	ComputeSampleTable( table.data() );
+
+	std::wcout << L"Sample patterns against " << PatternReferenceSamples * PatternReferenceSamples << L" jittered rays per point:" << std::endl;
+	std::vector<float> occlusion;
+	for( uint32_t samples : PatternSamples ) {
+		TracePattern( query, points, samples, jitterRadius, nullptr, occlusion );
+		ImageDiff shuffleDiff = CompareImages( reference.data(), occlusion.data(), points.size() );
+		TracePattern( query, points, samples, jitterRadius, table.data(), occlusion );
+		ImageDiff tableDiff = CompareImages( reference.data(), occlusion.data(), points.size() );
+		std::wcout << std::setw( 4 ) << samples * samples << L" rays: shuffle rmse " << std::setw( 6 ) << shuffleDiff.Rmse << L", psnr " << std::setw( 7 ) << shuffleDiff.Psnr
+			<< L", table rmse " << std::setw( 6 ) << tableDiff.Rmse << L", psnr " << std::setw( 7 ) << tableDiff.Psnr << std::endl;
+	}
+}
+
+// seconds of the fastest run
+float TimeSoftBatch( const OcclusionQuery& query, const std::vector<OcclusionRay>& points, float lightAngle, SoftShadowMethod method, std::vector<float>& occlusion ) {
+	occlusion.resize( points.size() );
+	float best = FLT_MAX;
+	for( uint32_t run = 0; run < BenchmarkRuns; run++ ) {
+		float start = Game::GetTime().GetRealTime();
+		query.TraceSoftBatch( points.data(), occlusion.data(), points.size(), lightAngle, method );
+		best = Min( best, Game::GetTime().GetRealTime() - start );
+	}
+	return best;
+}
+
+void PrintSoftError( const std::wstring& title, const std::vector<float>& reference, const std::vector<float>& occlusion, float time ) {
+	double absError = 0.0, bias = 0.0;
+	for( size_t i = 0; i < reference.size(); i++ ) {
+		double error = occlusion[i] - reference[i];
+		absError += abs( error );
+		bias += error;
+	}
+	double numPoints = static_cast<double>( reference.size() );
+	ImageDiff diff = CompareImages( reference.data(), occlusion.data(), reference.size() );
+	std::wcout << title << L" mean error " << std::setw( 6 ) << absError / numPoints << L", rmse " << std::setw( 6 ) << diff.Rmse << L", psnr " << std::setw( 7 ) << diff.Psnr
+		<< L", max error " << std::setw( 6 ) << diff.MaxError << L", bias " << std::setw( 7 ) << bias / numPoints << L", Mpoints/s " << std::setw( 8 ) << numPoints / time / 1e6 << std::endl;
+}
+
+// the shading points are the hits of the view rays moved 2 bricks towards the light like in GetShadowVal of psShadow.hlsl. SmoothTraverse1 runs once with
+// each version of the approximation, as without and with ANISOTROPIC. SmoothTraverse2 is a single ray that the shader averages over frames with TEMPORAL
+void RunSoftShadowTest( const TreeView& tree, uint32_t numPoints, float lightAngle ) {
+	std::wcout << std::fixed << std::setprecision( 4 );
+	OcclusionQuery query( tree );
+	uint32_t numNodes = static_cast<uint32_t>( tree.Nodes.Size );
+	float approxStart = Game::GetTime().GetRealTime();
+	std::vector<float> approx( numNodes );
+	ComputeApproximation( tree.Nodes.Data, numNodes, tree.Pointers.Data, approx.data() );
+	float approxEnd = Game::GetTime().GetRealTime();
+	std::vector<uint32_t> anisotropicApprox( numNodes );
+	ComputeApproximation( tree.Nodes.Data, numNodes, tree.Pointers.Data, anisotropicApprox.data() );
+	float anisotropicEnd = Game::GetTime().GetRealTime();
+	std::wcout << L"Approximation computed in " << ( approxEnd - approxStart ) * 1000.f << L" ms, anisotropic in " << ( anisotropicEnd - approxEnd ) * 1000.f << L" ms" << std::endl;
+
+	std::vector<OcclusionRay> viewRays;
+	GetViewRays( tree, numPoints, viewRays );
+	std::vector<OcclusionHit> viewHits;
+	query.TraceBatch( viewRays, viewHits );
+	std::vector<OcclusionRay> points;
+	float3 offset = 2.f * LightDir * tree.Size / static_cast<float>( query.GetGridResolution().x );
+	for( size_t i = 0; i < viewRays.size(); i++ ) {
+		if( !viewHits[i].Hit )
+			continue;
+		OcclusionRay point;
+		point.Origin = viewRays[i].Origin + viewRays[i].Direction * viewHits[i].Distance + offset;
+		point.Direction = LightDir;
+		points.push_back( point );
+	}
+	if( points.empty() )
+		return;
+
+	float angle = Deg2Rad( lightAngle );
+	float jitterRadius = tan( angle );
+	std::vector<float> reference;
+	float referenceTime = TraceJittered( query, points, ReferenceSamples, jitterRadius, reference );
+	double meanOcclusion = 0.0;
+	for( float value : reference )
+		meanOcclusion += value;
+	std::wcout << points.size() << L" points, light angle " << lightAngle << L" degrees, " << meanOcclusion / points.size() << L" mean occlusion of "
+		<< ReferenceSamples * ReferenceSamples << L" rays per point, " << points.size() / referenceTime / 1e6 << L" Mpoints/s" << std::endl;
+
+	std::vector<float> occlusion;
+	for( uint32_t samples : JitterSamples ) {
+		float time = TraceJittered( query, points, samples, jitterRadius, occlusion );
+		std::wstring title = std::to_wstring( samples * samples ) + L" jittered rays:";
+		title.resize( 20, L' ' );
+		PrintSoftError( title, reference, occlusion, time );
+	}
+
+	Span<float> approxSpan;
+	approxSpan.Data = approx.data();
+	approxSpan.Size = approx.size();
+	query.SetApproximation( approxSpan );
+	PrintSoftError( L"SmoothTraverse1:    ", reference, occlusion, TimeSoftBatch( query, points, angle, SoftShadowMethod::SmoothTraverse1, occlusion ) );
+
+	Span<uint32_t> anisotropicSpan;
+	anisotropicSpan.Data = anisotropicApprox.data();
+	anisotropicSpan.Size = anisotropicApprox.size();
+	query.SetApproximation( anisotropicSpan );
+	PrintSoftError( L"  ANISOTROPIC:      ", reference, occlusion, TimeSoftBatch( query, points, angle, SoftShadowMethod::SmoothTraverse1, occlusion ) );
+
+	PrintSoftError( L"SmoothTraverse2:    ", reference, occlusion, TimeSoftBatch( query, points, angle, SoftShadowMethod::SmoothTraverse2, occlusion ) );
+
+	RunPatternTest( query, points, jitterRadius );
+}
+
+// the recorded rays with the traversal defines they were recorded with, hits have to match and so do the steps of a hit
+bool RunTraversalCheck( const TreeView& tree, const TraversalVectors& vectors ) {
+	OcclusionQuery query( tree );
+	query.SetShortStack( vectors.ShortStack );
+	std::vector<uint4> distances;
+	if( vectors.EmptyDistance ) {
+		distances.resize( tree.Nodes.Size );
+		ComputeEmptyDistances( tree.Nodes.Data, static_cast<uint32_t>( tree.Nodes.Size ), distances.data() );
+		Span<uint4> emptyDistances;
+		emptyDistances.Data = distances.data();
+		emptyDistances.Size = distances.size();
+		query.SetEmptyDistances( emptyDistances );
+	}
+
+	size_t numHits = 0, hitMismatches = 0, stepMismatches = 0;
+	for( size_t i = 0; i < vectors.Vectors.size(); i++ ) {
+		const TraversalVector& vector = vectors.Vectors[i];
+		OcclusionHit hit = query.TraceGrid( vector.Pos, vector.Dir );
+		numHits += vector.Hit ? 1 : 0;
+		bool hitMismatch = hit.Hit != vector.Hit;
+		bool stepMismatch = !hitMismatch && hit.Hit && hit.Steps != vector.Steps;
+		if( !hitMismatch && !stepMismatch )
+			continue;
+		if( hitMismatches + stepMismatches < PrintedMismatches ) {
+			std::wcout << L"  ray " << i << L" (" << vector.Pos.x << L", " << vector.Pos.y << L", " << vector.Pos.z << L") -> (" << vector.Dir.x << L", " << vector.Dir.y
+				<< L", " << vector.Dir.z << L"): recorded " << ( vector.Hit ? L"hit after " + std::to_wstring( vector.Steps ) + L" steps" : std::wstring( L"miss" ) )
+				<< L", OcclusionQuery " << ( hit.Hit ? L"hit after " + std::to_wstring( hit.Steps ) + L" steps" : std::wstring( L"miss" ) ) << std::endl;
+		}
+		hitMismatches += hitMismatch ? 1 : 0;
+		stepMismatches += stepMismatch ? 1 : 0;
+	}
+	std::wcout << vectors.Vectors.size() << L" rays recorded by \"" << vectors.Source << L"\" on \"" << vectors.TreeFile << L"\", short stack " << vectors.ShortStack
+		<< L", empty distances " << vectors.EmptyDistance << L", " << numHits << L" hits: " << hitMismatches << L" different hits, " << stepMismatches
+		<< L" different step counts" << std::endl;
+	return hitMismatches == 0 && stepMismatches == 0;
+}
+
+int wmain( int argc, wchar_t *argv[] ) {
+	Logger::InitMainLogger();
+	Time::Init();
+
+	if( argc < 2 || std::wstring( argv[1] ) == L"-h" || std::wstring( argv[1] ) == L"--help" ) {
+		PrintHelp( argv[0] );
+		return 1;
+	}
+
+	bool success = true;
+	uint32_t benchmarkRays = 0;
+	uint32_t softShadowPoints = 0;
+	float lightAngle = 5.f;
+	TraversalVectors vectors;
+	bool checkVectors = false;
+	for( int i = 1; i < argc; i++ ) {
+		std::wstring fileName = argv[i];
+		if( fileName == L"-b" ) {
+			benchmarkRays = i + 1 < argc ? wcstoul( argv[++i], nullptr, 10 ) : 0;
+			if( benchmarkRays == 0 ) {
+				PrintHelp( argv[0] );
+				return 1;
+			}
+			continue;
+		}
+		if( fileName == L"-s" ) {
+			softShadowPoints = i + 1 < argc ? wcstoul( argv[++i], nullptr, 10 ) : 0;
+			if( softShadowPoints == 0 ) {
+				PrintHelp( argv[0] );
+				return 1;
+			}
+			continue;
+		}
+		if( fileName == L"-a" ) {
+			lightAngle = i + 1 < argc ? wcstof( argv[++i], nullptr ) : -1.f;
+			if( !( lightAngle >= 0.f ) ) {
+				PrintHelp( argv[0] );
+				return 1;
+			}
+			continue;
+		}
+		if( fileName == L"-v" ) {
+			if( i + 1 >= argc ) {
+				PrintHelp( argv[0] );
+				return 1;
+			}
+			if( !LoadTraversalVectors( argv[++i], vectors ) )
+				return 1;
+			checkVectors = true;
+			continue;
+		}
+
+		float start = Game::GetTime().GetRealTime();
+		MappedFile file;
+		TreeView tree;
+		if( !MapTreeFile( fileName, file, tree ) ) {
+			success = false;
+			continue;
+		}
+		float mapped = Game::GetTime().GetRealTime();
+
+		if( checkVectors ) {
+			Game::GetLogger().Log( L"TreeInspector", L"\"" + fileName + L"\": resolution " + std::to_wstring( tree.Resolution ) + L", loaded in "
+								   + std::to_wstring( ( mapped - start ) * 1000.f ) + L" ms" );
+			success = RunTraversalCheck( tree, vectors ) && success;
+			std::wcout << std::endl;
+			continue;
+		}
+		if( benchmarkRays > 0 ) {
+			Game::GetLogger().Log( L"TreeInspector", L"\"" + fileName + L"\": resolution " + std::to_wstring( tree.Resolution ) + L", loaded in "
+								   + std::to_wstring( ( mapped - start ) * 1000.f ) + L" ms" );
+			RunBenchmark( tree, benchmarkRays );
+			std::wcout << std::endl;
+			continue;
+		}
+		if( softShadowPoints > 0 ) {
+			Game::GetLogger().Log( L"TreeInspector", L"\"" + fileName + L"\": resolution " + std::to_wstring( tree.Resolution ) + L", loaded in "
+								   + std::to_wstring( ( mapped - start ) * 1000.f ) + L" ms" );
+			RunSoftShadowTest( tree, softShadowPoints, lightAngle );
+			std::wcout << std::endl;
+			continue;
+		}
+
+		TreeStats stats;
+		ComputeTreeStats( tree, stats );
+		float end = Game::GetTime().GetRealTime();
+
+		Game::GetLogger().Log( L"TreeInspector", L"\"" + fileName + L"\": resolution " + std::to_wstring( tree.Resolution ) + L", " + std::to_wstring( tree.Nodes.Size )
+							   + L" nodes, " + std::to_wstring( tree.Pointers.Size ) + L" pointers, loaded in " + std::to_wstring( ( mapped - start ) * 1000.f )
+							   + L" ms, analyzed in " + std::to_wstring( ( end - mapped ) * 1000.f ) + L" ms" );
+		PrintStats( tree, stats );
+		std::wcout << std::endl;
+	}
+	return success ? 0 : 1;
+}